@@ -0,0 +1,742 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+
+This file is part of Quake III Arena source code.
+
+Quake III Arena source code is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Quake III Arena source code is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Quake III Arena source code; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+===========================================================================
+*/
+// cl_bench.c -- timedemo benchmark runs with frame time statistics
+
+#include "client.h"
+
+#define JSON_IMPLEMENTATION
+#include "../qcommon/json.h"
+#undef JSON_IMPLEMENTATION
+
+/*
+==============================================================================
+
+\benchmark <demo> [demo ...] plays every demo bench_warmup times untimed and
+bench_repeats times with per-frame recording, all in timedemo mode.
+
+Each recorded frame keeps the wall time since the previous client frame and
+the renderer front end and back end msec reported by re.EndFrame. A run is
+reduced to min/avg/p50/p95/p99 and the 1% low (mean of the slowest 1% of
+frames) for each of them, a demo reports the median of its runs.
+
+The report goes to bench_report as JSON. When bench_baseline names an older
+report, demos found in both are compared and every total frame time stat
+that got slower by more than bench_threshold percent is flagged.
+
+==============================================================================
+*/
+
+#define BENCH_MAX_DEMOS		16
+#define BENCH_MAX_REPEATS	16
+#define BENCH_MAX_FRAMES	65536	// per run, the rest of a longer demo is not recorded
+#define BENCH_START_FRAMES	10		// client frames a queued demo may take to start
+
+typedef enum {
+	BENCH_TOTAL,
+	BENCH_FRONTEND,
+	BENCH_BACKEND,
+	BENCH_NUM_TIMES
+} benchTime_t;
+
+typedef enum {
+	BENCH_MIN,
+	BENCH_AVG,
+	BENCH_P50,
+	BENCH_P95,
+	BENCH_P99,
+	BENCH_LOW1,
+	BENCH_NUM_STATS
+} benchStat_t;
+
+static const char *benchTimeNames[ BENCH_NUM_TIMES ] = { "total", "front", "back" };
+static const char *benchStatNames[ BENCH_NUM_STATS ] = { "min", "avg", "p50", "p95", "p99", "low1" };
+
+typedef struct {
+	int			usec[ BENCH_NUM_TIMES ];
+} benchFrame_t;
+
+typedef struct {
+	int			frames;
+	int			msec;
+	double		fps;
+	double		stats[ BENCH_NUM_TIMES ][ BENCH_NUM_STATS ];	// msec
+} benchRun_t;
+
+typedef struct {
+	char		name[ MAX_QPATH ];
+	benchRun_t	runs[ BENCH_MAX_REPEATS ];
+	int			numRuns;
+	benchRun_t	summary;
+	int			regressions;
+} benchDemo_t;
+
+static struct {
+	bool		active;
+
+	benchDemo_t	demos[ BENCH_MAX_DEMOS ];
+	int			numDemos;
+	int			warmup;
+	int			repeats;
+
+	// current run
+	int			demo;
+	int			run;			// warm-up runs come first
+	int			waitFrames;		// since the demo command was queued
+	bool		recording;
+	int64_t		lastFrameTime;
+
+	benchFrame_t *frames;
+	int			numFrames;
+	bool		truncated;
+
+	char		savedTimedemo[ MAX_CVAR_VALUE_STRING ];
+} bench;
+
+static cvar_t *bench_warmup;
+static cvar_t *bench_repeats;
+static cvar_t *bench_report;
+static cvar_t *bench_baseline;
+static cvar_t *bench_threshold;
+
+
+/*
+=================
+CL_BenchRecording
+
+re.EndFrame only reports front and back end times when asked for them
+=================
+*/
+bool CL_BenchRecording( void ) {
+	return bench.recording;
+}
+
+
+/*
+=================
+CL_BenchStartRun
+=================
+*/
+static void CL_BenchStartRun( void ) {
+	const benchDemo_t *d = &bench.demos[ bench.demo ];
+
+	if ( bench.run < bench.warmup ) {
+		Com_Printf( "benchmark: %s warm-up %i/%i\n", d->name, bench.run + 1, bench.warmup );
+	} else {
+		Com_Printf( "benchmark: %s run %i/%i\n", d->name, bench.run - bench.warmup + 1, bench.repeats );
+	}
+
+	bench.recording = false;
+	bench.numFrames = 0;
+	bench.truncated = false;
+	bench.lastFrameTime = 0;
+	bench.waitFrames = 0;
+
+	Cbuf_AddText( va( "demo \"%s\"\n", d->name ) );
+}
+
+
+/*
+=================
+CL_BenchStop
+=================
+*/
+static void CL_BenchStop( void ) {
+	if ( bench.frames ) {
+		Z_Free( bench.frames );
+		bench.frames = NULL;
+	}
+
+	Cvar_Set( "timedemo", bench.savedTimedemo );
+
+	bench.active = false;
+	bench.recording = false;
+}
+
+
+/*
+=================
+CL_BenchSortInts
+=================
+*/
+static int QDECL CL_BenchSortInts( const void *a, const void *b ) {
+	return *(const int *)a - *(const int *)b;
+}
+
+
+/*
+=================
+CL_BenchSortDoubles
+=================
+*/
+static int QDECL CL_BenchSortDoubles( const void *a, const void *b ) {
+	const double x = *(const double *)a;
+	const double y = *(const double *)b;
+
+	return x < y ? -1 : ( x > y ? 1 : 0 );
+}
+
+
+/*
+=================
+CL_BenchPercentile
+
+Nearest rank on sorted samples
+=================
+*/
+static int CL_BenchPercentile( const int *sorted, int count, int percent ) {
+	int rank;
+
+	rank = ( count * percent + 99 ) / 100;
+	if ( rank < 1 ) {
+		rank = 1;
+	}
+
+	return sorted[ rank - 1 ];
+}
+
+
+/*
+=================
+CL_BenchReduceRun
+=================
+*/
+static void CL_BenchReduceRun( benchRun_t *run ) {
+	int *samples;
+	int64_t sum;
+	int i, t, slowest;
+
+	if ( bench.numFrames == 0 ) {
+		return;
+	}
+
+	samples = Z_Malloc( bench.numFrames * sizeof( *samples ) );
+	slowest = bench.numFrames / 100;
+	if ( slowest < 1 ) {
+		slowest = 1;
+	}
+
+	for ( t = 0; t < BENCH_NUM_TIMES; t++ ) {
+		for ( i = 0, sum = 0; i < bench.numFrames; i++ ) {
+			samples[ i ] = bench.frames[ i ].usec[ t ];
+			sum += samples[ i ];
+		}
+
+		qsort( samples, bench.numFrames, sizeof( *samples ), CL_BenchSortInts );
+
+		run->stats[ t ][ BENCH_MIN ] = samples[ 0 ] / 1000.0;
+		run->stats[ t ][ BENCH_AVG ] = (double)sum / bench.numFrames / 1000.0;
+		run->stats[ t ][ BENCH_P50 ] = CL_BenchPercentile( samples, bench.numFrames, 50 ) / 1000.0;
+		run->stats[ t ][ BENCH_P95 ] = CL_BenchPercentile( samples, bench.numFrames, 95 ) / 1000.0;
+		run->stats[ t ][ BENCH_P99 ] = CL_BenchPercentile( samples, bench.numFrames, 99 ) / 1000.0;
+
+		for ( i = bench.numFrames - slowest, sum = 0; i < bench.numFrames; i++ ) {
+			sum += samples[ i ];
+		}
+		run->stats[ t ][ BENCH_LOW1 ] = (double)sum / slowest / 1000.0;
+	}
+
+	Z_Free( samples );
+}
+
+
+/*
+=================
+CL_BenchMedian
+=================
+*/
+static double CL_BenchMedian( double *values, int count ) {
+	qsort( values, count, sizeof( *values ), CL_BenchSortDoubles );
+
+	if ( count & 1 ) {
+		return values[ count / 2 ];
+	}
+
+	return ( values[ count / 2 - 1 ] + values[ count / 2 ] ) * 0.5;
+}
+
+
+/*
+=================
+CL_BenchSummarize
+
+Median of the runs for every field, single slow runs do not skew the result
+=================
+*/
+static void CL_BenchSummarize( benchDemo_t *d ) {
+	double values[ BENCH_MAX_REPEATS ];
+	benchRun_t *s = &d->summary;
+	int i, t, n;
+
+	if ( d->numRuns == 0 ) {
+		return;
+	}
+
+	for ( i = 0; i < d->numRuns; i++ ) values[ i ] = d->runs[ i ].frames;
+	s->frames = (int)CL_BenchMedian( values, d->numRuns );
+
+	for ( i = 0; i < d->numRuns; i++ ) values[ i ] = d->runs[ i ].msec;
+	s->msec = (int)CL_BenchMedian( values, d->numRuns );
+
+	for ( i = 0; i < d->numRuns; i++ ) values[ i ] = d->runs[ i ].fps;
+	s->fps = CL_BenchMedian( values, d->numRuns );
+
+	for ( t = 0; t < BENCH_NUM_TIMES; t++ ) {
+		for ( n = 0; n < BENCH_NUM_STATS; n++ ) {
+			for ( i = 0; i < d->numRuns; i++ ) {
+				values[ i ] = d->runs[ i ].stats[ t ][ n ];
+			}
+			s->stats[ t ][ n ] = CL_BenchMedian( values, d->numRuns );
+		}
+	}
+}
+
+
+/*
+=================
+CL_BenchEscape
+
+Quotes a string for the report, json.h hands string values back still escaped
+=================
+*/
+static const char *CL_BenchEscape( const char *in, char *out, int outSize ) {
+	char *o = out, *end = out + outSize - 1;
+	const char *esc;
+
+	for ( ; *in && o < end; in++ ) {
+		esc = NULL;
+		switch ( *in ) {
+			case '"': esc = "\\\""; break;
+			case '\\': esc = "\\\\"; break;
+			default: break;
+		}
+		if ( esc ) {
+			if ( o + 2 > end ) {
+				break;
+			}
+			*o++ = esc[0];
+			*o++ = esc[1];
+		} else if ( (unsigned char)*in < ' ' ) {
+			if ( o + 6 > end ) {
+				break;
+			}
+			o += Com_sprintf( o, end - o + 1, "\\u%04x", (unsigned char)*in );
+		} else {
+			*o++ = *in;
+		}
+	}
+	*o = '\0';
+
+	return out;
+}
+
+
+/*
+=================
+CL_BenchCompare
+
+Flags total frame time stats that got slower than the baseline allows
+=================
+*/
+static int CL_BenchCompare( const char *filename, float threshold ) {
+	const char *json, *jsonEnd, *demos, *demo, *value, *times;
+	char name[ MAX_QPATH * 6 ], quoted[ MAX_QPATH * 6 ];
+	void *buffer;
+	double base, cur;
+	int len, i, n, regressions, matched;
+
+	len = FS_ReadFile( filename, &buffer );
+	if ( len <= 0 || !buffer ) {
+		Com_Printf( S_COLOR_YELLOW "benchmark: couldn't read baseline %s\n", filename );
+		return 0;
+	}
+
+	json = (const char *)buffer;
+	jsonEnd = json + len;
+
+	demos = JSON_ObjectGetNamedValue( json, jsonEnd, "demos" );
+	if ( JSON_ValueGetType( demos, jsonEnd ) != JSONTYPE_ARRAY ) {
+		Com_Printf( S_COLOR_YELLOW "benchmark: %s is not a benchmark report\n", filename );
+		FS_FreeFile( buffer );
+		return 0;
+	}
+
+	regressions = 0;
+	matched = 0;
+
+	for ( demo = JSON_ArrayGetFirstValue( demos, jsonEnd ); demo; demo = JSON_ArrayGetNextValue( demo, jsonEnd ) ) {
+		JSON_ValueGetString( JSON_ObjectGetNamedValue( demo, jsonEnd, "name" ), jsonEnd, name, sizeof( name ) );
+
+		for ( i = 0; i < bench.numDemos; i++ ) {
+			if ( bench.demos[ i ].numRuns && !Q_stricmp( CL_BenchEscape( bench.demos[ i ].name, quoted, sizeof( quoted ) ), name ) ) {
+				break;
+			}
+		}
+		if ( i == bench.numDemos ) {
+			continue;
+		}
+
+		times = JSON_ObjectGetNamedValue( demo, jsonEnd, benchTimeNames[ BENCH_TOTAL ] );
+		if ( JSON_ValueGetType( times, jsonEnd ) != JSONTYPE_OBJECT ) {
+			continue;
+		}
+
+		matched++;
+
+		for ( n = BENCH_AVG; n < BENCH_NUM_STATS; n++ ) {
+			value = JSON_ObjectGetNamedValue( times, jsonEnd, benchStatNames[ n ] );
+			if ( !value ) {
+				continue;
+			}
+			base = JSON_ValueGetDouble( value, jsonEnd );
+			cur = bench.demos[ i ].summary.stats[ BENCH_TOTAL ][ n ];
+			if ( base > 0.0 && cur > base * ( 1.0 + threshold / 100.0 ) ) {
+				Com_Printf( S_COLOR_RED "REGRESSION" S_COLOR_WHITE " %s: total %s %.3f -> %.3f msec (+%.1f%%)\n",
+					bench.demos[ i ].name, benchStatNames[ n ], base, cur, ( cur / base - 1.0 ) * 100.0 );
+				bench.demos[ i ].regressions++;
+				regressions++;
+			}
+		}
+	}
+
+	FS_FreeFile( buffer );
+
+	Com_Printf( "benchmark: %i of %i demos compared with %s, %i regressions over %g%%\n",
+		matched, bench.numDemos, filename, regressions, threshold );
+
+	return regressions;
+}
+
+
+/*
+=================
+CL_BenchWriteRun
+=================
+*/
+static void CL_BenchWriteRun( fileHandle_t f, const benchRun_t *run ) {
+	int t, n;
+
+	FS_Printf( f, "\"frames\":%i,\"msec\":%i,\"fps\":%.2f", run->frames, run->msec, run->fps );
+
+	for ( t = 0; t < BENCH_NUM_TIMES; t++ ) {
+		FS_Printf( f, ",\"%s\":{", benchTimeNames[ t ] );
+		for ( n = 0; n < BENCH_NUM_STATS; n++ ) {
+			FS_Printf( f, "%s\"%s\":%.3f", n ? "," : "", benchStatNames[ n ], run->stats[ t ][ n ] );
+		}
+		FS_Printf( f, "}" );
+	}
+}
+
+
+/*
+=================
+CL_BenchWriteReport
+=================
+*/
+static void CL_BenchWriteReport( const char *filename, int regressions ) {
+	const benchDemo_t *d;
+	fileHandle_t f;
+	char quoted[ MAX_STRING_CHARS ];
+	int i, r;
+
+	f = FS_FOpenFileWrite( filename );
+	if ( f == FS_INVALID_HANDLE ) {
+		Com_Printf( S_COLOR_YELLOW "benchmark: couldn't open %s for writing\n", filename );
+		return;
+	}
+
+	FS_Printf( f, "{\"version\":1,\"renderer\":\"%s\",\"width\":%i,\"height\":%i,\"warmup\":%i,\"repeats\":%i,\"regressions\":%i,\n\"demos\":[\n",
+		CL_BenchEscape( cls.glconfig.renderer_string, quoted, sizeof( quoted ) ), cls.glconfig.vidWidth, cls.glconfig.vidHeight, bench.warmup, bench.repeats, regressions );
+
+	for ( i = 0; i < bench.numDemos; i++ ) {
+		d = &bench.demos[ i ];
+		FS_Printf( f, "%s{\"name\":\"%s\",\"regressions\":%i,", i ? ",\n" : "", CL_BenchEscape( d->name, quoted, sizeof( quoted ) ), d->regressions );
+		CL_BenchWriteRun( f, &d->summary );
+		FS_Printf( f, ",\n \"runs\":[" );
+		for ( r = 0; r < d->numRuns; r++ ) {
+			FS_Printf( f, "%s\n  {", r ? "," : "" );
+			CL_BenchWriteRun( f, &d->runs[ r ] );
+			FS_Printf( f, "}" );
+		}
+		FS_Printf( f, "]}" );
+	}
+
+	FS_Printf( f, "\n]}\n" );
+	FS_FCloseFile( f );
+
+	Com_Printf( "benchmark: wrote %s\n", filename );
+}
+
+
+/*
+=================
+CL_BenchFinish
+=================
+*/
+static void CL_BenchFinish( void ) {
+	char filename[ MAX_QPATH ];
+	const benchRun_t *s;
+	int i, regressions;
+
+	Com_Printf( "----- benchmark results (msec) -----\n" );
+	Com_Printf( "%-24s %8s %7s %7s %7s %7s %7s %7s %7s\n", "demo", "fps", "avg", "p50", "p95", "p99", "low1", "front", "back" );
+
+	for ( i = 0; i < bench.numDemos; i++ ) {
+		CL_BenchSummarize( &bench.demos[ i ] );
+		s = &bench.demos[ i ].summary;
+		Com_Printf( "%-24s %8.1f %7.2f %7.2f %7.2f %7.2f %7.2f %7.2f %7.2f\n", bench.demos[ i ].name, s->fps,
+			s->stats[ BENCH_TOTAL ][ BENCH_AVG ], s->stats[ BENCH_TOTAL ][ BENCH_P50 ], s->stats[ BENCH_TOTAL ][ BENCH_P95 ],
+			s->stats[ BENCH_TOTAL ][ BENCH_P99 ], s->stats[ BENCH_TOTAL ][ BENCH_LOW1 ],
+			s->stats[ BENCH_FRONTEND ][ BENCH_AVG ], s->stats[ BENCH_BACKEND ][ BENCH_AVG ] );
+	}
+
+	regressions = 0;
+	if ( bench_baseline->string[0] ) {
+		Q_strncpyz( filename, bench_baseline->string, sizeof( filename ) );
+		COM_DefaultExtension( filename, sizeof( filename ), ".json" );
+		regressions = CL_BenchCompare( filename, bench_threshold->value );
+	}
+
+	Q_strncpyz( filename, bench_report->string, sizeof( filename ) );
+	COM_DefaultExtension( filename, sizeof( filename ), ".json" );
+	CL_BenchWriteReport( filename, regressions );
+
+	CL_BenchStop();
+}
+
+
+/*
+=================
+CL_BenchRunCompleted
+
+Called by CL_DemoCompleted before the client disconnects
+=================
+*/
+void CL_BenchRunCompleted( int frames, int msec ) {
+	benchDemo_t *d;
+	benchRun_t *run;
+
+	if ( !bench.active ) {
+		return;
+	}
+
+	d = &bench.demos[ bench.demo ];
+
+	if ( bench.recording ) {
+		bench.recording = false;
+
+		run = &d->runs[ d->numRuns++ ];
+		Com_Memset( run, 0, sizeof( *run ) );
+		run->frames = frames;
+		run->msec = msec;
+		run->fps = msec > 0 ? frames * 1000.0 / msec : 0.0;
+		CL_BenchReduceRun( run );
+
+		Com_Printf( "benchmark: %s avg %.2f p99 %.2f low1 %.2f msec, front %.2f back %.2f%s\n", d->name,
+			run->stats[ BENCH_TOTAL ][ BENCH_AVG ], run->stats[ BENCH_TOTAL ][ BENCH_P99 ], run->stats[ BENCH_TOTAL ][ BENCH_LOW1 ],
+			run->stats[ BENCH_FRONTEND ][ BENCH_AVG ], run->stats[ BENCH_BACKEND ][ BENCH_AVG ],
+			bench.truncated ? va( " (first %i frames)", BENCH_MAX_FRAMES ) : "" );
+	}
+
+	bench.run++;
+}
+
+
+/*
+=================
+CL_BenchNextRun
+
+Called by CL_DemoCompleted after the client disconnected,
+returns false when "nextdemo" may run
+=================
+*/
+bool CL_BenchNextRun( void ) {
+	if ( !bench.active ) {
+		return false;
+	}
+
+	if ( bench.run >= bench.warmup + bench.repeats ) {
+		bench.run = 0;
+		bench.demo++;
+	}
+
+	if ( bench.demo >= bench.numDemos ) {
+		CL_BenchFinish();
+		return false;
+	}
+
+	CL_BenchStartRun();
+	return true;
+}
+
+
+/*
+=================
+CL_BenchFrame
+
+Called once per client frame after the screen has been updated
+=================
+*/
+void CL_BenchFrame( void ) {
+	benchFrame_t *frame;
+	int64_t now;
+
+	if ( !bench.active ) {
+		return;
+	}
+
+	if ( !clc.demoplaying ) {
+		if ( ++bench.waitFrames > BENCH_START_FRAMES ) {
+			Com_Printf( S_COLOR_YELLOW "benchmark: %s is not playing, aborted\n", bench.demos[ bench.demo ].name );
+			CL_BenchStop();
+		}
+		return;
+	}
+
+	bench.waitFrames = 0;
+
+	if ( bench.run < bench.warmup || cls.state != CA_ACTIVE || !clc.timeDemoStart ) {
+		return;
+	}
+
+	now = Sys_Microseconds();
+
+	if ( !bench.recording ) {
+		// the first frame only sets the start time
+		bench.recording = true;
+		bench.lastFrameTime = now;
+		return;
+	}
+
+	if ( bench.numFrames >= BENCH_MAX_FRAMES ) {
+		bench.truncated = true;
+	} else {
+		frame = &bench.frames[ bench.numFrames++ ];
+		frame->usec[ BENCH_TOTAL ] = (int)( now - bench.lastFrameTime );
+		frame->usec[ BENCH_FRONTEND ] = time_frontend;
+		frame->usec[ BENCH_BACKEND ] = time_backend;
+	}
+
+	bench.lastFrameTime = now;
+}
+
+
+/*
+=================
+CL_Benchmark_f
+
+benchmark <demo> [demo ...]
+benchmark stop
+=================
+*/
+static void CL_Benchmark_f( void ) {
+	int i;
+
+	if ( Cmd_Argc() < 2 ) {
+		Com_Printf( "usage: benchmark <demo> [demo ...]\n"
+			"       benchmark stop\n" );
+		if ( bench.active ) {
+			Com_Printf( "running %s, demo %i of %i\n", bench.demos[ bench.demo ].name, bench.demo + 1, bench.numDemos );
+		}
+		return;
+	}
+
+	if ( !Q_stricmp( Cmd_Argv( 1 ), "stop" ) ) {
+		if ( bench.active ) {
+			CL_BenchStop();
+			Com_Printf( "benchmark stopped\n" );
+		}
+		return;
+	}
+
+	if ( bench.active ) {
+		Com_Printf( "benchmark already running, \\benchmark stop first\n" );
+		return;
+	}
+
+	Com_Memset( bench.demos, 0, sizeof( bench.demos ) );
+
+	bench.numDemos = Cmd_Argc() - 1;
+	if ( bench.numDemos > BENCH_MAX_DEMOS ) {
+		Com_Printf( S_COLOR_YELLOW "benchmark: only the first %i demos are used\n", BENCH_MAX_DEMOS );
+		bench.numDemos = BENCH_MAX_DEMOS;
+	}
+
+	for ( i = 0; i < bench.numDemos; i++ ) {
+		Q_strncpyz( bench.demos[ i ].name, Cmd_Argv( i + 1 ), sizeof( bench.demos[ i ].name ) );
+	}
+
+	bench.warmup = bench_warmup->integer;
+	bench.repeats = bench_repeats->integer;
+	bench.demo = 0;
+	bench.run = 0;
+
+	bench.frames = Z_Malloc( BENCH_MAX_FRAMES * sizeof( *bench.frames ) );
+
+	Q_strncpyz( bench.savedTimedemo, com_timedemo->string, sizeof( bench.savedTimedemo ) );
+	Cvar_Set( "timedemo", "1" );
+
+	bench.active = true;
+
+	CL_BenchStartRun();
+}
+
+
+/*
+=================
+CL_BenchInit
+=================
+*/
+void CL_BenchInit( void ) {
+	bench_warmup = Cvar_Get( "bench_warmup", "1", 0 );
+	Cvar_CheckRange( bench_warmup, "0", "8", CV_INTEGER );
+	Cvar_SetDescription( bench_warmup, "Untimed runs of every demo before \\benchmark starts recording." );
+
+	bench_repeats = Cvar_Get( "bench_repeats", "3", 0 );
+	Cvar_CheckRange( bench_repeats, "1", va( "%i", BENCH_MAX_REPEATS ), CV_INTEGER );
+	Cvar_SetDescription( bench_repeats, "Recorded runs of every demo, \\benchmark reports the median of them." );
+
+	bench_report = Cvar_Get( "bench_report", "benchmark", 0 );
+	Cvar_SetDescription( bench_report, "File the \\benchmark report is written to, as JSON." );
+
+	bench_baseline = Cvar_Get( "bench_baseline", "", 0 );
+	Cvar_SetDescription( bench_baseline, "Older \\benchmark report to check the new results against." );
+
+	bench_threshold = Cvar_Get( "bench_threshold", "5", 0 );
+	Cvar_CheckRange( bench_threshold, "0", "100", CV_FLOAT );
+	Cvar_SetDescription( bench_threshold, "Percent a frame time may grow over \\bench_baseline before it counts as a regression." );
+
+	Cmd_AddCommand( "benchmark", CL_Benchmark_f );
+}
+
+
+/*
+=================
+CL_BenchShutdown
+=================
+*/
+void CL_BenchShutdown( void ) {
+	if ( bench.active ) {
+		CL_BenchStop();
+	}
+
+	Cmd_RemoveCommand( "benchmark" );
+}
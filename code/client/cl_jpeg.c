@@ -47,6 +47,7 @@ typedef struct q_jpeg_error_mgr_s
 {
   struct jpeg_error_mgr pub;  /* "public" fields */
   jmp_buf setjmp_buffer;  /* for return to caller */
+  bool quiet;  /* no console output, decoding may run outside of the main thread */
 }
 q_jpeg_error_mgr_t;
 
@@ -58,9 +59,11 @@ static void CL_JPGErrorExit(j_common_ptr cinfo)
 	/* cinfo->err really points to a q_jpeg_error_mgr_s struct, so coerce pointer */
 	q_jpeg_error_mgr_t *jerr = (q_jpeg_error_mgr_t *)cinfo->err;
   
-	(*cinfo->err->format_message)( cinfo, buffer );
-  
-	Com_Printf( "Error: %s", buffer );
+	if ( !jerr->quiet ) {
+		(*cinfo->err->format_message)( cinfo, buffer );
+
+		Com_Printf( "Error: %s", buffer );
+	}
   
 	/* Return control to the setjmp point */
 	Q_longjmp( jerr->setjmp_buffer, 1 );
@@ -70,6 +73,10 @@ static void CL_JPGErrorExit(j_common_ptr cinfo)
 static void CL_JPGOutputMessage(j_common_ptr cinfo)
 {
   char buffer[JMSG_LENGTH_MAX];
+
+  if ( ((q_jpeg_error_mgr_t *)cinfo->err)->quiet ) {
+    return;
+  }
   
   /* Create the message */
   (*cinfo->err->format_message) (cinfo, buffer);
@@ -79,7 +86,15 @@ static void CL_JPGOutputMessage(j_common_ptr cinfo)
 }
 
 
-void CL_LoadJPG( const char *filename, unsigned char **pic, int *width, int *height )
+/*
+ * Decompresses a JPEG held in memory into 32 bit RGBA allocated with alloc().
+ * With filename == NULL nothing is printed and nothing engine-global is touched,
+ * so it can run on any thread. An invalid image format is reported in error
+ * instead of dropping, the caller decides what to do with it.
+ */
+static bool CL_DecompressJPG( const char *filename, const byte *data, int len,
+	void *(*alloc)( int size ), void (*release)( void *ptr ),
+	unsigned char **pic, int *width, int *height, char *error, int errorSize )
 {
 	/* This struct contains the JPEG decompression parameters and pointers to
 	* working space (which is allocated as needed by the JPEG library).
@@ -89,39 +104,15 @@ void CL_LoadJPG( const char *filename, unsigned char **pic, int *width, int *hei
 	* Note that this struct must live as long as the main JPEG parameter
 	* struct, to avoid dangling-pointer problems.
 	*/
-	/* This struct represents a JPEG error handler.  It is declared separately
-	 * because applications often want to supply a specialized error handler
-	 * (see the second half of this file for an example).  But here we just
-	 * take the easy way out and use the standard error handler, which will
-	 * print a message on stderr and call exit() if compression fails.
-	* Note that this struct must live as long as the main JPEG parameter
-	* struct, to avoid dangling-pointer problems.
-	*/
 	q_jpeg_error_mgr_t jerr;
 	/* More stuff */
 	JSAMPARRAY buffer;		/* Output row buffer */
 	unsigned int row_stride;	/* physical row width in output buffer */
 	unsigned int pixelcount, memcount;
 	unsigned int sindex, dindex;
-	byte *out;
-	int len;
-	union {
-		byte *b;
-		void *v;
-	} fbuffer;
+	byte *volatile out = NULL;
 	byte  *buf;
 
-	/* In this example we want to open the input file before doing anything else,
-	 * so that the setjmp() error recovery below can assume the file is open.
-	 * VERY IMPORTANT: use "b" option to fopen() if you are on a machine that
-	 * requires it in order to read binary files.
-	*/
-
-	len = FS_ReadFile( ( char * ) filename, &fbuffer.v );
-	if ( !fbuffer.b || len < 0 ) {
-		return;
-	}
-
 	/* Step 1: allocate and initialize JPEG decompression object */
 
 	/* We have to set up the error handler first, in case the initialization
@@ -132,19 +123,24 @@ void CL_LoadJPG( const char *filename, unsigned char **pic, int *width, int *hei
 	cinfo.err = jpeg_std_error(&jerr.pub);
 	cinfo.err->error_exit = CL_JPGErrorExit;
 	cinfo.err->output_message = CL_JPGOutputMessage;
+	jerr.quiet = ( filename == NULL );
 
 	/* Establish the setjmp return context for R_JPGErrorExit to use. */
 	if ( Q_setjmp( jerr.setjmp_buffer ) )
 	{
 		/* If we get here, the JPEG code has signaled an error.
-		* We need to clean up the JPEG object, close the input file, and return.
+		* We need to clean up the JPEG object and return.
 		*/
 		jpeg_destroy_decompress( &cinfo );
-		FS_FreeFile( fbuffer.v );
+		if ( out ) {
+			release( out );
+		}
 
 		/* Append the filename to the error for easier debugging */
-		Com_Printf( ", loading file %s\n", filename );
-		return;
+		if ( filename ) {
+			Com_Printf( ", loading file %s\n", filename );
+		}
+		return false;
 	}
 
   /* Now we can initialize the JPEG decompression object. */
@@ -152,7 +148,7 @@ void CL_LoadJPG( const char *filename, unsigned char **pic, int *width, int *hei
 
   /* Step 2: specify data source (eg, a file) */
 
-  jpeg_mem_src(&cinfo, fbuffer.b, len);
+  jpeg_mem_src(&cinfo, (unsigned char *)data, len);
 
   /* Step 3: read file parameters with jpeg_read_header() */
 
@@ -193,18 +189,18 @@ void CL_LoadJPG( const char *filename, unsigned char **pic, int *width, int *hei
       || pixelcount > 0x1FFFFFFF || cinfo.output_components != 3
     )
   {
+    Com_sprintf( error, errorSize, "LoadJPG: %s has an invalid image format: %dx%d*4=%d, components: %d", filename ? filename : "",
+		    cinfo.output_width, cinfo.output_height, pixelcount * 4, cinfo.output_components);
+
     // Free the memory to make sure we don't leak memory
-    FS_FreeFile( fbuffer.v );
     jpeg_destroy_decompress(&cinfo);
-  
-    Com_Error( ERR_DROP, "LoadJPG: %s has an invalid image format: %dx%d*4=%d, components: %d", filename,
-		    cinfo.output_width, cinfo.output_height, pixelcount * 4, cinfo.output_components);
+    return false;
   }
 
   memcount = pixelcount * 4;
   row_stride = cinfo.output_width * cinfo.output_components;
 
-  out = Z_Malloc( memcount );
+  out = alloc( memcount );
 
   *width = cinfo.output_width;
   *height = cinfo.output_height;
@@ -253,18 +249,84 @@ void CL_LoadJPG( const char *filename, unsigned char **pic, int *width, int *hei
   /* This is an important step since it will release a good deal of memory. */
   jpeg_destroy_decompress(&cinfo);
 
-  /* After finish_decompress, we can close the input file.
-   * Here we postpone it until after no more JPEG errors are possible,
-   * so as to simplify the setjmp error logic above.  (Actually, I don't
-   * think that jpeg_destroy can do an error exit, but why assume anything...)
-   */
-  FS_FreeFile( fbuffer.v );
-
   /* At this point you may want to check to see whether any corrupt-data
    * warnings occurred (test whether jerr.pub.num_warnings is nonzero).
    */
 
   /* And we're done! */
+  return true;
+}
+
+
+static void *CL_JPGMalloc( int size )
+{
+	return Z_Malloc( size );
+}
+
+
+void CL_LoadJPG( const char *filename, unsigned char **pic, int *width, int *height )
+{
+	char error[MAX_STRING_CHARS];
+	int len;
+	union {
+		byte *b;
+		void *v;
+	} fbuffer;
+
+	/* In this example we want to open the input file before doing anything else,
+	 * so that the setjmp() error recovery below can assume the file is open.
+	 * VERY IMPORTANT: use "b" option to fopen() if you are on a machine that
+	 * requires it in order to read binary files.
+	*/
+
+	len = FS_ReadFile( ( char * ) filename, &fbuffer.v );
+	if ( !fbuffer.b || len < 0 ) {
+		return;
+	}
+
+	error[0] = '\0';
+	if ( !CL_DecompressJPG( filename, fbuffer.b, len, CL_JPGMalloc, Z_Free, pic, width, height, error, sizeof( error ) ) ) {
+		*pic = NULL;
+	}
+
+	/* After finish_decompress, we can close the input file.
+	 * Here we postpone it until after no more JPEG errors are possible,
+	 * so as to simplify the setjmp error logic above.  (Actually, I don't
+	 * think that jpeg_destroy can do an error exit, but why assume anything...)
+	 */
+	FS_FreeFile( fbuffer.v );
+
+	if ( error[0] ) {
+		Com_Error( ERR_DROP, "%s", error );
+	}
+}
+
+
+/*
+=================
+CL_DecodeJPG
+
+Thread-safe variant for the renderer: decodes a file that was already read
+into memory, output is allocated with alloc() and nothing is printed.
+=================
+*/
+bool CL_DecodeJPG( const byte *data, int len, void *(*alloc)( int size ), void (*release)( void *ptr ), unsigned char **pic, int *width, int *height )
+{
+	char error[MAX_STRING_CHARS];
+
+	*pic = NULL;
+
+	if ( !data || len <= 0 ) {
+		return false;
+	}
+
+	error[0] = '\0';
+	if ( !CL_DecompressJPG( NULL, data, len, alloc, release, pic, width, height, error, sizeof( error ) ) ) {
+		*pic = NULL;
+		return false;
+	}
+
+	return true;
 }
 
 
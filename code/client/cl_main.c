@@ -689,10 +689,13 @@ static void CL_DemoCompleted( void ) {
 			Com_Printf( "%i frames, %3.*f seconds: %3.1f fps\n", clc.timeDemoFrames,
 			time > 10000 ? 1 : 2, time/1000.0, clc.timeDemoFrames*1000.0 / time );
 		}
+		CL_BenchRunCompleted( clc.timeDemoFrames, time );
 	}
 
 	CL_Disconnect( true );
-	CL_NextDemo();
+	if ( !CL_BenchNextRun() ) {
+		CL_NextDemo();
+	}
 }
 
 
@@ -3112,6 +3115,8 @@ void CL_Frame( int msec, int realMsec ) {
 	cls.framecount++;
 	SCR_UpdateScreen();
 
+	CL_BenchFrame();
+
 	// update audio
 	S_Update( realMsec );
 
@@ -3354,6 +3359,9 @@ CL_InitRef
 ============
 */
 static void CL_InitRef( void ) {
+#ifndef USE_PROFILER
+	static const int cl_profilingOff = 0;
+#endif
 	refimport_t	rimp;
 	refexport_t	*ret;
 #ifdef USE_RENDERER_DLOPEN
@@ -3409,6 +3417,13 @@ static void CL_InitRef( void ) {
 	rimp.Error = Com_Error;
 	rimp.Milliseconds = CL_ScaledMilliseconds;
 	rimp.Microseconds = Sys_Microseconds;
+#ifdef USE_PROFILER
+	rimp.profiling = &com_profiling;
+#else
+	rimp.profiling = &cl_profilingOff;
+#endif
+	rimp.ProfBegin = Com_ProfBegin;
+	rimp.ProfEnd = Com_ProfEnd;
 	rimp.Malloc = CL_RefMalloc;
 	rimp.FreeAll = CL_RefFreeAll;
 	rimp.Free = Z_Free;
@@ -3454,6 +3469,7 @@ static void CL_InitRef( void ) {
 	rimp.CL_SaveJPGToBuffer = CL_SaveJPGToBuffer;
 	rimp.CL_SaveJPG = CL_SaveJPG;
 	rimp.CL_LoadJPG = CL_LoadJPG;
+	rimp.CL_DecodeJPG = CL_DecodeJPG;
 
 	rimp.CL_IsMinimized = CL_IsMininized;
 	rimp.CL_SetScaling = CL_SetScaling;
@@ -4032,6 +4048,8 @@ void CL_Init( void ) {
 #endif
 	Cmd_AddCommand( "modelist", CL_ModeList_f );
 
+	CL_BenchInit();
+
 	Cvar_Set( "cl_running", "1" );
 #ifdef USE_MD5
 	CL_GenerateQKey();
@@ -4105,6 +4123,8 @@ void CL_Shutdown( const char *finalmsg, bool quit ) {
 	Cmd_RemoveCommand ("systeminfo");
 	Cmd_RemoveCommand ("modelist");
 
+	CL_BenchShutdown();
+
 #ifdef USE_CURL
 	Com_DL_Cleanup( &download );
 
@@ -593,12 +593,23 @@ void CL_WriteAVIAudioFrame( const byte *pcmBuffer, int size );
 bool CL_CloseAVI( bool reopen );
 bool CL_VideoRecording( void );
 
+//
+// cl_bench.c
+//
+void CL_BenchInit( void );
+void CL_BenchShutdown( void );
+void CL_BenchFrame( void );
+bool CL_BenchRecording( void );
+void CL_BenchRunCompleted( int frames, int msec );
+bool CL_BenchNextRun( void );
+
 //
 // cl_jpeg.c
 //
 size_t	CL_SaveJPGToBuffer( byte *buffer, size_t bufSize, int quality, int image_width, int image_height, byte *image_buffer, int padding );
 void	CL_SaveJPG( const char *filename, int quality, int image_width, int image_height, byte *image_buffer, int padding );
 void	CL_LoadJPG( const char *filename, unsigned char **pic, int *width, int *height );
+bool	CL_DecodeJPG( const byte *data, int len, void *(*alloc)( int size ), void (*release)( void *ptr ), unsigned char **pic, int *width, int *height );
 
 
 // base backend functions
@@ -234,7 +234,9 @@ S_Update
 void S_Update( int msec )
 {
 	if ( si.Update ) {
+		PROF_BEGIN( "S_Update" );
 		si.Update( msec );
+		PROF_END();
 	}
 }
 
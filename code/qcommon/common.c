@@ -106,8 +106,8 @@ cvar_t	*com_noErrorInterrupt;
 
 // com_speeds times
 int		time_game;
-int		time_frontend;		// renderer frontend time
-int		time_backend;		// renderer backend time
+int		time_frontend;		// renderer frontend time, usec
+int		time_backend;		// renderer backend time, usec
 
 static int	lastTime;
 int			com_frameTime;
@@ -3945,10 +3945,15 @@ void Com_Init( char *commandLine ) {
 
 	Cmd_AddCommand( "quit", Com_Quit_f );
 	Cmd_AddCommand( "changeVectors", MSG_ReportChangeVectors_f );
+	Cmd_AddCommand( "huffbench", Huffman_Bench_f );
 	Cmd_AddCommand( "writeconfig", Com_WriteConfig_f );
 	Cmd_SetCommandCompletionFunc( "writeconfig", Cmd_CompleteWriteCfgName );
 	Cmd_AddCommand( "game_restart", Com_GameRestart_f );
 
+#ifdef USE_PROFILER
+	Com_ProfInit();
+#endif
+
 	s = va( "%s %s %s", Q3_VERSION, PLATFORM_STRING, __DATE__ );
 	com_version = Cvar_Get( "version", s, CVAR_PROTECTED | CVAR_ROM | CVAR_SERVERINFO );
 	Cvar_SetDescription( com_version, "Read-only CVAR to see the version of the game." );
@@ -4230,9 +4235,17 @@ void Com_Frame( bool noDelay ) {
 	int	timeAfter;
 
 	if ( Q_setjmp( abortframe ) ) {
+#ifdef USE_PROFILER
+		Com_ProfAbort();
+#endif
 		return;			// an ERR_DROP was thrown
 	}
 
+#ifdef USE_PROFILER
+	Com_ProfFrame();
+#endif
+	PROF_BEGIN( "Com_Frame" );
+
 	minMsec = 0; // silent compiler warning
 
 	// bk001204 - init to zero.
@@ -4304,6 +4317,7 @@ void Com_Frame( bool noDelay ) {
 	}
 
 	// waiting for incoming packets
+	PROF_BEGIN( "Com_Frame wait" );
 	if ( noDelay == false )
 	do {
 		if ( com_sv_running->integer ) {
@@ -4323,12 +4337,15 @@ void Com_Frame( bool noDelay ) {
 #endif
 		NET_Sleep( sleepMsec * 1000 - 500 );
 	} while( Com_TimeVal( minMsec ) );
+	PROF_END();
 
+	PROF_BEGIN( "Com_EventLoop" );
 	lastTime = com_frameTime;
 	com_frameTime = Com_EventLoop();
 	realMsec = com_frameTime - lastTime;
 
 	Cbuf_Execute();
+	PROF_END();
 
 	// mess with msec if needed
 	msec = Com_ModifyMsec( realMsec );
@@ -4340,7 +4357,9 @@ void Com_Frame( bool noDelay ) {
 		timeBeforeServer = Sys_Milliseconds();
 	}
 
+	PROF_BEGIN( "SV_Frame" );
 	SV_Frame( msec );
+	PROF_END();
 
 	// if "dedicated" has been modified, start up
 	// or shut down the client system.
@@ -4401,7 +4420,9 @@ void Com_Frame( bool noDelay ) {
 			timeBeforeClient = Sys_Milliseconds();
 		}
 
+		PROF_BEGIN( "CL_Frame" );
 		CL_Frame( msec, realMsec );
+		PROF_END();
 
 		if ( com_speeds->integer ) {
 			timeAfter = Sys_Milliseconds();
@@ -4424,10 +4445,13 @@ void Com_Frame( bool noDelay ) {
 		ev = timeBeforeServer - timeBeforeFirstEvents + timeBeforeClient - timeBeforeEvents;
 		cl = timeAfter - timeBeforeClient;
 		sv -= time_game;
-		cl -= time_frontend + time_backend;
+		cl -= ( time_frontend + time_backend ) / 1000;
 
-		Com_Printf ("frame:%i all:%3i sv:%3i ev:%3i cl:%3i gm:%3i rf:%3i bk:%3i\n",
-					 com_frameNumber, all, sv, ev, cl, time_game, time_frontend, time_backend );
+		Com_Printf ("frame:%i all:%3i sv:%3i ev:%3i cl:%3i gm:%3i rf:%3i bk:%3i vis:%i/%i\n",
+					 com_frameNumber, all, sv, ev, cl, time_game, time_frontend / 1000, time_backend / 1000,
+					 c_visCacheHits, c_visCacheLookups );
+		c_visCacheHits = 0;
+		c_visCacheLookups = 0;
 	}
 
 	//
@@ -4447,6 +4471,8 @@ void Com_Frame( bool noDelay ) {
 	}
 
 	com_frameNumber++;
+
+	PROF_END();
 }
 
 
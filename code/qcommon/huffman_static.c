@@ -175,22 +175,69 @@ void HuffmanPutBit( byte* fout, int32_t bitIndex, int bit )
 }
 
 
+// stores up to 57 bits at once, bits above count must be zero
+static void HuffmanStoreBits( byte* fout, int32_t bitIndex, uint64_t bits, int count )
+{
+	byte *out = fout + ( bitIndex >> 3 );
+	const int bitOffset = bitIndex & 7;
+	int n;
+
+	bits <<= bitOffset;
+	count += bitOffset;
+
+	// like HuffmanPutBit, only a partially written first byte is preserved
+	if ( bitOffset )
+		*out |= (byte)bits;
+	else
+		*out = (byte)bits;
+
+	for ( n = 8; n < count; n += 8 )
+	{
+		bits >>= 8;
+		*++out = (byte)bits;
+	}
+}
+
+
 int HuffmanPutSymbol( byte* fout, uint32_t offset, int symbol )
 {
-	int32_t bits;
-	uint32_t i;
 	const uint16_t result = HuffmanEncoderTable[ symbol ];
 	const uint16_t bitCount = result & 15;
 	const uint16_t code = (result >> 4) & 0x7FF;
 
-	bits = (int32_t)code;
-	for( i = 0; i < bitCount; ++i )
+	HuffmanStoreBits( fout, offset, code, bitCount );
+
+	return bitCount;
+}
+
+
+/*
+Writes the low rawBits (0..7) of value as they are, followed by the codes
+of the next numSymbols bytes of value, the same bit stream as a sequence
+of HuffmanPutBit and HuffmanPutSymbol calls. All codes are packed into one
+64-bit accumulator and stored in whole bytes. Returns the number of bits written.
+*/
+int HuffmanPutBits( byte* fout, int32_t bitIndex, uint32_t value, int rawBits, int numSymbols )
+{
+	uint64_t acc;
+	int count;
+	int i;
+
+	acc = value & ( ( 1u << rawBits ) - 1 );
+	count = rawBits;
+	value >>= rawBits;
+
+	for ( i = 0; i < numSymbols; i++ )
 	{
-		HuffmanPutBit( fout, offset + i, bits & 1 );
-		bits >>= 1;
+		const uint16_t result = HuffmanEncoderTable[ value & 0xFF ];
+		acc |= (uint64_t)( ( result >> 4 ) & 0x7FF ) << count;
+		count += result & 15;
+		value >>= 8;
 	}
 
-	return bitCount;
+	HuffmanStoreBits( fout, bitIndex, acc, count );
+
+	return count;
 }
 
 
@@ -200,6 +247,21 @@ int HuffmanGetBit( const byte* buffer, int bitIndex )
 }
 
 
+// reads count (1..8) bits as they are, touches the same bytes as HuffmanGetBit would
+int HuffmanGetBits( const byte* buffer, int bitIndex, int count )
+{
+	const byte *in = buffer + ( bitIndex >> 3 );
+	const int bitOffset = bitIndex & 7;
+	uint32_t bits;
+
+	bits = in[0] >> bitOffset;
+	if ( bitOffset + count > 8 )
+		bits |= (uint32_t)in[1] << ( 8 - bitOffset );
+
+	return (int)( bits & ( ( 1u << count ) - 1 ) );
+}
+
+
 int HuffmanGetSymbol( unsigned int* symbol, const byte* buffer, int bitIndex )
 {
 	const uint16_t code = ((*(const uint32_t*)(buffer + (bitIndex >> 3))) >> ((uint32_t)bitIndex & 7)) & 0x7FF;
@@ -209,3 +271,217 @@ int HuffmanGetSymbol( unsigned int* symbol, const byte* buffer, int bitIndex )
 
 	return (int)(entry >> 8);
 }
+
+
+/*
+==============================================================================
+
+\huffbench [fields] [seed] checks HuffmanPutBits against the bit serial
+HuffmanPutBit path MSG_WriteBits used before: random fields of 1..32 bits
+must give the same bytes and read back to the same values. Then both
+encoders and the reader are timed on a snapshot like mix of field sizes.
+
+==============================================================================
+*/
+
+#define HUFF_BENCH_BUFFER	MAX_MSGLEN
+#define HUFF_BENCH_LIMIT	( ( HUFF_BENCH_BUFFER - 8 ) * 8 )	// a 32 bit field takes at most 51 bits
+#define HUFF_BENCH_LOOPS	200
+
+typedef struct {
+	uint32_t	value;
+	int			bits;
+} huffField_t;
+
+static byte huffSerial[ HUFF_BENCH_BUFFER + 8 ];
+static byte huffPacked[ HUFF_BENCH_BUFFER + 8 ];
+
+
+// the encoder as it was before HuffmanPutBits, one HuffmanPutBit call per bit
+static int HuffmanPutBitsSerial( byte* fout, int32_t bitIndex, uint32_t value, int bits )
+{
+	const int32_t start = bitIndex;
+	int i, j;
+
+	for ( i = 0; i < ( bits & 7 ); i++ )
+	{
+		HuffmanPutBit( fout, bitIndex++, value & 1 );
+		value >>= 1;
+	}
+
+	for ( ; i < bits; i += 8 )
+	{
+		const uint16_t result = HuffmanEncoderTable[ value & 0xFF ];
+		uint32_t code = ( result >> 4 ) & 0x7FF;
+
+		for ( j = 0; j < ( result & 15 ); j++ )
+		{
+			HuffmanPutBit( fout, bitIndex++, code & 1 );
+			code >>= 1;
+		}
+		value >>= 8;
+	}
+
+	return bitIndex - start;
+}
+
+
+// the MSG_ReadBits path without the msg_t
+static uint32_t HuffmanReadField( const byte* buffer, int* bitIndex, int bits )
+{
+	const int nbits = bits & 7;
+	unsigned int sym;
+	uint32_t value;
+	int i;
+
+	value = 0;
+	if ( nbits )
+	{
+		value = HuffmanGetBits( buffer, *bitIndex, nbits );
+		*bitIndex += nbits;
+	}
+
+	for ( i = nbits; i < bits; i += 8 )
+	{
+		*bitIndex += HuffmanGetSymbol( &sym, buffer, *bitIndex );
+		value |= sym << i;
+	}
+
+	return value;
+}
+
+
+static uint32_t HuffmanBenchMask( int bits )
+{
+	return 0xFFFFFFFFu >> ( 32 - bits );
+}
+
+
+/*
+=================
+Huffman_Fuzz
+
+Returns the number of fields that did not match
+=================
+*/
+static int Huffman_Fuzz( int numFields, int *seed )
+{
+	huffField_t field;
+	int32_t serialBit, packedBit, readBit;
+	int errors, messages, fields;
+	int i;
+
+	errors = 0;
+	messages = 0;
+	fields = 0;
+
+	while ( fields < numFields && errors < 10 )
+	{
+		// one message worth, random garbage past the end like a reused buffer
+		Com_RandomBytes( huffSerial, sizeof( huffSerial ) );
+		Com_Memcpy( huffPacked, huffSerial, sizeof( huffPacked ) );
+
+		serialBit = 0;
+		packedBit = 0;
+		readBit = 0;
+		for ( i = 0; fields + i < numFields && packedBit < HUFF_BENCH_LIMIT; i++ )
+		{
+			field.bits = 1 + ( Q_rand( seed ) & 31 );
+			field.value = ( (uint32_t)Q_rand( seed ) << 16 ^ (uint32_t)Q_rand( seed ) ) & HuffmanBenchMask( field.bits );
+
+			serialBit += HuffmanPutBitsSerial( huffSerial, serialBit, field.value, field.bits );
+			packedBit += HuffmanPutBits( huffPacked, packedBit, field.value, field.bits & 7, field.bits >> 3 );
+
+			if ( serialBit != packedBit || memcmp( huffSerial, huffPacked, ( packedBit + 7 ) >> 3 ) )
+			{
+				Com_Printf( S_COLOR_YELLOW "huffbench: %i bit field %08x differs at bit %i of message %i\n", field.bits, field.value, packedBit, messages );
+				errors++;
+				break;
+			}
+
+			if ( HuffmanReadField( huffPacked, &readBit, field.bits ) != field.value || readBit != packedBit )
+			{
+				Com_Printf( S_COLOR_YELLOW "huffbench: %i bit field %08x does not read back at bit %i of message %i\n", field.bits, field.value, packedBit, messages );
+				errors++;
+				break;
+			}
+		}
+
+		fields += i;
+		messages++;
+	}
+
+	Com_Printf( "%i fields in %i messages, %i mismatches\n", fields, messages, errors );
+
+	return errors;
+}
+
+
+/*
+=================
+Huffman_Bench_f
+=================
+*/
+void Huffman_Bench_f( void )
+{
+	// entity and player state deltas are mostly change bits, 8 and 16 bit fields
+	static const int mix[] = { 1, 1, 1, 1, 5, 8, 8, 16, 16, 32, 1, 24, 7, 10, 1, 16 };
+	static huffField_t fields[ HUFF_BENCH_LIMIT / 2 ];
+	int64_t start, usec[ 3 ];
+	int numFields, fieldBits, numBits;
+	int seed, loop, i;
+	int32_t bitIndex;
+
+	numFields = Cmd_Argc() > 1 ? atoi( Cmd_Argv( 1 ) ) : 200000;
+	seed = Cmd_Argc() > 2 ? atoi( Cmd_Argv( 2 ) ) : 0x5eed;
+	if ( numFields < 1 )
+		numFields = 1;
+
+	Huffman_Fuzz( numFields, &seed );
+
+	// one message of the mix
+	numFields = 0;
+	fieldBits = 0;
+	numBits = 0;
+	do
+	{
+		huffField_t *f = &fields[ numFields ];
+		f->bits = mix[ numFields % ARRAY_LEN( mix ) ];
+		f->value = ( (uint32_t)Q_rand( &seed ) << 16 ^ (uint32_t)Q_rand( &seed ) ) & HuffmanBenchMask( f->bits );
+		fieldBits += f->bits;
+		numBits += HuffmanPutBitsSerial( huffSerial, numBits, f->value, f->bits );
+		numFields++;
+	} while ( numBits < HUFF_BENCH_LIMIT - 64 && numFields < ARRAY_LEN( fields ) );
+
+	start = Sys_Microseconds();
+	for ( loop = 0; loop < HUFF_BENCH_LOOPS; loop++ )
+	{
+		for ( i = 0, bitIndex = 0; i < numFields; i++ )
+			bitIndex += HuffmanPutBitsSerial( huffSerial, bitIndex, fields[ i ].value, fields[ i ].bits );
+	}
+	usec[ 0 ] = Sys_Microseconds() - start;
+
+	start = Sys_Microseconds();
+	for ( loop = 0; loop < HUFF_BENCH_LOOPS; loop++ )
+	{
+		for ( i = 0, bitIndex = 0; i < numFields; i++ )
+			bitIndex += HuffmanPutBits( huffPacked, bitIndex, fields[ i ].value, fields[ i ].bits & 7, fields[ i ].bits >> 3 );
+	}
+	usec[ 1 ] = Sys_Microseconds() - start;
+
+	start = Sys_Microseconds();
+	for ( loop = 0; loop < HUFF_BENCH_LOOPS; loop++ )
+	{
+		for ( i = 0, bitIndex = 0; i < numFields; i++ )
+			HuffmanReadField( huffPacked, &bitIndex, fields[ i ].bits );
+	}
+	usec[ 2 ] = Sys_Microseconds() - start;
+
+	Com_Printf( "%i x %i fields, %i bits in %i bytes, MB/s of field data:\n", HUFF_BENCH_LOOPS, numFields, fieldBits, ( numBits + 7 ) >> 3 );
+	for ( i = 0; i < 3; i++ )
+	{
+		static const char *names[] = { "serial write", "packed write", "read" };
+		const double mb = (double)fieldBits / 8 * HUFF_BENCH_LOOPS / ( 1024 * 1024 );
+		Com_Printf( "%-13s %8.2f msec %8.1f\n", names[ i ], usec[ i ] / 1000.0, usec[ i ] ? mb * 1000000.0 / usec[ i ] : 0.0 );
+	}
+}
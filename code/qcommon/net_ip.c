@@ -20,6 +20,10 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 ===========================================================================
 */
 
+#ifdef __linux__
+#define _GNU_SOURCE // recvmmsg, sendmmsg
+#endif
+
 #include "../qcommon/q_shared.h"
 #include "../qcommon/qcommon.h"
 
@@ -93,6 +97,15 @@ static bool	winsockInitialized = false;
 #		include <sys/filio.h>
 #	endif
 
+#	ifdef __linux__
+#		include <sys/epoll.h>
+#		ifdef __GLIBC_PREREQ
+#			if __GLIBC_PREREQ( 2, 35 )
+#				define EPOLL_PWAIT2 // microsecond timeouts
+#			endif
+#		endif
+#	endif
+
 typedef int SOCKET;
 #	define INVALID_SOCKET		-1
 #	define SOCKET_ERROR			-1
@@ -175,6 +188,9 @@ static cvar_t	*net_mcast6addr;
 static cvar_t	*net_mcast6iface;
 #endif
 static cvar_t	*net_dropsim;
+#ifdef __linux__
+static cvar_t	*net_batch;
+#endif
 
 static sockaddr_t socksRelayAddr;
 
@@ -213,6 +229,30 @@ typedef struct
 static nip_localaddr_t localIP[MAX_IPS];
 static int numIP;
 
+#ifdef __linux__
+#define NET_BATCH_SIZE		32	// datagrams moved by a single recvmmsg/sendmmsg
+#define NET_BATCH_PACKET	( MAX_PACKETLEN + 64 ) // larger packets bypass the send queue
+
+typedef struct {
+	SOCKET		sock;
+	sockaddr_t	addr;
+	socklen_t	addrlen;
+	netadrtype_t type;
+	int			length;
+	byte		data[ NET_BATCH_PACKET ];
+} netQueuedPacket_t;
+
+static int		epoll_fd = -1;
+
+// receive ring, NET_Sleep is never re-entered from the packet handlers
+static byte		recvData[ NET_BATCH_SIZE ][ MAX_MSGLEN_BUF ];
+
+// packets sent between NET_BeginPacketBatch and NET_FlushPacketBatch
+static netQueuedPacket_t sendQueue[ NET_BATCH_SIZE ];
+static int		sendCount;
+static bool		sendBatching;
+#endif
+
 static void	NET_Restart_f( void );
 
 //=============================================================================
@@ -636,6 +676,55 @@ bool NET_IsLocalAddress( const netadr_t *adr )
 
 //=============================================================================
 
+/*
+==================
+NET_ParsePacket
+
+Fills in the sender of a datagram that has been read from sock and
+strips the socks relay header, returns false if it should be dropped
+==================
+*/
+static bool NET_ParsePacket( SOCKET sock, sockaddr_t *from, socklen_t fromlen, int ret, netadr_t *net_from, msg_t *net_message )
+{
+	if ( sock == ip_socket )
+	{
+		memset( &from->v4.sin_zero, 0, sizeof( from->v4.sin_zero ) );
+
+		if ( usingSocks && memcmp( from, &socksRelayAddr, fromlen ) == 0 ) {
+			if ( ret < 10 || net_message->data[0] != 0 || net_message->data[1] != 0 || net_message->data[2] != 0 || net_message->data[3] != 1 ) {
+				return false;
+			}
+			net_from->type = NA_IP;
+			net_from->ipv._4[0] = net_message->data[4];
+			net_from->ipv._4[1] = net_message->data[5];
+			net_from->ipv._4[2] = net_message->data[6];
+			net_from->ipv._4[3] = net_message->data[7];
+			net_from->port = *(uint16_t *)&net_message->data[8];
+			net_message->readcount = 10;
+		}
+		else {
+			net_from->type = NA_BAD;
+			SockadrToNetadr( from, net_from );
+			net_message->readcount = 0;
+		}
+	}
+	else
+	{
+		net_from->type = NA_BAD;
+		SockadrToNetadr( from, net_from );
+		net_message->readcount = 0;
+	}
+
+	if( ret >= net_message->maxsize ) {
+		Com_Printf( "Oversize packet from %s\n", NET_AdrToString( net_from ) );
+		return false;
+	}
+
+	net_message->cursize = ret;
+	return true;
+}
+
+
 /*
 ==================
 NET_GetPacket
@@ -645,15 +734,27 @@ Receive one packet
 */
 static bool NET_GetPacket( netadr_t *net_from, msg_t *net_message, const fd_set *fdr )
 {
+	SOCKET	sockets[3];
+	int		i, numSockets;
 	int 	ret;
 	sockaddr_t	from;
 	socklen_t	fromlen;
 	int		err;
 
-	if(ip_socket != INVALID_SOCKET && FD_ISSET(ip_socket, fdr))
+	numSockets = 0;
+	if ( ip_socket != INVALID_SOCKET && FD_ISSET( ip_socket, fdr ) )
+		sockets[numSockets++] = ip_socket;
+#ifdef USE_IPV6
+	if ( ip6_socket != INVALID_SOCKET && FD_ISSET( ip6_socket, fdr ) )
+		sockets[numSockets++] = ip6_socket;
+	if ( multicast6_socket != INVALID_SOCKET && multicast6_socket != ip6_socket && FD_ISSET( multicast6_socket, fdr ) )
+		sockets[numSockets++] = multicast6_socket;
+#endif
+
+	for ( i = 0; i < numSockets; i++ )
 	{
 		fromlen = sizeof(from);
-		ret = recvfrom( ip_socket, (void *)net_message->data, net_message->maxsize, 0, (struct sockaddr *) &from, &fromlen );
+		ret = recvfrom( sockets[i], (void *)net_message->data, net_message->maxsize, 0, (struct sockaddr *) &from, &fromlen );
 
 		if (ret == SOCKET_ERROR)
 		{
@@ -664,100 +765,240 @@ static bool NET_GetPacket( netadr_t *net_from, msg_t *net_message, const fd_set
 		}
 		else
 		{
-			memset( &from.v4.sin_zero, 0, sizeof( from.v4.sin_zero ) );
+			return NET_ParsePacket( sockets[i], &from, fromlen, ret, net_from, net_message );
+		}
+	}
 
-			if ( usingSocks && memcmp( &from, &socksRelayAddr, fromlen ) == 0 ) {
-				if ( ret < 10 || net_message->data[0] != 0 || net_message->data[1] != 0 || net_message->data[2] != 0 || net_message->data[3] != 1 ) {
-					return false;
-				}
-				net_from->type = NA_IP;
-				net_from->ipv._4[0] = net_message->data[4];
-				net_from->ipv._4[1] = net_message->data[5];
-				net_from->ipv._4[2] = net_message->data[6];
-				net_from->ipv._4[3] = net_message->data[7];
-				net_from->port = *(uint16_t *)&net_message->data[8];
-				net_message->readcount = 10;
-			}
-			else {
-				net_from->type = NA_BAD;
-				SockadrToNetadr( &from, net_from );
-				net_message->readcount = 0;
-			}
+	return false;
+}
 
-			if( ret >= net_message->maxsize ) {
-				Com_Printf( "Oversize packet from %s\n", NET_AdrToString( net_from ) );
-				return false;
-			}
 
-			net_message->cursize = ret;
-			return true;
-		}
+/*
+==================
+NET_DispatchPacket
+==================
+*/
+static void NET_DispatchPacket( const netadr_t *from, msg_t *netmsg )
+{
+	if ( net_dropsim->value > 0.0f && net_dropsim->value <= 100.0f )
+	{
+		// com_dropsim->value percent of incoming packets get dropped.
+		if ( rand() < (int) (((double) RAND_MAX) / 100.0 * (double) net_dropsim->value) )
+			return; // drop this packet
 	}
 
-#ifdef USE_IPV6
-	if(ip6_socket != INVALID_SOCKET && FD_ISSET(ip6_socket, fdr))
-	{
-		fromlen = sizeof(from);
-		ret = recvfrom(ip6_socket, (void *)net_message->data, net_message->maxsize, 0, (struct sockaddr *) &from, &fromlen);
+#ifdef DEDICATED
+	Com_RunAndTimeServerPacket( from, netmsg );
+#else
+	if ( com_sv_running->integer || com_dedicated->integer )
+		Com_RunAndTimeServerPacket( from, netmsg );
+	else
+		CL_PacketEvent( from, netmsg );
+#endif
+}
 
-		if (ret == SOCKET_ERROR)
-		{
-			err = socketError;
 
-			if( err != EAGAIN && err != ECONNRESET )
+#ifdef __linux__
+/*
+==================
+NET_RecvBatch
+
+Reads up to NET_BATCH_SIZE datagrams from sock into data with one
+recvmmsg, returns their number or SOCKET_ERROR
+==================
+*/
+static int NET_RecvBatch( SOCKET sock, byte (*data)[ MAX_MSGLEN_BUF ], struct mmsghdr *hdr, sockaddr_t *from )
+{
+	struct iovec iov[ NET_BATCH_SIZE ];
+	int i;
+
+	memset( hdr, 0, sizeof( *hdr ) * NET_BATCH_SIZE );
+	for ( i = 0; i < NET_BATCH_SIZE; i++ ) {
+		iov[i].iov_base = data[i];
+		iov[i].iov_len = MAX_MSGLEN;
+		hdr[i].msg_hdr.msg_name = &from[i];
+		hdr[i].msg_hdr.msg_namelen = sizeof( from[i] );
+		hdr[i].msg_hdr.msg_iov = &iov[i];
+		hdr[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	return recvmmsg( sock, hdr, NET_BATCH_SIZE, 0, NULL );
+}
+
+
+/*
+==================
+NET_ReceiveBatch
+
+Reads everything that is queued on sock, NET_BATCH_SIZE datagrams per
+recvmmsg, and hands each of them to NET_DispatchPacket
+==================
+*/
+static void NET_ReceiveBatch( SOCKET sock )
+{
+	struct mmsghdr hdr[ NET_BATCH_SIZE ];
+	sockaddr_t from[ NET_BATCH_SIZE ];
+	netadr_t adr;
+	msg_t netmsg;
+	int i, ret;
+
+	do {
+		// a handler may have restarted networking
+#ifdef USE_IPV6
+		if ( sock != ip_socket && sock != ip6_socket )
+#else
+		if ( sock != ip_socket )
+#endif
+			return;
+
+		ret = NET_RecvBatch( sock, recvData, hdr, from );
+		if ( ret == SOCKET_ERROR ) {
+			if ( socketError != EAGAIN && socketError != ECONNRESET )
 				Com_Printf( "NET_GetPacket: %s\n", NET_ErrorString() );
+			return;
 		}
-		else
-		{
-			net_from->type = NA_BAD;
-			SockadrToNetadr( &from, net_from );
-			net_message->readcount = 0;
 
-			if(ret >= net_message->maxsize)
-			{
-				Com_Printf( "Oversize packet from %s\n", NET_AdrToString( net_from ) );
-				return false;
+		// the datagrams are out of the socket buffer now: a Com_Error in
+		// one of the handlers drops the rest of this batch, up to 31 of
+		// them, where the recvfrom loop left them queued for the next frame
+		for ( i = 0; i < ret; i++ ) {
+			MSG_Init( &netmsg, recvData[i], MAX_MSGLEN );
+			if ( NET_ParsePacket( sock, &from[i], hdr[i].msg_hdr.msg_namelen, hdr[i].msg_len, &adr, &netmsg ) ) {
+				NET_DispatchPacket( &adr, &netmsg );
 			}
-			
-			net_message->cursize = ret;
-			return true;
 		}
+	} while ( ret == NET_BATCH_SIZE );
+}
+#endif // __linux__
+
+//=============================================================================
+
+
+/*
+==================
+NET_SendError
+==================
+*/
+static void NET_SendError( netadrtype_t type ) {
+	int err = socketError;
+
+	// wouldblock is silent
+	if( err == EAGAIN ) {
+		return;
 	}
 
-	if(multicast6_socket != INVALID_SOCKET && multicast6_socket != ip6_socket && FD_ISSET(multicast6_socket, fdr))
-	{
-		fromlen = sizeof(from);
-		ret = recvfrom(multicast6_socket, (void *)net_message->data, net_message->maxsize, 0, (struct sockaddr *) &from, &fromlen);
+	// some PPP links do not allow broadcasts and return an error
+	if( ( err == EADDRNOTAVAIL ) && ( type == NA_BROADCAST ) ) {
+		return;
+	}
 
-		if (ret == SOCKET_ERROR)
-		{
-			err = socketError;
+	Com_Printf( "Sys_SendPacket: %s\n", NET_ErrorString() );
+}
 
-			if( err != EAGAIN && err != ECONNRESET )
-				Com_Printf( "NET_GetPacket: %s\n", NET_ErrorString() );
-		}
-		else
-		{
-			net_from->type = NA_BAD;
-			SockadrToNetadr( &from, net_from );
-			net_message->readcount = 0;
 
-			if(ret >= net_message->maxsize)
-			{
-				Com_Printf( "Oversize packet from %s\n", NET_AdrToString( net_from ) );
-				return false;
+#ifdef __linux__
+/*
+==================
+NET_SendBatch
+
+Sends the queued packets with one sendmmsg per run of packets that
+leave through the same socket
+==================
+*/
+static void NET_SendBatch( void ) {
+	struct mmsghdr hdr[ NET_BATCH_SIZE ];
+	struct iovec iov[ NET_BATCH_SIZE ];
+	SOCKET sock;
+	int i, n, ret;
+
+	memset( hdr, 0, sizeof( hdr[0] ) * sendCount );
+	for ( i = 0; i < sendCount; i++ ) {
+		iov[i].iov_base = sendQueue[i].data;
+		iov[i].iov_len = sendQueue[i].length;
+		hdr[i].msg_hdr.msg_name = &sendQueue[i].addr;
+		hdr[i].msg_hdr.msg_namelen = sendQueue[i].addrlen;
+		hdr[i].msg_hdr.msg_iov = &iov[i];
+		hdr[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	for ( i = 0; i < sendCount; ) {
+		sock = sendQueue[i].sock;
+		for ( n = i + 1; n < sendCount && sendQueue[n].sock == sock; n++ )
+			;
+		while ( i < n ) {
+			ret = sendmmsg( sock, &hdr[i], n - i, 0 );
+			if ( ret <= 0 ) {
+				// the packet at i failed, carry on with the rest
+				NET_SendError( sendQueue[i].type );
+				i++;
+			} else {
+				i += ret;
 			}
+		}
+	}
 
-			net_message->cursize = ret;
-			return true;
+	sendCount = 0;
+}
+#endif
+
+
+/*
+==================
+NET_SendTo
+
+Queues the packet while a batch is open, sends it right away otherwise
+==================
+*/
+static int NET_SendTo( SOCKET sock, const void *data, int length, const sockaddr_t *addr, socklen_t addrlen, netadrtype_t type ) {
+#ifdef __linux__
+	netQueuedPacket_t *p;
+
+	if ( sendBatching && length <= NET_BATCH_PACKET ) {
+		if ( sendCount == NET_BATCH_SIZE ) {
+			NET_SendBatch();
 		}
+		p = &sendQueue[ sendCount++ ];
+		p->sock = sock;
+		p->addr = *addr;
+		p->addrlen = addrlen;
+		p->type = type;
+		p->length = length;
+		memcpy( p->data, data, length );
+		return length;
 	}
-#endif // USE_IPV6
+#endif
+	return sendto( sock, data, length, 0, (const struct sockaddr *) addr, addrlen );
+}
 
-	return false;
+
+/*
+==================
+NET_BeginPacketBatch
+
+Until NET_FlushPacketBatch, outgoing packets are collected and handed
+to the kernel together, this is a no-op where sendmmsg is not available
+==================
+*/
+void NET_BeginPacketBatch( void ) {
+#ifdef __linux__
+	sendBatching = ( networkingEnabled && net_batch->integer ) ? true : false;
+#endif
 }
 
-//=============================================================================
+
+/*
+==================
+NET_FlushPacketBatch
+==================
+*/
+void NET_FlushPacketBatch( void ) {
+#ifdef __linux__
+	if ( sendCount ) {
+		NET_SendBatch();
+	}
+	sendBatching = false;
+#endif
+}
 
 
 /*
@@ -809,32 +1050,20 @@ void Sys_SendPacket( int length, const void *data, const netadr_t *to ) {
 			cmd.s.u.v4.addr.s_addr = addr.v4.sin_addr.s_addr;
 			cmd.s.u.v4.port = addr.v4.sin_port;
 			memcpy( cmd.s.u.v4.data, data, length );
-			ret = sendto( ip_socket, cmd.buf, length + 10, 0, ( struct sockaddr * ) &socksRelayAddr.v4, sizeof( socksRelayAddr.v4 ) );
+			ret = NET_SendTo( ip_socket, cmd.buf, length + 10, &socksRelayAddr, sizeof( socksRelayAddr.v4 ), to->type );
 		}
 	}
 	else {
 		if ( addr.ss.ss_family == AF_INET )
-			ret = sendto( ip_socket, data, length, 0, (struct sockaddr *) &addr, sizeof(struct sockaddr_in) );
+			ret = NET_SendTo( ip_socket, data, length, &addr, sizeof(struct sockaddr_in), to->type );
 #ifdef USE_IPV6
 		else if ( addr.ss.ss_family == AF_INET6 )
-			ret = sendto( ip6_socket, data, length, 0, (struct sockaddr *) &addr, sizeof(struct sockaddr_in6) );
+			ret = NET_SendTo( ip6_socket, data, length, &addr, sizeof(struct sockaddr_in6), to->type );
 #endif
 	}
 
 	if( ret == SOCKET_ERROR ) {
-		int err = socketError;
-
-		// wouldblock is silent
-		if( err == EAGAIN ) {
-			return;
-		}
-
-		// some PPP links do not allow broadcasts and return an error
-		if( ( err == EADDRNOTAVAIL ) && ( to->type == NA_BROADCAST ) ) {
-			return;
-		}
-
-		Com_Printf( "Sys_SendPacket: %s\n", NET_ErrorString() );
+		NET_SendError( to->type );
 	}
 }
 
@@ -1678,10 +1907,61 @@ static bool NET_GetCvars( void ) {
 	net_dropsim = Cvar_Get( "net_dropsim", "", CVAR_TEMP );
 	Cvar_SetDescription( net_dropsim, "Simulated packet drops." );
 
+#ifdef __linux__
+	net_batch = Cvar_Get( "net_batch", "1", CVAR_ARCHIVE_ND );
+	Cvar_CheckRange( net_batch, "0", "1", CV_INTEGER );
+	Cvar_SetDescription( net_batch, "Wait for packets with epoll, read them with recvmmsg and send snapshots with one sendmmsg per server frame." );
+#endif
+
 	return modified ? true : false;
 }
 
 
+#ifdef __linux__
+/*
+====================
+NET_OpenPoll
+====================
+*/
+static void NET_OpenPoll( void ) {
+	struct epoll_event ev;
+
+	epoll_fd = epoll_create1( EPOLL_CLOEXEC );
+	if ( epoll_fd == -1 ) {
+		Com_Printf( S_COLOR_YELLOW "WARNING: NET_OpenPoll: epoll_create1: %s\n", NET_ErrorString() );
+		return;
+	}
+
+	memset( &ev, 0, sizeof( ev ) );
+	ev.events = EPOLLIN;
+
+	if ( ip_socket != INVALID_SOCKET ) {
+		ev.data.fd = ip_socket;
+		epoll_ctl( epoll_fd, EPOLL_CTL_ADD, ip_socket, &ev );
+	}
+#ifdef USE_IPV6
+	if ( ip6_socket != INVALID_SOCKET ) {
+		ev.data.fd = ip6_socket;
+		epoll_ctl( epoll_fd, EPOLL_CTL_ADD, ip6_socket, &ev );
+	}
+#endif
+}
+
+
+/*
+====================
+NET_ClosePoll
+====================
+*/
+static void NET_ClosePoll( void ) {
+	if ( epoll_fd != -1 ) {
+		close( epoll_fd );
+		epoll_fd = -1;
+	}
+}
+#endif
+
+
 /*
 ====================
 NET_Config
@@ -1727,6 +2007,10 @@ static void NET_Config( bool enableNetworking ) {
 	}
 
 	if( stop ) {
+		NET_FlushPacketBatch();
+#ifdef __linux__
+		NET_ClosePoll();
+#endif
 		if ( ip_socket != INVALID_SOCKET ) {
 			closesocket( ip_socket );
 			ip_socket = INVALID_SOCKET;
@@ -1759,12 +2043,188 @@ static void NET_Config( bool enableNetworking ) {
 			NET_OpenIP();
 #ifdef USE_IPV6
 			NET_SetMulticast6();
+#endif
+#ifdef __linux__
+			NET_OpenPoll();
 #endif
 		}
 	}
 }
 
 
+#ifdef __linux__
+/*
+==============================================================================
+
+\netbench [packets] [size] sends a packet storm over loopback between two
+sockets of its own, once with a sendto and a recvfrom per datagram and once
+through the send queue and recvmmsg that net_batch uses. Every datagram
+carries its sequence number, lost and out of order ones are reported.
+
+==============================================================================
+*/
+
+#define NET_BENCH_BURST		( NET_BATCH_SIZE * 4 )	// in flight at once, fits the default receive buffer
+
+typedef struct {
+	int64_t		sendUsec;
+	int64_t		recvUsec;
+	int			received;
+	int			errors;
+	int			calls;		// receive syscalls
+} netBenchRun_t;
+
+
+/*
+====================
+NET_BenchWait
+
+The rest of a burst should already be queued on loopback, wait a little
+in case it is not before calling it lost
+====================
+*/
+static bool NET_BenchWait( SOCKET sock )
+{
+	struct timeval tv;
+	fd_set fdr;
+
+	FD_ZERO( &fdr );
+	FD_SET( sock, &fdr );
+	tv.tv_sec = 0;
+	tv.tv_usec = 100000;
+
+	return select( sock + 1, &fdr, NULL, NULL, &tv ) > 0;
+}
+
+
+/*
+====================
+NET_BenchRun
+====================
+*/
+static void NET_BenchRun( SOCKET from, SOCKET to, const sockaddr_t *addr, byte (*data)[ MAX_MSGLEN_BUF ], int packets, int size, bool batched, netBenchRun_t *run )
+{
+	struct mmsghdr hdr[ NET_BATCH_SIZE ];
+	sockaddr_t fromAddr[ NET_BATCH_SIZE ];
+	byte packet[ MAX_PACKETLEN ];
+	int64_t start;
+	int sent, expect, seq, burst;
+	int i, ret;
+
+	memset( run, 0, sizeof( *run ) );
+	memset( packet, 0xA5, sizeof( packet ) );
+
+	expect = 0;
+	for ( sent = 0; sent < packets; ) {
+		burst = MIN( NET_BENCH_BURST, packets - sent );
+
+		start = Sys_Microseconds();
+		sendBatching = batched;
+		for ( i = 0; i < burst; i++, sent++ ) {
+			memcpy( packet, &sent, sizeof( sent ) );
+			if ( NET_SendTo( from, packet, size, addr, sizeof( addr->v4 ), NA_IP ) == SOCKET_ERROR )
+				NET_SendError( NA_IP );
+		}
+		NET_FlushPacketBatch();
+		run->sendUsec += Sys_Microseconds() - start;
+
+		start = Sys_Microseconds();
+		while ( expect < sent ) {
+			if ( batched ) {
+				ret = NET_RecvBatch( to, data, hdr, fromAddr );
+			} else {
+				ret = recvfrom( to, (void *)data[0], MAX_MSGLEN, 0, NULL, NULL );
+				hdr[0].msg_len = ret;
+				ret = ( ret == SOCKET_ERROR ) ? SOCKET_ERROR : 1;
+			}
+			run->calls++;
+
+			if ( ret == SOCKET_ERROR ) {
+				if ( socketError != EAGAIN ) {
+					Com_Printf( "netbench: %s\n", NET_ErrorString() );
+					break;
+				}
+				if ( !NET_BenchWait( to ) )
+					break; // the rest of the burst was lost
+				continue;
+			}
+
+			for ( i = 0; i < ret; i++ ) {
+				memcpy( &seq, data[i], sizeof( seq ) );
+				if ( seq != expect || hdr[i].msg_len != size )
+					run->errors++;
+				expect = seq + 1;
+				run->received++;
+			}
+		}
+		run->recvUsec += Sys_Microseconds() - start;
+		expect = sent;
+	}
+}
+
+
+/*
+====================
+NET_Bench_f
+====================
+*/
+static void NET_Bench_f( void )
+{
+	static const char *names[] = { "sendto/recvfrom", "sendmmsg/recvmmsg" };
+	netBenchRun_t runs[ 2 ];
+	byte (*data)[ MAX_MSGLEN_BUF ];
+	SOCKET from, to;
+	sockaddr_t addr;
+	socklen_t addrlen;
+	int packets, size, rcvbuf, err, i;
+
+	packets = Cmd_Argc() > 1 ? atoi( Cmd_Argv( 1 ) ) : 100000;
+	size = Cmd_Argc() > 2 ? atoi( Cmd_Argv( 2 ) ) : 512;
+	if ( packets < 1 )
+		packets = 1;
+	size = MAX( (int)sizeof( int ), MIN( size, MAX_PACKETLEN ) );
+
+	from = NET_IPSocket( "127.0.0.1", PORT_ANY, &err );
+	if ( from == INVALID_SOCKET )
+		return;
+	to = NET_IPSocket( "127.0.0.1", PORT_ANY, &err );
+	if ( to == INVALID_SOCKET ) {
+		closesocket( from );
+		return;
+	}
+
+	// room for a whole burst of full size packets, the kernel may cap this at rmem_max
+	rcvbuf = NET_BENCH_BURST * ( MAX_PACKETLEN + 1024 );
+	setsockopt( to, SOL_SOCKET, SO_RCVBUF, (const char *)&rcvbuf, sizeof( rcvbuf ) );
+
+	addrlen = sizeof( addr );
+	if ( getsockname( to, (struct sockaddr *)&addr, &addrlen ) == SOCKET_ERROR ) {
+		Com_Printf( "netbench: getsockname: %s\n", NET_ErrorString() );
+	} else {
+		// not recvData, rcon may run this from inside NET_ReceiveBatch
+		data = Z_Malloc( NET_BATCH_SIZE * sizeof( *data ) );
+
+		for ( i = 0; i < 2; i++ )
+			NET_BenchRun( from, to, &addr, data, packets, size, i != 0, &runs[i] );
+
+		Z_Free( data );
+
+		Com_Printf( "%i packets of %i bytes over loopback, %i in flight\n", packets, size, NET_BENCH_BURST );
+		Com_Printf( "                   send msec  recv msec  recv calls  kpkt/s  lost  errors\n" );
+		for ( i = 0; i < 2; i++ ) {
+			const int64_t usec = runs[i].sendUsec + runs[i].recvUsec;
+			Com_Printf( "%-18s %9.2f  %9.2f  %10i  %6.0f  %4i  %6i\n", names[i],
+				runs[i].sendUsec / 1000.0, runs[i].recvUsec / 1000.0, runs[i].calls,
+				usec ? runs[i].received * 1000.0 / usec : 0.0, packets - runs[i].received, runs[i].errors );
+		}
+	}
+
+	closesocket( to );
+	closesocket( from );
+}
+#endif
+
+
 /*
 ====================
 NET_Init
@@ -1787,6 +2247,9 @@ void NET_Init( void ) {
 	NET_Config( true );
 	
 	Cmd_AddCommand( "net_restart", NET_Restart_f );
+#ifdef __linux__
+	Cmd_AddCommand( "netbench", NET_Bench_f );
+#endif
 }
 
 
@@ -1827,27 +2290,59 @@ static void NET_Event( const fd_set *fdr )
 		MSG_Init( &netmsg, bufData, MAX_MSGLEN );
 
 		if ( NET_GetPacket( &from, &netmsg, fdr ) )
-		{
-			if ( net_dropsim->value > 0.0f && net_dropsim->value <= 100.0f )
-			{
-				// com_dropsim->value percent of incoming packets get dropped.
-				if ( rand() < (int) (((double) RAND_MAX) / 100.0 * (double) net_dropsim->value) )
-					continue; // drop this packet
-			}
+			NET_DispatchPacket( &from, &netmsg );
+		else
+			break;
+	}
+}
 
-#ifdef DEDICATED
-			Com_RunAndTimeServerPacket( &from, &netmsg );
-#else
-			if ( com_sv_running->integer || com_dedicated->integer )
-				Com_RunAndTimeServerPacket( &from, &netmsg );
-			else
-				CL_PacketEvent( &from, &netmsg );
+
+#ifdef __linux__
+/*
+====================
+NET_PollSleep
+
+NET_Sleep with epoll, readable sockets are drained with recvmmsg
+====================
+*/
+static bool NET_PollSleep( int timeout )
+{
+	struct epoll_event events[ 2 ];
+	int i, retval;
+#ifdef EPOLL_PWAIT2
+	static bool noPwait2;
+	struct timespec ts;
+
+	if ( !noPwait2 ) {
+		ts.tv_sec = timeout / 1000000;
+		ts.tv_nsec = ( timeout % 1000000 ) * 1000;
+		retval = epoll_pwait2( epoll_fd, events, ARRAY_LEN( events ), &ts, NULL );
+		if ( retval == -1 && errno == ENOSYS ) {
+			noPwait2 = true; // older kernel, stay with epoll_wait from now on
+		}
+	}
+	if ( noPwait2 )
 #endif
+	{
+		// whole milliseconds, rounded up since waking early just spins Com_Frame
+		retval = epoll_wait( epoll_fd, events, ARRAY_LEN( events ), ( timeout + 999 ) / 1000 );
+	}
+
+	if ( retval > 0 ) {
+		for ( i = 0; i < retval; i++ ) {
+			NET_ReceiveBatch( events[i].data.fd );
 		}
-		else
-			break;
+		return false;
 	}
+
+	if ( retval == SOCKET_ERROR && socketError != EINTR ) {
+		Com_Printf( S_COLOR_YELLOW "Warning: epoll_wait() syscall failed: %s\n",
+			NET_ErrorString() );
+	}
+
+	return true;
 }
+#endif
 
 
 /*
@@ -1869,6 +2364,14 @@ bool NET_Sleep( int timeout )
 	if ( timeout < 0 )
 		timeout = 0;
 
+	// in case a Com_Error skipped the end of a batch
+	NET_FlushPacketBatch();
+
+#ifdef __linux__
+	if ( epoll_fd != -1 && net_batch->integer )
+		return NET_PollSleep( timeout );
+#endif
+
 	FD_ZERO( &fdr );
 
 	if ( ip_socket != INVALID_SOCKET )
@@ -0,0 +1,439 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+
+This file is part of Quake III Arena source code.
+
+Quake III Arena source code is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Quake III Arena source code is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Quake III Arena source code; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+===========================================================================
+*/
+// prof.c -- scoped CPU timings written to per-thread rings, dumped as a chrome trace
+
+#include "q_shared.h"
+#include "qcommon.h"
+
+/*
+==============================================================================
+
+Every thread that enters a scope gets its own ring of finished scopes, so
+recording never takes a lock: only the owning thread writes to a ring and
+publishes its head, "profdump" reads whatever has been published. The ring
+keeps the most recent PROF_RING_SIZE scopes of each thread, older ones are
+overwritten. A thread that exits leaves its ring to the next thread that
+registers, so restarting the render thread doesn't use up the slots.
+
+Scope names must be string literals, only the pointer is stored.
+
+The output loads in chrome://tracing and ui.perfetto.dev.
+
+==============================================================================
+*/
+
+#ifdef USE_PROFILER
+
+int com_profiling;
+
+#ifdef _WIN32
+#include <windows.h>
+#define PROF_THREAD_LOCAL __declspec(thread)
+#else
+#include <pthread.h>
+#define PROF_THREAD_LOCAL __thread
+#endif
+
+#define PROF_RING_SIZE	65536	// must be a power of two
+#define PROF_MAX_DEPTH	32
+#define PROF_MAX_THREADS 32
+
+typedef struct {
+	const char	*name;
+	int64_t		start;
+	int64_t		duration;
+} profScope_t;
+
+typedef struct {
+	profScope_t	ring[PROF_RING_SIZE];
+	volatile unsigned int head;		// scopes finished so far, only written by the owner
+	volatile unsigned int base;		// head when the current owner took the ring over
+	volatile int exited;			// the owner is gone, the ring can be taken over
+
+	// open scopes, only touched by the owner
+	const char	*stackName[PROF_MAX_DEPTH];
+	int64_t		stackStart[PROF_MAX_DEPTH];
+	int			depth;
+	int			generation;
+
+	const char	*firstScope;	// to tell threads apart in the trace
+} profThread_t;
+
+static profThread_t *volatile profThreads[PROF_MAX_THREADS];
+static volatile int profNumThreads;
+static volatile int profGeneration;
+static PROF_THREAD_LOCAL profThread_t *profSelf;
+static PROF_THREAD_LOCAL int profRefused;	// generation + 1 when no slot was left
+#ifdef _WIN32
+static DWORD profExitKey = FLS_OUT_OF_INDEXES;
+#else
+static pthread_key_t profExitKey;
+static bool profExitKeyValid;
+#endif
+
+static cvar_t *com_profile;
+
+
+#ifdef _MSC_VER
+#define Prof_Publish( p, v )		InterlockedExchange( (volatile LONG *)(p), (v) )
+#define Prof_Acquire( p )			InterlockedCompareExchange( (volatile LONG *)(p), 0, 0 )
+#define Prof_PublishPtr( p, v )		InterlockedExchangePointer( (PVOID volatile *)(p), (v) )
+#define Prof_AcquirePtr( p )		InterlockedCompareExchangePointer( (PVOID volatile *)(p), NULL, NULL )
+#else
+#define Prof_Publish( p, v )		__atomic_store_n( (p), (v), __ATOMIC_RELEASE )
+#define Prof_Acquire( p )			__atomic_load_n( (p), __ATOMIC_ACQUIRE )
+#define Prof_PublishPtr( p, v )		__atomic_store_n( (p), (v), __ATOMIC_RELEASE )
+#define Prof_AcquirePtr( p )		__atomic_load_n( (p), __ATOMIC_ACQUIRE )
+#endif
+
+
+static bool Prof_CompareExchange( volatile int *p, int expected, int desired ) {
+#ifdef _MSC_VER
+	return InterlockedCompareExchange( (volatile LONG *)p, desired, expected ) == expected;
+#else
+	return __atomic_compare_exchange_n( p, &expected, desired, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE );
+#endif
+}
+
+
+/*
+=================
+Prof_ThreadExit
+
+Called by the thread library when a registered thread exits
+=================
+*/
+#ifdef _WIN32
+static VOID WINAPI Prof_ThreadExit( PVOID data ) {
+#else
+static void Prof_ThreadExit( void *data ) {
+#endif
+	profThread_t *t = (profThread_t *)data;
+
+	if ( t ) {
+		Prof_Publish( &t->exited, 1 );
+	}
+}
+
+
+/*
+=================
+Prof_WatchThread
+=================
+*/
+static void Prof_WatchThread( profThread_t *t ) {
+#ifdef _WIN32
+	if ( profExitKey != FLS_OUT_OF_INDEXES ) {
+		FlsSetValue( profExitKey, t );
+	}
+#else
+	if ( profExitKeyValid ) {
+		pthread_setspecific( profExitKey, t );
+	}
+#endif
+}
+
+
+/*
+=================
+Prof_RegisterThread
+
+First scope of a thread. The ring of a thread that has exited is taken over
+if there is one, otherwise a new one is allocated with calloc since the
+zone allocator is not thread safe.
+=================
+*/
+static profThread_t *Prof_RegisterThread( const char *name ) {
+	profThread_t *t;
+	int i, index;
+
+	index = Prof_Acquire( &profNumThreads );
+	for ( i = 0; i < index && i < PROF_MAX_THREADS; i++ ) {
+		t = Prof_AcquirePtr( &profThreads[ i ] );
+		if ( t && Prof_Acquire( &t->exited ) && Prof_CompareExchange( &t->exited, 1, 0 ) ) {
+			// the old owner is gone, only "profdump" may still be reading
+			t->depth = 0;
+			t->generation = profGeneration;
+			t->firstScope = name;
+			Prof_Publish( &t->base, t->head );
+			Prof_WatchThread( t );
+			return t;
+		}
+	}
+
+	do {
+		index = Prof_Acquire( &profNumThreads );
+		if ( index >= PROF_MAX_THREADS ) {
+			return NULL;
+		}
+	} while ( !Prof_CompareExchange( &profNumThreads, index, index + 1 ) );
+
+	t = calloc( 1, sizeof( *t ) );
+	if ( !t ) {
+		return NULL;
+	}
+
+	t->firstScope = name;
+	t->generation = profGeneration;
+
+	Prof_PublishPtr( &profThreads[ index ], t );
+	Prof_WatchThread( t );
+
+	return t;
+}
+
+
+/*
+=================
+Com_ProfBegin
+=================
+*/
+void Com_ProfBegin( const char *name ) {
+	profThread_t *t;
+
+	if ( !com_profiling ) {
+		return;
+	}
+
+	t = profSelf;
+	if ( !t ) {
+		// without a slot, try again with the next recording only
+		if ( profRefused == profGeneration + 1 ) {
+			return;
+		}
+		t = profSelf = Prof_RegisterThread( name );
+		if ( !t ) {
+			profRefused = profGeneration + 1;
+			return;
+		}
+	}
+
+	if ( t->generation != profGeneration ) {
+		// scopes left open when recording was switched off
+		t->generation = profGeneration;
+		t->depth = 0;
+	}
+
+	if ( t->depth < PROF_MAX_DEPTH ) {
+		t->stackName[ t->depth ] = name;
+		t->stackStart[ t->depth ] = Sys_Microseconds();
+	}
+	t->depth++;
+}
+
+
+/*
+=================
+Com_ProfEnd
+=================
+*/
+void Com_ProfEnd( void ) {
+	profThread_t *t;
+	profScope_t *s;
+	int64_t now;
+	unsigned int head;
+
+	if ( !com_profiling ) {
+		return;
+	}
+
+	t = profSelf;
+	if ( !t || t->depth <= 0 ) {
+		return;
+	}
+
+	t->depth--;
+
+	if ( t->generation != profGeneration || t->depth >= PROF_MAX_DEPTH ) {
+		return;
+	}
+
+	now = Sys_Microseconds();
+
+	head = t->head;
+	s = &t->ring[ head & ( PROF_RING_SIZE - 1 ) ];
+	s->name = t->stackName[ t->depth ];
+	s->start = t->stackStart[ t->depth ];
+	s->duration = now - s->start;
+
+	Prof_Publish( &t->head, head + 1 );
+}
+
+
+/*
+=================
+Com_ProfAbort
+
+Drops the scopes of the calling thread that a longjmp went past
+=================
+*/
+void Com_ProfAbort( void ) {
+	if ( profSelf ) {
+		profSelf->depth = 0;
+	}
+}
+
+
+/*
+=================
+Com_ProfFrame
+
+Follows com_profile once per frame, a new recording starts with empty stacks
+=================
+*/
+void Com_ProfFrame( void ) {
+	if ( com_profile->integer && !com_profiling ) {
+		profGeneration++;
+	}
+	com_profiling = com_profile->integer ? 1 : 0;
+}
+
+
+/*
+=================
+Prof_WriteString
+=================
+*/
+static void Prof_WriteString( fileHandle_t f, const char *s ) {
+	char buf[ MAX_QPATH * 2 ];
+	int n;
+
+	for ( n = 0; *s && n < (int)sizeof( buf ) - 2; s++ ) {
+		if ( *s == '"' || *s == '\\' ) {
+			buf[ n++ ] = '\\';
+		}
+		buf[ n++ ] = *s;
+	}
+	buf[ n ] = '\0';
+
+	FS_Write( buf, n, f );
+}
+
+
+/*
+=================
+Com_ProfDump_f
+
+Writes the recorded scopes of all threads as chrome trace JSON
+=================
+*/
+static void Com_ProfDump_f( void ) {
+	char filename[ MAX_QPATH ];
+	const profThread_t *t;
+	const profScope_t *s;
+	fileHandle_t f;
+	int numThreads;
+	unsigned int head, first, n;
+	int i, total;
+	bool comma;
+
+	if ( Cmd_Argc() > 1 ) {
+		Q_strncpyz( filename, Cmd_Argv( 1 ), sizeof( filename ) );
+		COM_DefaultExtension( filename, sizeof( filename ), ".json" );
+	} else {
+		Q_strncpyz( filename, "profile.json", sizeof( filename ) );
+	}
+
+	numThreads = Prof_Acquire( &profNumThreads );
+	if ( numThreads > PROF_MAX_THREADS ) {
+		numThreads = PROF_MAX_THREADS;
+	}
+
+	if ( numThreads == 0 ) {
+		Com_Printf( "Nothing recorded, set com_profile 1 first.\n" );
+		return;
+	}
+
+	f = FS_FOpenFileWrite( filename );
+	if ( f == FS_INVALID_HANDLE ) {
+		Com_Printf( "Couldn't open %s for writing.\n", filename );
+		return;
+	}
+
+	FS_Printf( f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n" );
+	comma = false;
+	total = 0;
+
+	for ( i = 0; i < numThreads; i++ ) {
+		t = Prof_AcquirePtr( &profThreads[ i ] );
+		if ( !t ) {
+			continue; // still being registered
+		}
+		if ( Prof_Acquire( &t->exited ) && Prof_Acquire( &t->head ) == Prof_Acquire( &t->base ) ) {
+			continue; // nothing recorded by a thread that is gone
+		}
+
+		FS_Printf( f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%i,\"args\":{\"name\":\"", comma ? ",\n" : "", i );
+		Prof_WriteString( f, t->firstScope );
+		FS_Printf( f, "\"}}" );
+		comma = true;
+
+		// keep away from the slots the owner may be overwriting right now,
+		// unsigned differences stay right when head wraps around
+		head = Prof_Acquire( &t->head );
+		n = head - Prof_Acquire( &t->base );
+		if ( n > PROF_RING_SIZE - 1024 ) {
+			n = PROF_RING_SIZE - 1024;
+		}
+		first = head - n;
+
+		for ( n = first; n != head; n++ ) {
+			s = &t->ring[ n & ( PROF_RING_SIZE - 1 ) ];
+			FS_Printf( f, ",\n{\"name\":\"" );
+			Prof_WriteString( f, s->name );
+			FS_Printf( f, "\",\"ph\":\"X\",\"pid\":1,\"tid\":%i,\"ts\":%lld,\"dur\":%lld}",
+				i, (long long)s->start, (long long)s->duration );
+		}
+		total += (int)( head - first );
+	}
+
+	FS_Printf( f, "\n]}\n" );
+	FS_FCloseFile( f );
+
+	Com_Printf( "Wrote %i scopes from %i threads to %s\n", total, numThreads, filename );
+}
+
+
+/*
+=================
+Com_ProfInit
+=================
+*/
+void Com_ProfInit( void ) {
+	com_profile = Cvar_Get( "com_profile", "0", CVAR_TEMP );
+	Cvar_SetDescription( com_profile, "Records scoped CPU timings of every thread, \\profdump [filename] writes them out as chrome trace JSON." );
+
+	Cmd_AddCommand( "profdump", Com_ProfDump_f );
+
+#ifdef _WIN32
+	profExitKey = FlsAlloc( Prof_ThreadExit );
+#else
+	profExitKeyValid = pthread_key_create( &profExitKey, Prof_ThreadExit ) == 0;
+#endif
+}
+
+#else
+
+void Com_ProfBegin( const char *name ) { }
+void Com_ProfEnd( void ) { }
+
+#endif // USE_PROFILER
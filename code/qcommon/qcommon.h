@@ -219,6 +219,8 @@ void NET_JoinMulticast6(void);
 void NET_LeaveMulticast6(void);
 #endif
 bool NET_Sleep(int timeout);
+void NET_BeginPacketBatch(void);
+void NET_FlushPacketBatch(void);
 
 #define MAX_PACKETLEN 1400 // max size of a network packet
 
@@ -1046,8 +1048,9 @@ extern cvar_t *com_affinityMask;
 
 // com_speeds times
 extern int time_game;
-extern int time_frontend;
-extern int time_backend; // renderer backend time
+extern int time_frontend; // renderer frontend time, usec
+extern int time_backend; // renderer backend time, usec
+extern int c_visCacheHits, c_visCacheLookups; // snapshot visibility cache, only counted with com_speeds
 
 extern int com_frameTime;
 
@@ -1135,6 +1138,22 @@ void Com_Init(char *commandLine);
 void Com_FrameInit(void);
 void Com_Frame(bool noDelay);
 
+// scoped CPU timings, see prof.c
+// PROF_BEGIN/PROF_END must pair up within a thread and take string literals
+void Com_ProfBegin(const char *name);
+void Com_ProfEnd(void);
+#ifdef USE_PROFILER
+extern int com_profiling;
+void Com_ProfInit(void);
+void Com_ProfFrame(void);
+void Com_ProfAbort(void);
+#define PROF_BEGIN(name) do { if (com_profiling) Com_ProfBegin(name); } while (0)
+#define PROF_END() do { if (com_profiling) Com_ProfEnd(); } while (0)
+#else
+#define PROF_BEGIN(name)
+#define PROF_END()
+#endif
+
 /*
 ==============================================================
 
@@ -1352,8 +1371,11 @@ void Huff_Decompress(msg_t *buf, int offset);
 // static huffman functions
 void HuffmanPutBit(byte *fout, int32_t bitIndex, int bit);
 int HuffmanPutSymbol(byte *fout, uint32_t offset, int symbol);
+int HuffmanPutBits(byte *fout, int32_t bitIndex, uint32_t value, int rawBits, int numSymbols);
 int HuffmanGetBit(const byte *buffer, int bitIndex);
+int HuffmanGetBits(const byte *buffer, int bitIndex, int count);
 int HuffmanGetSymbol(unsigned int *symbol, const byte *buffer, int bitIndex);
+void Huffman_Bench_f(void);
 
 #define SV_ENCODE_START 4
 #define SV_DECODE_START 12
@@ -218,6 +218,17 @@ static const char *vmName[VM_COUNT] = {
 	"cgame",
 	"ui"};
 
+#ifdef USE_PROFILER
+// scope names for the CPU profiler
+static const char *vmCallName[VM_COUNT] = {
+	"VM_Call qagame",
+#ifndef USE_DEDICATED
+	"VM_Call cgame",
+	"VM_Call ui",
+#endif
+};
+#endif
+
 static void VM_VmInfo_f(void);
 static void VM_VmProfile_f(void);
 
@@ -2204,6 +2215,8 @@ intptr_t QDECL VM_Call(vm_t *vm, int nargs, int callnum, ...)
 	}
 #endif
 
+	PROF_BEGIN(vmCallName[vm->index]);
+
 	++vm->callLevel;
 	// if we have a dll loaded, call it directly
 	if (vm->entryPoint)
@@ -2251,6 +2264,8 @@ intptr_t QDECL VM_Call(vm_t *vm, int nargs, int callnum, ...)
 	}
 	--vm->callLevel;
 
+	PROF_END();
+
 	return r;
 }
 
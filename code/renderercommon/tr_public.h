@@ -25,7 +25,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include "tr_types.h"
 #include "vulkan/vulkan.h"
 
-#define	REF_API_VERSION		8
+#define	REF_API_VERSION		10
 
 //
 // these are the functions exported by the refresh module
@@ -88,8 +88,8 @@ typedef struct {
 
 	void	(*BeginFrame)( stereoFrame_t stereoFrame );
 
-	// if the pointers are not NULL, timing info will be returned
-	void	(*EndFrame)( int *frontEndMsec, int *backEndMsec );
+	// if the pointers are not NULL, timing info will be returned in microseconds
+	void	(*EndFrame)( int *frontEndUsec, int *backEndUsec );
 
 
 	int		(*MarkFragments)( int numPoints, const vec3_t *points, const vec3_t projection,
@@ -140,6 +140,12 @@ typedef struct {
 
 	int64_t	(*Microseconds)( void );
 
+	// CPU profiler scopes, no-ops unless com_profile is set
+	// which *profiling follows, so callers can skip the call
+	const int	*profiling;
+	void	(*ProfBegin)( const char *name );
+	void	(*ProfEnd)( void );
+
 	// stack based memory allocation for per-level things that
 	// won't be freed
 #ifdef HUNK_DEBUG
@@ -202,6 +208,8 @@ typedef struct {
 	size_t	(*CL_SaveJPGToBuffer)( byte *buffer, size_t bufSize, int quality, int image_width, int image_height, byte *image_buffer, int padding );
 	void	(*CL_SaveJPG)( const char *filename, int quality, int image_width, int image_height, byte *image_buffer, int padding );
 	void	(*CL_LoadJPG)( const char *filename, unsigned char **pic, int *width, int *height );
+	// decodes a file already in memory, safe to call from any thread, nothing is printed on failure
+	bool	(*CL_DecodeJPG)( const byte *data, int len, void *(*alloc)( int size ), void (*release)( void *ptr ), unsigned char **pic, int *width, int *height );
 
 	bool 	(*CL_IsMinimized)( void );
 	void	(*CL_SetScaling)( float factor, int captureWidth, int captureHeight );
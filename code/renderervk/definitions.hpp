@@ -39,6 +39,7 @@ constexpr int MAX_IMAGE_CHUNKS = 56;
 constexpr int MAX_SWAPCHAIN_IMAGES = 8;
 constexpr int MAX_ATTACHMENTS_IN_POOL(8 + VK_NUM_BLOOM_PASSES * 2); // depth + msaa + msaa-resolve + depth-resolve + screenmap.msaa + screenmap.resolve + screenmap.depth + bloom_extract + blur pairs
 constexpr int NUM_COMMAND_BUFFERS = 2;                              // number of command buffers / render semaphores / framebuffer sets
+constexpr int NUM_STAGING_BUFFERS = 3;                              // image upload ring: one being filled, the rest may be in flight
 constexpr int MAX_VK_PIPELINES = ((1024 + 128) * 2);
 
 typedef unsigned char byte;
@@ -383,6 +384,7 @@ struct Vk_Instance
     struct { 
         vk::DeviceSize vertex_buffer_max{}; 
         uint32_t push_size{}, push_size_max{}; 
+        uint32_t staging_submits{}, staging_stalls{};
     } stats;
 
 
@@ -489,9 +491,11 @@ struct Vk_Instance
     bool active{};
     bool wideLines{};
     bool samplerAnisotropy{};
+    bool textureCompressionBC{}; // BC1/BC3/BC7 sampled images, enabled by r_ext_compressed_textures
     bool fragmentStores{};
     bool dedicatedAllocation{};
     bool debugMarkers{};
+    bool pipelineCreationFeedback{}; // VK_EXT_pipeline_creation_feedback, counts pipeline cache hits
 
     float maxAnisotropy{};
     float maxLod{};
@@ -506,6 +510,7 @@ struct Vk_Instance
     bool clearAttachment{};		// requires VK_IMAGE_USAGE_TRANSFER_DST_BIT for swapchains
     bool fboActive{};
     bool blitEnabled{};
+    bool mipBlitEnabled{}; // RGBA8 mip chains can be generated with vkCmdBlitImage
     bool msaaActive{};
 
     bool offscreenRender{};
@@ -546,6 +551,17 @@ struct Vk_Instance
 #endif
 	} staging_buffer;
 
+#ifdef USE_UPLOAD_QUEUE
+	// submitted staging buffers, the current one is swapped with the oldest on every flush
+	struct staging_slot_s {
+		staging_buffer_s buffer{};
+		vk::CommandBuffer command_buffer{};
+		vk::Fence fence{};
+		bool fence_wait{};
+	} staging_ring[NUM_STAGING_BUFFERS - 1]{};
+	uint32_t staging_ring_index{};
+#endif
+
 	struct samplers_s {
 		int count{};
 		Vk_Sampler_Def def[MAX_VK_SAMPLERS]{};
@@ -32,12 +32,15 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include "vk_vbo.hpp"
 #include "vk.hpp"
 #include "tr_cmds.hpp"
+#include "tr_smp.hpp"
 #include "string_operations.hpp"
 #include "vk_descriptors.hpp"
 #include "vk_render_pass.hpp"
 #include "vk_pipeline.hpp"
+#include "vk_profiler.hpp"
 
 backEndData_t *backEndData;
+backEndData_t *backEndBuffers[SMP_FRAMES];
 backEndState_t backEnd;
 
 /*
@@ -195,6 +198,171 @@ static void RB_BeginDrawingView( void ) {
 static void RB_LightingPass(void);
 #endif
 
+/*
+==============================================================================
+
+Instanced batches
+
+Consecutive MD3 surfaces with the same sort apart from the entity number
+normally end up in one batch per entity, each with its own modelview matrix.
+When the entities agree on everything the shader reads from them, their
+vertexes are moved to world space instead and the whole run is drawn as one
+batch with the world matrix. Per-entity lighting is kept in tess.instances.
+Stages that read positions or normals as entity-local, or compare them with
+the view origin, would see world space instead and are left alone.
+
+==============================================================================
+*/
+
+static bool RB_InstanceShader(const shader_t &shader)
+{
+	int i, b;
+
+	if (shader.entityMergable || shader.numDeforms || shader.isSky || &shader == tr.shadowShader)
+		return false;
+
+	for (i = 0; i < MAX_SHADER_STAGES; i++)
+	{
+		const shaderStage_t *pStage = shader.stages[i];
+		if (!pStage)
+			break;
+		for (b = 0; b < NUM_TEXTURE_BUNDLES; b++)
+		{
+			const textureBundle_t &bundle = pStage->bundle[b];
+			int tm;
+
+			// specular uses a fixed light origin in model space,
+			// portal alpha measures model space vertexes from the world view origin
+			if (bundle.alphaGen == alphaGen_t::AGEN_LIGHTING_SPECULAR || bundle.alphaGen == alphaGen_t::AGEN_PORTAL)
+				return false;
+
+			// vector texgen and environment reflections turn with the entity axis
+			if (bundle.tcGen == texCoordGen_t::TCGEN_VECTOR || bundle.tcGen == texCoordGen_t::TCGEN_ENVIRONMENT_MAPPED ||
+				bundle.tcGen == texCoordGen_t::TCGEN_ENVIRONMENT_MAPPED_FP)
+				return false;
+
+			// turbulence is phased by vertex position
+			for (tm = 0; tm < bundle.numTexMods; tm++)
+			{
+				if (bundle.texMods[tm].type == texMod_t::TMOD_TURBULENT)
+					return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+static bool RB_InstanceEntity(const trRefEntity_t &ent)
+{
+	return (ent.e.renderfx & (RF_DEPTHHACK | RF_FIRST_PERSON)) == 0 && !ent.e.nonNormalizedAxes;
+}
+
+// everything the stage iterator takes from backEnd.currentEntity apart from lighting
+static bool RB_SameInstanceState(const trRefEntity_t &a, const trRefEntity_t &b)
+{
+	return a.e.shader.u32 == b.e.shader.u32 && a.e.shaderTime.i == b.e.shaderTime.i && a.intShaderTime == b.intShaderTime &&
+		   a.e.shaderTexCoord[0] == b.e.shaderTexCoord[0] && a.e.shaderTexCoord[1] == b.e.shaderTexCoord[1] &&
+		   a.e.renderfx == b.e.renderfx;
+}
+
+/*
+==================
+RB_CanInstance
+
+Checks whether the surfaces after the current entity's run can join its batch
+==================
+*/
+static bool RB_CanInstance(const drawSurf_t *drawSurf, const drawSurf_t *end, const trRefEntity_t &ent)
+{
+	const unsigned int sort = drawSurf->sort;
+	int entityNum;
+
+	if (*drawSurf->surface != surfaceType_t::SF_MD3)
+		return false;
+
+	// skip the other surfaces of this entity
+	while (drawSurf < end && drawSurf->sort == sort)
+		drawSurf++;
+
+	if (drawSurf == end || ((drawSurf->sort ^ sort) & ~QSORT_REFENTITYNUM_MASK) || *drawSurf->surface != surfaceType_t::SF_MD3)
+		return false;
+
+	entityNum = (drawSurf->sort >> QSORT_REFENTITYNUM_SHIFT) & REFENTITYNUM_MASK;
+	if (entityNum == REFENTITYNUM_WORLD)
+		return false;
+
+	const trRefEntity_t &next = backEnd.refdef.entities[entityNum];
+
+	return RB_InstanceEntity(next) && RB_SameInstanceState(ent, next);
+}
+
+/*
+==================
+RB_BeginInstance
+==================
+*/
+static void RB_BeginInstance(const trRefEntity_t &ent)
+{
+	tessInstance_t *inst;
+
+	if (tess.numInstances == MAX_TESS_INSTANCES)
+	{
+		RB_EndSurface();
+		RB_BeginSurface(*tess.shader, tess.fogNum);
+	}
+
+	inst = &tess.instances[tess.numInstances++];
+	inst->entity = &ent;
+	inst->firstVertex = tess.numVertexes;
+
+	// lightDir is kept in entity space
+	VectorScale(ent.e.axis[0], ent.lightDir[0], inst->lightDir);
+	VectorMA(inst->lightDir, ent.lightDir[1], ent.e.axis[1], inst->lightDir);
+	VectorMA(inst->lightDir, ent.lightDir[2], ent.e.axis[2], inst->lightDir);
+}
+
+/*
+==================
+RB_AddInstanceSurface
+
+Tessellates in entity space and moves the new vertexes to world space
+==================
+*/
+static void RB_AddInstanceSurface(const surfaceType_t *surface)
+{
+	const trRefEntity_t &ent = *backEnd.currentEntity;
+	vec3_t v;
+	int i;
+
+	rb_surfaceTable[static_cast<uint32_t>(*surface)](const_cast<surfaceType_t *>(surface));
+
+	if (tess.numInstances == 0)
+	{
+		// tess was flushed on overflow
+		RB_BeginInstance(ent);
+		tess.instances[0].firstVertex = 0;
+	}
+
+	for (i = tess.instanceVertexes; i < tess.numVertexes; i++)
+	{
+		VectorCopy(tess.xyz[i], v);
+		VectorMA(ent.e.origin, v[0], ent.e.axis[0], tess.xyz[i]);
+		VectorMA(tess.xyz[i], v[1], ent.e.axis[1], tess.xyz[i]);
+		VectorMA(tess.xyz[i], v[2], ent.e.axis[2], tess.xyz[i]);
+#ifdef USE_TESS_NEEDS_NORMAL
+		if (!tess.needsNormal)
+			continue;
+#endif
+		VectorCopy(tess.normal[i], v);
+		VectorScale(ent.e.axis[0], v[0], tess.normal[i]);
+		VectorMA(tess.normal[i], v[1], ent.e.axis[1], tess.normal[i]);
+		VectorMA(tess.normal[i], v[2], ent.e.axis[2], tess.normal[i]);
+	}
+
+	tess.instanceVertexes = tess.numVertexes;
+}
+
 /*
 ==================
 RB_RenderDrawSurfList
@@ -214,6 +382,7 @@ static void RB_RenderDrawSurfList(drawSurf_t *drawSurfs, const int numDrawSurfs)
 	float oldShaderSort;
 #endif
 	double originalTime; // -EC-
+	bool instanced;
 
 	// save original time for entity shader offsets
 	originalTime = backEnd.refdef.floatTime;
@@ -227,6 +396,7 @@ static void RB_RenderDrawSurfList(drawSurf_t *drawSurfs, const int numDrawSurfs)
 	oldShaderSort = -1;
 #endif
 	depthRange = false;
+	instanced = false;
 
 	backEnd.pc.c_surfaces += numDrawSurfs;
 
@@ -235,7 +405,10 @@ static void RB_RenderDrawSurfList(drawSurf_t *drawSurfs, const int numDrawSurfs)
 		if (drawSurf->sort == oldSort)
 		{
 			// fast path, same as previous sort
-			rb_surfaceTable[static_cast<uint32_t>(*drawSurf->surface)](drawSurf->surface);
+			if (instanced)
+				RB_AddInstanceSurface(drawSurf->surface);
+			else
+				rb_surfaceTable[static_cast<uint32_t>(*drawSurf->surface)](drawSurf->surface);
 			continue;
 		}
 
@@ -246,15 +419,40 @@ static void RB_RenderDrawSurfList(drawSurf_t *drawSurfs, const int numDrawSurfs)
 			continue;
 		}
 		//
+		// another entity joins the instanced batch, no matrix change needed
+		//
+		if (instanced && ((oldSort ^ drawSurf->sort) & ~QSORT_REFENTITYNUM_MASK) == 0 && entityNum != REFENTITYNUM_WORLD &&
+			*drawSurf->surface == surfaceType_t::SF_MD3)
+		{
+			const trRefEntity_t &ent = backEnd.refdef.entities[entityNum];
+
+			if (RB_InstanceEntity(ent) && RB_SameInstanceState(*backEnd.currentEntity, ent))
+			{
+				backEnd.currentEntity = &ent;
+				backEnd.pc.c_instanceEntities++;
+				backEnd.pc.c_instanceDrawsSaved += tess.numPasses;
+				RB_BeginInstance(ent);
+				RB_AddInstanceSurface(drawSurf->surface);
+				oldSort = drawSurf->sort;
+				oldEntityNum = entityNum;
+				continue;
+			}
+		}
+		//
 		// change the tess parameters if needed
 		// a "entityMergable" shader is a shader that can have surfaces from separate
 		// entities merged into a single batch, like smoke and blood puff sprites
-		if (((oldSort ^ drawSurfs->sort) & ~QSORT_REFENTITYNUM_MASK) || !shader->entityMergable)
+		if (instanced || ((oldSort ^ drawSurfs->sort) & ~QSORT_REFENTITYNUM_MASK) || !shader->entityMergable)
 		{
 			//if (oldShader != NULL)
 			//{
 				RB_EndSurface();
 			//}
+			if (instanced)
+			{
+				instanced = false;
+				oldEntityNum = -1; // back to entity space
+			}
 #ifdef USE_PMLIGHT
 #define INSERT_POINT shaderSort_t::SS_FOG
 			if (backEnd.refdef.numLitSurfs && oldShaderSort < static_cast<float>(INSERT_POINT) && shader->sort >= static_cast<float>(INSERT_POINT))
@@ -267,6 +465,16 @@ static void RB_RenderDrawSurfList(drawSurf_t *drawSurfs, const int numDrawSurfs)
 #endif
 			RB_BeginSurface(*shader, fogNum);
 			oldShader = shader;
+
+			if (r_instancing->integer && entityNum != REFENTITYNUM_WORLD && !dlighted && RB_InstanceShader(*tess.shader) &&
+				RB_InstanceEntity(backEnd.refdef.entities[entityNum]) &&
+				RB_CanInstance(drawSurf, drawSurfs + numDrawSurfs, backEnd.refdef.entities[entityNum]))
+			{
+				instanced = true;
+				oldEntityNum = -1; // force world matrix setup
+				backEnd.pc.c_instanceBatches++;
+				backEnd.pc.c_instanceEntities++;
+			}
 		}
 
 		oldSort = drawSurf->sort;
@@ -286,8 +494,11 @@ static void RB_RenderDrawSurfList(drawSurf_t *drawSurfs, const int numDrawSurfs)
 				else
 					backEnd.refdef.floatTime = originalTime - (double)backEnd.currentEntity->e.shaderTime.f;
 
-				// set up the transformation matrix
-				R_RotateForEntity(*backEnd.currentEntity, backEnd.viewParms, backEnd.ort);
+				// set up the transformation matrix, instances are moved to world space on the CPU
+				if (instanced)
+					backEnd.ort = backEnd.viewParms.world;
+				else
+					R_RotateForEntity(*backEnd.currentEntity, backEnd.viewParms, backEnd.ort);
 				// set up the dynamic lighting if needed
 #ifdef USE_LEGACY_DLIGHTS
 #ifdef USE_PMLIGHT
@@ -337,7 +548,15 @@ static void RB_RenderDrawSurfList(drawSurf_t *drawSurfs, const int numDrawSurfs)
 		}
 
 		// add the triangles for this surface
-		rb_surfaceTable[static_cast<uint32_t>(*drawSurf->surface)](drawSurf->surface);
+		if (instanced)
+		{
+			RB_BeginInstance(*backEnd.currentEntity);
+			RB_AddInstanceSurface(drawSurf->surface);
+		}
+		else
+		{
+			rb_surfaceTable[static_cast<uint32_t>(*drawSurf->surface)](drawSurf->surface);
+		}
 	}
 
 	// draw the contents of the last shader batch
@@ -593,6 +812,9 @@ void RE_UploadCinematic(int w, int h, int cols, int rows, byte *data, int client
 {
 	image_t *image;
 
+	// scratch image may still be sampled by the back end
+	R_SyncRenderThread();
+
 	if (!tr.scratchImage[client])
 	{
 		tr.scratchImage[client] = R_CreateImage(va_cpp("*scratch%i", client), {}, data, cols, rows, static_cast<imgFlags_t>(imgFlags_t::IMGFLAG_CLAMPTOEDGE | imgFlags_t::IMGFLAG_RGB | imgFlags_t::IMGFLAG_NOSCALE));
@@ -822,6 +1044,7 @@ RB_DrawSurfs
 static const void *RB_DrawSurfs(const void *data)
 {
 	const drawSurfsCommand_t *cmd;
+	gpuZone_t zone;
 
 	// finish any 2D drawing if needed
 	RB_EndSurface();
@@ -831,6 +1054,9 @@ static const void *RB_DrawSurfs(const void *data)
 	backEnd.refdef = cmd->refdef;
 	backEnd.viewParms = cmd->viewParms;
 
+	zone = (backEnd.viewParms.portalView != portalView_t::PV_NONE) ? gpuZone_t::GPU_ZONE_PORTAL : gpuZone_t::GPU_ZONE_VIEW;
+	vk_profiler_begin(zone);
+
 #ifdef USE_VBO
 	VBO_UnBind();
 #endif
@@ -853,13 +1079,17 @@ static const void *RB_DrawSurfs(const void *data)
 	RB_ShadowFinish();
 
 	// add light flares on lights that aren't obscured
+	vk_profiler_begin(gpuZone_t::GPU_ZONE_FLARES);
 	RB_RenderFlares();
+	vk_profiler_end(gpuZone_t::GPU_ZONE_FLARES);
 
 #ifdef USE_PMLIGHT
 	if (backEnd.refdef.numLitSurfs)
 	{
+		vk_profiler_begin(gpuZone_t::GPU_ZONE_DLIGHTS);
 		RB_BeginDrawingLitSurfs();
 		RB_LightingPass();
+		vk_profiler_end(gpuZone_t::GPU_ZONE_DLIGHTS);
 	}
 #endif
 
@@ -876,6 +1106,8 @@ static const void *RB_DrawSurfs(const void *data)
 	// TODO Maybe check for rdf_noworld stuff but q3mme has full 3d ui
 	backEnd.doneSurfaces = true; // for bloom
 
+	vk_profiler_end(zone);
+
 	return (const void *)(cmd + 1);
 }
 
@@ -890,6 +1122,9 @@ static const void *RB_DrawBuffer(const void *data)
 
 	cmd = (const drawBufferCommand_t *)data;
 
+	backEnd.doneBloom = false;
+	backEnd.color2D.u32 = ~0U;
+
 	vk_begin_frame();
 
 	tess.depthRange = Vk_Depth_Range::DEPTH_RANGE_NORMAL;
@@ -1092,8 +1327,6 @@ static const void *RB_SwapBuffers(const void *data)
 
 	cmd = (const swapBuffersCommand_t *)data;
 
-	tr.needScreenMap = 0;
-
 	vk_end_frame();
 
 	if ( backEnd.doneSurfaces && !glState.finishCalled ) {
@@ -1154,7 +1387,10 @@ RB_ExecuteRenderCommands
 */
 void RB_ExecuteRenderCommands(const void *data)
 {
-	backEnd.pc.msec = ri.Milliseconds();
+	backEnd.pc.usec = ri.Microseconds();
+	backEnd.cmds = data;
+
+	R_PROF_BEGIN("RB_ExecuteRenderCommands");
 
 	while (1)
 	{
@@ -1193,6 +1429,7 @@ void RB_ExecuteRenderCommands(const void *data)
 		default:
 			// stop rendering
 			vk_end_frame();
+			R_PROF_END();
 			return;
 		}
 	}
@@ -28,6 +28,8 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include "vk_vbo.hpp"
 #include "tr_shader.hpp"
 #include "tr_model.hpp"
+#include "tr_smp.hpp"
+#include "tr_prefetch.hpp"
 #include "math.hpp"
 #include "utils.hpp"
 #include "string_operations.hpp"
@@ -2096,6 +2098,38 @@ static void R_LoadShaders(const lump_t *l)
 	}
 }
 
+/*
+=================
+R_PrefetchWorldImages
+
+Hands the world shaders to the image prefetch in the order
+R_LoadSurfaces() is going to register them.
+=================
+*/
+static void R_PrefetchWorldImages(const lump_t *surfs)
+{
+	std::vector<std::string_view> names;
+	std::vector<bool> seen(s_worldData.numShaders);
+	const dsurface_t *in;
+	int i, count, shaderNum;
+
+	in = reinterpret_cast<const dsurface_t *>((fileBase + surfs->fileofs));
+	count = surfs->filelen / sizeof(*in);
+
+	for (i = 0; i < count; i++)
+	{
+		shaderNum = LittleLong(in[i].shaderNum);
+		if (shaderNum < 0 || shaderNum >= s_worldData.numShaders || seen[shaderNum])
+		{
+			continue;
+		}
+		seen[shaderNum] = true;
+		names.emplace_back(s_worldData.shaders[shaderNum].shader);
+	}
+
+	R_PrefetchImages(names);
+}
+
 /*
 =================
 R_LoadMarksurfaces
@@ -2524,6 +2558,10 @@ void RE_LoadWorldMap(const char *name)
 		ri.Error(ERR_DROP, "ERROR: attempted to redundantly load world map");
 	}
 
+	R_SyncRenderThread();
+
+	R_StartLoadPhases();
+
 	// set default sun direction to be used if it isn't
 	// overridden by a shader
 	tr.sunDirection[0] = 0.45f;
@@ -2586,22 +2624,31 @@ void RE_LoadWorldMap(const char *name)
 		}
 	}
 
+	R_LoadPhase("file");
+
 	// load into heap
 	R_LoadLightmaps(header->lumps[LUMP_LIGHTMAPS]);
+	R_LoadPhase("lightmaps");
 	R_PreLoadFogs(&header->lumps[LUMP_FOGS]);
 	R_LoadShaders(&header->lumps[LUMP_SHADERS]);
+	R_PrefetchWorldImages(&header->lumps[LUMP_SURFACES]);
+	R_LoadPhase("image prefetch setup");
 	R_LoadPlanes(&header->lumps[LUMP_PLANES]);
 	R_LoadFogs(&header->lumps[LUMP_FOGS], &header->lumps[LUMP_BRUSHES], &header->lumps[LUMP_BRUSHSIDES]);
 	R_LoadSurfaces(&header->lumps[LUMP_SURFACES], &header->lumps[LUMP_DRAWVERTS], &header->lumps[LUMP_DRAWINDEXES]);
+	R_ClearPrefetchedImages();
+	R_LoadPhase("surfaces, shaders and images");
 	R_LoadMarksurfaces(&header->lumps[LUMP_LEAFSURFACES]);
 	R_LoadNodesAndLeafs(&header->lumps[LUMP_NODES], &header->lumps[LUMP_LEAFS]);
 	R_LoadSubmodels(&header->lumps[LUMP_MODELS]);
 	R_LoadVisibility(header->lumps[LUMP_VISIBILITY]);
 	R_LoadEntities(&header->lumps[LUMP_ENTITIES]);
 	R_LoadLightGrid(&header->lumps[LUMP_LIGHTGRID]);
+	R_LoadPhase("bsp tree and lumps");
 
 #ifdef USE_VBO
 	R_BuildWorldVBO(*s_worldData.surfaces, s_worldData.numsurfaces);
+	R_LoadPhase("vbo");
 #endif
 
 	tr.mapLoading = false;
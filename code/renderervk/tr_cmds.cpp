@@ -25,9 +25,11 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include "tr_local.hpp"
 #include "tr_shader.hpp"
 #include "tr_scene.hpp"
+#include "tr_smp.hpp"
 #include "vk.hpp"
 #include "vk_pipeline.hpp"
 #include "utils.hpp"
+#include "vk_profiler.hpp"
 
 constexpr int MODE_RED_CYAN = 1;
 constexpr int MODE_RED_BLUE = 2;
@@ -41,18 +43,24 @@ R_PerformanceCounters
 */
 static void R_PerformanceCounters(void)
 {
+	backEndCounters_t &pc = R_BackEndCounters();
+
+	R_GPUProfilerFlushLog();
+
 	if (!r_speeds->integer)
 	{
 		// clear the counters even if we aren't printing
 		Com_Memset(&tr.pc, 0, sizeof(tr.pc));
-		Com_Memset(&backEnd.pc, 0, sizeof(backEnd.pc));
+		Com_Memset(&pc, 0, sizeof(pc));
 		return;
 	}
 
 	if (r_speeds->integer == 1) {
 		ri.Printf (PRINT_ALL, "%i/%i shaders/surfs %i leafs %i verts %i/%i tris %.2f mtex\n",
-			backEnd.pc.c_shaders, backEnd.pc.c_surfaces, tr.pc.c_leafs, backEnd.pc.c_vertexes, 
-			backEnd.pc.c_indexes/3, backEnd.pc.c_totalIndexes/3, R_SumOfUsedImages()/1000000.0); 
+			pc.c_shaders, pc.c_surfaces, tr.pc.c_leafs, pc.c_vertexes, 
+			pc.c_indexes/3, pc.c_totalIndexes/3, R_SumOfUsedImages()/1000000.0); 
+		ri.Printf(PRINT_ALL, "%i draws %i/%i instanced ents/batches %i draws saved\n",
+			pc.c_draws, pc.c_instanceEntities, pc.c_instanceBatches, pc.c_instanceDrawsSaved);
 	}
 	else if (r_speeds->integer == 2) {
 		ri.Printf(PRINT_ALL, "(patch) %i sin %i sclip  %i sout %i bin %i bclip %i bout\n",
@@ -68,11 +76,11 @@ static void R_PerformanceCounters(void)
 	}
 	else if (r_speeds->integer == 4)
 	{
-		if (backEnd.pc.c_dlightVertexes)
+		if (pc.c_dlightVertexes)
 		{
 			ri.Printf(PRINT_ALL, "dlight srf:%i  culled:%i  verts:%i  tris:%i\n",
 					  tr.pc.c_dlightSurfaces, tr.pc.c_dlightSurfacesCulled,
-					  backEnd.pc.c_dlightVertexes, backEnd.pc.c_dlightIndexes / 3);
+					  pc.c_dlightVertexes, pc.c_dlightIndexes / 3);
 		}
 	}
 	else if (r_speeds->integer == 5)
@@ -82,11 +90,23 @@ static void R_PerformanceCounters(void)
 	else if (r_speeds->integer == 6)
 	{
 		ri.Printf(PRINT_ALL, "flare adds:%i tests:%i renders:%i\n",
-				  backEnd.pc.c_flareAdds, backEnd.pc.c_flareTests, backEnd.pc.c_flareRenders);
+				  pc.c_flareAdds, pc.c_flareTests, pc.c_flareRenders);
+	}
+	else if (r_speeds->integer == 7)
+	{
+		const smpCounters_t &smp = R_SMPCounters();
+		ri.Printf(PRINT_ALL, "%s: front %.2f back %.2f wait %.2f overlap %.2f msec (%i%%)\n",
+				  R_RenderThreadActive() ? "smp" : "serial",
+				  smp.frontUsec / 1000.0, smp.backUsec / 1000.0, smp.waitUsec / 1000.0, smp.overlapUsec / 1000.0,
+				  smp.backUsec ? smp.overlapUsec * 100 / smp.backUsec : 0);
+	}
+	else if (r_speeds->integer == 8)
+	{
+		R_GPUProfilerPrint();
 	}
 
 	Com_Memset(&tr.pc, 0, sizeof(tr.pc));
-	Com_Memset(&backEnd.pc, 0, sizeof(backEnd.pc));
+	Com_Memset(&pc, 0, sizeof(pc));
 }
 
 /*
@@ -123,8 +143,16 @@ static void R_IssueRenderCommands(void)
 	// actually start the commands going
 	if (!r_skipBackEnd->integer)
 	{
-		// let it start on the new batch
-		RB_ExecuteRenderCommands(cmdList.cmds);
+		// let it start on the new batch, frames with pending
+		// screenshots or video capture are finished in place
+		R_SubmitRenderCommands(cmdList.cmds, backEnd.screenshotMask != 0);
+
+		if (R_RenderThreadActive())
+		{
+			// keep building the next frame in the other buffer
+			tr.smpFrame ^= 1;
+			backEndData = backEndBuffers[tr.smpFrame];
+		}
 	}
 }
 
@@ -287,9 +315,6 @@ void RE_BeginFrame(stereoFrame_t stereoFrame)
 		return;
 	}
 
-	backEnd.doneBloom = false;
-	backEnd.color2D.u32 = ~0U;
-
 	tr.frameCount++;
 	tr.frameSceneNum = 0;
 
@@ -352,6 +377,9 @@ void RE_TakeVideoFrame(int width, int height,
 		return;
 	}
 
+	// back end owns the capture state while it is replaying a frame
+	R_SyncRenderThread();
+
 	backEnd.screenshotMask |= SCREENSHOT_AVI;
 
 	videoFrameCommand_t &cmd = backEnd.vcmd;
@@ -409,10 +437,10 @@ void RE_VertexLighting(bool allowed)
 =============
 RE_EndFrame
 
-Returns the number of msec spent in the back end
+Returns the number of usec spent in the front end and the back end
 =============
 */
-void RE_EndFrame(int *frontEndMsec, int *backEndMsec)
+void RE_EndFrame(int *frontEndUsec, int *backEndUsec)
 {
 
 	swapBuffersCommand_t *cmd;
@@ -431,27 +459,29 @@ void RE_EndFrame(int *frontEndMsec, int *backEndMsec)
 
 	R_IssueRenderCommands();
 
-	R_PerformanceCounters();
-
-	R_InitNextFrame();
+	tr.needScreenMap = 0;
 
-	if (frontEndMsec)
+	if (backEndUsec)
 	{
-		*frontEndMsec = tr.frontEndMsec;
+		*backEndUsec = static_cast<int>(R_BackEndCounters().usec);
 	}
-	tr.frontEndMsec = 0;
 
-	if (backEndMsec)
+	R_PerformanceCounters();
+
+	R_InitNextFrame();
+
+	if (frontEndUsec)
 	{
-		*backEndMsec = backEnd.pc.msec;
+		*frontEndUsec = static_cast<int>(tr.frontEndUsec);
 	}
-	backEnd.pc.msec = 0;
+	tr.frontEndUsec = 0;
 
 	backEnd.throttle = false;
 
 	// recompile GPU shaders if needed
 	if (ri.Cvar_CheckGroup(CVG_RENDERER))
 	{
+		R_SyncRenderThread();
 
 		// texturemode stuff
 		if (r_textureMode->modified)
@@ -16,6 +16,6 @@ void RE_FinishBloom();
 bool RE_CanMinimize();
 const glconfig_t *RE_GetConfig();
 void RE_VertexLighting(bool allowed);
-void RE_EndFrame(int *frontEndMsec, int *backEndMsec);
+void RE_EndFrame(int *frontEndUsec, int *backEndUsec);
 
 #endif // TR_CMDS_HPP
@@ -25,6 +25,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include "tr_local.hpp"
 #include "vk.hpp"
 #include "tr_shader.hpp"
+#include "tr_smp.hpp"
 #include "utils.hpp"
 #include "vk_descriptors.hpp"
 
@@ -37,6 +38,9 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include <string>
 #include <span>
 #include "vk_pipeline.hpp"
+#include "tr_prefetch.hpp"
+#include "tr_image_kernels.hpp"
+#include "tr_image_bc.hpp"
 
 // Note that the ordering indicates the order of preference used
 // when there are multiple images of different formats available
@@ -185,6 +189,8 @@ void R_SetColorMappings()
 		return;
 	}
 
+	R_SyncRenderThread();
+
 	int i, j;
 	float g;
 	int inf;
@@ -354,6 +360,8 @@ void TextureMode(std::string_view sv_mode)
 	image_t* img;
 	int i;
 
+	R_SyncRenderThread();
+
 	for (i = 0; i < static_cast<int>(arrayLen(modes)); i++)
 	{
 		if (!Q_stricmp_cpp(modes[i].name, sv_mode))
@@ -431,6 +439,17 @@ void R_ImageList_f(void)
 			format = "RGB  ";
 			estSize *= 2;
 			break;
+		case vk::Format::eBc1RgbUnormBlock:
+		case vk::Format::eBc1RgbaUnormBlock:
+			format = "BC1  ";
+			estSize /= 2;
+			break;
+		case vk::Format::eBc3UnormBlock:
+			format = "BC3  ";
+			break;
+		case vk::Format::eBc7UnormBlock:
+			format = "BC7  ";
+			break;
 		default:
 			ri.Printf(PRINT_ALL, "Unsupported vk::format of image->internalFormat \n");
 			break;
@@ -553,12 +572,11 @@ before or after.
 static void ResampleTexture(unsigned* in, int inwidth, int inheight, unsigned* out,
 	int outwidth, int outheight)
 {
-	int i, j;
+	int i;
 	unsigned* inrow, * inrow2;
 	unsigned frac, fracstep;
 	std::array<unsigned, MAX_TEXTURE_SIZE> p1{};
 	std::array<unsigned, MAX_TEXTURE_SIZE> p2{};
-	byte* pix1, * pix2, * pix3, * pix4;
 
 	if (outwidth > static_cast<int>(p1.size()))
 		ri.Error(ERR_DROP, "ResampleTexture: max width");
@@ -582,17 +600,7 @@ static void ResampleTexture(unsigned* in, int inwidth, int inheight, unsigned* o
 	{
 		inrow = in + inwidth * (int)((i + 0.25) * inheight / outheight);
 		inrow2 = in + inwidth * (int)((i + 0.75) * inheight / outheight);
-		for (j = 0; j < outwidth; j++)
-		{
-			pix1 = (byte*)inrow + p1[j];
-			pix2 = (byte*)inrow + p2[j];
-			pix3 = (byte*)inrow2 + p1[j];
-			pix4 = (byte*)inrow2 + p2[j];
-			((byte*)(out + j))[0] = (pix1[0] + pix2[0] + pix3[0] + pix4[0]) >> 2;
-			((byte*)(out + j))[1] = (pix1[1] + pix2[1] + pix3[1] + pix4[1]) >> 2;
-			((byte*)(out + j))[2] = (pix1[2] + pix2[2] + pix3[2] + pix4[2]) >> 2;
-			((byte*)(out + j))[3] = (pix1[3] + pix2[3] + pix3[3] + pix4[3]) >> 2;
-		}
+		imageKernels.resampleRow(out, inrow, inrow2, p1.data(), p2.data(), outwidth);
 	}
 }
 
@@ -606,10 +614,6 @@ Proper linear filter
 */
 static void R_MipMap2(unsigned* const out, unsigned* const in, int inWidth, int inHeight)
 {
-	int i, j, k;
-	byte* outpix;
-	int inWidthMask, inHeightMask;
-	int total;
 	int outWidth, outHeight;
 	unsigned* temp;
 
@@ -621,40 +625,7 @@ static void R_MipMap2(unsigned* const out, unsigned* const in, int inWidth, int
 	else
 		temp = out;
 
-	inWidthMask = inWidth - 1;
-	inHeightMask = inHeight - 1;
-
-	for (i = 0; i < outHeight; i++)
-	{
-		for (j = 0; j < outWidth; j++)
-		{
-			outpix = (byte*)(temp + i * outWidth + j);
-			for (k = 0; k < 4; k++)
-			{
-				total =
-					1 * ((byte*)&in[((i * 2 - 1) & inHeightMask) * inWidth + ((j * 2 - 1) & inWidthMask)])[k] +
-					2 * ((byte*)&in[((i * 2 - 1) & inHeightMask) * inWidth + ((j * 2) & inWidthMask)])[k] +
-					2 * ((byte*)&in[((i * 2 - 1) & inHeightMask) * inWidth + ((j * 2 + 1) & inWidthMask)])[k] +
-					1 * ((byte*)&in[((i * 2 - 1) & inHeightMask) * inWidth + ((j * 2 + 2) & inWidthMask)])[k] +
-
-					2 * ((byte*)&in[((i * 2) & inHeightMask) * inWidth + ((j * 2 - 1) & inWidthMask)])[k] +
-					4 * ((byte*)&in[((i * 2) & inHeightMask) * inWidth + ((j * 2) & inWidthMask)])[k] +
-					4 * ((byte*)&in[((i * 2) & inHeightMask) * inWidth + ((j * 2 + 1) & inWidthMask)])[k] +
-					2 * ((byte*)&in[((i * 2) & inHeightMask) * inWidth + ((j * 2 + 2) & inWidthMask)])[k] +
-
-					2 * ((byte*)&in[((i * 2 + 1) & inHeightMask) * inWidth + ((j * 2 - 1) & inWidthMask)])[k] +
-					4 * ((byte*)&in[((i * 2 + 1) & inHeightMask) * inWidth + ((j * 2) & inWidthMask)])[k] +
-					4 * ((byte*)&in[((i * 2 + 1) & inHeightMask) * inWidth + ((j * 2 + 1) & inWidthMask)])[k] +
-					2 * ((byte*)&in[((i * 2 + 1) & inHeightMask) * inWidth + ((j * 2 + 2) & inWidthMask)])[k] +
-
-					1 * ((byte*)&in[((i * 2 + 2) & inHeightMask) * inWidth + ((j * 2 - 1) & inWidthMask)])[k] +
-					2 * ((byte*)&in[((i * 2 + 2) & inHeightMask) * inWidth + ((j * 2) & inWidthMask)])[k] +
-					2 * ((byte*)&in[((i * 2 + 2) & inHeightMask) * inWidth + ((j * 2 + 1) & inWidthMask)])[k] +
-					1 * ((byte*)&in[((i * 2 + 2) & inHeightMask) * inWidth + ((j * 2 + 2) & inWidthMask)])[k];
-				outpix[k] = total / 36;
-			}
-		}
-	}
+	imageKernels.mipMap2(temp, in, inWidth, inHeight);
 
 	if (out == in)
 	{
@@ -672,8 +643,7 @@ Operates in place, quartering the size of the texture
 */
 static void R_MipMap(byte* out, byte* in, int width, int height)
 {
-	int i, j;
-	int row;
+	int i;
 
 	if (in == NULL)
 		return;
@@ -689,13 +659,9 @@ static void R_MipMap(byte* out, byte* in, int width, int height)
 		return;
 	}
 
-	row = width * 4;
-	width >>= 1;
-	height >>= 1;
-
-	if (width == 0 || height == 0)
+	if (width == 1 || height == 1)
 	{
-		width += height; // get largest
+		width = (width >> 1) + (height >> 1); // get largest
 		for (i = 0; i < width; i++, out += 4, in += 8)
 		{
 			out[0] = (in[0] + in[4]) >> 1;
@@ -706,19 +672,10 @@ static void R_MipMap(byte* out, byte* in, int width, int height)
 		return;
 	}
 
-	for (i = 0; i < height; i++, in += row)
-	{
-		for (j = 0; j < width; j++, out += 4, in += 8)
-		{
-			out[0] = (in[0] + in[4] + in[row + 0] + in[row + 4]) >> 2;
-			out[1] = (in[1] + in[5] + in[row + 1] + in[row + 5]) >> 2;
-			out[2] = (in[2] + in[6] + in[row + 2] + in[row + 6]) >> 2;
-			out[3] = (in[3] + in[7] + in[row + 3] + in[row + 7]) >> 2;
-		}
-	}
+	imageKernels.mipMapBox(out, in, width, height);
 }
 
-static void generate_image_upload_data(image_t* image, byte* data, Image_Upload_Data* upload_data)
+static void generate_image_upload_data(image_t* image, byte* data, Image_Upload_Data* upload_data, bool gpu_mips)
 {
 
 	bool mipmap = HasFlag(image->flags, imgFlags_t::IMGFLAG_MIPMAP);
@@ -874,7 +831,18 @@ static void generate_image_upload_data(image_t* image, byte* data, Image_Upload_
 	Com_Memcpy(upload_data->buffer, scaled_buffer, mip_level_size);
 	upload_data->buffer_size = mip_level_size;
 
-	if (mipmap)
+	if (mipmap && gpu_mips)
+	{
+		// level 0 is already light scaled, the blits only average it down
+		while (scaled_width > 1 && scaled_height > 1)
+		{
+			scaled_width >>= 1;
+			scaled_height >>= 1;
+			miplevel++;
+		}
+		upload_data->gpu_mips = true;
+	}
+	else if (mipmap)
 	{
 		while (scaled_width > 1 && scaled_height > 1)
 		{
@@ -909,18 +877,50 @@ static void generate_image_upload_data(image_t* image, byte* data, Image_Upload_
 		ri.Hunk_FreeTempMemory(resampled_buffer);
 }
 
+static void upload_compressed_image(image_t* image, const compressedImage_t& compressed)
+{
+	image->internalFormat = compressed.format;
+	image->uploadWidth = compressed.width;
+	image->uploadHeight = compressed.height;
+
+	vk_create_image(*image, compressed.width, compressed.height, compressed.levels);
+	vk_upload_image_data(*image, 0, 0, compressed.width, compressed.height, compressed.levels, compressed.data, compressed.size, false);
+}
+
 static void upload_vk_image(image_t* image, byte* pic)
 {
 
 	Image_Upload_Data upload_data;
 	int w, h;
 
-	generate_image_upload_data(image, pic, &upload_data);
+	const bool rgba8 = r_texturebits->integer > 16 || r_texturebits->integer == 0 || HasFlag(image->flags, imgFlags_t::IMGFLAG_LIGHTMAP);
+
+	// lightmaps are updated in place and need exact colors
+	const bool compress = vk_inst.textureCompressionBC && pic != nullptr && HasFlag(image->flags, imgFlags_t::IMGFLAG_MIPMAP) &&
+		!HasFlag(image->flags, imgFlags_t::IMGFLAG_LIGHTMAP) && !HasFlag(image->flags, imgFlags_t::IMGFLAG_NO_COMPRESSION);
+
+	// r_colorMipLevels tints every level on the CPU, the encoder needs the whole chain in memory
+	const bool gpu_mips = !compress && rgba8 && r_gpuMipMaps->integer && vk_inst.mipBlitEnabled && !r_colorMipLevels->integer;
+
+	generate_image_upload_data(image, pic, &upload_data, gpu_mips);
 
 	w = upload_data.base_level_width;
 	h = upload_data.base_level_height;
 
-	if (r_texturebits->integer > 16 || r_texturebits->integer == 0 || (HasFlag(image->flags, imgFlags_t::IMGFLAG_LIGHTMAP)))
+	if (compress)
+	{
+		compressedImage_t compressed;
+
+		if (R_CompressImage(upload_data.buffer, w, h, upload_data.mip_levels, compressed))
+		{
+			upload_compressed_image(image, compressed);
+			R_FreeCompressedImage(compressed);
+			ri.Hunk_FreeTempMemory(upload_data.buffer);
+			return;
+		}
+	}
+
+	if (rgba8)
 	{
 		image->internalFormat = vk::Format::eR8G8B8A8Unorm;
 		// image->internalFormat = VK_FORMAT_B8G8R8A8_UNORM;
@@ -934,21 +934,20 @@ static void upload_vk_image(image_t* image, byte* pic)
 	image->uploadWidth = w;
 	image->uploadHeight = h;
 
-	vk_create_image(*image, w, h, upload_data.mip_levels);
-	vk_upload_image_data(*image, 0, 0, w, h, upload_data.mip_levels, upload_data.buffer, upload_data.buffer_size, false);
+	vk_create_image(*image, w, h, upload_data.mip_levels, upload_data.gpu_mips);
+	vk_upload_image_data(*image, 0, 0, w, h, upload_data.mip_levels, upload_data.buffer, upload_data.buffer_size, false, upload_data.gpu_mips);
 
 	ri.Hunk_FreeTempMemory(upload_data.buffer);
 }
 
 /*
 ================
-R_CreateImage
+R_AllocImage
 
-This is the only way any image_t are created
-Picture data may be modified in-place during mipmap processing
+Registers a new image_t, the caller uploads its contents
 ================
 */
-image_t* R_CreateImage(std::string_view name, std::string_view name2, byte* pic, int width, int height, imgFlags_t flags)
+static image_t* R_AllocImage(std::string_view name, std::string_view name2, int width, int height, imgFlags_t flags)
 {
 	image_t* image;
 	long hash;
@@ -960,6 +959,9 @@ image_t* R_CreateImage(std::string_view name, std::string_view name2, byte* pic,
 		ri.Error(ERR_DROP, "R_CreateImage: \"%s\" is too long", name.data());
 	}
 
+	// uploads go through the same queue the back end submits to
+	R_SyncRenderThread();
+
 	if (!name2.empty() && Q_stricmp_cpp(name, name2) != 0)
 	{
 		// leave only file name
@@ -1023,10 +1025,94 @@ image_t* R_CreateImage(std::string_view name, std::string_view name2, byte* pic,
 	image->view = VK_NULL_HANDLE;
 	image->descriptor = VK_NULL_HANDLE;
 
+	return image;
+}
+
+/*
+================
+R_CreateImage
+
+This is the only way any image_t are created
+Picture data may be modified in-place during mipmap processing
+================
+*/
+image_t* R_CreateImage(std::string_view name, std::string_view name2, byte* pic, int width, int height, imgFlags_t flags)
+{
+	image_t* image = R_AllocImage(name, name2, width, height, flags);
+
 	upload_vk_image(image, pic);
 	return image;
 }
 
+/*
+================
+R_UsePrecompressedImage
+
+Pre-compressed files are uploaded as they are, so they can only stand in
+for images that would reach the GPU without any color changes
+================
+*/
+static bool R_UsePrecompressedImage(imgFlags_t flags)
+{
+	int i;
+
+	if (!vk_inst.textureCompressionBC)
+		return false;
+
+	if (HasFlag(flags, imgFlags_t::IMGFLAG_NO_COMPRESSION) || HasFlag(flags, imgFlags_t::IMGFLAG_LIGHTMAP) || HasFlag(flags, imgFlags_t::IMGFLAG_COLORSHIFT))
+		return false;
+
+	if (tr.mapLoading && r_mapGreyScale->value > 0)
+		return false;
+
+	if (HasFlag(flags, imgFlags_t::IMGFLAG_NOLIGHTSCALE))
+		return true;
+
+	// see R_LightScaleTexture()
+	if (!glConfig.deviceSupportsGamma && !vk_inst.fboActive && memcmp(s_gammatable, s_gammatable_linear.data(), sizeof(s_gammatable)) != 0)
+		return false;
+
+	if (HasFlag(flags, imgFlags_t::IMGFLAG_MIPMAP))
+	{
+		for (i = 0; i < 256; i++)
+		{
+			if (s_intensitytable[i] != i)
+				return false;
+		}
+	}
+
+	return true;
+}
+
+static image_t* R_CreatePrecompressedImage(std::string_view name, std::string_view name2, compressedImage_t& compressed, imgFlags_t flags)
+{
+	image_t* image;
+	int skip;
+
+	skip = 0;
+	if (HasFlag(flags, imgFlags_t::IMGFLAG_PICMIP) && (tr.mapLoading || r_nomip->integer == 0))
+	{
+		skip = r_picmip->integer;
+	}
+	while ((compressed.width >> skip) > glConfig.maxTextureSize || (compressed.height >> skip) > glConfig.maxTextureSize)
+	{
+		skip++;
+	}
+
+	R_SkipCompressedLevels(compressed, skip);
+
+	if (!HasFlag(flags, imgFlags_t::IMGFLAG_MIPMAP))
+	{
+		compressed.levels = 1;
+		compressed.size = R_CompressedLevelSize(compressed.blockBytes, compressed.width, compressed.height);
+	}
+
+	image = R_AllocImage(name, name2, compressed.width, compressed.height, flags);
+	upload_compressed_image(image, compressed);
+
+	return image;
+}
+
 /*
 =================
 R_LoadImage
@@ -1112,6 +1198,58 @@ static std::array<char, MAX_QPATH> R_LoadImage(std::string_view name, byte** pic
 	return localName;
 }
 
+/*
+=================
+R_FindImagePath
+
+Returns the file R_LoadImage() will pick for name, judging only by
+which files exist, or an empty string when there is none.
+=================
+*/
+std::array<char, MAX_QPATH> R_FindImagePath(std::string_view name)
+{
+	std::array<char, MAX_QPATH> localName;
+	std::string_view altName;
+	int orgLoader = -1;
+	int i;
+
+	Q_strncpyz_cpp(localName, name, localName.size());
+
+	std::string_view ext = COM_GetExtension_cpp(localName);
+	if (!ext.empty())
+	{
+		for (i = 0; i < numImageLoaders; i++)
+		{
+			if (!Q_stricmp_cpp(ext, imageLoaders[i].ext))
+			{
+				if (ri.FS_ReadFile(localName.data(), NULL) > 0)
+				{
+					return localName;
+				}
+				orgLoader = i;
+				COM_StripExtension_cpp(name, localName);
+				break;
+			}
+		}
+	}
+
+	for (i = 0; i < numImageLoaders; i++)
+	{
+		if (i == orgLoader)
+			continue;
+
+		altName = va_cpp("%s.%s", localName.data(), imageLoaders[i].ext);
+		if (ri.FS_ReadFile(altName.data(), NULL) > 0)
+		{
+			Q_strncpyz_cpp(localName, altName, localName.size());
+			return localName;
+		}
+	}
+
+	localName[0] = '\0';
+	return localName;
+}
+
 /*
 ===============
 R_FindImageFile
@@ -1176,9 +1314,37 @@ image_t* R_FindImageFile(std::string_view name, imgFlags_t flags)
 	}
 
 	//
-	// load the pic from disk
+	// .ktx2/.dds replacement
+	//
+	if (R_UsePrecompressedImage(flags))
+	{
+		compressedImage_t compressed;
+		int64_t start = R_LoadTimestamp();
+
+		if (R_LoadCompressedImage(name, compressed))
+		{
+			R_CountImageFile(start);
+
+			start = R_LoadTimestamp();
+			image = R_CreatePrecompressedImage(name, {}, compressed, flags);
+			R_CountImageCreate(start);
+
+			R_FreeCompressedImage(compressed);
+			return image;
+		}
+	}
+
+	//
+	// load the pic from disk, unless the level prefetch already decoded it
 	//
-	auto localName = R_LoadImage(name, &pic, &width, &height);
+	std::array<char, MAX_QPATH> localName;
+	const bool prefetched = R_TakePrefetchedImage(name, localName, &pic, &width, &height);
+	if (!prefetched)
+	{
+		const int64_t start = R_LoadTimestamp();
+		localName = R_LoadImage(name, &pic, &width, &height);
+		R_CountImageFile(start);
+	}
 	if (pic == nullptr)
 	{
 		return nullptr;
@@ -1207,8 +1373,14 @@ image_t* R_FindImageFile(std::string_view name, imgFlags_t flags)
 		}
 	}
 
+	const int64_t start = R_LoadTimestamp();
 	image = R_CreateImage(name.data(), localName.data(), pic, width, height, flags);
-	ri.Free(pic);
+	R_CountImageCreate(start);
+
+	if (prefetched)
+		R_FreePrefetchedImage(pic);
+	else
+		ri.Free(pic);
 	return image;
 }
 
@@ -1474,6 +1646,8 @@ void R_DeleteTextures(void)
 		return;
 	}
 
+	R_SyncRenderThread();
+
 
 	int i;
 
@@ -23,6 +23,7 @@ typedef struct
 	int mip_levels;
 	int base_level_width;
 	int base_level_height;
+	bool gpu_mips; // buffer holds level 0 only, the rest of mip_levels is generated on upload
 } Image_Upload_Data;
 
 typedef struct
@@ -47,6 +48,7 @@ void TextureMode(std::string_view sv_mode);
 void R_ImageList_f(void);
 image_t *R_CreateImage(std::string_view name, std::string_view name2, byte *pic, int width, int height, imgFlags_t flags);
 image_t *R_FindImageFile(std::string_view name, imgFlags_t flags);
+std::array<char, MAX_QPATH> R_FindImagePath(std::string_view name);
 void R_SetColorMappings(void);
 void R_InitImages(void);
 void R_DeleteTextures(void);
@@ -0,0 +1,625 @@
+#include "tr_image_bc.hpp"
+#include "tr_jobs.hpp"
+#include "string_operations.hpp"
+
+#include <algorithm>
+
+// bump when the encoder output changes so old cache entries are not reused
+constexpr int BC_CACHE_VERSION = 1;
+
+constexpr int MAX_COMPRESSED_LEVELS = 16;
+
+constexpr uint32_t DDS_MAGIC = 0x20534444; // "DDS "
+constexpr uint32_t DDS_HEADER_SIZE = 124;
+constexpr uint32_t DDSD_CAPS = 0x1;
+constexpr uint32_t DDSD_HEIGHT = 0x2;
+constexpr uint32_t DDSD_WIDTH = 0x4;
+constexpr uint32_t DDSD_PIXELFORMAT = 0x1000;
+constexpr uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+constexpr uint32_t DDSD_LINEARSIZE = 0x80000;
+constexpr uint32_t DDPF_FOURCC = 0x4;
+constexpr uint32_t DDSCAPS_COMPLEX = 0x8;
+constexpr uint32_t DDSCAPS_TEXTURE = 0x1000;
+constexpr uint32_t DDSCAPS_MIPMAP = 0x400000;
+constexpr uint32_t FOURCC_DXT1 = 0x31545844;
+constexpr uint32_t FOURCC_DXT5 = 0x35545844;
+constexpr uint32_t FOURCC_DX10 = 0x30315844;
+constexpr uint32_t DXGI_FORMAT_BC1_UNORM = 71;
+constexpr uint32_t DXGI_FORMAT_BC3_UNORM = 77;
+constexpr uint32_t DXGI_FORMAT_BC7_UNORM = 98;
+
+constexpr byte KTX2_IDENTIFIER[12] = {0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+constexpr int KTX2_LEVEL_INDEX = 80;
+constexpr uint32_t KTX2_VK_FORMAT_BC1_RGB = 131;
+constexpr uint32_t KTX2_VK_FORMAT_BC1_RGBA = 133;
+constexpr uint32_t KTX2_VK_FORMAT_BC3 = 137;
+constexpr uint32_t KTX2_VK_FORMAT_BC7 = 145;
+
+static uint32_t R_ReadLong(const byte *p)
+{
+	uint32_t v;
+	Com_Memcpy(&v, p, sizeof(v));
+	return LittleLong(v);
+}
+
+static uint64_t R_ReadLong64(const byte *p)
+{
+	return static_cast<uint64_t>(R_ReadLong(p)) | (static_cast<uint64_t>(R_ReadLong(p + 4)) << 32);
+}
+
+static void R_WriteLong(byte *p, const uint32_t v)
+{
+	const uint32_t le = LittleLong(v);
+	Com_Memcpy(p, &le, sizeof(le));
+}
+
+int R_CompressedLevelSize(const int blockBytes, const int width, const int height)
+{
+	return ((width + 3) / 4) * ((height + 3) / 4) * blockBytes;
+}
+
+static int R_CompressedChainSize(const int blockBytes, int width, int height, const int levels)
+{
+	int i, size;
+
+	for (i = 0, size = 0; i < levels; i++)
+	{
+		size += R_CompressedLevelSize(blockBytes, width, height);
+		width = width > 1 ? width >> 1 : 1;
+		height = height > 1 ? height >> 1 : 1;
+	}
+
+	return size;
+}
+
+/*
+===============
+R_SetCompressedLevels
+
+Fits the level count to the file contents, copies the chain and
+returns false when not even level 0 is there.
+===============
+*/
+static bool R_SetCompressedLevels(compressedImage_t &image, int levels, const byte *data, const int size)
+{
+	if (image.width <= 0 || image.height <= 0 || image.width > 32768 || image.height > 32768)
+	{
+		return false;
+	}
+
+	levels = std::clamp(levels, 1, MAX_COMPRESSED_LEVELS);
+	while (levels > 1 && R_CompressedChainSize(image.blockBytes, image.width, image.height, levels) > size)
+	{
+		levels--;
+	}
+
+	image.levels = levels;
+	image.size = R_CompressedChainSize(image.blockBytes, image.width, image.height, levels);
+	if (image.size > size)
+	{
+		return false;
+	}
+
+	image.data = static_cast<byte *>(ri.Malloc(image.size));
+	if (data)
+	{
+		Com_Memcpy(image.data, data, image.size);
+	}
+
+	return true;
+}
+
+static bool R_ParseDDS(const byte *buf, const int len, compressedImage_t &image)
+{
+	uint32_t fourCC;
+	int offset;
+
+	if (len < 4 + static_cast<int>(DDS_HEADER_SIZE) || R_ReadLong(buf) != DDS_MAGIC || R_ReadLong(buf + 4) != DDS_HEADER_SIZE)
+	{
+		return false;
+	}
+
+	if ((R_ReadLong(buf + 80) & DDPF_FOURCC) == 0)
+	{
+		return false;
+	}
+
+	offset = 4 + DDS_HEADER_SIZE;
+	fourCC = R_ReadLong(buf + 84);
+
+	if (fourCC == FOURCC_DXT1)
+	{
+		image.format = vk::Format::eBc1RgbaUnormBlock;
+		image.blockBytes = 8;
+	}
+	else if (fourCC == FOURCC_DXT5)
+	{
+		image.format = vk::Format::eBc3UnormBlock;
+		image.blockBytes = 16;
+	}
+	else if (fourCC == FOURCC_DX10 && len >= offset + 20)
+	{
+		switch (R_ReadLong(buf + offset))
+		{
+		case DXGI_FORMAT_BC1_UNORM:
+			image.format = vk::Format::eBc1RgbaUnormBlock;
+			image.blockBytes = 8;
+			break;
+		case DXGI_FORMAT_BC3_UNORM:
+			image.format = vk::Format::eBc3UnormBlock;
+			image.blockBytes = 16;
+			break;
+		case DXGI_FORMAT_BC7_UNORM:
+			image.format = vk::Format::eBc7UnormBlock;
+			image.blockBytes = 16;
+			break;
+		default:
+			return false;
+		}
+		offset += 20;
+	}
+	else
+	{
+		return false;
+	}
+
+	image.height = R_ReadLong(buf + 12);
+	image.width = R_ReadLong(buf + 16);
+
+	const int levels = (R_ReadLong(buf + 8) & DDSD_MIPMAPCOUNT) ? static_cast<int>(R_ReadLong(buf + 28)) : 1;
+
+	return R_SetCompressedLevels(image, levels, buf + offset, len - offset);
+}
+
+static bool R_ParseKTX2(const byte *buf, const int len, compressedImage_t &image)
+{
+	int i, levels, width, height, offset;
+
+	if (len < KTX2_LEVEL_INDEX || memcmp(buf, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0)
+	{
+		return false;
+	}
+
+	switch (R_ReadLong(buf + 12))
+	{
+	case KTX2_VK_FORMAT_BC1_RGB:
+		image.format = vk::Format::eBc1RgbUnormBlock;
+		image.blockBytes = 8;
+		break;
+	case KTX2_VK_FORMAT_BC1_RGBA:
+		image.format = vk::Format::eBc1RgbaUnormBlock;
+		image.blockBytes = 8;
+		break;
+	case KTX2_VK_FORMAT_BC3:
+		image.format = vk::Format::eBc3UnormBlock;
+		image.blockBytes = 16;
+		break;
+	case KTX2_VK_FORMAT_BC7:
+		image.format = vk::Format::eBc7UnormBlock;
+		image.blockBytes = 16;
+		break;
+	default:
+		return false;
+	}
+
+	// plain 2D textures only: no depth, arrays, cube faces or supercompression
+	if (R_ReadLong(buf + 28) > 1 || R_ReadLong(buf + 32) > 1 || R_ReadLong(buf + 36) != 1 || R_ReadLong(buf + 44) != 0)
+	{
+		return false;
+	}
+
+	image.width = R_ReadLong(buf + 20);
+	image.height = R_ReadLong(buf + 24);
+	levels = std::clamp(static_cast<int>(R_ReadLong(buf + 40)), 1, MAX_COMPRESSED_LEVELS);
+
+	if (len < KTX2_LEVEL_INDEX + levels * 24)
+	{
+		return false;
+	}
+
+	// levels are not stored in order in the file, keep the ones that are complete
+	for (i = 0, width = image.width, height = image.height; i < levels; i++)
+	{
+		const uint64_t levelOffset = R_ReadLong64(buf + KTX2_LEVEL_INDEX + i * 24);
+		const uint64_t levelLength = R_ReadLong64(buf + KTX2_LEVEL_INDEX + i * 24 + 8);
+
+		if (levelLength != static_cast<uint64_t>(R_CompressedLevelSize(image.blockBytes, width, height)) || levelOffset + levelLength > static_cast<uint64_t>(len))
+		{
+			break;
+		}
+
+		width = width > 1 ? width >> 1 : 1;
+		height = height > 1 ? height >> 1 : 1;
+	}
+
+	if (i == 0 || !R_SetCompressedLevels(image, i, nullptr, INT_MAX))
+	{
+		return false;
+	}
+
+	for (i = 0, offset = 0, width = image.width, height = image.height; i < image.levels; i++)
+	{
+		const int levelSize = R_CompressedLevelSize(image.blockBytes, width, height);
+
+		Com_Memcpy(image.data + offset, buf + R_ReadLong64(buf + KTX2_LEVEL_INDEX + i * 24), levelSize);
+		offset += levelSize;
+
+		width = width > 1 ? width >> 1 : 1;
+		height = height > 1 ? height >> 1 : 1;
+	}
+
+	return true;
+}
+
+static bool R_LoadCompressedFile(const char *fileName, compressedImage_t &image)
+{
+	void *buf;
+	int len;
+	bool ok;
+
+	len = ri.FS_ReadFile(fileName, &buf);
+	if (!buf)
+	{
+		return false;
+	}
+
+	Com_Memset(&image, 0, sizeof(image));
+
+	ok = len > 0 && (R_ParseKTX2(static_cast<const byte *>(buf), len, image) || R_ParseDDS(static_cast<const byte *>(buf), len, image));
+
+	ri.FS_FreeFile(buf);
+
+	if (!ok)
+	{
+		ri.Printf(PRINT_DEVELOPER, "WARNING: %s is not a supported BC1/BC3/BC7 texture\n", fileName);
+		R_FreeCompressedImage(image);
+	}
+
+	return ok;
+}
+
+/*
+===============
+R_LoadCompressedImage
+===============
+*/
+bool R_LoadCompressedImage(std::string_view name, compressedImage_t &image)
+{
+	std::array<char, MAX_QPATH> strippedName;
+
+	COM_StripExtension_cpp(name, strippedName);
+
+	if (R_LoadCompressedFile(va_cpp("%s.ktx2", strippedName.data()).data(), image))
+	{
+		return true;
+	}
+
+	return R_LoadCompressedFile(va_cpp("%s.dds", strippedName.data()).data(), image);
+}
+
+void R_SkipCompressedLevels(compressedImage_t &image, int skip)
+{
+	int offset;
+
+	skip = std::min(skip, image.levels - 1);
+
+	for (offset = 0; skip > 0; skip--)
+	{
+		offset += R_CompressedLevelSize(image.blockBytes, image.width, image.height);
+		image.width = image.width > 1 ? image.width >> 1 : 1;
+		image.height = image.height > 1 ? image.height >> 1 : 1;
+		image.levels--;
+	}
+
+	if (offset)
+	{
+		image.size -= offset;
+		memmove(image.data, image.data + offset, image.size);
+	}
+}
+
+void R_FreeCompressedImage(compressedImage_t &image)
+{
+	if (image.data)
+	{
+		ri.Free(image.data);
+		image.data = nullptr;
+	}
+}
+
+//=============================================================================
+
+/*
+BC1/BC3 encoder after J.M.P. van Waveren, "Real-Time DXT Compression":
+the end points are the inset bounding box of the block colors, every
+pixel takes the nearest of the four palette entries.
+*/
+
+static uint16_t R_ColorTo565(const byte *c)
+{
+	return static_cast<uint16_t>(((c[0] >> 3) << 11) | ((c[1] >> 2) << 5) | (c[2] >> 3));
+}
+
+static void R_ColorFrom565(const uint16_t v, int *c)
+{
+	const int r = (v >> 11) & 31;
+	const int g = (v >> 5) & 63;
+	const int b = v & 31;
+
+	c[0] = (r << 3) | (r >> 2);
+	c[1] = (g << 2) | (g >> 4);
+	c[2] = (b << 3) | (b >> 2);
+}
+
+static void R_EncodeColorBlock(const byte *block, byte *out)
+{
+	byte minColor[3] = {255, 255, 255};
+	byte maxColor[3] = {0, 0, 0};
+	int palette[4][3];
+	uint32_t indices;
+	int i, j, k;
+
+	for (i = 0; i < 16; i++)
+	{
+		for (k = 0; k < 3; k++)
+		{
+			minColor[k] = std::min(minColor[k], block[i * 4 + k]);
+			maxColor[k] = std::max(maxColor[k], block[i * 4 + k]);
+		}
+	}
+
+	for (k = 0; k < 3; k++)
+	{
+		const int inset = (maxColor[k] - minColor[k]) >> 4;
+		minColor[k] += inset;
+		maxColor[k] -= inset;
+	}
+
+	const uint16_t c0 = R_ColorTo565(maxColor);
+	const uint16_t c1 = R_ColorTo565(minColor);
+
+	out[0] = c0 & 255;
+	out[1] = c0 >> 8;
+	out[2] = c1 & 255;
+	out[3] = c1 >> 8;
+
+	// c0 > c1 selects the four color mode, equal end points mean a flat block
+	indices = 0;
+	if (c0 != c1)
+	{
+		R_ColorFrom565(c0, palette[0]);
+		R_ColorFrom565(c1, palette[1]);
+		for (k = 0; k < 3; k++)
+		{
+			palette[2][k] = (2 * palette[0][k] + palette[1][k]) / 3;
+			palette[3][k] = (palette[0][k] + 2 * palette[1][k]) / 3;
+		}
+
+		for (i = 0; i < 16; i++)
+		{
+			int best = 0, bestDist = INT_MAX;
+			for (j = 0; j < 4; j++)
+			{
+				const int dr = block[i * 4 + 0] - palette[j][0];
+				const int dg = block[i * 4 + 1] - palette[j][1];
+				const int db = block[i * 4 + 2] - palette[j][2];
+				const int dist = dr * dr + dg * dg + db * db;
+				if (dist < bestDist)
+				{
+					bestDist = dist;
+					best = j;
+				}
+			}
+			indices |= static_cast<uint32_t>(best) << (i * 2);
+		}
+	}
+
+	R_WriteLong(out + 4, indices);
+}
+
+static void R_EncodeAlphaBlock(const byte *block, byte *out)
+{
+	int palette[8];
+	uint64_t indices;
+	int i, j;
+
+	byte minAlpha = 255, maxAlpha = 0;
+	for (i = 0; i < 16; i++)
+	{
+		minAlpha = std::min(minAlpha, block[i * 4 + 3]);
+		maxAlpha = std::max(maxAlpha, block[i * 4 + 3]);
+	}
+
+	// a0 > a1 selects eight interpolated values
+	out[0] = maxAlpha;
+	out[1] = minAlpha;
+
+	indices = 0;
+	if (maxAlpha != minAlpha)
+	{
+		palette[0] = maxAlpha;
+		palette[1] = minAlpha;
+		for (j = 1; j < 7; j++)
+		{
+			palette[j + 1] = ((7 - j) * maxAlpha + j * minAlpha) / 7;
+		}
+
+		for (i = 0; i < 16; i++)
+		{
+			int best = 0, bestDist = INT_MAX;
+			for (j = 0; j < 8; j++)
+			{
+				const int dist = abs(block[i * 4 + 3] - palette[j]);
+				if (dist < bestDist)
+				{
+					bestDist = dist;
+					best = j;
+				}
+			}
+			indices |= static_cast<uint64_t>(best) << (i * 3);
+		}
+	}
+
+	for (i = 0; i < 6; i++)
+	{
+		out[2 + i] = (indices >> (i * 8)) & 255;
+	}
+}
+
+typedef struct
+{
+	const byte *pixels;
+	int width;
+	int height;
+	int blockBytes;
+	byte *out;
+} encodeLevel_t;
+
+static void R_EncodeRowJob(void *arg, int by)
+{
+	const encodeLevel_t *level = static_cast<const encodeLevel_t *>(arg);
+	const int blocksWide = (level->width + 3) / 4;
+	byte block[64];
+	byte *out;
+	int bx, x, y;
+
+	out = level->out + by * blocksWide * level->blockBytes;
+
+	for (bx = 0; bx < blocksWide; bx++, out += level->blockBytes)
+	{
+		// blocks hanging over the edge repeat the last row and column
+		for (y = 0; y < 4; y++)
+		{
+			const int sy = std::min(by * 4 + y, level->height - 1);
+			for (x = 0; x < 4; x++)
+			{
+				const int sx = std::min(bx * 4 + x, level->width - 1);
+				Com_Memcpy(block + (y * 4 + x) * 4, level->pixels + (sy * level->width + sx) * 4, 4);
+			}
+		}
+
+		if (level->blockBytes == 16)
+		{
+			R_EncodeAlphaBlock(block, out);
+			R_EncodeColorBlock(block, out + 8);
+		}
+		else
+		{
+			R_EncodeColorBlock(block, out);
+		}
+	}
+}
+
+static uint64_t R_HashPixels(const byte *data, const int size, uint64_t hash)
+{
+	uint64_t word;
+	int i;
+
+	// FNV-1a over 64-bit words
+	for (i = 0; i + 8 <= size; i += 8)
+	{
+		Com_Memcpy(&word, data + i, sizeof(word));
+		hash = (hash ^ word) * 0x100000001B3ULL;
+		hash ^= hash >> 29;
+	}
+	for (; i < size; i++)
+	{
+		hash = (hash ^ data[i]) * 0x100000001B3ULL;
+	}
+
+	return hash;
+}
+
+static void R_WriteCacheFile(const char *path, const compressedImage_t &image)
+{
+	const int len = 4 + DDS_HEADER_SIZE + image.size;
+	byte *buf = static_cast<byte *>(ri.Hunk_AllocateTempMemory(len));
+
+	Com_Memset(buf, 0, 4 + DDS_HEADER_SIZE);
+	R_WriteLong(buf, DDS_MAGIC);
+	R_WriteLong(buf + 4, DDS_HEADER_SIZE);
+	R_WriteLong(buf + 8, DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE);
+	R_WriteLong(buf + 12, image.height);
+	R_WriteLong(buf + 16, image.width);
+	R_WriteLong(buf + 20, R_CompressedLevelSize(image.blockBytes, image.width, image.height));
+	R_WriteLong(buf + 28, image.levels);
+	R_WriteLong(buf + 76, 32);
+	R_WriteLong(buf + 80, DDPF_FOURCC);
+	R_WriteLong(buf + 84, image.blockBytes == 16 ? FOURCC_DXT5 : FOURCC_DXT1);
+	R_WriteLong(buf + 108, DDSCAPS_TEXTURE | (image.levels > 1 ? DDSCAPS_COMPLEX | DDSCAPS_MIPMAP : 0));
+	Com_Memcpy(buf + 4 + DDS_HEADER_SIZE, image.data, image.size);
+
+	ri.FS_WriteFile(path, buf, len);
+
+	ri.Hunk_FreeTempMemory(buf);
+}
+
+/*
+===============
+R_CompressImage
+===============
+*/
+bool R_CompressImage(const byte *pixels, const int width, const int height, const int levels, compressedImage_t &image)
+{
+	encodeLevel_t level;
+	uint64_t hash;
+	int i, w, h, offset;
+	bool alpha;
+
+	alpha = false;
+	for (i = 0; i < width * height; i++)
+	{
+		if (pixels[i * 4 + 3] != 255)
+		{
+			alpha = true;
+			break;
+		}
+	}
+
+	// the rest of the chain follows from level 0 and the mipmap settings
+	const int key[] = {BC_CACHE_VERSION, width, height, levels, r_simpleMipMaps->integer, r_colorMipLevels->integer};
+	hash = R_HashPixels(reinterpret_cast<const byte *>(key), sizeof(key), 0xCBF29CE484222325ULL);
+	hash = R_HashPixels(pixels, width * height * 4, hash);
+
+	const std::string_view path = va_cpp("texcache/%08x%08x.dds", static_cast<unsigned>(hash >> 32), static_cast<unsigned>(hash));
+	std::array<char, MAX_QPATH> cacheName;
+	Q_strncpyz_cpp(cacheName, path, cacheName.size());
+
+	if (R_LoadCompressedFile(cacheName.data(), image))
+	{
+		if (image.width == width && image.height == height && image.levels == levels && image.blockBytes == (alpha ? 16 : 8))
+		{
+			return true;
+		}
+		R_FreeCompressedImage(image);
+	}
+
+	Com_Memset(&image, 0, sizeof(image));
+	image.format = alpha ? vk::Format::eBc3UnormBlock : vk::Format::eBc1RgbaUnormBlock;
+	image.blockBytes = alpha ? 16 : 8;
+	image.width = width;
+	image.height = height;
+	image.levels = levels;
+	image.size = R_CompressedChainSize(image.blockBytes, width, height, levels);
+	image.data = static_cast<byte *>(ri.Malloc(image.size));
+
+	for (i = 0, w = width, h = height, offset = 0; i < levels; i++)
+	{
+		level.pixels = pixels;
+		level.width = w;
+		level.height = h;
+		level.blockBytes = image.blockBytes;
+		level.out = image.data + offset;
+
+		R_RunJobs(R_EncodeRowJob, &level, (h + 3) / 4);
+
+		pixels += w * h * 4;
+		offset += R_CompressedLevelSize(image.blockBytes, w, h);
+		w = w > 1 ? w >> 1 : 1;
+		h = h > 1 ? h >> 1 : 1;
+	}
+
+	R_WriteCacheFile(cacheName.data(), image);
+
+	return true;
+}
@@ -0,0 +1,36 @@
+#ifndef TR_IMAGE_BC_HPP
+#define TR_IMAGE_BC_HPP
+
+#include "tr_local.hpp"
+
+// Block compressed textures (r_ext_compressed_textures).
+// Pre-compressed BC1/BC3/BC7 images are read from .ktx2 or .dds files next
+// to the source image. Everything else is encoded to BC1 (opaque) or BC3
+// once and cached in the homepath as texcache/<checksum>.dds, the checksum
+// covers the final RGBA mip chain so gamma, picmip etc. changes miss the cache.
+
+typedef struct
+{
+	vk::Format format;
+	int blockBytes;
+	int width; // level 0
+	int height;
+	int levels;
+	byte *data; // all levels back to back, ri.Malloc'ed
+	int size;
+} compressedImage_t;
+
+int R_CompressedLevelSize(const int blockBytes, const int width, const int height);
+
+// looks for name.ktx2 and name.dds, extension of name is ignored
+bool R_LoadCompressedImage(std::string_view name, compressedImage_t &image);
+
+// drops the largest levels, used for picmip and the texture size limit
+void R_SkipCompressedLevels(compressedImage_t &image, int skip);
+
+// encodes an RGBA mip chain laid out like Image_Upload_Data, or takes it from the cache
+bool R_CompressImage(const byte *pixels, const int width, const int height, const int levels, compressedImage_t &image);
+
+void R_FreeCompressedImage(compressedImage_t &image);
+
+#endif // TR_IMAGE_BC_HPP
@@ -0,0 +1,625 @@
+#include "tr_image_kernels.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define USE_IMAGE_SSE2
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define AVX2_TARGET
+#else
+#define AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#endif
+
+// x / 36 == ( x * MIPMAP2_DIV36 ) >> 21 for every 4x4 filter sum ( x <= 36 * 255 )
+constexpr int MIPMAP2_DIV36 = 58255;
+
+imageKernels_t imageKernels;
+
+static bool R_IsPowerOfTwo(const int x)
+{
+	return x > 0 && (x & (x - 1)) == 0;
+}
+
+/*
+================
+R_MipMap2_Scalar
+================
+*/
+static void R_MipMap2_Scalar(uint32_t *out, const uint32_t *in, int inWidth, int inHeight)
+{
+	int i, j, k;
+	byte *outpix;
+	int inWidthMask, inHeightMask;
+	int total;
+	int outWidth, outHeight;
+
+	outWidth = inWidth >> 1;
+	outHeight = inHeight >> 1;
+
+	inWidthMask = inWidth - 1;
+	inHeightMask = inHeight - 1;
+
+	for (i = 0; i < outHeight; i++)
+	{
+		for (j = 0; j < outWidth; j++)
+		{
+			outpix = (byte *)(out + i * outWidth + j);
+			for (k = 0; k < 4; k++)
+			{
+				total =
+					1 * ((const byte *)&in[((i * 2 - 1) & inHeightMask) * inWidth + ((j * 2 - 1) & inWidthMask)])[k] +
+					2 * ((const byte *)&in[((i * 2 - 1) & inHeightMask) * inWidth + ((j * 2) & inWidthMask)])[k] +
+					2 * ((const byte *)&in[((i * 2 - 1) & inHeightMask) * inWidth + ((j * 2 + 1) & inWidthMask)])[k] +
+					1 * ((const byte *)&in[((i * 2 - 1) & inHeightMask) * inWidth + ((j * 2 + 2) & inWidthMask)])[k] +
+
+					2 * ((const byte *)&in[((i * 2) & inHeightMask) * inWidth + ((j * 2 - 1) & inWidthMask)])[k] +
+					4 * ((const byte *)&in[((i * 2) & inHeightMask) * inWidth + ((j * 2) & inWidthMask)])[k] +
+					4 * ((const byte *)&in[((i * 2) & inHeightMask) * inWidth + ((j * 2 + 1) & inWidthMask)])[k] +
+					2 * ((const byte *)&in[((i * 2) & inHeightMask) * inWidth + ((j * 2 + 2) & inWidthMask)])[k] +
+
+					2 * ((const byte *)&in[((i * 2 + 1) & inHeightMask) * inWidth + ((j * 2 - 1) & inWidthMask)])[k] +
+					4 * ((const byte *)&in[((i * 2 + 1) & inHeightMask) * inWidth + ((j * 2) & inWidthMask)])[k] +
+					4 * ((const byte *)&in[((i * 2 + 1) & inHeightMask) * inWidth + ((j * 2 + 1) & inWidthMask)])[k] +
+					2 * ((const byte *)&in[((i * 2 + 1) & inHeightMask) * inWidth + ((j * 2 + 2) & inWidthMask)])[k] +
+
+					1 * ((const byte *)&in[((i * 2 + 2) & inHeightMask) * inWidth + ((j * 2 - 1) & inWidthMask)])[k] +
+					2 * ((const byte *)&in[((i * 2 + 2) & inHeightMask) * inWidth + ((j * 2) & inWidthMask)])[k] +
+					2 * ((const byte *)&in[((i * 2 + 2) & inHeightMask) * inWidth + ((j * 2 + 1) & inWidthMask)])[k] +
+					1 * ((const byte *)&in[((i * 2 + 2) & inHeightMask) * inWidth + ((j * 2 + 2) & inWidthMask)])[k];
+				outpix[k] = total / 36;
+			}
+		}
+	}
+}
+
+/*
+================
+R_MipMapBox_Scalar
+================
+*/
+static void R_MipMapBox_Scalar(byte *out, const byte *in, int width, int height)
+{
+	int i, j;
+	int row;
+
+	row = width * 4;
+	width >>= 1;
+	height >>= 1;
+
+	for (i = 0; i < height; i++, in += row)
+	{
+		for (j = 0; j < width; j++, out += 4, in += 8)
+		{
+			out[0] = (in[0] + in[4] + in[row + 0] + in[row + 4]) >> 2;
+			out[1] = (in[1] + in[5] + in[row + 1] + in[row + 5]) >> 2;
+			out[2] = (in[2] + in[6] + in[row + 2] + in[row + 6]) >> 2;
+			out[3] = (in[3] + in[7] + in[row + 3] + in[row + 7]) >> 2;
+		}
+	}
+}
+
+static void R_ResampleRow_Scalar(uint32_t *out, const uint32_t *inrow, const uint32_t *inrow2, const unsigned *p1, const unsigned *p2, int outWidth)
+{
+	const byte *pix1, *pix2, *pix3, *pix4;
+	int j;
+
+	for (j = 0; j < outWidth; j++)
+	{
+		pix1 = (const byte *)inrow + p1[j];
+		pix2 = (const byte *)inrow + p2[j];
+		pix3 = (const byte *)inrow2 + p1[j];
+		pix4 = (const byte *)inrow2 + p2[j];
+		((byte *)(out + j))[0] = (pix1[0] + pix2[0] + pix3[0] + pix4[0]) >> 2;
+		((byte *)(out + j))[1] = (pix1[1] + pix2[1] + pix3[1] + pix4[1]) >> 2;
+		((byte *)(out + j))[2] = (pix1[2] + pix2[2] + pix3[2] + pix4[2]) >> 2;
+		((byte *)(out + j))[3] = (pix1[3] + pix2[3] + pix3[3] + pix4[3]) >> 2;
+	}
+}
+
+#ifdef USE_IMAGE_SSE2
+
+/*
+The vectorized 4x4 filter first sums the four source rows of an output row
+with 1-2-2-1 weights into a 16-bit row, padded with one wrapped-around
+pixel on each side, then applies the same weights across that row.
+*/
+static uint16_t *R_MipMap2Sums(const int inWidth)
+{
+	static thread_local std::vector<uint16_t> sums;
+
+	if (sums.size() < static_cast<size_t>(inWidth + 2) * 4)
+	{
+		sums.resize(static_cast<size_t>(inWidth + 2) * 4);
+	}
+
+	return sums.data();
+}
+
+static void R_MipMap2ColumnSums(uint16_t *sums, const byte *r0, const byte *r1, const byte *r2, const byte *r3, int x, const int inWidth)
+{
+	int k;
+
+	for (; x < inWidth * 4; x += 4)
+	{
+		for (k = 0; k < 4; k++)
+		{
+			sums[x + 4 + k] = r0[x + k] + 2 * r1[x + k] + 2 * r2[x + k] + r3[x + k];
+		}
+	}
+
+	// wrap around like the masked scalar lookups
+	Com_Memcpy(sums, sums + inWidth * 4, 4 * sizeof(*sums));
+	Com_Memcpy(sums + (inWidth + 1) * 4, sums + 4, 4 * sizeof(*sums));
+}
+
+static void R_MipMap2RowTail(uint32_t *out, const uint16_t *sums, int j, const int outWidth)
+{
+	const uint16_t *s;
+	int k;
+
+	for (; j < outWidth; j++)
+	{
+		s = sums + j * 8;
+		for (k = 0; k < 4; k++)
+		{
+			((byte *)(out + j))[k] = (s[k] + 2 * s[4 + k] + 2 * s[8 + k] + s[12 + k]) / 36;
+		}
+	}
+}
+
+static void R_MipMap2_SSE2(uint32_t *out, const uint32_t *in, int inWidth, int inHeight)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i div36 = _mm_set1_epi16(static_cast<short>(MIPMAP2_DIV36));
+	const byte *r0, *r1, *r2, *r3;
+	uint16_t *sums;
+	uint32_t *dst;
+	int i, j, x;
+
+	if (!R_IsPowerOfTwo(inWidth) || !R_IsPowerOfTwo(inHeight) || inWidth < 2 || inHeight < 2)
+	{
+		R_MipMap2_Scalar(out, in, inWidth, inHeight);
+		return;
+	}
+
+	const int outWidth = inWidth >> 1;
+	const int outHeight = inHeight >> 1;
+	const int inHeightMask = inHeight - 1;
+
+	sums = R_MipMap2Sums(inWidth);
+
+	for (i = 0; i < outHeight; i++)
+	{
+		r0 = (const byte *)(in + ((i * 2 - 1) & inHeightMask) * inWidth);
+		r1 = (const byte *)(in + (i * 2) * inWidth);
+		r2 = (const byte *)(in + (i * 2 + 1) * inWidth);
+		r3 = (const byte *)(in + ((i * 2 + 2) & inHeightMask) * inWidth);
+
+		for (x = 0; x < inWidth * 4; x += 8)
+		{
+			const __m128i a = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(r0 + x)), zero);
+			const __m128i b = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(r1 + x)), zero);
+			const __m128i c = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(r2 + x)), zero);
+			const __m128i d = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(r3 + x)), zero);
+			_mm_storeu_si128((__m128i *)(sums + x + 4), _mm_add_epi16(_mm_add_epi16(a, d), _mm_slli_epi16(_mm_add_epi16(b, c), 1)));
+		}
+		R_MipMap2ColumnSums(sums, r0, r1, r2, r3, x, inWidth);
+
+		dst = out + i * outWidth;
+		for (j = 0; j + 2 <= outWidth; j += 2)
+		{
+			const uint16_t *s = sums + j * 8;
+			const __m128i A = _mm_loadu_si128((const __m128i *)(s));
+			const __m128i B = _mm_loadu_si128((const __m128i *)(s + 8));
+			const __m128i C = _mm_loadu_si128((const __m128i *)(s + 16));
+			const __m128i E = _mm_unpacklo_epi64(A, B);
+			const __m128i O = _mm_unpackhi_epi64(A, B);
+			const __m128i E2 = _mm_unpacklo_epi64(B, C);
+			const __m128i O2 = _mm_unpackhi_epi64(B, C);
+			__m128i t = _mm_add_epi16(_mm_add_epi16(E, O2), _mm_slli_epi16(_mm_add_epi16(O, E2), 1));
+			t = _mm_srli_epi16(_mm_mulhi_epu16(t, div36), 5);
+			_mm_storel_epi64((__m128i *)(dst + j), _mm_packus_epi16(t, t));
+		}
+		R_MipMap2RowTail(dst, sums, j, outWidth);
+	}
+}
+
+static void R_MipMapBox_SSE2(byte *out, const byte *in, int width, int height)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const byte *a, *b;
+	int i, j, k;
+
+	const int row = width * 4;
+	width >>= 1;
+	height >>= 1;
+
+	for (i = 0; i < height; i++, out += width * 4)
+	{
+		// same source stepping as the scalar loop, which matters for odd widths
+		a = in + i * (width * 8 + row);
+		b = a + row;
+
+		for (j = 0; j + 4 <= width; j += 4)
+		{
+			const __m128 a0 = _mm_castsi128_ps(_mm_loadu_si128((const __m128i *)(a + j * 8)));
+			const __m128 a1 = _mm_castsi128_ps(_mm_loadu_si128((const __m128i *)(a + j * 8 + 16)));
+			const __m128 b0 = _mm_castsi128_ps(_mm_loadu_si128((const __m128i *)(b + j * 8)));
+			const __m128 b1 = _mm_castsi128_ps(_mm_loadu_si128((const __m128i *)(b + j * 8 + 16)));
+			const __m128i ea = _mm_castps_si128(_mm_shuffle_ps(a0, a1, _MM_SHUFFLE(2, 0, 2, 0)));
+			const __m128i oa = _mm_castps_si128(_mm_shuffle_ps(a0, a1, _MM_SHUFFLE(3, 1, 3, 1)));
+			const __m128i eb = _mm_castps_si128(_mm_shuffle_ps(b0, b1, _MM_SHUFFLE(2, 0, 2, 0)));
+			const __m128i ob = _mm_castps_si128(_mm_shuffle_ps(b0, b1, _MM_SHUFFLE(3, 1, 3, 1)));
+			__m128i lo = _mm_add_epi16(_mm_add_epi16(_mm_unpacklo_epi8(ea, zero), _mm_unpacklo_epi8(oa, zero)),
+									   _mm_add_epi16(_mm_unpacklo_epi8(eb, zero), _mm_unpacklo_epi8(ob, zero)));
+			__m128i hi = _mm_add_epi16(_mm_add_epi16(_mm_unpackhi_epi8(ea, zero), _mm_unpackhi_epi8(oa, zero)),
+									   _mm_add_epi16(_mm_unpackhi_epi8(eb, zero), _mm_unpackhi_epi8(ob, zero)));
+			lo = _mm_srli_epi16(lo, 2);
+			hi = _mm_srli_epi16(hi, 2);
+			_mm_storeu_si128((__m128i *)(out + j * 4), _mm_packus_epi16(lo, hi));
+		}
+
+		for (; j < width; j++)
+		{
+			for (k = 0; k < 4; k++)
+			{
+				out[j * 4 + k] = (a[j * 8 + k] + a[j * 8 + 4 + k] + b[j * 8 + k] + b[j * 8 + 4 + k]) >> 2;
+			}
+		}
+	}
+}
+
+static int R_LoadPixel(const uint32_t *row, const unsigned offset)
+{
+	int pixel;
+
+	Com_Memcpy(&pixel, (const byte *)row + offset, sizeof(pixel));
+
+	return pixel;
+}
+
+static void R_ResampleRow_SSE2(uint32_t *out, const uint32_t *inrow, const uint32_t *inrow2, const unsigned *p1, const unsigned *p2, int outWidth)
+{
+	const __m128i zero = _mm_setzero_si128();
+	int j;
+
+	for (j = 0; j + 4 <= outWidth; j += 4)
+	{
+		const __m128i a = _mm_setr_epi32(R_LoadPixel(inrow, p1[j]), R_LoadPixel(inrow, p1[j + 1]), R_LoadPixel(inrow, p1[j + 2]), R_LoadPixel(inrow, p1[j + 3]));
+		const __m128i b = _mm_setr_epi32(R_LoadPixel(inrow, p2[j]), R_LoadPixel(inrow, p2[j + 1]), R_LoadPixel(inrow, p2[j + 2]), R_LoadPixel(inrow, p2[j + 3]));
+		const __m128i c = _mm_setr_epi32(R_LoadPixel(inrow2, p1[j]), R_LoadPixel(inrow2, p1[j + 1]), R_LoadPixel(inrow2, p1[j + 2]), R_LoadPixel(inrow2, p1[j + 3]));
+		const __m128i d = _mm_setr_epi32(R_LoadPixel(inrow2, p2[j]), R_LoadPixel(inrow2, p2[j + 1]), R_LoadPixel(inrow2, p2[j + 2]), R_LoadPixel(inrow2, p2[j + 3]));
+		__m128i lo = _mm_add_epi16(_mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero)),
+								   _mm_add_epi16(_mm_unpacklo_epi8(c, zero), _mm_unpacklo_epi8(d, zero)));
+		__m128i hi = _mm_add_epi16(_mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero)),
+								   _mm_add_epi16(_mm_unpackhi_epi8(c, zero), _mm_unpackhi_epi8(d, zero)));
+		lo = _mm_srli_epi16(lo, 2);
+		hi = _mm_srli_epi16(hi, 2);
+		_mm_storeu_si128((__m128i *)(out + j), _mm_packus_epi16(lo, hi));
+	}
+
+	R_ResampleRow_Scalar(out + j, inrow, inrow2, p1 + j, p2 + j, outWidth - j);
+}
+
+AVX2_TARGET static void R_MipMap2_AVX2(uint32_t *out, const uint32_t *in, int inWidth, int inHeight)
+{
+	const __m256i div36 = _mm256_set1_epi16(static_cast<short>(MIPMAP2_DIV36));
+	const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 0, 4, 1, 5);
+	const byte *r0, *r1, *r2, *r3;
+	uint16_t *sums;
+	uint32_t *dst;
+	int i, j, x;
+
+	if (!R_IsPowerOfTwo(inWidth) || !R_IsPowerOfTwo(inHeight) || inWidth < 2 || inHeight < 2)
+	{
+		R_MipMap2_Scalar(out, in, inWidth, inHeight);
+		return;
+	}
+
+	const int outWidth = inWidth >> 1;
+	const int outHeight = inHeight >> 1;
+	const int inHeightMask = inHeight - 1;
+
+	sums = R_MipMap2Sums(inWidth);
+
+	for (i = 0; i < outHeight; i++)
+	{
+		r0 = (const byte *)(in + ((i * 2 - 1) & inHeightMask) * inWidth);
+		r1 = (const byte *)(in + (i * 2) * inWidth);
+		r2 = (const byte *)(in + (i * 2 + 1) * inWidth);
+		r3 = (const byte *)(in + ((i * 2 + 2) & inHeightMask) * inWidth);
+
+		for (x = 0; x + 16 <= inWidth * 4; x += 16)
+		{
+			const __m256i a = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(r0 + x)));
+			const __m256i b = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(r1 + x)));
+			const __m256i c = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(r2 + x)));
+			const __m256i d = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(r3 + x)));
+			_mm256_storeu_si256((__m256i *)(sums + x + 4), _mm256_add_epi16(_mm256_add_epi16(a, d), _mm256_slli_epi16(_mm256_add_epi16(b, c), 1)));
+		}
+		R_MipMap2ColumnSums(sums, r0, r1, r2, r3, x, inWidth);
+
+		// the in-lane unpacks produce outputs in j, j+2, j+1, j+3 order, fixed up by the final permute
+		dst = out + i * outWidth;
+		for (j = 0; j + 4 <= outWidth; j += 4)
+		{
+			const uint16_t *s = sums + j * 8;
+			const __m256i A = _mm256_loadu_si256((const __m256i *)(s));
+			const __m256i B = _mm256_loadu_si256((const __m256i *)(s + 16));
+			const __m256i A2 = _mm256_loadu_si256((const __m256i *)(s + 8));
+			const __m256i B2 = _mm256_loadu_si256((const __m256i *)(s + 24));
+			const __m256i E = _mm256_unpacklo_epi64(A, B);
+			const __m256i O = _mm256_unpackhi_epi64(A, B);
+			const __m256i E2 = _mm256_unpacklo_epi64(A2, B2);
+			const __m256i O2 = _mm256_unpackhi_epi64(A2, B2);
+			__m256i t = _mm256_add_epi16(_mm256_add_epi16(E, O2), _mm256_slli_epi16(_mm256_add_epi16(O, E2), 1));
+			t = _mm256_srli_epi16(_mm256_mulhi_epu16(t, div36), 5);
+			t = _mm256_permutevar8x32_epi32(_mm256_packus_epi16(t, t), order);
+			_mm_storeu_si128((__m128i *)(dst + j), _mm256_castsi256_si128(t));
+		}
+		R_MipMap2RowTail(dst, sums, j, outWidth);
+	}
+}
+
+AVX2_TARGET static void R_MipMapBox_AVX2(byte *out, const byte *in, int width, int height)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const byte *a, *b;
+	int i, j, k;
+
+	const int row = width * 4;
+	width >>= 1;
+	height >>= 1;
+
+	for (i = 0; i < height; i++, out += width * 4)
+	{
+		a = in + i * (width * 8 + row);
+		b = a + row;
+
+		for (j = 0; j + 8 <= width; j += 8)
+		{
+			const __m256 a0 = _mm256_castsi256_ps(_mm256_loadu_si256((const __m256i *)(a + j * 8)));
+			const __m256 a1 = _mm256_castsi256_ps(_mm256_loadu_si256((const __m256i *)(a + j * 8 + 32)));
+			const __m256 b0 = _mm256_castsi256_ps(_mm256_loadu_si256((const __m256i *)(b + j * 8)));
+			const __m256 b1 = _mm256_castsi256_ps(_mm256_loadu_si256((const __m256i *)(b + j * 8 + 32)));
+			const __m256i ea = _mm256_castps_si256(_mm256_shuffle_ps(a0, a1, _MM_SHUFFLE(2, 0, 2, 0)));
+			const __m256i oa = _mm256_castps_si256(_mm256_shuffle_ps(a0, a1, _MM_SHUFFLE(3, 1, 3, 1)));
+			const __m256i eb = _mm256_castps_si256(_mm256_shuffle_ps(b0, b1, _MM_SHUFFLE(2, 0, 2, 0)));
+			const __m256i ob = _mm256_castps_si256(_mm256_shuffle_ps(b0, b1, _MM_SHUFFLE(3, 1, 3, 1)));
+			__m256i lo = _mm256_add_epi16(_mm256_add_epi16(_mm256_unpacklo_epi8(ea, zero), _mm256_unpacklo_epi8(oa, zero)),
+										  _mm256_add_epi16(_mm256_unpacklo_epi8(eb, zero), _mm256_unpacklo_epi8(ob, zero)));
+			__m256i hi = _mm256_add_epi16(_mm256_add_epi16(_mm256_unpackhi_epi8(ea, zero), _mm256_unpackhi_epi8(oa, zero)),
+										  _mm256_add_epi16(_mm256_unpackhi_epi8(eb, zero), _mm256_unpackhi_epi8(ob, zero)));
+			lo = _mm256_srli_epi16(lo, 2);
+			hi = _mm256_srli_epi16(hi, 2);
+			// the 128-bit lane shuffles leave pixel pairs as 0 1 4 5 2 3 6 7
+			_mm256_storeu_si256((__m256i *)(out + j * 4), _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), _MM_SHUFFLE(3, 1, 2, 0)));
+		}
+
+		for (; j < width; j++)
+		{
+			for (k = 0; k < 4; k++)
+			{
+				out[j * 4 + k] = (a[j * 8 + k] + a[j * 8 + 4 + k] + b[j * 8 + k] + b[j * 8 + 4 + k]) >> 2;
+			}
+		}
+	}
+}
+
+AVX2_TARGET static void R_ResampleRow_AVX2(uint32_t *out, const uint32_t *inrow, const uint32_t *inrow2, const unsigned *p1, const unsigned *p2, int outWidth)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	int j;
+
+	for (j = 0; j + 8 <= outWidth; j += 8)
+	{
+		const __m256i o1 = _mm256_loadu_si256((const __m256i *)(p1 + j));
+		const __m256i o2 = _mm256_loadu_si256((const __m256i *)(p2 + j));
+		const __m256i a = _mm256_i32gather_epi32((const int *)inrow, o1, 1);
+		const __m256i b = _mm256_i32gather_epi32((const int *)inrow, o2, 1);
+		const __m256i c = _mm256_i32gather_epi32((const int *)inrow2, o1, 1);
+		const __m256i d = _mm256_i32gather_epi32((const int *)inrow2, o2, 1);
+		__m256i lo = _mm256_add_epi16(_mm256_add_epi16(_mm256_unpacklo_epi8(a, zero), _mm256_unpacklo_epi8(b, zero)),
+									  _mm256_add_epi16(_mm256_unpacklo_epi8(c, zero), _mm256_unpacklo_epi8(d, zero)));
+		__m256i hi = _mm256_add_epi16(_mm256_add_epi16(_mm256_unpackhi_epi8(a, zero), _mm256_unpackhi_epi8(b, zero)),
+									  _mm256_add_epi16(_mm256_unpackhi_epi8(c, zero), _mm256_unpackhi_epi8(d, zero)));
+		lo = _mm256_srli_epi16(lo, 2);
+		hi = _mm256_srli_epi16(hi, 2);
+		_mm256_storeu_si256((__m256i *)(out + j), _mm256_packus_epi16(lo, hi));
+	}
+
+	R_ResampleRow_Scalar(out + j, inrow, inrow2, p1 + j, p2 + j, outWidth - j);
+}
+
+static bool R_CPUHasAVX2(void)
+{
+#ifdef _MSC_VER
+	int regs[4];
+
+	__cpuid(regs, 0);
+	if (regs[0] < 7)
+		return false;
+
+	// the OS has to save the ymm registers as well
+	__cpuid(regs, 1);
+	if ((regs[2] & (1 << 27)) == 0 || (regs[2] & (1 << 28)) == 0)
+		return false;
+	if ((_xgetbv(0) & 6) != 6)
+		return false;
+
+	__cpuidex(regs, 7, 0);
+	return (regs[1] & (1 << 5)) != 0;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+
+static const imageKernels_t sse2Kernels = {"sse2", R_MipMap2_SSE2, R_MipMapBox_SSE2, R_ResampleRow_SSE2};
+static const imageKernels_t avx2Kernels = {"avx2", R_MipMap2_AVX2, R_MipMapBox_AVX2, R_ResampleRow_AVX2};
+
+#endif // USE_IMAGE_SSE2
+
+static const imageKernels_t scalarKernels = {"scalar", R_MipMap2_Scalar, R_MipMapBox_Scalar, R_ResampleRow_Scalar};
+
+/*
+================
+R_InitImageKernels
+================
+*/
+void R_InitImageKernels(void)
+{
+	imageKernels = scalarKernels;
+
+#ifdef USE_IMAGE_SSE2
+	imageKernels = R_CPUHasAVX2() ? avx2Kernels : sse2Kernels;
+#endif
+
+	ri.Printf(PRINT_DEVELOPER, "...using %s image kernels\n", imageKernels.name);
+}
+
+//=============================================================================
+
+typedef struct
+{
+	std::vector<uint32_t> mipMap2;
+	std::vector<uint32_t> mipMapBox;
+	std::vector<uint32_t> resample;
+	int64_t usec[3];
+} imageBenchResult_t;
+
+static int64_t R_BenchUsec(const std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void R_BenchKernels(const imageKernels_t &k, const std::vector<uint32_t> &src, const int size, const int runs, imageBenchResult_t &res)
+{
+	std::array<unsigned, MAX_TEXTURE_SIZE> p1, p2;
+	std::chrono::steady_clock::time_point start;
+	unsigned frac, fracstep;
+	uint32_t *out;
+	int run, w, i;
+
+	// full mip chains, every level written behind the previous one
+	res.mipMap2.assign(src.size() / 3 * 2, 0);
+	res.mipMapBox.assign(src.size() / 3 * 2, 0);
+
+	start = std::chrono::steady_clock::now();
+	for (run = 0; run < runs; run++)
+	{
+		const uint32_t *in = src.data();
+		out = res.mipMap2.data();
+		for (w = size; w > 1; w >>= 1)
+		{
+			k.mipMap2(out, in, w, w);
+			in = out;
+			out += (w >> 1) * (w >> 1);
+		}
+	}
+	res.usec[0] = R_BenchUsec(start);
+
+	start = std::chrono::steady_clock::now();
+	for (run = 0; run < runs; run++)
+	{
+		const uint32_t *in = src.data();
+		out = res.mipMapBox.data();
+		for (w = size; w > 1; w >>= 1)
+		{
+			k.mipMapBox((byte *)out, (const byte *)in, w, w);
+			in = out;
+			out += (w >> 1) * (w >> 1);
+		}
+	}
+	res.usec[1] = R_BenchUsec(start);
+
+	// non power of two source scaled up to size, like ResampleTexture() does on load
+	const int inSize = size * 3 / 4;
+	res.resample.assign(size * size, 0);
+
+	fracstep = inSize * 0x10000 / size;
+	frac = fracstep >> 2;
+	for (i = 0; i < size; i++, frac += fracstep)
+		p1[i] = 4 * (frac >> 16);
+	frac = 3 * (fracstep >> 2);
+	for (i = 0; i < size; i++, frac += fracstep)
+		p2[i] = 4 * (frac >> 16);
+
+	start = std::chrono::steady_clock::now();
+	for (run = 0; run < runs; run++)
+	{
+		out = res.resample.data();
+		for (i = 0; i < size; i++, out += size)
+		{
+			const uint32_t *inrow = src.data() + inSize * (int)((i + 0.25) * inSize / size);
+			const uint32_t *inrow2 = src.data() + inSize * (int)((i + 0.75) * inSize / size);
+			k.resampleRow(out, inrow, inrow2, p1.data(), p2.data(), size);
+		}
+	}
+	res.usec[2] = R_BenchUsec(start);
+}
+
+/*
+================
+R_ImageBench_f
+
+Times the scalar and the vectorized image kernels on random
+textures and checks that they produce identical mip chains.
+================
+*/
+void R_ImageBench_f(void)
+{
+	static const int sizes[] = {256, 512, 1024, 2048};
+	std::vector<const imageKernels_t *> kernels = {&scalarKernels};
+	imageBenchResult_t ref, res;
+	std::vector<uint32_t> src;
+	uint32_t seed = 0x12345678;
+	int runs, mismatches;
+	size_t n, i;
+
+#ifdef USE_IMAGE_SSE2
+	kernels.push_back(&sse2Kernels);
+	if (R_CPUHasAVX2())
+		kernels.push_back(&avx2Kernels);
+#endif
+
+	runs = ri.Cmd_Argc() > 1 ? atoi(ri.Cmd_Argv(1)) : 4;
+	if (runs < 1)
+		runs = 1;
+
+	mismatches = 0;
+
+	ri.Printf(PRINT_ALL, "image kernels in use: %s, %i runs, msec for mipmap2 / box mipmap / resample\n", imageKernels.name, runs);
+
+	for (const int size : sizes)
+	{
+		src.resize(size * size);
+		for (i = 0; i < src.size(); i++)
+		{
+			seed = seed * 1664525 + 1013904223;
+			src[i] = seed;
+		}
+
+		for (n = 0; n < kernels.size(); n++)
+		{
+			R_BenchKernels(*kernels[n], src, size, runs, n == 0 ? ref : res);
+
+			if (n > 0 && (res.mipMap2 != ref.mipMap2 || res.mipMapBox != ref.mipMapBox || res.resample != ref.resample))
+			{
+				ri.Printf(PRINT_WARNING, "%s kernels differ from scalar at %ix%i\n", kernels[n]->name, size, size);
+				mismatches++;
+			}
+
+			const imageBenchResult_t &r = n == 0 ? ref : res;
+			ri.Printf(PRINT_ALL, "%4i %-6s %8.2f %8.2f %8.2f\n", size, kernels[n]->name,
+					  r.usec[0] / 1000.0, r.usec[1] / 1000.0, r.usec[2] / 1000.0);
+		}
+	}
+
+	ri.Printf(PRINT_ALL, "%i mismatches\n", mismatches);
+}
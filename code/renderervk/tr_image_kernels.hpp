@@ -0,0 +1,29 @@
+#ifndef TR_IMAGE_KERNELS_HPP
+#define TR_IMAGE_KERNELS_HPP
+
+#include "tr_local.hpp"
+
+// RGBA8 mipmap and resample loops used by generate_image_upload_data().
+// R_InitImageKernels() picks SSE2 or AVX2 versions at runtime, every version
+// writes the same bytes as the scalar one, "imagebench" checks and times them.
+
+typedef struct
+{
+	const char *name;
+
+	// 4x4 filtered quartering with wrap-around (r_simpleMipMaps 0), out must not alias in
+	void (*mipMap2)(uint32_t *out, const uint32_t *in, int inWidth, int inHeight);
+
+	// 2x2 box quartering (r_simpleMipMaps 1) of a width x height image, both at least 2, may run in place
+	void (*mipMapBox)(byte *out, const byte *in, int width, int height);
+
+	// one ResampleTexture() row, p1/p2 hold the byte offsets of the two source columns
+	void (*resampleRow)(uint32_t *out, const uint32_t *inrow, const uint32_t *inrow2, const unsigned *p1, const unsigned *p2, int outWidth);
+} imageKernels_t;
+
+extern imageKernels_t imageKernels;
+
+void R_InitImageKernels(void);
+void R_ImageBench_f(void);
+
+#endif // TR_IMAGE_KERNELS_HPP
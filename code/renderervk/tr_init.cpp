@@ -32,6 +32,11 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include "tr_image.hpp"
 #include "tr_light.hpp"
 #include "tr_model.hpp"
+#include "tr_jobs.hpp"
+#include "tr_smp.hpp"
+#include "tr_prefetch.hpp"
+#include "tr_image_kernels.hpp"
+#include "tr_mesh_kernels.hpp"
 
 #include "string_operations.hpp"
 
@@ -173,6 +178,7 @@ cvar_t *r_mapGreyScale;
 
 cvar_t *r_debugSurface;
 cvar_t *r_simpleMipMaps;
+cvar_t *r_gpuMipMaps;
 
 cvar_t *r_showImages;
 cvar_t *r_defaultImage;
@@ -186,6 +192,15 @@ cvar_t *r_saveFontData;
 
 cvar_t *r_marksOnTriangleMeshes;
 
+cvar_t *r_workerThreads;
+cvar_t *r_smp;
+cvar_t *r_pipelineCache;
+cvar_t *r_pipelineThread;
+cvar_t *r_loadStats;
+cvar_t *r_gpuProfileLog;
+cvar_t *r_md3FrameCache;
+cvar_t *r_instancing;
+
 cvar_t *r_aviMotionJpegQuality;
 cvar_t *r_screenshotJpegQuality;
 
@@ -197,6 +212,7 @@ int max_polyverts;
 #include "vk.hpp"
 #include "math.hpp"
 #include "vk_pipeline.hpp"
+#include "vk_pipeline_cache.hpp"
 #include "utils.hpp"
 Vk_Instance vk_inst;
 Vk_World vk_world;
@@ -262,6 +278,18 @@ static void InitOpenGL(void)
 
 	if (glConfig.vidWidth == 0)
 	{
+#ifdef USE_NULL_RENDERER
+		// no window, render at \r_customWidth x \r_customHeight
+		glConfig.vidWidth = ri.Cvar_VariableIntegerValue("r_customWidth");
+		glConfig.vidHeight = ri.Cvar_VariableIntegerValue("r_customHeight");
+		if (glConfig.vidWidth <= 0 || glConfig.vidHeight <= 0)
+		{
+			glConfig.vidWidth = 640;
+			glConfig.vidHeight = 480;
+		}
+		glConfig.windowAspect = (float)glConfig.vidWidth / (float)glConfig.vidHeight;
+		glConfig.isFullscreen = false;
+#else
 		if (!ri.VKimp_Init)
 		{
 			ri.Error(ERR_FATAL, "Vulkan interface is not initialized");
@@ -269,6 +297,7 @@ static void InitOpenGL(void)
 
 		// This function is responsible for initializing a valid Vulkan subsystem.
 		ri.VKimp_Init(&glConfig);
+#endif
 
 		gls.windowWidth = glConfig.vidWidth;
 		gls.windowHeight = glConfig.vidHeight;
@@ -307,7 +336,9 @@ static void InitOpenGL(void)
 
 		glConfig.deviceSupportsGamma = false;
 
+#ifndef USE_NULL_RENDERER
 		ri.GLimp_InitGamma(&glConfig);
+#endif
 
 		gls.deviceSupportsGamma = glConfig.deviceSupportsGamma;
 
@@ -743,6 +774,9 @@ static void R_ScreenShot_f(void)
 		return;
 	}
 
+	// screenshot state is shared with the back end
+	R_SyncRenderThread();
+
 	if (!strcmp(ri.Cmd_Argv(1), "levelshot"))
 	{
 		R_LevelShot();
@@ -1041,11 +1075,15 @@ static void GfxInfo_f(void)
 
 static void VkInfo_f(void)
 {
+	R_SyncRenderThread();
+
 	ri.Printf(PRINT_ALL, "max_vertex_usage: %iKb\n", (int)((vk_inst.stats.vertex_buffer_max + 1023) / 1024));
 	ri.Printf(PRINT_ALL, "max_push_size: %ib\n", vk_inst.stats.push_size_max);
+	ri.Printf(PRINT_ALL, "staging submits: %i, stalls: %i\n", vk_inst.stats.staging_submits, vk_inst.stats.staging_stalls);
 
 	ri.Printf(PRINT_ALL, "pipeline handles: %i\n", vk_inst.pipeline_create_count);
 	ri.Printf(PRINT_ALL, "pipeline descriptors: %i, base: %i\n", vk_inst.pipelines_count, vk_inst.pipelines_world_base);
+	vk_pipeline_cache_info();
 	ri.Printf(PRINT_ALL, "image chunks: %i\n", vk_world.num_image_chunks);
 }
 
@@ -1056,6 +1094,8 @@ RE_SyncRender
 */
 static void RE_SyncRender(void)
 {
+	R_SyncRenderThread();
+
 	if (vk_inst.device)
 		vk_wait_idle();
 }
@@ -1077,6 +1117,8 @@ static void R_Register(void)
 	ri.Cmd_AddCommand("screenshotBMP", R_ScreenShot_f);
 	ri.Cmd_AddCommand("gfxinfo", GfxInfo_f);
 	ri.Cmd_AddCommand("vkinfo", VkInfo_f);
+	ri.Cmd_AddCommand("imagebench", R_ImageBench_f);
+	ri.Cmd_AddCommand("meshbench", R_MeshBench_f);
 
 	//
 	// temporary latched variables that can only change over a restart
@@ -1097,6 +1139,9 @@ static void R_Register(void)
 
 	r_simpleMipMaps = ri.Cvar_Get("r_simpleMipMaps", "1", CVAR_ARCHIVE_ND | CVAR_LATCH);
 	ri.Cvar_SetDescription(r_simpleMipMaps, "Whether or not to use a simple mipmapping algorithm or a more correct one:\n 0: off (proper linear filter)\n 1: on (for slower machines)");
+	r_gpuMipMaps = ri.Cvar_Get("r_gpuMipMaps", "0", CVAR_ARCHIVE_ND | CVAR_LATCH);
+	ri.Cvar_CheckRange(r_gpuMipMaps, "0", "1", CV_INTEGER);
+	ri.Cvar_SetDescription(r_gpuMipMaps, "Uploads only the base level of 32-bit textures and generates the mip chain on the GPU with linear blits, which filters like r_simpleMipMaps 1. Ignored with r_colorMipLevels.");
 	r_vertexLight = ri.Cvar_Get("r_vertexLight", "0", CVAR_ARCHIVE | CVAR_LATCH);
 	ri.Cvar_SetDescription(r_vertexLight, "Set to 1 to use vertex light instead of lightmaps, collapse all multi-stage shaders into single-stage ones, might cause rendering artifacts.");
 
@@ -1276,7 +1321,10 @@ static void R_Register(void)
 	r_showcluster = ri.Cvar_Get("r_showcluster", "0", CVAR_CHEAT);
 	ri.Cvar_SetDescription(r_showcluster, "Shows current cluster index.");
 	r_speeds = ri.Cvar_Get("r_speeds", "0", CVAR_CHEAT);
-	ri.Cvar_SetDescription(r_speeds, "Prints out various debugging stats from PVS:\n 0: Disabled\n 1: Backend BSP\n 2: Frontend grid culling\n 3: Current view cluster index\n 4: Dynamic lighting\n 5: zFar clipping\n 6: Flares");
+	ri.Cvar_SetDescription(r_speeds, "Prints out various debugging stats from PVS:\n 0: Disabled\n 1: Backend BSP\n 2: Frontend grid culling\n 3: Current view cluster index\n 4: Dynamic lighting\n 5: zFar clipping\n 6: Flares\n 7: Front/back end timing and SMP overlap\n 8: GPU time per pass from timestamp queries, one frame late");
+	r_gpuProfileLog = ri.Cvar_Get("r_gpuProfileLog", "0", CVAR_TEMP);
+	ri.Cvar_CheckRange(r_gpuProfileLog, "0", "100000", CV_INTEGER);
+	ri.Cvar_SetDescription(r_gpuProfileLog, "Writes the r_speeds 8 GPU timings of the next N frames to gpuprofile.csv, resets to 0 when done.");
 	r_debugSurface = ri.Cvar_Get("r_debugSurface", "0", CVAR_CHEAT);
 	ri.Cvar_SetDescription(r_debugSurface, "Backend visual debugging tool for bezier mesh surfaces.");
 	r_nobind = ri.Cvar_Get("r_nobind", "0", CVAR_CHEAT);
@@ -1323,6 +1371,37 @@ static void R_Register(void)
 	ri.Cvar_SetDescription(r_bloom_modulate, "Modulate extracted color:\n 0: off (color = color, i.e. no changes)\n 1: by itself (color = color * color)\n 2: by intensity (color = color * luma(color))");
 	ri.Cvar_SetGroup(r_bloom_modulate, CVG_RENDERER);
 
+	r_workerThreads = ri.Cvar_Get("r_workerThreads", "0", CVAR_ARCHIVE_ND | CVAR_LATCH);
+	ri.Cvar_CheckRange(r_workerThreads, "-1", "15", CV_INTEGER);
+	ri.Cvar_SetDescription(r_workerThreads, "Number of renderer worker threads used for parallel front-end work like world traversal:\n"
+											" 0 - disabled, everything runs on the main thread\n"
+											" -1 - use all available cores except one");
+
+	r_smp = ri.Cvar_Get("r_smp", "0", CVAR_ARCHIVE_ND | CVAR_LATCH);
+	ri.Cvar_CheckRange(r_smp, "0", "1", CV_INTEGER);
+	ri.Cvar_SetDescription(r_smp, "Replays render commands on a dedicated back end thread while the main thread builds the next frame, see r_speeds 7 for front/back overlap.");
+
+	r_pipelineCache = ri.Cvar_Get("r_pipelineCache", "1", CVAR_ARCHIVE_ND | CVAR_LATCH);
+	ri.Cvar_CheckRange(r_pipelineCache, "0", "1", CV_INTEGER);
+	ri.Cvar_SetDescription(r_pipelineCache, "Saves the Vulkan pipeline cache to vkpipelines.cache on shutdown and reuses it on the next start with the same driver and build.");
+
+	r_pipelineThread = ri.Cvar_Get("r_pipelineThread", "0", CVAR_ARCHIVE_ND | CVAR_LATCH);
+	ri.Cvar_CheckRange(r_pipelineThread, "0", "1", CV_INTEGER);
+	ri.Cvar_SetDescription(r_pipelineThread, "Compiles the pipelines of loaded shaders on a background thread instead of at registration or first use, see vkinfo for statistics.");
+
+	r_loadStats = ri.Cvar_Get("r_loadStats", "0", CVAR_ARCHIVE_ND);
+	ri.Cvar_CheckRange(r_loadStats, "0", "1", CV_INTEGER);
+	ri.Cvar_SetDescription(r_loadStats, "Prints how long each step of level loading took at the end of registration, including the image prefetch done on r_workerThreads.");
+
+	r_md3FrameCache = ri.Cvar_Get("r_md3FrameCache", "16", CVAR_ARCHIVE_ND | CVAR_LATCH);
+	ri.Cvar_CheckRange(r_md3FrameCache, "0", "256", CV_INTEGER);
+	ri.Cvar_SetDescription(r_md3FrameCache, "Decodes MD3 vertex positions and normals once at load time so animated models only need a lerp per frame.\n"
+		" Value is the hunk memory limit per model in megabytes, all of its LODs together, decoded frames take three times the file size. 0 - decode every frame.");
+
+	r_instancing = ri.Cvar_Get("r_instancing", "1", CVAR_ARCHIVE_ND);
+	ri.Cvar_CheckRange(r_instancing, "0", "1", CV_INTEGER);
+	ri.Cvar_SetDescription(r_instancing, "Draws MD3 entities that share a shader and entity state as one batch, their vertexes are moved to world space on the CPU. Savings are shown by \\r_speeds 1.");
+
 	if (glConfig.vidWidth)
 		return;
 
@@ -1331,8 +1410,10 @@ static void R_Register(void)
 	//
 	r_allowExtensions = ri.Cvar_Get("r_allowExtensions", "1", CVAR_ARCHIVE_ND | CVAR_LATCH | CVAR_DEVELOPER);
 	ri.Cvar_SetDescription(r_allowExtensions, "Use all of the OpenGL extensions your card is capable of.");
-	r_ext_compressed_textures = ri.Cvar_Get("r_ext_compressed_textures", "0", CVAR_ARCHIVE_ND | CVAR_LATCH | CVAR_DEVELOPER);
-	ri.Cvar_SetDescription(r_ext_compressed_textures, "Enables texture compression.");
+	r_ext_compressed_textures = ri.Cvar_Get("r_ext_compressed_textures", "0", CVAR_ARCHIVE_ND | CVAR_LATCH);
+	ri.Cvar_SetDescription(r_ext_compressed_textures, "Enables BC1/BC3/BC7 texture compression.\n"
+		" Pre-compressed .ktx2 and .dds files next to the images are used as-is,\n"
+		" other mipmapped textures are compressed once and cached in texcache/.");
 	r_ext_multitexture = ri.Cvar_Get("r_ext_multitexture", "1", CVAR_ARCHIVE_ND | CVAR_LATCH | CVAR_DEVELOPER);
 	ri.Cvar_SetDescription(r_ext_multitexture, "Enables hardware multi-texturing (0: off, 1: on).");
 	r_ext_compiled_vertex_array = ri.Cvar_Get("r_ext_compiled_vertex_array", "1", CVAR_ARCHIVE_ND | CVAR_LATCH | CVAR_DEVELOPER);
@@ -1509,13 +1590,26 @@ void R_Init(void)
 
 	R_Register();
 
+	R_InitJobs();
+
+	R_InitImageKernels();
+	R_InitMeshKernels();
+
+	R_InitRenderThread();
+
 	max_polys = r_maxpolys->integer;
 	max_polyverts = r_maxpolyverts->integer;
 
-	ptr = reinterpret_cast<byte *>(ri.Hunk_Alloc(sizeof(*backEndData) + sizeof(srfPoly_t) * max_polys + sizeof(polyVert_t) * max_polyverts, h_low));
-	backEndData = (backEndData_t *)ptr;
-	backEndData->polys = (srfPoly_t *)((char *)ptr + sizeof(*backEndData));
-	backEndData->polyVerts = (polyVert_t *)((char *)ptr + sizeof(*backEndData) + sizeof(srfPoly_t) * max_polys);
+	// second buffer is only needed when the back end runs on its own thread
+	Com_Memset(backEndBuffers, 0, sizeof(backEndBuffers));
+	for (i = 0; i < (R_RenderThreadActive() ? SMP_FRAMES : 1); i++)
+	{
+		ptr = reinterpret_cast<byte *>(ri.Hunk_Alloc(sizeof(*backEndData) + sizeof(srfPoly_t) * max_polys + sizeof(polyVert_t) * max_polyverts, h_low));
+		backEndBuffers[i] = (backEndData_t *)ptr;
+		backEndBuffers[i]->polys = (srfPoly_t *)((char *)ptr + sizeof(*backEndData));
+		backEndBuffers[i]->polyVerts = (polyVert_t *)((char *)ptr + sizeof(*backEndData) + sizeof(srfPoly_t) * max_polys);
+	}
+	backEndData = backEndBuffers[tr.smpFrame];
 
 	R_InitNextFrame();
 
@@ -1547,6 +1641,9 @@ static void RE_Shutdown(refShutdownCode_t code)
 {
 	ri.Printf(PRINT_ALL, "RE_Shutdown( %i )\n", code);
 
+	// let the back end finish its list before anything it uses goes away
+	R_ShutdownRenderThread();
+
 	ri.Cmd_RemoveCommand("modellist");
 	ri.Cmd_RemoveCommand("screenshotBMP");
 	ri.Cmd_RemoveCommand("screenshotJPEG");
@@ -1557,6 +1654,8 @@ static void RE_Shutdown(refShutdownCode_t code)
 	ri.Cmd_RemoveCommand("gfxinfo");
 	ri.Cmd_RemoveCommand("shaderstate");
 	ri.Cmd_RemoveCommand("vkinfo");
+	ri.Cmd_RemoveCommand("imagebench");
+	ri.Cmd_RemoveCommand("meshbench");
 
 	//if ( tr.registered ) {
 		//R_IssuePendingRenderCommands();
@@ -1568,6 +1667,8 @@ static void RE_Shutdown(refShutdownCode_t code)
 
 	R_DoneFreeType();
 
+	R_ShutdownJobs();
+
 	if (r_device->modified)
 	{
 		code = REF_UNLOAD_DLL;
@@ -1582,7 +1683,9 @@ static void RE_Shutdown(refShutdownCode_t code)
 
 		if (code != REF_KEEP_WINDOW)
 		{
+#ifndef USE_NULL_RENDERER
 			ri.VKimp_Shutdown(code == REF_UNLOAD_DLL ? true : false);
+#endif
 			Com_Memset(&glConfig, 0, sizeof(glConfig));
 		}
 	}
@@ -1602,7 +1705,11 @@ Touch all images to make sure they are resident
 */
 static void RE_EndRegistration(void)
 {
+	R_SyncRenderThread();
+	// first frame should not have to compile anything queued during loading
+	vk_finish_pipelines(false);
 	vk_wait_idle();
+	R_PrintLoadStats();
 	// command buffer is not in recording state at this stage
 	// so we can't issue RB_ShowImages() there
 }
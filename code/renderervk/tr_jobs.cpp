@@ -0,0 +1,182 @@
+#include "tr_jobs.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+constexpr int MAX_JOB_WORKERS = 15;
+
+static struct
+{
+	std::vector<std::thread> threads;
+	std::mutex lock;
+	std::condition_variable wake;
+	std::condition_variable done;
+
+	// current batch, published under lock
+	jobFunc_t func;
+	void *arg;
+	int count;
+	unsigned generation;
+	int pending; // workers that have not finished the current batch yet
+	bool quit;
+
+	std::atomic<int> next;
+} jobs;
+
+static void R_DrainJobs(const jobFunc_t func, void *arg, const int count)
+{
+	int index;
+
+	while ((index = jobs.next.fetch_add(1, std::memory_order_relaxed)) < count)
+	{
+		func(arg, index);
+	}
+}
+
+static void R_JobWorker(void)
+{
+	unsigned seen = 0;
+
+	for (;;)
+	{
+		jobFunc_t func;
+		void *arg;
+		int count;
+
+		{
+			std::unique_lock<std::mutex> lk(jobs.lock);
+			jobs.wake.wait(lk, [&seen]
+						   { return jobs.quit || jobs.generation != seen; });
+			if (jobs.quit)
+			{
+				return;
+			}
+			seen = jobs.generation;
+			func = jobs.func;
+			arg = jobs.arg;
+			count = jobs.count;
+		}
+
+		R_DrainJobs(func, arg, count);
+
+		{
+			std::lock_guard<std::mutex> lk(jobs.lock);
+			if (--jobs.pending == 0)
+			{
+				jobs.done.notify_one();
+			}
+		}
+	}
+}
+
+/*
+===============
+R_InitJobs
+===============
+*/
+void R_InitJobs(void)
+{
+	int numWorkers;
+
+	R_ShutdownJobs();
+
+	numWorkers = r_workerThreads->integer;
+	if (numWorkers < 0)
+	{
+		// leave one core for the main thread
+		numWorkers = static_cast<int>(std::thread::hardware_concurrency()) - 1;
+	}
+	numWorkers = std::clamp(numWorkers, 0, MAX_JOB_WORKERS);
+
+	if (numWorkers == 0)
+	{
+		return;
+	}
+
+	jobs.quit = false;
+	jobs.generation = 0;
+	jobs.pending = 0;
+
+	jobs.threads.reserve(numWorkers);
+	for (int i = 0; i < numWorkers; i++)
+	{
+		jobs.threads.emplace_back(R_JobWorker);
+	}
+
+	ri.Printf(PRINT_ALL, "...using %i renderer worker threads\n", numWorkers);
+}
+
+/*
+===============
+R_ShutdownJobs
+===============
+*/
+void R_ShutdownJobs(void)
+{
+	if (jobs.threads.empty())
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lk(jobs.lock);
+		jobs.quit = true;
+	}
+	jobs.wake.notify_all();
+
+	for (std::thread &t : jobs.threads)
+	{
+		t.join();
+	}
+
+	jobs.threads.clear();
+}
+
+int R_JobWorkers(void)
+{
+	return static_cast<int>(jobs.threads.size());
+}
+
+/*
+===============
+R_RunJobs
+===============
+*/
+void R_RunJobs(jobFunc_t func, void *arg, int count)
+{
+	if (count <= 0)
+	{
+		return;
+	}
+
+	if (jobs.threads.empty() || count == 1)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			func(arg, i);
+		}
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lk(jobs.lock);
+		jobs.func = func;
+		jobs.arg = arg;
+		jobs.count = count;
+		jobs.next.store(0, std::memory_order_relaxed);
+		jobs.pending = static_cast<int>(jobs.threads.size());
+		jobs.generation++;
+	}
+	jobs.wake.notify_all();
+
+	// calling thread takes its share too
+	R_DrainJobs(func, arg, count);
+
+	std::unique_lock<std::mutex> lk(jobs.lock);
+	jobs.done.wait(lk, []
+				   { return jobs.pending == 0; });
+}
@@ -0,0 +1,23 @@
+#ifndef TR_JOBS_HPP
+#define TR_JOBS_HPP
+
+#include "tr_local.hpp"
+
+// Small fixed-size worker pool for data-parallel renderer work.
+// Jobs must not call into ri.* (not thread-safe) and must only touch
+// state that is either read-only for the duration of R_RunJobs or owned
+// by the job index they were given.
+
+using jobFunc_t = void (*)(void *arg, int index);
+
+void R_InitJobs(void);
+void R_ShutdownJobs(void);
+
+// number of worker threads, 0 means everything runs on the calling thread
+int R_JobWorkers(void);
+
+// runs func( arg, 0 .. count-1 ) across the workers and the calling thread,
+// returns when all indexes are done
+void R_RunJobs(jobFunc_t func, void *arg, int count);
+
+#endif // TR_JOBS_HPP
@@ -951,6 +951,8 @@ typedef struct
 	// int/float whereas the official IQM tool exports byte/byte
 	int blendWeightsType; // IQM_UBYTE or IQM_FLOAT
 
+	float *influenceWeights; // [num_influences * 4] either format as floats, for skinning
+
 	char *jointNames;
 	int *jointParents;
 	float *bindJoints;	   // [num_joints * 12]
@@ -1083,6 +1085,14 @@ enum class modtype_t : uint8_t
 	MOD_IQM
 };
 
+// MD3 vertex frames decoded at load time (r_md3FrameCache), numFrames * numVerts
+// of these per surface, see model_t::md3Frames
+typedef struct
+{
+	vec3_t xyz;
+	vec3_t normal;
+} md3DecodedVert_t;
+
 typedef struct model_s
 {
 	std::array<char, MAX_QPATH> name;
@@ -1092,6 +1102,7 @@ typedef struct model_s
 	int dataSize;					// just for listing purposes
 	bmodel_t *bmodel;				// only if type == modtype_t::MOD_BRUSH
 	md3Header_t *md3[MD3_MAX_LODS]; // only if type == modtype_t::MOD_MESH
+	const md3DecodedVert_t **md3Frames[MD3_MAX_LODS]; // per surface of md3[], nullptr if not decoded
 	void *modelData;				// only if type == (modtype_t::MOD_MDR | modtype_t::MOD_IQM)
 
 	int numLods;
@@ -1203,7 +1214,12 @@ typedef struct
 	int c_flareTests;
 	int c_flareRenders;
 
-	int msec; // total msec for backend run
+	int64_t usec; // total usec for backend run
+
+	int c_draws;
+	int c_instanceBatches;	 // batches with more than one entity in world space
+	int c_instanceEntities;	 // entities merged into such a batch after the first
+	int c_instanceDrawsSaved; // draws the merged entities would have issued on their own
 #ifdef USE_PMLIGHT
 	int c_lit_batches;
 	int c_lit_vertices;
@@ -1266,6 +1282,8 @@ typedef struct
 	bool screenMapDone;
 	bool doneBloom;
 
+	const void *cmds; // command list being replayed
+
 } backEndState_t;
 
 typedef struct drawSurfsCommand_s drawSurfsCommand_t;
@@ -1299,6 +1317,7 @@ struct trGlobals_t
 
 	int visCount;	// incremented every time a new vis cluster is entered
 	int frameCount; // incremented every frame
+	int smpFrame;	// backEndBuffers[] index the front end is filling
 	int sceneCount; // incremented every scene
 	int viewCount;	// incremented every view (twice a scene if portaled)
 					// and every R_MarkFragments call
@@ -1363,7 +1382,7 @@ struct trGlobals_t
 	vec3_t sunDirection;
 
 	frontEndCounters_t pc;
-	int frontEndMsec; // not in pc due to clearing issue
+	int64_t frontEndUsec; // not in pc due to clearing issue
 
 	//
 	// put large tables at the end, so most elements will be
@@ -1531,6 +1550,7 @@ extern cvar_t *r_mapGreyScale;
 
 extern cvar_t *r_debugSurface;
 extern cvar_t *r_simpleMipMaps;
+extern cvar_t *r_gpuMipMaps; // generate texture mip chains with GPU blits
 
 extern cvar_t *r_showImages;
 extern cvar_t *r_defaultImage;
@@ -1540,8 +1560,26 @@ extern cvar_t *r_printShaders;
 
 extern cvar_t *r_marksOnTriangleMeshes;
 
+extern cvar_t *r_workerThreads; // renderer job pool size, 0 - single-threaded
+extern cvar_t *r_smp;			 // run the back end on its own thread
+extern cvar_t *r_pipelineCache;	 // keep compiled pipelines on disk between runs
+extern cvar_t *r_pipelineThread; // compile pipelines on a background thread during level load
+extern cvar_t *r_loadStats;		 // print level load timings at the end of registration
+extern cvar_t *r_gpuProfileLog;	 // frames of GPU timings to write to gpuprofile.csv
+extern cvar_t *r_md3FrameCache;	 // decode MD3 vertex frames once at load time, size limit in MB per model, all lods together
+extern cvar_t *r_instancing;	 // draw MD3 entities sharing a shader as one world space batch
+
 //====================================================================
 
+// CPU profiler scopes, recorded by the engine while com_profile is set
+#ifdef USE_PROFILER
+#define R_PROF_BEGIN(name) do { if (*ri.profiling) ri.ProfBegin(name); } while (0)
+#define R_PROF_END() do { if (*ri.profiling) ri.ProfEnd(); } while (0)
+#else
+#define R_PROF_BEGIN(name)
+#define R_PROF_END()
+#endif
+
 void R_SwapBuffers(int);
 
 void R_AddNullModelSurfaces(trRefEntity_t *e);
@@ -1627,6 +1665,16 @@ typedef struct stageVars
 	vec2_t *texcoordPtr[NUM_TEXTURE_BUNDLES];
 } stageVars_t;
 
+// an entity moved to world space in an instanced batch, see RB_RenderDrawSurfList()
+typedef struct
+{
+	const trRefEntity_t *entity;
+	int firstVertex;
+	vec3_t lightDir; // entity lightDir in world space
+} tessInstance_t;
+
+constexpr int MAX_TESS_INSTANCES = 128;
+
 typedef struct shaderCommands_s
 {
 #pragma pack(push, 16)
@@ -1681,6 +1729,11 @@ typedef struct shaderCommands_s
 	int numPasses;
 	shaderStage_t **xstages;
 
+	// set when vertexes of several entities were moved to world space
+	int numInstances;
+	int instanceVertexes; // vertexes already in world space
+	tessInstance_t instances[MAX_TESS_INSTANCES];
+
 } shaderCommands_t;
 
 extern shaderCommands_t tess;
@@ -1871,7 +1924,11 @@ typedef struct
 extern int max_polys;
 extern int max_polyverts;
 
-extern backEndData_t *backEndData;
+// with r_smp the front end fills one buffer while the back end replays the other
+constexpr int SMP_FRAMES = 2;
+
+extern backEndData_t *backEndData; // == backEndBuffers[tr.smpFrame]
+extern backEndData_t *backEndBuffers[SMP_FRAMES];
 
 void RB_TakeScreenshot(const int x, const int y, const int width, const int height, const char *fileName);
 void RB_TakeScreenshotJPEG(const int x, const int y, const int width, const int height, const char *fileName);
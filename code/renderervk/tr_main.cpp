@@ -31,6 +31,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include "tr_world.hpp"
 #include "tr_cmds.hpp"
 #include "tr_model.hpp"
+#include "tr_smp.hpp"
 #include "math.hpp"
 #include "utils.hpp"
 
@@ -1033,6 +1034,58 @@ static bool IsMirror(const drawSurf_t &drawSurf, const int entityNum)
 	return false;
 }
 
+// untransformed triangles of a portal surface
+typedef struct
+{
+	int numVerts;
+	const float *xyz;
+	int xyzStride; // in floats
+	const float *normals;
+	int normalStride; // 0 when all vertexes share the plane normal
+	int numIndexes;
+	const uint32_t *indexes;
+} portalGeometry_t;
+
+/*
+** R_GetPortalGeometry
+**
+** Brush faces and misc_model triangle soups are read straight from the
+** surface, everything else has to go through tess.
+*/
+static bool R_GetPortalGeometry(const surfaceType_t *surface, portalGeometry_t &geo)
+{
+	switch (*surface)
+	{
+	case surfaceType_t::SF_FACE:
+	{
+		const srfSurfaceFace_t *face = reinterpret_cast<const srfSurfaceFace_t *>(surface);
+		geo.numVerts = face->numPoints;
+		geo.xyz = face->points[0];
+		geo.xyzStride = VERTEXSIZE;
+		// per-vertex normals for non-coplanar faces
+		geo.normals = face->normals ? face->normals : face->plane.normal;
+		geo.normalStride = face->normals ? 4 : 0;
+		geo.numIndexes = face->numIndices;
+		geo.indexes = reinterpret_cast<const uint32_t *>(reinterpret_cast<const byte *>(face) + face->ofsIndices);
+		return true;
+	}
+	case surfaceType_t::SF_TRIANGLES:
+	{
+		const srfTriangles_t *tri = reinterpret_cast<const srfTriangles_t *>(surface);
+		geo.numVerts = tri->numVerts;
+		geo.xyz = tri->verts[0].xyz;
+		geo.xyzStride = sizeof(drawVert_t) / sizeof(float);
+		geo.normals = tri->verts[0].normal;
+		geo.normalStride = sizeof(drawVert_t) / sizeof(float);
+		geo.numIndexes = tri->numIndexes;
+		geo.indexes = reinterpret_cast<const uint32_t *>(tri->indexes);
+		return true;
+	}
+	default:
+		return false;
+	}
+}
+
 /*
 ** SurfIsOffscreen
 **
@@ -1044,32 +1097,52 @@ static bool SurfIsOffscreen(const drawSurf_t &drawSurf, bool &isMirror)
 	int entityNum;
 	int numTriangles;
 	shader_t *shader;
+	const shader_t *state;
 	int fogNum;
 	int dlighted;
 	vec4_t clip, eye;
 	int i;
 	unsigned int pointAnd = (unsigned int)~0;
+	portalGeometry_t geo;
+	bool tessellated;
 
 	isMirror = false;
 
 	R_RotateForViewer();
 
 	R_DecomposeSort(drawSurf.sort, entityNum, &shader, fogNum, dlighted);
-	RB_BeginSurface(*shader, fogNum);
+	state = shader->remappedShader ? shader->remappedShader : shader;
+
+	tessellated = !R_GetPortalGeometry(drawSurf.surface, geo);
+	if (tessellated)
+	{
+		// tess belongs to the back end
+		R_SyncRenderThread();
+
+		RB_BeginSurface(*shader, fogNum);
 #ifdef USE_VBO
-	tess.allowVBO = false;
+		tess.allowVBO = false;
 #endif
 #ifdef USE_TESS_NEEDS_NORMAL
-	tess.needsNormal = true;
+		tess.needsNormal = true;
 #endif
-	rb_surfaceTable[static_cast<uint32_t>(*drawSurf.surface)](drawSurf.surface);
+		rb_surfaceTable[static_cast<uint32_t>(*drawSurf.surface)](drawSurf.surface);
+
+		geo.numVerts = tess.numVertexes;
+		geo.xyz = tess.xyz[0];
+		geo.xyzStride = 4;
+		geo.normals = tess.normal[0];
+		geo.normalStride = 4;
+		geo.numIndexes = tess.numIndexes;
+		geo.indexes = tess.indexes;
+	}
 
-	for (i = 0; i < tess.numVertexes; i++)
+	for (i = 0; i < geo.numVerts; i++)
 	{
 		int j;
 		unsigned int pointFlags = 0;
 
-		R_TransformModelToClip(tess.xyz[i], tr.ort.modelMatrix, tr.viewParms.projectionMatrix, eye, clip);
+		R_TransformModelToClip(geo.xyz + i * geo.xyzStride, tr.ort.modelMatrix, tr.viewParms.projectionMatrix, eye, clip);
 
 		for (j = 0; j < 3; j++)
 		{
@@ -1088,7 +1161,10 @@ static bool SurfIsOffscreen(const drawSurf_t &drawSurf, bool &isMirror)
 	// trivially reject
 	if (pointAnd)
 	{
-		tess.numIndexes = 0;
+		if (tessellated)
+		{
+			tess.numIndexes = 0;
+		}
 		return true;
 	}
 
@@ -1097,14 +1173,15 @@ static bool SurfIsOffscreen(const drawSurf_t &drawSurf, bool &isMirror)
 	// based on vertex distance isn't 100% correct (we should be checking for
 	// range to the surface), but it's good enough for the types of portals
 	// we have in the game right now.
-	numTriangles = tess.numIndexes / 3;
+	numTriangles = geo.numIndexes / 3;
 
-	for (i = 0; i < tess.numIndexes; i += 3)
+	for (i = 0; i < geo.numIndexes; i += 3)
 	{
 		vec3_t normal{};
 		float len;
+		const uint32_t index = geo.indexes[i];
 
-		VectorSubtract(tess.xyz[tess.indexes[i]], tr.viewParms.ort.origin, normal);
+		VectorSubtract(geo.xyz + index * geo.xyzStride, tr.viewParms.ort.origin, normal);
 
 		len = VectorLengthSquared(normal); // lose the sqrt
 		if (len < shortest)
@@ -1112,12 +1189,15 @@ static bool SurfIsOffscreen(const drawSurf_t &drawSurf, bool &isMirror)
 			shortest = len;
 		}
 
-		if (DotProduct(normal, tess.normal[tess.indexes[i]]) >= 0)
+		if (DotProduct(normal, geo.normals + index * geo.normalStride) >= 0)
 		{
 			numTriangles--;
 		}
 	}
-	tess.numIndexes = 0;
+	if (tessellated)
+	{
+		tess.numIndexes = 0;
+	}
 	if (!numTriangles)
 	{
 		return true;
@@ -1131,7 +1211,7 @@ static bool SurfIsOffscreen(const drawSurf_t &drawSurf, bool &isMirror)
 		return false;
 	}
 
-	if (shortest > (tess.shader->portalRange * tess.shader->portalRange))
+	if (shortest > (state->portalRange * state->portalRange))
 	{
 		return true;
 	}
@@ -1830,6 +1910,8 @@ void R_RenderView(const viewParms_t &parms)
 	int firstDrawSurf;
 	int numDrawSurfs;
 
+	R_PROF_BEGIN("R_RenderView");
+
 	tr.viewCount++;
 
 	tr.viewParms = parms;
@@ -1855,4 +1937,6 @@ void R_RenderView(const viewParms_t &parms)
 	}
 
 	R_SortDrawSurfs(*(tr.refdef.drawSurfs + firstDrawSurf), numDrawSurfs - firstDrawSurf);
+
+	R_PROF_END();
 }
\ No newline at end of file
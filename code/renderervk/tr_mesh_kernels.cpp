@@ -0,0 +1,694 @@
+#include "tr_mesh_kernels.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define USE_MESH_SSE2
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define AVX2_TARGET
+#else
+#define AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#endif
+
+meshKernels_t meshKernels;
+
+/*
+================
+R_LerpPacked_Scalar
+================
+*/
+static void R_LerpPacked_Scalar(vec4_t *xyz, vec4_t *normal, const md3XyzNormal_t *oldVerts, const md3XyzNormal_t *newVerts, int numVerts, float backlerp)
+{
+	float *outXyz, *outNormal;
+	float oldXyzScale, newXyzScale;
+	float oldNormalScale, newNormalScale;
+	unsigned lat, lng;
+	int vertNum;
+
+	outXyz = xyz[0];
+	outNormal = normal[0];
+
+	newXyzScale = MD3_XYZ_SCALE * (1.0 - backlerp);
+	newNormalScale = 1.0 - backlerp;
+
+	if (backlerp == 0)
+	{
+		//
+		// just copy the vertexes
+		//
+		for (vertNum = 0; vertNum < numVerts; vertNum++, newVerts++, outXyz += 4, outNormal += 4)
+		{
+			outXyz[0] = newVerts->xyz[0] * newXyzScale;
+			outXyz[1] = newVerts->xyz[1] * newXyzScale;
+			outXyz[2] = newVerts->xyz[2] * newXyzScale;
+
+			lat = (newVerts->normal >> 8) & 0xff;
+			lng = (newVerts->normal & 0xff);
+			lat *= (FUNCTABLE_SIZE / 256);
+			lng *= (FUNCTABLE_SIZE / 256);
+
+			// decode X as cos( lat ) * sin( long )
+			// decode Y as sin( lat ) * sin( long )
+			// decode Z as cos( long )
+
+			outNormal[0] = tr.sinTable[(lat + (FUNCTABLE_SIZE / 4)) & FUNCTABLE_MASK] * tr.sinTable[lng];
+			outNormal[1] = tr.sinTable[lat] * tr.sinTable[lng];
+			outNormal[2] = tr.sinTable[(lng + (FUNCTABLE_SIZE / 4)) & FUNCTABLE_MASK];
+		}
+		return;
+	}
+
+	//
+	// interpolate and copy the vertex and normal
+	//
+	oldXyzScale = MD3_XYZ_SCALE * backlerp;
+	oldNormalScale = backlerp;
+
+	for (vertNum = 0; vertNum < numVerts; vertNum++, oldVerts++, newVerts++, outXyz += 4, outNormal += 4)
+	{
+		// interpolate the xyz
+		outXyz[0] = oldVerts->xyz[0] * oldXyzScale + newVerts->xyz[0] * newXyzScale;
+		outXyz[1] = oldVerts->xyz[1] * oldXyzScale + newVerts->xyz[1] * newXyzScale;
+		outXyz[2] = oldVerts->xyz[2] * oldXyzScale + newVerts->xyz[2] * newXyzScale;
+
+		// FIXME: interpolate lat/long instead?
+		lat = (newVerts->normal >> 8) & 0xff;
+		lng = (newVerts->normal & 0xff);
+		lat *= 4;
+		lng *= 4;
+		const vec3_t uncompressedNewNormal = {
+			tr.sinTable[(lat + (FUNCTABLE_SIZE / 4)) & FUNCTABLE_MASK] * tr.sinTable[lng],
+			tr.sinTable[lat] * tr.sinTable[lng],
+			tr.sinTable[(lng + (FUNCTABLE_SIZE / 4)) & FUNCTABLE_MASK]};
+
+		lat = (oldVerts->normal >> 8) & 0xff;
+		lng = (oldVerts->normal & 0xff);
+		lat *= 4;
+		lng *= 4;
+		const vec3_t uncompressedOldNormal = {
+			tr.sinTable[(lat + (FUNCTABLE_SIZE / 4)) & FUNCTABLE_MASK] * tr.sinTable[lng],
+			tr.sinTable[lat] * tr.sinTable[lng],
+			tr.sinTable[(lng + (FUNCTABLE_SIZE / 4)) & FUNCTABLE_MASK]};
+
+		outNormal[0] = uncompressedOldNormal[0] * oldNormalScale + uncompressedNewNormal[0] * newNormalScale;
+		outNormal[1] = uncompressedOldNormal[1] * oldNormalScale + uncompressedNewNormal[1] * newNormalScale;
+		outNormal[2] = uncompressedOldNormal[2] * oldNormalScale + uncompressedNewNormal[2] * newNormalScale;
+	}
+}
+
+/*
+================
+R_LerpDecoded_Scalar
+================
+*/
+static void R_LerpDecoded_Scalar(vec4_t *xyz, vec4_t *normal, const md3DecodedVert_t *oldVerts, const md3DecodedVert_t *newVerts, int numVerts, float backlerp)
+{
+	float oldScale, newScale;
+	int vertNum;
+
+	if (backlerp == 0)
+	{
+		for (vertNum = 0; vertNum < numVerts; vertNum++, newVerts++)
+		{
+			VectorCopy(newVerts->xyz, xyz[vertNum]);
+			VectorCopy(newVerts->normal, normal[vertNum]);
+		}
+		return;
+	}
+
+	oldScale = backlerp;
+	newScale = 1.0f - backlerp;
+
+	for (vertNum = 0; vertNum < numVerts; vertNum++, oldVerts++, newVerts++)
+	{
+		xyz[vertNum][0] = oldVerts->xyz[0] * oldScale + newVerts->xyz[0] * newScale;
+		xyz[vertNum][1] = oldVerts->xyz[1] * oldScale + newVerts->xyz[1] * newScale;
+		xyz[vertNum][2] = oldVerts->xyz[2] * oldScale + newVerts->xyz[2] * newScale;
+
+		normal[vertNum][0] = oldVerts->normal[0] * oldScale + newVerts->normal[0] * newScale;
+		normal[vertNum][1] = oldVerts->normal[1] * oldScale + newVerts->normal[1] * newScale;
+		normal[vertNum][2] = oldVerts->normal[2] * oldScale + newVerts->normal[2] * newScale;
+	}
+}
+
+/*
+** R_Normalize_Scalar
+*
+* The inputs to this routing seem to always be close to length = 1.0 (about 0.6 to 2.0)
+* This means that we don't have to worry about zero length ort enormously long vectors.
+*/
+static void R_Normalize_Scalar(vec4_t *normals, int count)
+{
+	// given the input, it's safe to call VectorNormalizeFast
+	while (count-- > 0)
+	{
+		VectorNormalizeFast(normals[0]);
+		normals++;
+	}
+}
+
+#ifdef USE_MESH_SSE2
+
+/*
+Normal decode tables: cos(lat), sin(lat), 1 times sin(lng), sin(lng), cos(lng)
+is the same product the scalar decode computes, one multiply per normal.
+*/
+alignas(16) static float normalLat[256][4];
+alignas(16) static float normalLng[256][4];
+
+static void R_InitNormalTables(void)
+{
+	int i;
+
+	for (i = 0; i < 256; i++)
+	{
+		normalLat[i][0] = tr.sinTable[(i * 4 + (FUNCTABLE_SIZE / 4)) & FUNCTABLE_MASK];
+		normalLat[i][1] = tr.sinTable[i * 4];
+		normalLat[i][2] = 1.0f;
+		normalLat[i][3] = 0.0f;
+
+		normalLng[i][0] = tr.sinTable[i * 4];
+		normalLng[i][1] = tr.sinTable[i * 4];
+		normalLng[i][2] = tr.sinTable[(i * 4 + (FUNCTABLE_SIZE / 4)) & FUNCTABLE_MASK];
+		normalLng[i][3] = 0.0f;
+	}
+}
+
+static inline __m128 R_DecodeNormal_SSE2(const short n)
+{
+	return _mm_mul_ps(_mm_load_ps(normalLat[(n >> 8) & 0xff]), _mm_load_ps(normalLng[n & 0xff]));
+}
+
+// sign extended xyz of the first and second vertex in v, w holds the normal
+static inline __m128 R_UnpackLo_SSE2(const __m128i v)
+{
+	return _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16));
+}
+
+static inline __m128 R_UnpackHi_SSE2(const __m128i v)
+{
+	return _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16));
+}
+
+static inline void R_StoreXYZ_SSE2(float *out, const __m128 v, const __m128 mask)
+{
+	_mm_storeu_ps(out, _mm_or_ps(_mm_and_ps(v, mask), _mm_andnot_ps(mask, _mm_loadu_ps(out))));
+}
+
+// must round like Q_rsqrt()
+static inline __m128 R_RSqrt_SSE2(const __m128 x)
+{
+#if defined(_MSC_SSE2)
+	return _mm_rsqrt_ps(x);
+#elif defined(_GCC_SSE2)
+	return _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(x));
+#else
+	const __m128 x2 = _mm_mul_ps(x, _mm_set1_ps(0.5f));
+	const __m128 y = _mm_castsi128_ps(_mm_sub_epi32(_mm_set1_epi32(0x5f3759df), _mm_srai_epi32(_mm_castps_si128(x), 1)));
+	return _mm_mul_ps(y, _mm_sub_ps(_mm_set1_ps(1.5f), _mm_mul_ps(_mm_mul_ps(x2, y), y)));
+#endif
+}
+
+static void R_LerpPacked_SSE2(vec4_t *xyz, vec4_t *normal, const md3XyzNormal_t *oldVerts, const md3XyzNormal_t *newVerts, int numVerts, float backlerp)
+{
+	const float newXyzScale = MD3_XYZ_SCALE * (1.0 - backlerp);
+	const float newNormalScale = 1.0 - backlerp;
+	const __m128 mask = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+	int i, j;
+
+	if (backlerp == 0)
+	{
+		const __m128 scale = _mm_set1_ps(newXyzScale);
+
+		for (i = 0; i + 4 <= numVerts; i += 4)
+		{
+			const __m128i n01 = _mm_loadu_si128((const __m128i *)&newVerts[i]);
+			const __m128i n23 = _mm_loadu_si128((const __m128i *)&newVerts[i + 2]);
+
+			R_StoreXYZ_SSE2(xyz[i + 0], _mm_mul_ps(R_UnpackLo_SSE2(n01), scale), mask);
+			R_StoreXYZ_SSE2(xyz[i + 1], _mm_mul_ps(R_UnpackHi_SSE2(n01), scale), mask);
+			R_StoreXYZ_SSE2(xyz[i + 2], _mm_mul_ps(R_UnpackLo_SSE2(n23), scale), mask);
+			R_StoreXYZ_SSE2(xyz[i + 3], _mm_mul_ps(R_UnpackHi_SSE2(n23), scale), mask);
+
+			for (j = 0; j < 4; j++)
+			{
+				R_StoreXYZ_SSE2(normal[i + j], R_DecodeNormal_SSE2(newVerts[i + j].normal), mask);
+			}
+		}
+	}
+	else
+	{
+		const __m128 oldScale = _mm_set1_ps(static_cast<float>(MD3_XYZ_SCALE * backlerp));
+		const __m128 newScale = _mm_set1_ps(newXyzScale);
+		const __m128 oldNormalScale = _mm_set1_ps(backlerp);
+		const __m128 newNormalScaleV = _mm_set1_ps(newNormalScale);
+
+		for (i = 0; i + 4 <= numVerts; i += 4)
+		{
+			const __m128i o01 = _mm_loadu_si128((const __m128i *)&oldVerts[i]);
+			const __m128i o23 = _mm_loadu_si128((const __m128i *)&oldVerts[i + 2]);
+			const __m128i n01 = _mm_loadu_si128((const __m128i *)&newVerts[i]);
+			const __m128i n23 = _mm_loadu_si128((const __m128i *)&newVerts[i + 2]);
+
+			R_StoreXYZ_SSE2(xyz[i + 0], _mm_add_ps(_mm_mul_ps(R_UnpackLo_SSE2(o01), oldScale), _mm_mul_ps(R_UnpackLo_SSE2(n01), newScale)), mask);
+			R_StoreXYZ_SSE2(xyz[i + 1], _mm_add_ps(_mm_mul_ps(R_UnpackHi_SSE2(o01), oldScale), _mm_mul_ps(R_UnpackHi_SSE2(n01), newScale)), mask);
+			R_StoreXYZ_SSE2(xyz[i + 2], _mm_add_ps(_mm_mul_ps(R_UnpackLo_SSE2(o23), oldScale), _mm_mul_ps(R_UnpackLo_SSE2(n23), newScale)), mask);
+			R_StoreXYZ_SSE2(xyz[i + 3], _mm_add_ps(_mm_mul_ps(R_UnpackHi_SSE2(o23), oldScale), _mm_mul_ps(R_UnpackHi_SSE2(n23), newScale)), mask);
+
+			for (j = 0; j < 4; j++)
+			{
+				const __m128 o = _mm_mul_ps(R_DecodeNormal_SSE2(oldVerts[i + j].normal), oldNormalScale);
+				const __m128 n = _mm_mul_ps(R_DecodeNormal_SSE2(newVerts[i + j].normal), newNormalScaleV);
+				R_StoreXYZ_SSE2(normal[i + j], _mm_add_ps(o, n), mask);
+			}
+		}
+	}
+
+	if (i < numVerts)
+	{
+		R_LerpPacked_Scalar(xyz + i, normal + i, oldVerts + i, newVerts + i, numVerts - i, backlerp);
+	}
+}
+
+static void R_LerpDecoded_SSE2(vec4_t *xyz, vec4_t *normal, const md3DecodedVert_t *oldVerts, const md3DecodedVert_t *newVerts, int numVerts, float backlerp)
+{
+	const __m128 mask = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+	// 16-byte loads of a vec3 read 4 bytes into the next vertex, leave the last one to the scalar loop
+	const int simdVerts = numVerts - 1;
+	int i, j;
+
+	if (backlerp == 0)
+	{
+		for (i = 0; i + 4 <= simdVerts; i += 4)
+		{
+			for (j = i; j < i + 4; j++)
+			{
+				R_StoreXYZ_SSE2(xyz[j], _mm_loadu_ps(newVerts[j].xyz), mask);
+				R_StoreXYZ_SSE2(normal[j], _mm_loadu_ps(newVerts[j].normal), mask);
+			}
+		}
+	}
+	else
+	{
+		const __m128 oldScale = _mm_set1_ps(backlerp);
+		const __m128 newScale = _mm_set1_ps(1.0f - backlerp);
+
+		for (i = 0; i + 4 <= simdVerts; i += 4)
+		{
+			for (j = i; j < i + 4; j++)
+			{
+				R_StoreXYZ_SSE2(xyz[j], _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(oldVerts[j].xyz), oldScale), _mm_mul_ps(_mm_loadu_ps(newVerts[j].xyz), newScale)), mask);
+				R_StoreXYZ_SSE2(normal[j], _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(oldVerts[j].normal), oldScale), _mm_mul_ps(_mm_loadu_ps(newVerts[j].normal), newScale)), mask);
+			}
+		}
+	}
+
+	if (i < numVerts)
+	{
+		R_LerpDecoded_Scalar(xyz + i, normal + i, oldVerts + i, newVerts + i, numVerts - i, backlerp);
+	}
+}
+
+static void R_Normalize_SSE2(vec4_t *normals, int count)
+{
+	int i;
+
+	for (i = 0; i + 4 <= count; i += 4)
+	{
+		__m128 x = _mm_loadu_ps(normals[i + 0]);
+		__m128 y = _mm_loadu_ps(normals[i + 1]);
+		__m128 z = _mm_loadu_ps(normals[i + 2]);
+		__m128 w = _mm_loadu_ps(normals[i + 3]);
+
+		_MM_TRANSPOSE4_PS(x, y, z, w);
+
+		// same summation order as DotProduct()
+		const __m128 ilength = R_RSqrt_SSE2(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)));
+		x = _mm_mul_ps(x, ilength);
+		y = _mm_mul_ps(y, ilength);
+		z = _mm_mul_ps(z, ilength);
+
+		// w was left alone, transposing back restores it
+		_MM_TRANSPOSE4_PS(x, y, z, w);
+
+		_mm_storeu_ps(normals[i + 0], x);
+		_mm_storeu_ps(normals[i + 1], y);
+		_mm_storeu_ps(normals[i + 2], z);
+		_mm_storeu_ps(normals[i + 3], w);
+	}
+
+	R_Normalize_Scalar(normals + i, count - i);
+}
+
+/*
+AVX2 versions work on two vertexes per register, eight per iteration.
+*/
+
+AVX2_TARGET static inline __m256 R_DecodeNormals_AVX2(const short a, const short b)
+{
+	const __m256 lat = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_load_ps(normalLat[(a >> 8) & 0xff])), _mm_load_ps(normalLat[(b >> 8) & 0xff]), 1);
+	const __m256 lng = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_load_ps(normalLng[a & 0xff])), _mm_load_ps(normalLng[b & 0xff]), 1);
+
+	return _mm256_mul_ps(lat, lng);
+}
+
+AVX2_TARGET static inline __m256 R_UnpackPair_AVX2(const md3XyzNormal_t *v)
+{
+	return _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)v)));
+}
+
+// keeps w of both destination vertexes
+AVX2_TARGET static inline void R_StorePair_AVX2(float *out, const __m256 v)
+{
+	_mm256_storeu_ps(out, _mm256_blend_ps(v, _mm256_loadu_ps(out), 0x88));
+}
+
+AVX2_TARGET static void R_LerpPacked_AVX2(vec4_t *xyz, vec4_t *normal, const md3XyzNormal_t *oldVerts, const md3XyzNormal_t *newVerts, int numVerts, float backlerp)
+{
+	const float newXyzScale = MD3_XYZ_SCALE * (1.0 - backlerp);
+	const float newNormalScale = 1.0 - backlerp;
+	int i, j;
+
+	if (backlerp == 0)
+	{
+		const __m256 scale = _mm256_set1_ps(newXyzScale);
+
+		for (i = 0; i + 8 <= numVerts; i += 8)
+		{
+			for (j = i; j < i + 8; j += 2)
+			{
+				R_StorePair_AVX2(xyz[j], _mm256_mul_ps(R_UnpackPair_AVX2(&newVerts[j]), scale));
+				R_StorePair_AVX2(normal[j], R_DecodeNormals_AVX2(newVerts[j].normal, newVerts[j + 1].normal));
+			}
+		}
+	}
+	else
+	{
+		const __m256 oldScale = _mm256_set1_ps(static_cast<float>(MD3_XYZ_SCALE * backlerp));
+		const __m256 newScale = _mm256_set1_ps(newXyzScale);
+		const __m256 oldNormalScale = _mm256_set1_ps(backlerp);
+		const __m256 newNormalScaleV = _mm256_set1_ps(newNormalScale);
+
+		for (i = 0; i + 8 <= numVerts; i += 8)
+		{
+			for (j = i; j < i + 8; j += 2)
+			{
+				const __m256 o = _mm256_mul_ps(R_UnpackPair_AVX2(&oldVerts[j]), oldScale);
+				const __m256 n = _mm256_mul_ps(R_UnpackPair_AVX2(&newVerts[j]), newScale);
+				R_StorePair_AVX2(xyz[j], _mm256_add_ps(o, n));
+
+				const __m256 on = _mm256_mul_ps(R_DecodeNormals_AVX2(oldVerts[j].normal, oldVerts[j + 1].normal), oldNormalScale);
+				const __m256 nn = _mm256_mul_ps(R_DecodeNormals_AVX2(newVerts[j].normal, newVerts[j + 1].normal), newNormalScaleV);
+				R_StorePair_AVX2(normal[j], _mm256_add_ps(on, nn));
+			}
+		}
+	}
+
+	if (i < numVerts)
+	{
+		R_LerpPacked_SSE2(xyz + i, normal + i, oldVerts + i, newVerts + i, numVerts - i, backlerp);
+	}
+}
+
+AVX2_TARGET static inline __m256 R_LoadPair_AVX2(const float *a, const float *b)
+{
+	return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(a)), _mm_loadu_ps(b), 1);
+}
+
+AVX2_TARGET static void R_LerpDecoded_AVX2(vec4_t *xyz, vec4_t *normal, const md3DecodedVert_t *oldVerts, const md3DecodedVert_t *newVerts, int numVerts, float backlerp)
+{
+	const int simdVerts = numVerts - 1;
+	int i, j;
+
+	if (backlerp == 0)
+	{
+		for (i = 0; i + 8 <= simdVerts; i += 8)
+		{
+			for (j = i; j < i + 8; j += 2)
+			{
+				R_StorePair_AVX2(xyz[j], R_LoadPair_AVX2(newVerts[j].xyz, newVerts[j + 1].xyz));
+				R_StorePair_AVX2(normal[j], R_LoadPair_AVX2(newVerts[j].normal, newVerts[j + 1].normal));
+			}
+		}
+	}
+	else
+	{
+		const __m256 oldScale = _mm256_set1_ps(backlerp);
+		const __m256 newScale = _mm256_set1_ps(1.0f - backlerp);
+
+		for (i = 0; i + 8 <= simdVerts; i += 8)
+		{
+			for (j = i; j < i + 8; j += 2)
+			{
+				const __m256 ox = _mm256_mul_ps(R_LoadPair_AVX2(oldVerts[j].xyz, oldVerts[j + 1].xyz), oldScale);
+				const __m256 nx = _mm256_mul_ps(R_LoadPair_AVX2(newVerts[j].xyz, newVerts[j + 1].xyz), newScale);
+				R_StorePair_AVX2(xyz[j], _mm256_add_ps(ox, nx));
+
+				const __m256 on = _mm256_mul_ps(R_LoadPair_AVX2(oldVerts[j].normal, oldVerts[j + 1].normal), oldScale);
+				const __m256 nn = _mm256_mul_ps(R_LoadPair_AVX2(newVerts[j].normal, newVerts[j + 1].normal), newScale);
+				R_StorePair_AVX2(normal[j], _mm256_add_ps(on, nn));
+			}
+		}
+	}
+
+	if (i < numVerts)
+	{
+		R_LerpDecoded_SSE2(xyz + i, normal + i, oldVerts + i, newVerts + i, numVerts - i, backlerp);
+	}
+}
+
+static bool R_CPUHasAVX2(void)
+{
+#ifdef _MSC_VER
+	int regs[4];
+
+	__cpuid(regs, 0);
+	if (regs[0] < 7)
+		return false;
+
+	// the OS has to save the ymm registers as well
+	__cpuid(regs, 1);
+	if ((regs[2] & (1 << 27)) == 0 || (regs[2] & (1 << 28)) == 0)
+		return false;
+	if ((_xgetbv(0) & 6) != 6)
+		return false;
+
+	__cpuidex(regs, 7, 0);
+	return (regs[1] & (1 << 5)) != 0;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+
+static const meshKernels_t sse2Kernels = {"sse2", R_LerpPacked_SSE2, R_LerpDecoded_SSE2, R_Normalize_SSE2};
+static const meshKernels_t avx2Kernels = {"avx2", R_LerpPacked_AVX2, R_LerpDecoded_AVX2, R_Normalize_SSE2};
+
+#endif // USE_MESH_SSE2
+
+static const meshKernels_t scalarKernels = {"scalar", R_LerpPacked_Scalar, R_LerpDecoded_Scalar, R_Normalize_Scalar};
+
+/*
+================
+R_InitMeshKernels
+
+tr.sinTable has to be filled in already
+================
+*/
+void R_InitMeshKernels(void)
+{
+	meshKernels = scalarKernels;
+
+#ifdef USE_MESH_SSE2
+	R_InitNormalTables();
+	meshKernels = R_CPUHasAVX2() ? avx2Kernels : sse2Kernels;
+#endif
+
+	ri.Printf(PRINT_DEVELOPER, "...using %s mesh kernels\n", meshKernels.name);
+}
+
+//=============================================================================
+
+constexpr int MESH_BENCH_LOOPS = 1000;
+// normals out of the vectorized normalize may differ by an ulp or so with -ffast-math style builds
+constexpr float MESH_BENCH_TOLERANCE = 1e-5f;
+
+typedef struct
+{
+	std::vector<float> xyz[3];
+	std::vector<float> normal[3];
+	int64_t usec[4];
+} meshBenchResult_t;
+
+static int64_t R_BenchUsec(const std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void R_BenchMeshKernels(const meshKernels_t &k, const std::vector<md3XyzNormal_t> &packed, const std::vector<md3DecodedVert_t> &decoded,
+							   const int numVerts, const int runs, meshBenchResult_t &res)
+{
+	std::chrono::steady_clock::time_point start;
+	int run, i, test;
+
+	for (test = 0; test < 3; test++)
+	{
+		// w is expected to survive
+		res.xyz[test].assign(numVerts * 4, 7.0f);
+		res.normal[test].assign(numVerts * 4, 7.0f);
+	}
+
+	vec4_t *xyz = reinterpret_cast<vec4_t *>(res.xyz[0].data());
+	vec4_t *normal = reinterpret_cast<vec4_t *>(res.normal[0].data());
+
+	start = std::chrono::steady_clock::now();
+	for (run = 0; run < runs * MESH_BENCH_LOOPS; run++)
+	{
+		k.lerpPacked(xyz, normal, packed.data(), packed.data() + numVerts, numVerts, 0.0f);
+	}
+	res.usec[0] = R_BenchUsec(start);
+
+	xyz = reinterpret_cast<vec4_t *>(res.xyz[1].data());
+	normal = reinterpret_cast<vec4_t *>(res.normal[1].data());
+
+	start = std::chrono::steady_clock::now();
+	for (run = 0; run < runs * MESH_BENCH_LOOPS; run++)
+	{
+		k.lerpPacked(xyz, normal, packed.data(), packed.data() + numVerts, numVerts, 0.37f);
+	}
+	res.usec[1] = R_BenchUsec(start);
+
+	xyz = reinterpret_cast<vec4_t *>(res.xyz[2].data());
+	normal = reinterpret_cast<vec4_t *>(res.normal[2].data());
+
+	start = std::chrono::steady_clock::now();
+	for (run = 0; run < runs * MESH_BENCH_LOOPS; run++)
+	{
+		k.lerpDecoded(xyz, normal, decoded.data(), decoded.data() + numVerts, numVerts, 0.37f);
+	}
+	res.usec[2] = R_BenchUsec(start);
+
+	// normalize the lerped packed normals, the same input every time
+	std::vector<float> lerped = res.normal[1];
+	start = std::chrono::steady_clock::now();
+	for (run = 0; run < runs * MESH_BENCH_LOOPS; run++)
+	{
+		for (i = 0; i < numVerts * 4; i += 4)
+		{
+			Com_Memcpy(&res.normal[1][i], &lerped[i], 3 * sizeof(float));
+		}
+		k.normalize(reinterpret_cast<vec4_t *>(res.normal[1].data()), numVerts);
+	}
+	res.usec[3] = R_BenchUsec(start);
+}
+
+static float R_MaxDifference(const std::vector<float> &a, const std::vector<float> &b)
+{
+	float diff = 0.0f;
+	size_t i;
+
+	for (i = 0; i < a.size(); i++)
+	{
+		diff = std::max(diff, std::fabs(a[i] - b[i]));
+	}
+
+	return diff;
+}
+
+/*
+================
+R_MeshBench_f
+
+Times the scalar and the vectorized MD3 lerp kernels on random
+frames and checks them against the scalar results.
+================
+*/
+void R_MeshBench_f(void)
+{
+	static const int vertCounts[] = {61, 250, 999};
+	std::vector<const meshKernels_t *> kernels = {&scalarKernels};
+	std::vector<md3XyzNormal_t> packed;
+	std::vector<md3DecodedVert_t> decoded;
+	std::vector<float> xyz, normal;
+	meshBenchResult_t ref, res;
+	uint32_t seed = 0x12345678;
+	int runs, mismatches, inexact, test;
+	size_t n, i;
+
+#ifdef USE_MESH_SSE2
+	kernels.push_back(&sse2Kernels);
+	if (R_CPUHasAVX2())
+		kernels.push_back(&avx2Kernels);
+#endif
+
+	runs = ri.Cmd_Argc() > 1 ? atoi(ri.Cmd_Argv(1)) : 4;
+	if (runs < 1)
+		runs = 1;
+
+	mismatches = 0;
+	inexact = 0;
+
+	ri.Printf(PRINT_ALL, "mesh kernels in use: %s, %i x %i runs, msec for copy / lerp / decoded lerp / normalize\n", meshKernels.name, runs, MESH_BENCH_LOOPS);
+
+	for (const int numVerts : vertCounts)
+	{
+		// two frames
+		packed.resize(numVerts * 2);
+		for (i = 0; i < packed.size(); i++)
+		{
+			seed = seed * 1664525 + 1013904223;
+			packed[i].xyz[0] = static_cast<short>(seed >> 16);
+			packed[i].xyz[1] = static_cast<short>(seed);
+			seed = seed * 1664525 + 1013904223;
+			packed[i].xyz[2] = static_cast<short>(seed >> 16);
+			packed[i].normal = static_cast<short>(seed);
+		}
+
+		// the way R_DecodeMD3Frames() expands them
+		xyz.assign(packed.size() * 4, 0.0f);
+		normal.assign(packed.size() * 4, 0.0f);
+		R_LerpPacked_Scalar(reinterpret_cast<vec4_t *>(xyz.data()), reinterpret_cast<vec4_t *>(normal.data()), packed.data(), packed.data(), static_cast<int>(packed.size()), 0.0f);
+		decoded.resize(packed.size());
+		for (i = 0; i < decoded.size(); i++)
+		{
+			VectorCopy(&xyz[i * 4], decoded[i].xyz);
+			VectorCopy(&normal[i * 4], decoded[i].normal);
+		}
+
+		for (n = 0; n < kernels.size(); n++)
+		{
+			R_BenchMeshKernels(*kernels[n], packed, decoded, numVerts, runs, n == 0 ? ref : res);
+
+			if (n > 0)
+			{
+				for (test = 0; test < 3; test++)
+				{
+					if (res.xyz[test] == ref.xyz[test] && res.normal[test] == ref.normal[test])
+					{
+						continue;
+					}
+					if (R_MaxDifference(res.xyz[test], ref.xyz[test]) > MESH_BENCH_TOLERANCE || R_MaxDifference(res.normal[test], ref.normal[test]) > MESH_BENCH_TOLERANCE)
+					{
+						ri.Printf(PRINT_WARNING, "%s kernels differ from scalar, test %i, %i verts\n", kernels[n]->name, test, numVerts);
+						mismatches++;
+					}
+					else
+					{
+						inexact++;
+					}
+				}
+			}
+
+			const meshBenchResult_t &r = n == 0 ? ref : res;
+			ri.Printf(PRINT_ALL, "%4i %-6s %8.2f %8.2f %8.2f %8.2f\n", numVerts, kernels[n]->name,
+					  r.usec[0] / 1000.0, r.usec[1] / 1000.0, r.usec[2] / 1000.0, r.usec[3] / 1000.0);
+		}
+	}
+
+	ri.Printf(PRINT_ALL, "%i mismatches, %i within %g of scalar\n", mismatches, inexact, MESH_BENCH_TOLERANCE);
+}
@@ -0,0 +1,29 @@
+#ifndef TR_MESH_KERNELS_HPP
+#define TR_MESH_KERNELS_HPP
+
+#include "tr_local.hpp"
+
+// MD3 vertex lerp loops used by RB_SurfaceMesh().
+// R_InitMeshKernels() picks SSE2 or AVX2 versions at runtime, "meshbench"
+// compares them against the scalar ones and times them.
+
+typedef struct
+{
+	const char *name;
+
+	// packed frames to tess layout, oldVerts is not read when backlerp is 0, w of xyz and normal is kept
+	void (*lerpPacked)(vec4_t *xyz, vec4_t *normal, const md3XyzNormal_t *oldVerts, const md3XyzNormal_t *newVerts, int numVerts, float backlerp);
+
+	// same for frames expanded by R_DecodeMD3Frames()
+	void (*lerpDecoded)(vec4_t *xyz, vec4_t *normal, const md3DecodedVert_t *oldVerts, const md3DecodedVert_t *newVerts, int numVerts, float backlerp);
+
+	// VectorNormalizeFast() on every normal, w is kept
+	void (*normalize)(vec4_t *normals, int count);
+} meshKernels_t;
+
+extern meshKernels_t meshKernels;
+
+void R_InitMeshKernels(void);
+void R_MeshBench_f(void);
+
+#endif // TR_MESH_KERNELS_HPP
@@ -28,6 +28,8 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include "vk_flares.hpp"
 #include "tr_model_iqm.hpp"
 #include "tr_shader.hpp"
+#include "tr_smp.hpp"
+#include "tr_prefetch.hpp"
 #include "math.hpp"
 
 #include <functional>
@@ -123,6 +125,7 @@ static qhandle_t R_RegisterMD3(std::string_view name, model_t &mod)
 		{
 			mod.numLods++;
 			mod.md3[lod] = mod.md3[lod + 1];
+			mod.md3Frames[lod] = mod.md3Frames[lod + 1];
 		}
 		return mod.index;
 	}
@@ -322,6 +325,9 @@ qhandle_t RE_RegisterModel(const char *name)
 
 	// allocate a new model_t
 
+	// model data and its vertex buffers may be in use by the back end
+	R_SyncRenderThread();
+
 	if ((mod = R_AllocModel()) == NULL)
 	{
 		ri.Printf(PRINT_WARNING, "RE_RegisterModel: R_AllocModel() failed for '%s'\n", name);
@@ -400,6 +406,132 @@ qhandle_t RE_RegisterModel(const char *name)
 	return hModel;
 }
 
+/*
+=================
+R_MD3DecodedSize
+=================
+*/
+static std::size_t R_MD3DecodedSize(const md3Header_t *hdr)
+{
+	const md3Surface_t *surf;
+	std::size_t size;
+	int i;
+
+	size = 0;
+	surf = (const md3Surface_t *)((const byte *)hdr + hdr->ofsSurfaces);
+	for (i = 0; i < hdr->numSurfaces; i++)
+	{
+		size += static_cast<std::size_t>(surf->numVerts) * surf->numFrames * sizeof(md3DecodedVert_t);
+		surf = (const md3Surface_t *)((const byte *)surf + surf->ofsEnd);
+	}
+
+	return size;
+}
+
+/*
+=================
+R_GetMD3Frames
+
+Returns the frames R_DecodeMD3Frames() expanded for this surface of the model,
+or nullptr if it is only available packed
+=================
+*/
+const md3DecodedVert_t *R_GetMD3Frames(const model_t &mod, const md3Surface_t *surface)
+{
+	const md3Header_t *hdr;
+	const md3Surface_t *surf;
+	int lod, i;
+
+	for (lod = 0; lod < mod.numLods; lod++)
+	{
+		hdr = mod.md3[lod];
+		if (!mod.md3Frames[lod] || (const byte *)surface < (const byte *)hdr || (const byte *)surface >= (const byte *)hdr + hdr->ofsEnd)
+		{
+			continue;
+		}
+
+		surf = (const md3Surface_t *)((const byte *)hdr + hdr->ofsSurfaces);
+		for (i = 0; i < hdr->numSurfaces; i++)
+		{
+			if (surf == surface)
+			{
+				return mod.md3Frames[lod][i];
+			}
+			surf = (const md3Surface_t *)((const byte *)surf + surf->ofsEnd);
+		}
+	}
+
+	return nullptr;
+}
+
+/*
+=================
+R_DecodeMD3Frames
+
+Expands the packed xyz and lat/long normals of every frame into floats
+so RB_SurfaceMesh() only has to lerp them
+=================
+*/
+static void R_DecodeMD3Frames(model_t &mod, const int lod, md3Header_t *hdr)
+{
+	md3Surface_t *surf;
+	md3XyzNormal_t *in;
+	md3DecodedVert_t *out;
+	const md3DecodedVert_t **frames;
+	std::size_t size, used;
+	unsigned lat, lng;
+	int i, j;
+
+	if (r_md3FrameCache->integer <= 0)
+	{
+		return;
+	}
+
+	// the limit covers every lod of the model, the higher ones are loaded first
+	used = 0;
+	for (i = lod + 1; i < MD3_MAX_LODS; i++)
+	{
+		if (mod.md3Frames[i])
+		{
+			used += R_MD3DecodedSize(mod.md3[i]);
+		}
+	}
+
+	size = R_MD3DecodedSize(hdr);
+	if (size == 0 || used + size > static_cast<std::size_t>(r_md3FrameCache->integer) * 1024 * 1024)
+	{
+		return;
+	}
+
+	frames = reinterpret_cast<const md3DecodedVert_t **>(ri.Hunk_Alloc(hdr->numSurfaces * sizeof(*frames), h_low));
+	out = reinterpret_cast<md3DecodedVert_t *>(ri.Hunk_Alloc(size, h_low));
+	mod.md3Frames[lod] = frames;
+	mod.dataSize += size;
+
+	surf = (md3Surface_t *)((byte *)hdr + hdr->ofsSurfaces);
+	for (i = 0; i < hdr->numSurfaces; i++)
+	{
+		frames[i] = out;
+
+		in = (md3XyzNormal_t *)((byte *)surf + surf->ofsXyzNormals);
+		for (j = 0; j < surf->numVerts * surf->numFrames; j++, in++, out++)
+		{
+			out->xyz[0] = in->xyz[0] * MD3_XYZ_SCALE;
+			out->xyz[1] = in->xyz[1] * MD3_XYZ_SCALE;
+			out->xyz[2] = in->xyz[2] * MD3_XYZ_SCALE;
+
+			lat = ((in->normal >> 8) & 0xff) * (FUNCTABLE_SIZE / 256);
+			lng = (in->normal & 0xff) * (FUNCTABLE_SIZE / 256);
+
+			out->normal[0] = tr.sinTable[(lat + (FUNCTABLE_SIZE / 4)) & FUNCTABLE_MASK] * tr.sinTable[lng];
+			out->normal[1] = tr.sinTable[lat] * tr.sinTable[lng];
+			out->normal[2] = tr.sinTable[(lng + (FUNCTABLE_SIZE / 4)) & FUNCTABLE_MASK];
+		}
+
+		surf = (md3Surface_t *)((byte *)surf + surf->ofsEnd);
+	}
+}
+
 /*
 =================
 R_LoadMD3
@@ -650,6 +782,8 @@ static bool R_LoadMD3(model_t &mod, const int lod, void *buffer, const std::size
 		surf = (md3Surface_t *)((byte *)surf + surf->ofsEnd);
 	}
 
+	R_DecodeMD3Frames(mod, lod, hdr);
+
 	return true;
 }
 
@@ -1006,6 +1140,8 @@ void RE_BeginRegistration(glconfig_t *glconfigOut)
 
 	R_Init();
 
+	R_ResetLoadStats();
+
 	*glconfigOut = glConfig;
 
 	tr.viewCluster = -1; // force markleafs to regenerate
@@ -1031,6 +1167,8 @@ void R_ModelInit(void)
 	// leave a space for NULL model
 	tr.numModels = 0;
 
+	RB_ClearIQMPoseCache();
+
 	mod = R_AllocModel();
 	mod->type = modtype_t::MOD_BAD;
 }
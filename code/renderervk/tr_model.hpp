@@ -4,6 +4,7 @@
 #include "tr_local.hpp"
 
 model_t *R_GetModelByHandle(qhandle_t index);
+const md3DecodedVert_t *R_GetMD3Frames(const model_t &mod, const md3Surface_t *surface);
 void R_ModelBounds(qhandle_t handle, vec3_t mins, vec3_t maxs);
 void R_ModelInit();
 void R_Modellist_f();
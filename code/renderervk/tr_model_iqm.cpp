@@ -462,6 +462,45 @@ int R_IQMLerpTag(orientation_t &tag, iqmData_t &data,
 	return true;
 }
 
+/*
+=================
+RB_IQMPoseMats
+
+Surfaces of one model share the joint palette, keep the last one
+around so it is built once per entity and pose instead of per surface.
+Back end only, R_IQMLerpTag() runs on the front end.
+=================
+*/
+static struct
+{
+	const iqmData_t *data;
+	int frame;
+	int oldframe;
+	float backlerp;
+	float poseMats[IQM_MAX_JOINTS * 12];
+} poseCache;
+
+static const float *RB_IQMPoseMats(iqmData_t &data, const int frame, const int oldframe, const float backlerp)
+{
+	if (poseCache.data != &data || poseCache.frame != frame || poseCache.oldframe != oldframe || poseCache.backlerp != backlerp)
+	{
+		ComputePoseMats(data, frame, oldframe, backlerp, poseCache.poseMats);
+
+		poseCache.data = &data;
+		poseCache.frame = frame;
+		poseCache.oldframe = oldframe;
+		poseCache.backlerp = backlerp;
+	}
+
+	return poseCache.poseMats;
+}
+
+// model data is about to be freed, a new model may end up at the same address
+void RB_ClearIQMPoseCache(void)
+{
+	poseCache.data = nullptr;
+}
+
 /*
 =================
 RB_AddIQMSurfaces
@@ -473,9 +512,10 @@ void RB_IQMSurfaceAnim(const surfaceType_t &surface)
 {
 	srfIQModel_t &surf = (srfIQModel_t &)surface;
 	iqmData_t *data = surf.data;
-	float poseMats[IQM_MAX_JOINTS * 12];
-	float influenceVtxMat[SHADER_MAX_VERTEXES * 12]{};
-	float influenceNrmMat[SHADER_MAX_VERTEXES * 9]{};
+	const float *poseMats;
+	// every used entry is written below, no need to clear them
+	float influenceVtxMat[SHADER_MAX_VERTEXES * 12];
+	float influenceNrmMat[SHADER_MAX_VERTEXES * 9];
 	int i;
 
 	float *xyz;
@@ -517,8 +557,8 @@ void RB_IQMSurfaceAnim(const surfaceType_t &surface)
 
 	if (data->num_poses > 0)
 	{
-		// compute interpolated joint matrices
-		ComputePoseMats(*data, frame, oldframe, backlerp, poseMats);
+		// compute interpolated joint matrices, or reuse them from the previous surface of this entity
+		poseMats = RB_IQMPoseMats(*data, frame, oldframe, backlerp);
 
 		// compute vertex blend influence matricies
 		for (i = 0; i < surf.num_influences; i++)
@@ -526,23 +566,8 @@ void RB_IQMSurfaceAnim(const surfaceType_t &surface)
 			int influence = surf.first_influence + i;
 			float *vtxMat = &influenceVtxMat[12 * i];
 			float *nrmMat = &influenceNrmMat[9 * i];
+			const float *blendWeights = &data->influenceWeights[4 * influence];
 			int j;
-			float blendWeights[4]{};
-
-			if (data->blendWeightsType == IQM_FLOAT)
-			{
-				blendWeights[0] = data->influenceBlendWeights.f[4 * influence + 0];
-				blendWeights[1] = data->influenceBlendWeights.f[4 * influence + 1];
-				blendWeights[2] = data->influenceBlendWeights.f[4 * influence + 2];
-				blendWeights[3] = data->influenceBlendWeights.f[4 * influence + 3];
-			}
-			else
-			{
-				blendWeights[0] = (float)data->influenceBlendWeights.b[4 * influence + 0] / 255.0f;
-				blendWeights[1] = (float)data->influenceBlendWeights.b[4 * influence + 1] / 255.0f;
-				blendWeights[2] = (float)data->influenceBlendWeights.b[4 * influence + 2] / 255.0f;
-				blendWeights[3] = (float)data->influenceBlendWeights.b[4 * influence + 3] / 255.0f;
-			}
 
 			if (blendWeights[0] <= 0.0f)
 			{
@@ -577,7 +602,7 @@ void RB_IQMSurfaceAnim(const surfaceType_t &surface)
 				vtxMat[10] = blendWeights[0] * poseMats[12 * data->influenceBlendIndexes[4 * influence + 0] + 10];
 				vtxMat[11] = blendWeights[0] * poseMats[12 * data->influenceBlendIndexes[4 * influence + 0] + 11];
 
-				for (j = 1; j < static_cast<int>(arrayLen(blendWeights)); j++)
+				for (j = 1; j < 4; j++)
 				{
 					if (blendWeights[j] <= 0.0f)
 					{
@@ -1254,7 +1279,8 @@ bool R_LoadIQM(model_t &mod, void *buffer, const int filesize, std::string_view
 
 			if (vertexArrayFormat[IQM_BLENDWEIGHTS] == IQM_UBYTE)
 			{
-				size += allocateInfluences * 4 * sizeof(byte); // influenceBlendWeights
+				size += allocateInfluences * 4 * sizeof(byte);	// influenceBlendWeights
+				size += allocateInfluences * 4 * sizeof(float); // influenceWeights
 			}
 			else if (vertexArrayFormat[IQM_BLENDWEIGHTS] == IQM_FLOAT)
 			{
@@ -1335,6 +1361,9 @@ bool R_LoadIQM(model_t &mod, void *buffer, const int filesize, std::string_view
 
 			if (vertexArrayFormat[IQM_BLENDWEIGHTS] == IQM_UBYTE)
 			{
+				iqmData.influenceWeights = (float *)dataPtr;
+				dataPtr += allocateInfluences * 4 * sizeof(float); // influenceWeights
+
 				iqmData.influenceBlendWeights.b = (byte *)dataPtr;
 				dataPtr += allocateInfluences * 4 * sizeof(byte); // influenceBlendWeights
 			}
@@ -1342,6 +1371,8 @@ bool R_LoadIQM(model_t &mod, void *buffer, const int filesize, std::string_view
 			{
 				iqmData.influenceBlendWeights.f = (float *)dataPtr;
 				dataPtr += allocateInfluences * 4 * sizeof(float); // influenceBlendWeights
+
+				iqmData.influenceWeights = iqmData.influenceBlendWeights.f;
 			}
 		}
 	}
@@ -1530,6 +1561,15 @@ bool R_LoadIQM(model_t &mod, void *buffer, const int filesize, std::string_view
 					}
 				}
 			}
+
+			// convert byte weights once instead of for every skinned surface
+			if (vertexArrayFormat[IQM_BLENDWEIGHTS] == IQM_UBYTE)
+			{
+				for (i = 0; i < static_cast<uint32_t>(totalInfluences * 4); i++)
+				{
+					iqmData.influenceWeights[i] = (float)iqmData.influenceBlendWeights.b[i] / 255.0f;
+				}
+			}
 		}
 	}
 
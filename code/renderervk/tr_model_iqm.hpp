@@ -10,6 +10,7 @@ int R_IQMLerpTag(orientation_t &tag, iqmData_t &data,
                  float frac, const char *tagName);
 
 void RB_IQMSurfaceAnim(const surfaceType_t &surface);
+void RB_ClearIQMPoseCache(void);
 bool R_LoadIQM(model_t &mod, void *buffer, int filesize, std::string_view mod_name);
 
 #endif // TR_MODEL_IQM_HPP
\ No newline at end of file
@@ -0,0 +1,355 @@
+#include "tr_prefetch.hpp"
+#include "tr_image.hpp"
+#include "tr_jobs.hpp"
+#include "tr_shader.hpp"
+#include "string_operations.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+constexpr int PREFETCH_IMAGES_PER_THREAD = 4;
+constexpr int MAX_PREFETCH_BATCH = 16 * PREFETCH_IMAGES_PER_THREAD;
+// decoded pixels waiting for their shader, past this only the requested image is decoded
+constexpr int64_t MAX_PREFETCH_BYTES = 96 * 1024 * 1024;
+
+constexpr int MAX_LOAD_PHASES = 16;
+
+typedef struct
+{
+	std::string path; // file picked by R_FindImagePath
+	void *file;		  // only valid while its batch is decoded
+	int fileSize;
+	byte *pic; // std::malloc'ed, owned here until taken
+	int width;
+	int height;
+	bool started;
+} prefetchImage_t;
+
+static struct
+{
+	std::vector<prefetchImage_t> images;
+	std::unordered_map<std::string, int> lookup; // lowercase name as the shader asks for it
+	int64_t heldBytes;
+	int batchSize;
+} prefetch;
+
+static struct
+{
+	int64_t registrationStart;
+	int64_t phaseStart;
+	struct
+	{
+		const char *name;
+		int usec;
+	} phases[MAX_LOAD_PHASES];
+	int numPhases;
+
+	int imageFiles;
+	int64_t imageFileUsec;
+	int imageCreates;
+	int64_t imageCreateUsec;
+
+	int prefetchQueued;
+	int prefetchDecoded;
+	int prefetchUsed;
+	int prefetchBatches;
+	int64_t prefetchReadUsec;
+	int64_t prefetchDecodeUsec;
+} loadStats;
+
+int64_t R_LoadTimestamp(void)
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static std::string R_PrefetchKey(std::string_view name)
+{
+	std::string key(name);
+
+	std::transform(key.begin(), key.end(), key.begin(), [](unsigned char c)
+				   { return static_cast<char>(std::tolower(c)); });
+
+	return key;
+}
+
+static void *R_PrefetchAlloc(int size)
+{
+	return std::malloc(size);
+}
+
+static void R_PrefetchRelease(void *ptr)
+{
+	std::free(ptr);
+}
+
+static void R_DecodeImageJob(void *arg, int index)
+{
+	prefetchImage_t *image = static_cast<prefetchImage_t **>(arg)[index];
+
+	// the engine JPG decoder is the only image loader that is safe off the main thread
+	if (!ri.CL_DecodeJPG(static_cast<const byte *>(image->file), image->fileSize, R_PrefetchAlloc, R_PrefetchRelease,
+						 &image->pic, &image->width, &image->height))
+	{
+		image->pic = nullptr;
+	}
+}
+
+/*
+===============
+R_DecodePrefetchBatch
+
+Reads the requested image and the ones queued after it,
+then decodes them on the job pool.
+===============
+*/
+static void R_DecodePrefetchBatch(const int first)
+{
+	std::array<prefetchImage_t *, MAX_PREFETCH_BATCH> batch;
+	const int limit = prefetch.heldBytes < MAX_PREFETCH_BYTES ? prefetch.batchSize : 1;
+	int64_t start;
+	int i, count;
+
+	start = R_LoadTimestamp();
+
+	count = 0;
+	for (i = first; i < static_cast<int>(prefetch.images.size()) && count < limit; i++)
+	{
+		prefetchImage_t &image = prefetch.images[i];
+
+		if (image.started)
+		{
+			continue;
+		}
+		image.started = true;
+
+		image.fileSize = ri.FS_ReadFile(image.path.c_str(), &image.file);
+		if (!image.file)
+		{
+			continue;
+		}
+		if (image.fileSize <= 0)
+		{
+			ri.FS_FreeFile(image.file);
+			image.file = nullptr;
+			continue;
+		}
+
+		batch[count++] = &image;
+	}
+
+	loadStats.prefetchReadUsec += R_LoadTimestamp() - start;
+
+	if (count == 0)
+	{
+		return;
+	}
+
+	start = R_LoadTimestamp();
+	R_RunJobs(R_DecodeImageJob, batch.data(), count);
+	loadStats.prefetchDecodeUsec += R_LoadTimestamp() - start;
+	loadStats.prefetchBatches++;
+
+	for (i = 0; i < count; i++)
+	{
+		prefetchImage_t *image = batch[i];
+
+		ri.FS_FreeFile(image->file);
+		image->file = nullptr;
+
+		if (image->pic)
+		{
+			prefetch.heldBytes += static_cast<int64_t>(image->width) * image->height * 4;
+			loadStats.prefetchDecoded++;
+		}
+	}
+}
+
+/*
+===============
+R_PrefetchImages
+===============
+*/
+void R_PrefetchImages(std::span<const std::string_view> shaderNames)
+{
+	std::vector<std::string> names;
+	const int workers = R_JobWorkers();
+
+	R_ClearPrefetchedImages();
+
+	// nothing to overlap with, the serial path is just as fast
+	if (workers == 0)
+	{
+		return;
+	}
+
+	prefetch.batchSize = std::min((workers + 1) * PREFETCH_IMAGES_PER_THREAD, MAX_PREFETCH_BATCH);
+
+	for (const std::string_view shaderName : shaderNames)
+	{
+		R_GetShaderImageNames(shaderName, names);
+	}
+
+	for (const std::string &name : names)
+	{
+		std::string key = R_PrefetchKey(name);
+
+		if (prefetch.lookup.contains(key))
+		{
+			continue;
+		}
+
+		const std::array<char, MAX_QPATH> path = R_FindImagePath(name);
+		std::string_view ext = COM_GetExtension_cpp(path);
+		if (Q_stricmp_cpp(ext, "jpg") && Q_stricmp_cpp(ext, "jpeg"))
+		{
+			continue;
+		}
+
+		prefetch.lookup.emplace(std::move(key), static_cast<int>(prefetch.images.size()));
+		prefetch.images.push_back({path.data(), nullptr, 0, nullptr, 0, 0, false});
+	}
+
+	loadStats.prefetchQueued += static_cast<int>(prefetch.images.size());
+}
+
+/*
+===============
+R_ClearPrefetchedImages
+===============
+*/
+void R_ClearPrefetchedImages(void)
+{
+	for (prefetchImage_t &image : prefetch.images)
+	{
+		std::free(image.pic);
+	}
+
+	prefetch.images.clear();
+	prefetch.lookup.clear();
+	prefetch.heldBytes = 0;
+}
+
+/*
+===============
+R_TakePrefetchedImage
+===============
+*/
+bool R_TakePrefetchedImage(std::string_view name, std::array<char, MAX_QPATH> &localName, byte **pic, int *width, int *height)
+{
+	if (prefetch.images.empty())
+	{
+		return false;
+	}
+
+	const auto it = prefetch.lookup.find(R_PrefetchKey(name));
+	if (it == prefetch.lookup.end())
+	{
+		return false;
+	}
+
+	prefetchImage_t &image = prefetch.images[it->second];
+
+	if (!image.started)
+	{
+		R_DecodePrefetchBatch(it->second);
+	}
+
+	// failed to decode or already taken, let R_LoadImage() deal with it
+	if (!image.pic)
+	{
+		return false;
+	}
+
+	Q_strncpyz_cpp(localName, image.path, localName.size());
+	*pic = image.pic;
+	*width = image.width;
+	*height = image.height;
+
+	prefetch.heldBytes -= static_cast<int64_t>(image.width) * image.height * 4;
+	image.pic = nullptr;
+
+	loadStats.prefetchUsed++;
+
+	return true;
+}
+
+void R_FreePrefetchedImage(byte *pic)
+{
+	std::free(pic);
+}
+
+void R_CountImageFile(int64_t start)
+{
+	loadStats.imageFiles++;
+	loadStats.imageFileUsec += R_LoadTimestamp() - start;
+}
+
+void R_CountImageCreate(int64_t start)
+{
+	loadStats.imageCreates++;
+	loadStats.imageCreateUsec += R_LoadTimestamp() - start;
+}
+
+void R_StartLoadPhases(void)
+{
+	loadStats.numPhases = 0;
+	loadStats.phaseStart = R_LoadTimestamp();
+}
+
+void R_LoadPhase(const char *name)
+{
+	const int64_t now = R_LoadTimestamp();
+
+	if (loadStats.numPhases < MAX_LOAD_PHASES)
+	{
+		loadStats.phases[loadStats.numPhases].name = name;
+		loadStats.phases[loadStats.numPhases].usec = static_cast<int>(now - loadStats.phaseStart);
+		loadStats.numPhases++;
+	}
+
+	loadStats.phaseStart = now;
+}
+
+void R_ResetLoadStats(void)
+{
+	Com_Memset(&loadStats, 0, sizeof(loadStats));
+	loadStats.registrationStart = R_LoadTimestamp();
+}
+
+/*
+===============
+R_PrintLoadStats
+===============
+*/
+void R_PrintLoadStats(void)
+{
+	int i;
+
+	if (!r_loadStats->integer || !loadStats.registrationStart)
+	{
+		return;
+	}
+
+	ri.Printf(PRINT_ALL, "----- load stats -----\n");
+
+	for (i = 0; i < loadStats.numPhases; i++)
+	{
+		ri.Printf(PRINT_ALL, "%8.1f msec world %s\n", loadStats.phases[i].usec / 1000.0, loadStats.phases[i].name);
+	}
+
+	ri.Printf(PRINT_ALL, "%8.1f msec %i image files loaded serially\n", loadStats.imageFileUsec / 1000.0, loadStats.imageFiles);
+	if (loadStats.prefetchQueued)
+	{
+		ri.Printf(PRINT_ALL, "%8.1f msec prefetch read, %i batches\n", loadStats.prefetchReadUsec / 1000.0, loadStats.prefetchBatches);
+		ri.Printf(PRINT_ALL, "%8.1f msec prefetch decode on %i threads, %i of %i images decoded, %i used\n",
+				  loadStats.prefetchDecodeUsec / 1000.0, R_JobWorkers() + 1,
+				  loadStats.prefetchDecoded, loadStats.prefetchQueued, loadStats.prefetchUsed);
+	}
+	ri.Printf(PRINT_ALL, "%8.1f msec %i images created and uploaded\n", loadStats.imageCreateUsec / 1000.0, loadStats.imageCreates);
+	ri.Printf(PRINT_ALL, "%8.1f msec total registration\n", (R_LoadTimestamp() - loadStats.registrationStart) / 1000.0);
+}
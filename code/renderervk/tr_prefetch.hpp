@@ -0,0 +1,39 @@
+#ifndef TR_PREFETCH_HPP
+#define TR_PREFETCH_HPP
+
+#include "tr_local.hpp"
+
+#include <span>
+#include <string_view>
+
+// Level load image prefetch and load timing (r_loadStats).
+// R_PrefetchImages() collects the images the world shaders reference and
+// reads the JPG ones in batches on the main thread, their decoding runs on
+// the job pool. R_FindImageFile() takes the pixels from here when a shader
+// asks for them, so R_CreateImage() still sees images in the original order.
+// Other formats stay on the serial path, their loaders call ri.Error/ri.Malloc.
+
+// shaderNames should be in the order the world loader is going to register them
+void R_PrefetchImages(std::span<const std::string_view> shaderNames);
+
+// frees everything nobody asked for
+void R_ClearPrefetchedImages(void);
+
+// hands over the decoded image for name, pic has to be released with R_FreePrefetchedImage()
+bool R_TakePrefetchedImage(std::string_view name, std::array<char, MAX_QPATH> &localName, byte **pic, int *width, int *height);
+void R_FreePrefetchedImage(byte *pic);
+
+// load statistics, reset by RE_BeginRegistration and printed by RE_EndRegistration
+void R_ResetLoadStats(void);
+void R_PrintLoadStats(void);
+
+// world loader phases: R_StartLoadPhases() starts the clock, R_LoadPhase() closes the running phase
+void R_StartLoadPhases(void);
+void R_LoadPhase(const char *name);
+
+// microsecond timestamps for the image counters
+int64_t R_LoadTimestamp(void);
+void R_CountImageFile(int64_t start);
+void R_CountImageCreate(int64_t start);
+
+#endif // TR_PREFETCH_HPP
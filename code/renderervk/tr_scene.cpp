@@ -404,7 +404,9 @@ void RE_RenderScene(const refdef_t *fd)
 	if (!tr.registered || r_norefresh->integer)
 		return;
 
-	int startTime = ri.Milliseconds();
+	const int64_t startTime = ri.Microseconds();
+
+	R_PROF_BEGIN("RE_RenderScene");
 
 	if (!tr.world && !(fd->rdflags & RDF_NOWORLDMODEL))
 	{
@@ -573,5 +575,7 @@ void RE_RenderScene(const refdef_t *fd)
 	r_firstSceneDlight = r_numdlights;
 	r_firstScenePoly = r_numpolys;
 
-	tr.frontEndMsec += ri.Milliseconds() - startTime;
+	R_PROF_END();
+
+	tr.frontEndUsec += ri.Microseconds() - startTime;
 }
\ No newline at end of file
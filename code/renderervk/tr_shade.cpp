@@ -31,6 +31,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include "vk_descriptors.hpp"
 #include "vk_pipeline.hpp"
 #include "utils.hpp"
+#include "vk_profiler.hpp"
 
 shaderCommands_t tess;
 
@@ -113,6 +114,9 @@ void RB_BeginSurface(shader_t &shader, const int fogNum)
 	tess.xstages = state->stages;
 	tess.numPasses = state->numUnfoggedPasses;
 
+	tess.numInstances = 0;
+	tess.instanceVertexes = 0;
+
 	tess.shaderTime = backEnd.refdef.floatTime - tess.shader->timeOffset;
 	if (tess.shader->clampTime && tess.shaderTime >= tess.shader->clampTime)
 	{
@@ -166,84 +170,59 @@ void R_ComputeTexCoords(const int b, const textureBundle_t &bundle)
 	}
 
 	//
-	// alter texture coordinates
+	// alter texture coordinates, consecutive affine texMods are folded
+	// into one matrix so that the vertexes are walked once per run
 	//
+	texModInfo_t acc, tmi;
+	bool pending = false;
+
 	for (tm = 0; tm < bundle.numTexMods; tm++)
 	{
-		switch (bundle.texMods[tm].type)
-		{
-		case texMod_t::TMOD_NONE:
-			tm = TR_MAX_TEXMODS; // break out of for loop
-			break;
-
-		case texMod_t::TMOD_TURBULENT:
-			RB_CalcTurbulentTexCoords(bundle.texMods[tm].wave, (float *)src, (float *)dst);
-			src = dst;
-			break;
-
-		case texMod_t::TMOD_ENTITY_TRANSLATE:
-			RB_CalcScrollTexCoords(backEnd.currentEntity->e.shaderTexCoord, (float *)src, (float *)dst);
-			src = dst;
-			break;
+		const texModInfo_t &texMod = bundle.texMods[tm];
 
-		case texMod_t::TMOD_SCROLL:
-			RB_CalcScrollTexCoords(bundle.texMods[tm].scroll, (float *)src, (float *)dst);
-			src = dst;
-			break;
-
-		case texMod_t::TMOD_SCALE:
-			RB_CalcScaleTexCoords(bundle.texMods[tm].scale, (float *)src, (float *)dst);
-			src = dst;
+		if (texMod.type == texMod_t::TMOD_NONE)
 			break;
 
-		case texMod_t::TMOD_OFFSET:
-			for (i = 0; i < tess.numVertexes; i++)
-			{
-				dst[i][0] = src[i][0] + bundle.texMods[tm].offset[0];
-				dst[i][1] = src[i][1] + bundle.texMods[tm].offset[1];
-			}
-			src = dst;
-			break;
-
-		case texMod_t::TMOD_SCALE_OFFSET:
-			for (i = 0; i < tess.numVertexes; i++)
+		if (RB_TexModMatrix(texMod, tmi))
+		{
+			if (pending)
 			{
-				dst[i][0] = (src[i][0] * bundle.texMods[tm].scale[0]) + bundle.texMods[tm].offset[0];
-				dst[i][1] = (src[i][1] * bundle.texMods[tm].scale[1]) + bundle.texMods[tm].offset[1];
+				RB_ConcatTexMods(acc, tmi);
 			}
-			src = dst;
-			break;
-
-		case texMod_t::TMOD_OFFSET_SCALE:
-			for (i = 0; i < tess.numVertexes; i++)
+			else
 			{
-				dst[i][0] = (src[i][0] + bundle.texMods[tm].offset[0]) * bundle.texMods[tm].scale[0];
-				dst[i][1] = (src[i][1] + bundle.texMods[tm].offset[1]) * bundle.texMods[tm].scale[1];
+				acc = tmi;
+				pending = true;
 			}
-			src = dst;
-			break;
-
-		case texMod_t::TMOD_STRETCH:
-			RB_CalcStretchTexCoords(bundle.texMods[tm].wave, (float *)src, (float *)dst);
-			src = dst;
-			break;
+			continue;
+		}
 
-		case texMod_t::TMOD_TRANSFORM:
-			RB_CalcTransformTexCoords(bundle.texMods[tm], (float *)src, (float *)dst);
+		if (pending)
+		{
+			RB_CalcTransformTexCoords(acc, (float *)src, (float *)dst);
 			src = dst;
-			break;
+			pending = false;
+		}
 
-		case texMod_t::TMOD_ROTATE:
-			RB_CalcRotateTexCoords(bundle.texMods[tm].rotateSpeed, (float *)src, (float *)dst);
+		switch (texMod.type)
+		{
+		case texMod_t::TMOD_TURBULENT:
+			RB_CalcTurbulentTexCoords(texMod.wave, (float *)src, (float *)dst);
 			src = dst;
 			break;
 
 		default:
-			ri.Error(ERR_DROP, "ERROR: unknown texmod '%d' in shader '%s'", static_cast<int>(bundle.texMods[tm].type), tess.shader->name);
+			ri.Error(ERR_DROP, "ERROR: unknown texmod '%d' in shader '%s'", static_cast<int>(texMod.type), tess.shader->name);
 			break;
 		}
 	}
 
+	if (pending)
+	{
+		RB_CalcTransformTexCoords(acc, (float *)src, (float *)dst);
+		src = dst;
+	}
+
 	tess.svars.texcoordPtr[b] = src;
 }
 
@@ -1006,7 +985,9 @@ void RB_StageIteratorGeneric(void)
 		{
 			if (!fogCollapse)
 			{
+				vk_profiler_begin(gpuZone_t::GPU_ZONE_DLIGHTS);
 				rebindIndex = ProjectDlightTexture();
+				vk_profiler_end(gpuZone_t::GPU_ZONE_DLIGHTS);
 			}
 		}
 #endif // USE_LEGACY_DLIGHTS
@@ -1014,7 +995,9 @@ void RB_StageIteratorGeneric(void)
 	// now do fog
 	if (tess.fogNum && static_cast<int>(tess.shader->fogPass) && !fogCollapse)
 	{
+		vk_profiler_begin(gpuZone_t::GPU_ZONE_FOG);
 		RB_FogPass(rebindIndex);
+		vk_profiler_end(gpuZone_t::GPU_ZONE_FOG);
 	}
 }
 
@@ -87,12 +87,11 @@ static float EvalWaveFormClamped(const waveForm_t &wf)
 }
 
 /*
-** RB_CalcStretchTexCoords
+** RB_StretchMatrix
 */
-void RB_CalcStretchTexCoords(const waveForm_t &wf, float *src, float *dst)
+static void RB_StretchMatrix(const waveForm_t &wf, texModInfo_t &tmi)
 {
 	float p;
-	texModInfo_t tmi;
 
 	p = 1.0f / EvalWaveForm(wf);
 
@@ -103,8 +102,6 @@ void RB_CalcStretchTexCoords(const waveForm_t &wf, float *src, float *dst)
 	tmi.matrix[0][1] = 0;
 	tmi.matrix[1][1] = p;
 	tmi.translate[1] = 0.5f - 0.5f * p;
-
-	RB_CalcTransformTexCoords(tmi, src, dst);
 }
 
 /*
@@ -117,153 +114,199 @@ DEFORMATIONS
 
 /*
 ========================
-RB_CalcDeformVertexes
+vertexDeform_t
+
+deformVertexes wave, bulge, move and deformVertexes normal only look at
+one vertex at a time, so a run of them is applied in a single walk over
+tess.xyz instead of one walk per deform. Everything that is the same for
+all vertexes is worked out once per batch.
 ========================
 */
-static void RB_CalcDeformVertexes(deformStage_t &ds)
+typedef struct
+{
+	deform_t type;
+	const deformStage_t *ds;
+	const float *table; // DEFORM_WAVE, nullptr when the scale is constant
+	float scale;		// DEFORM_WAVE with zero frequency
+	double now;
+	vec3_t offset;		// DEFORM_MOVE
+} vertexDeform_t;
+
+/*
+========================
+RB_PrepareVertexDeform
+
+Returns false for deforms that rebuild the surface
+========================
+*/
+static bool RB_PrepareVertexDeform(const deformStage_t &ds, vertexDeform_t &vd)
 {
-	int i;
-	vec3_t offset{};
-	float scale;
-	float *xyz = (float *)tess.xyz;
-	float *normal = (float *)tess.normal;
 	const float *table;
+	float scale;
 
-	if (ds.deformationWave.frequency == 0)
-	{
-		scale = EvalWaveForm(ds.deformationWave);
+	vd.type = ds.deformation;
+	vd.ds = &ds;
 
-		for (i = 0; i < tess.numVertexes; i++, xyz += 4, normal += 4)
+	switch (ds.deformation)
+	{
+	case deform_t::DEFORM_WAVE:
+		if (ds.deformationWave.frequency == 0)
 		{
-			VectorScale(normal, scale, offset);
-
-			xyz[0] += offset[0];
-			xyz[1] += offset[1];
-			xyz[2] += offset[2];
+			vd.table = nullptr;
+			vd.scale = EvalWaveForm(ds.deformationWave);
 		}
-	}
-	else
-	{
+		else
+		{
+			vd.table = TableForFunc(ds.deformationWave.func);
+			if (vd.table == nullptr)
+			{
+				ri.Error(ERR_DROP, "TableForFunc called with invalid function '%d' in shader '%s'", static_cast<int>(ds.deformationWave.func), tess.shader->name);
+			}
+			vd.now = tess.shaderTime * ds.deformationWave.frequency;
+		}
+		return true;
+
+	case deform_t::DEFORM_NORMALS:
+		vd.now = tess.shaderTime * ds.deformationWave.frequency;
+		return true;
+
+	case deform_t::DEFORM_BULGE:
+		vd.now = backEnd.refdef.floatTime * ds.bulgeSpeed;
+		return true;
+
+	case deform_t::DEFORM_MOVE:
 		table = TableForFunc(ds.deformationWave.func);
 		if (table == nullptr)
 		{
 			ri.Error(ERR_DROP, "TableForFunc called with invalid function '%d' in shader '%s'", static_cast<int>(ds.deformationWave.func), tess.shader->name);
 		}
-		for (i = 0; i < tess.numVertexes; i++, xyz += 4, normal += 4)
-		{
-			float off = (xyz[0] + xyz[1] + xyz[2]) * ds.deformationSpread;
 
-			scale = WAVEVALUE(table, ds.deformationWave.base,
-							  ds.deformationWave.amplitude,
-							  ds.deformationWave.phase + off,
-							  ds.deformationWave.frequency);
+		scale = WAVEVALUE(table, ds.deformationWave.base,
+						  ds.deformationWave.amplitude,
+						  ds.deformationWave.phase,
+						  ds.deformationWave.frequency);
 
-			VectorScale(normal, scale, offset);
+		VectorScale(ds.moveVector, scale, vd.offset);
+		return true;
 
-			xyz[0] += offset[0];
-			xyz[1] += offset[1];
-			xyz[2] += offset[2];
-		}
+	default:
+		return false;
+	}
+}
+
+/*
+========================
+RB_CalcDeformVertex
+
+Wave along the normal
+========================
+*/
+static inline void RB_CalcDeformVertex(const vertexDeform_t &vd, float *xyz, const float *normal)
+{
+	const deformStage_t &ds = *vd.ds;
+	float scale;
+
+	if (vd.table)
+	{
+		const float off = (xyz[0] + xyz[1] + xyz[2]) * ds.deformationSpread;
+
+		scale = ds.deformationWave.base + vd.table[(int64_t)(((ds.deformationWave.phase + off) + vd.now) * FUNCTABLE_SIZE) & FUNCTABLE_MASK] * ds.deformationWave.amplitude;
+	}
+	else
+	{
+		scale = vd.scale;
 	}
+
+	xyz[0] += normal[0] * scale;
+	xyz[1] += normal[1] * scale;
+	xyz[2] += normal[2] * scale;
 }
 
 /*
 =========================
-RB_CalcDeformNormals
+RB_CalcDeformNormal
 
 Wiggle the normals for wavy environment mapping
 =========================
 */
-static void RB_CalcDeformNormals(deformStage_t &ds)
+static inline void RB_CalcDeformNormal(const vertexDeform_t &vd, const float *xyz, float *normal)
 {
-	int i;
+	const deformStage_t &ds = *vd.ds;
 	float scale;
-	float *xyz = (float *)tess.xyz;
-	float *normal = (float *)tess.normal;
 
-	for (i = 0; i < tess.numVertexes; i++, xyz += 4, normal += 4)
-	{
-		scale = 0.98f;
-		scale = R_NoiseGet4f(xyz[0] * scale, xyz[1] * scale, xyz[2] * scale,
-							 tess.shaderTime * ds.deformationWave.frequency);
-		normal[0] += ds.deformationWave.amplitude * scale;
-
-		scale = 0.98f;
-		scale = R_NoiseGet4f(100 + xyz[0] * scale, xyz[1] * scale, xyz[2] * scale,
-							 tess.shaderTime * ds.deformationWave.frequency);
-		normal[1] += ds.deformationWave.amplitude * scale;
-
-		scale = 0.98f;
-		scale = R_NoiseGet4f(200 + xyz[0] * scale, xyz[1] * scale, xyz[2] * scale,
-							 tess.shaderTime * ds.deformationWave.frequency);
-		normal[2] += ds.deformationWave.amplitude * scale;
-
-		VectorNormalizeFast(normal);
-	}
+	scale = 0.98f;
+	scale = R_NoiseGet4f(xyz[0] * scale, xyz[1] * scale, xyz[2] * scale, vd.now);
+	normal[0] += ds.deformationWave.amplitude * scale;
+
+	scale = 0.98f;
+	scale = R_NoiseGet4f(100 + xyz[0] * scale, xyz[1] * scale, xyz[2] * scale, vd.now);
+	normal[1] += ds.deformationWave.amplitude * scale;
+
+	scale = 0.98f;
+	scale = R_NoiseGet4f(200 + xyz[0] * scale, xyz[1] * scale, xyz[2] * scale, vd.now);
+	normal[2] += ds.deformationWave.amplitude * scale;
+
+	VectorNormalizeFast(normal);
 }
 
 /*
 ========================
-RB_CalcBulgeVertexes
+RB_CalcBulgeVertex
 ========================
 */
-static void RB_CalcBulgeVertexes(deformStage_t &ds)
+static inline void RB_CalcBulgeVertex(const vertexDeform_t &vd, float *xyz, const float *normal, const float *st)
 {
-	int i;
-	const float *st = (const float *)tess.texCoords[0][0];
-	float *xyz = (float *)tess.xyz;
-	float *normal = (float *)tess.normal;
-	double now;
-
-	now = backEnd.refdef.floatTime * ds.bulgeSpeed;
-
-	for (i = 0; i < tess.numVertexes; i++, xyz += 4, st += 2, normal += 4)
-	{
-		int64_t off;
-		float scale;
+	const deformStage_t &ds = *vd.ds;
+	int64_t off;
+	float scale;
 
-		off = (float)(FUNCTABLE_SIZE / (PI_cpp * 2)) * (st[0] * ds.bulgeWidth + now);
+	off = (float)(FUNCTABLE_SIZE / (PI_cpp * 2)) * (st[0] * ds.bulgeWidth + vd.now);
 
-		scale = tr.sinTable[off & FUNCTABLE_MASK] * ds.bulgeHeight;
+	scale = tr.sinTable[off & FUNCTABLE_MASK] * ds.bulgeHeight;
 
-		xyz[0] += normal[0] * scale;
-		xyz[1] += normal[1] * scale;
-		xyz[2] += normal[2] * scale;
-	}
+	xyz[0] += normal[0] * scale;
+	xyz[1] += normal[1] * scale;
+	xyz[2] += normal[2] * scale;
 }
 
 /*
-======================
-RB_CalcMoveVertexes
+========================
+RB_CalcVertexDeforms
 
-A deformation that can move an entire surface along a wave path
-======================
+Applies deforms in shader order on each vertex
+========================
 */
-static void RB_CalcMoveVertexes(deformStage_t &ds)
+static void RB_CalcVertexDeforms(const vertexDeform_t *deforms, const int numDeforms)
 {
-	int i;
-	float *xyz;
-	const float *table;
-	float scale;
-	vec3_t offset{};
+	int i, d;
 
-	table = TableForFunc(ds.deformationWave.func);
-	if (table == nullptr)
+	for (i = 0; i < tess.numVertexes; i++)
 	{
-		ri.Error(ERR_DROP, "TableForFunc called with invalid function '%d' in shader '%s'", static_cast<int>(ds.deformationWave.func), tess.shader->name);
-	}
-
-	scale = WAVEVALUE(table, ds.deformationWave.base,
-					  ds.deformationWave.amplitude,
-					  ds.deformationWave.phase,
-					  ds.deformationWave.frequency);
+		float *xyz = tess.xyz[i];
+		float *normal = tess.normal[i];
 
-	VectorScale(ds.moveVector, scale, offset);
+		for (d = 0; d < numDeforms; d++)
+		{
+			const vertexDeform_t &vd = deforms[d];
 
-	xyz = (float *)tess.xyz;
-	for (i = 0; i < tess.numVertexes; i++, xyz += 4)
-	{
-		VectorAdd(xyz, offset, xyz);
+			switch (vd.type)
+			{
+			case deform_t::DEFORM_WAVE:
+				RB_CalcDeformVertex(vd, xyz, normal);
+				break;
+			case deform_t::DEFORM_NORMALS:
+				RB_CalcDeformNormal(vd, xyz, normal);
+				break;
+			case deform_t::DEFORM_BULGE:
+				RB_CalcBulgeVertex(vd, xyz, normal, tess.texCoords[0][i]);
+				break;
+			case deform_t::DEFORM_MOVE:
+				VectorAdd(xyz, vd.offset, xyz);
+				break;
+			default:
+				break;
+			}
+		}
 	}
 }
 
@@ -572,28 +615,31 @@ RB_DeformTessGeometry
 */
 void RB_DeformTessGeometry(void)
 {
+	vertexDeform_t vertexDeforms[MAX_SHADER_DEFORMS];
+	int numVertexDeforms = 0;
 	int i;
 
 	for (i = 0; i < tess.shader->numDeforms; i++)
 	{
 		deformStage_t &ds = tess.shader->deforms[i];
 
+		if (RB_PrepareVertexDeform(ds, vertexDeforms[numVertexDeforms]))
+		{
+			numVertexDeforms++;
+			continue;
+		}
+
+		// the next deform works on whole quads, bring the vertexes up to date first
+		if (numVertexDeforms)
+		{
+			RB_CalcVertexDeforms(vertexDeforms, numVertexDeforms);
+			numVertexDeforms = 0;
+		}
+
 		switch (ds.deformation)
 		{
 		case deform_t::DEFORM_NONE:
 			break;
-		case deform_t::DEFORM_NORMALS:
-			RB_CalcDeformNormals(ds);
-			break;
-		case deform_t::DEFORM_WAVE:
-			RB_CalcDeformVertexes(ds);
-			break;
-		case deform_t::DEFORM_BULGE:
-			RB_CalcBulgeVertexes(ds);
-			break;
-		case deform_t::DEFORM_MOVE:
-			RB_CalcMoveVertexes(ds);
-			break;
 		case deform_t::DEFORM_PROJECTION_SHADOW:
 			RB_ProjectionShadowDeform();
 			break;
@@ -613,8 +659,15 @@ void RB_DeformTessGeometry(void)
 		case deform_t::DEFORM_TEXT7:
 			DeformText(std::string_view(backEnd.refdef.text[static_cast<int>(ds.deformation) - static_cast<int>(deform_t::DEFORM_TEXT0)]));
 			break;
+		default:
+			break;
 		}
 	}
+
+	if (numVertexDeforms)
+	{
+		RB_CalcVertexDeforms(vertexDeforms, numVertexDeforms);
+	}
 }
 
 /*
@@ -1128,46 +1181,6 @@ void RB_CalcTurbulentTexCoords(const waveForm_t &wf, float *src, float *dst)
 	}
 }
 
-/*
-** RB_CalcScaleTexCoords
-*/
-void RB_CalcScaleTexCoords(const float scale[2], float *src, float *dst)
-{
-	int i;
-
-	for (i = 0; i < tess.numVertexes; i++, dst += 2, src += 2)
-	{
-		dst[0] = src[0] * scale[0];
-		dst[1] = src[1] * scale[1];
-	}
-}
-
-/*
-** RB_CalcScrollTexCoords
-*/
-void RB_CalcScrollTexCoords(const float scrollSpeed[2], float *src, float *dst)
-{
-	int i;
-	double timeScale;						 // -EC-: set to double
-	double adjustedScrollS, adjustedScrollT; // -EC-: set to double
-
-	timeScale = tess.shaderTime;
-
-	adjustedScrollS = (double)scrollSpeed[0] * timeScale;
-	adjustedScrollT = (double)scrollSpeed[1] * timeScale;
-
-	// clamp so coordinates don't continuously get larger, causing problems
-	// with hardware limits
-	adjustedScrollS = adjustedScrollS - floor(adjustedScrollS);
-	adjustedScrollT = adjustedScrollT - floor(adjustedScrollT);
-
-	for (i = 0; i < tess.numVertexes; i++, dst += 2, src += 2)
-	{
-		dst[0] = src[0] + adjustedScrollS;
-		dst[1] = src[1] + adjustedScrollT;
-	}
-}
-
 /*
 ** RB_CalcTransformTexCoords
 */
@@ -1186,15 +1199,14 @@ void RB_CalcTransformTexCoords(const texModInfo_t &tmi, float *src, float *dst)
 }
 
 /*
-** RB_CalcRotateTexCoords
+** RB_RotateMatrix
 */
-void RB_CalcRotateTexCoords(float degsPerSecond, float *src, float *dst)
+static void RB_RotateMatrix(float degsPerSecond, texModInfo_t &tmi)
 {
 	double timeScale = tess.shaderTime; // -EC- set to double
 	double degs;						// -EC- set to double
 	int64_t index;
 	float sinValue, cosValue;
-	texModInfo_t tmi{};
 
 	degs = -degsPerSecond * timeScale;
 	index = degs * (FUNCTABLE_SIZE / 360.0f);
@@ -1209,8 +1221,117 @@ void RB_CalcRotateTexCoords(float degsPerSecond, float *src, float *dst)
 	tmi.matrix[0][1] = sinValue;
 	tmi.matrix[1][1] = cosValue;
 	tmi.translate[1] = 0.5 - 0.5 * sinValue - 0.5 * cosValue;
+}
+
+/*
+** RB_ScrollMatrix
+*/
+static void RB_ScrollMatrix(const float scrollSpeed[2], texModInfo_t &tmi)
+{
+	double adjustedScrollS, adjustedScrollT; // -EC-: set to double
+
+	adjustedScrollS = (double)scrollSpeed[0] * tess.shaderTime;
+	adjustedScrollT = (double)scrollSpeed[1] * tess.shaderTime;
+
+	// clamp so coordinates don't continuously get larger, causing problems
+	// with hardware limits
+	adjustedScrollS = adjustedScrollS - floor(adjustedScrollS);
+	adjustedScrollT = adjustedScrollT - floor(adjustedScrollT);
+
+	tmi.matrix[0][0] = 1.0f;
+	tmi.matrix[1][0] = 0.0f;
+	tmi.translate[0] = adjustedScrollS;
+
+	tmi.matrix[0][1] = 0.0f;
+	tmi.matrix[1][1] = 1.0f;
+	tmi.translate[1] = adjustedScrollT;
+}
+
+/*
+** RB_TexModMatrix
+**
+** Returns false for texMods that are not an affine st transform (turb)
+*/
+bool RB_TexModMatrix(const texModInfo_t &tm, texModInfo_t &tmi)
+{
+	switch (tm.type)
+	{
+	case texMod_t::TMOD_SCROLL:
+		RB_ScrollMatrix(tm.scroll, tmi);
+		return true;
+
+	case texMod_t::TMOD_ENTITY_TRANSLATE:
+		RB_ScrollMatrix(backEnd.currentEntity->e.shaderTexCoord, tmi);
+		return true;
+
+	case texMod_t::TMOD_ROTATE:
+		RB_RotateMatrix(tm.rotateSpeed, tmi);
+		return true;
+
+	case texMod_t::TMOD_STRETCH:
+		RB_StretchMatrix(tm.wave, tmi);
+		return true;
+
+	case texMod_t::TMOD_TRANSFORM:
+		tmi.matrix[0][0] = tm.matrix[0][0];
+		tmi.matrix[1][0] = tm.matrix[1][0];
+		tmi.matrix[0][1] = tm.matrix[0][1];
+		tmi.matrix[1][1] = tm.matrix[1][1];
+		tmi.translate[0] = tm.translate[0];
+		tmi.translate[1] = tm.translate[1];
+		return true;
+
+	case texMod_t::TMOD_SCALE:
+	case texMod_t::TMOD_OFFSET:
+	case texMod_t::TMOD_SCALE_OFFSET:
+	case texMod_t::TMOD_OFFSET_SCALE:
+		{
+			const float ss = (tm.type == texMod_t::TMOD_OFFSET) ? 1.0f : tm.scale[0];
+			const float st = (tm.type == texMod_t::TMOD_OFFSET) ? 1.0f : tm.scale[1];
+			float os = (tm.type == texMod_t::TMOD_SCALE) ? 0.0f : tm.offset[0];
+			float ot = (tm.type == texMod_t::TMOD_SCALE) ? 0.0f : tm.offset[1];
+
+			if (tm.type == texMod_t::TMOD_OFFSET_SCALE)
+			{
+				os *= ss;
+				ot *= st;
+			}
+
+			tmi.matrix[0][0] = ss;
+			tmi.matrix[1][0] = 0.0f;
+			tmi.translate[0] = os;
+
+			tmi.matrix[0][1] = 0.0f;
+			tmi.matrix[1][1] = st;
+			tmi.translate[1] = ot;
+		}
+		return true;
+
+	default:
+		return false;
+	}
+}
 
-	RB_CalcTransformTexCoords(tmi, src, dst);
+/*
+** RB_ConcatTexMods
+**
+** Folds b into a so that a applies both, a first
+*/
+void RB_ConcatTexMods(texModInfo_t &a, const texModInfo_t &b)
+{
+	const float m00 = a.matrix[0][0] * b.matrix[0][0] + a.matrix[0][1] * b.matrix[1][0];
+	const float m10 = a.matrix[1][0] * b.matrix[0][0] + a.matrix[1][1] * b.matrix[1][0];
+	const float m01 = a.matrix[0][0] * b.matrix[0][1] + a.matrix[0][1] * b.matrix[1][1];
+	const float m11 = a.matrix[1][0] * b.matrix[0][1] + a.matrix[1][1] * b.matrix[1][1];
+	const float t0 = a.translate[0] * b.matrix[0][0] + a.translate[1] * b.matrix[1][0] + b.translate[0];
+	const float t1 = a.translate[0] * b.matrix[0][1] + a.translate[1] * b.matrix[1][1] + b.translate[1];
+
+	a.matrix[0][0] = m00;
+	a.matrix[1][0] = m10;
+	a.matrix[0][1] = m01;
+	a.matrix[1][1] = m11;
+	a.translate[0] = t0;
+	a.translate[1] = t1;
 }
 
 /*
@@ -1284,22 +1405,18 @@ void RB_CalcSpecularAlpha(unsigned char *alphas)
 **
 ** The basic vertex lighting calc
 */
-static void RB_CalcDiffuseColor_scalar(unsigned char* colors)
+static void RB_CalcDiffuseColor_scalar(unsigned char* colors, const trRefEntity_t* ent, const vec3_t &entLightDir, const int firstVertex, const int numVertexes)
 {
-	const trRefEntity_t* ent = backEnd.currentEntity;
 	const std::uint32_t  ambientLightInt = ent->ambientLightInt;
 
-	const int numVertexes = tess.numVertexes;
-
 	vec3_t ambientLight{}, lightDir{}, directedLight{};
 	VectorCopy(ent->ambientLight, ambientLight);
 	VectorCopy(ent->directedLight, directedLight);
-	VectorCopy(ent->lightDir, lightDir);
+	VectorCopy(entLightDir, lightDir);
 
-	float* v = tess.xyz[0];
-	float* normal = tess.normal[0];
+	float* normal = tess.normal[firstVertex];
 
-	for (int i = 0; i < numVertexes; ++i, v += 4, normal += 4)
+	for (int i = firstVertex; i < firstVertex + numVertexes; ++i, normal += 4)
 	{
 		const float incoming = DotProduct(normal, lightDir);
 
@@ -1324,5 +1441,20 @@ static void RB_CalcDiffuseColor_scalar(unsigned char* colors)
 
 void RB_CalcDiffuseColor(unsigned char *colors)
 {
-	RB_CalcDiffuseColor_scalar(colors);
+	int i, last;
+
+	if (tess.numInstances == 0)
+	{
+		RB_CalcDiffuseColor_scalar(colors, backEnd.currentEntity, backEnd.currentEntity->lightDir, 0, tess.numVertexes);
+		return;
+	}
+
+	// instanced batch, each entity has its own light
+	for (i = 0; i < tess.numInstances; i++)
+	{
+		const tessInstance_t &inst = tess.instances[i];
+
+		last = (i + 1 < tess.numInstances) ? tess.instances[i + 1].firstVertex : tess.numVertexes;
+		RB_CalcDiffuseColor_scalar(colors, inst.entity, inst.lightDir, inst.firstVertex, last - inst.firstVertex);
+	}
 }
\ No newline at end of file
@@ -3,12 +3,10 @@
 
 #include "tr_local.hpp"
 
-void RB_CalcStretchTexCoords(const waveForm_t &wf, float *src, float *dst);
 void RB_CalcTransformTexCoords(const texModInfo_t &tmi, float *src, float *dst);
-void RB_CalcRotateTexCoords(float degsPerSecond, float *src, float *dst);
-void RB_CalcScrollTexCoords(const float scrollSpeed[2], float *src, float *dst);
-void RB_CalcScaleTexCoords(const float scale[2], float *src, float *dst);
 void RB_CalcTurbulentTexCoords(const waveForm_t &wf, float *src, float *dst);
+bool RB_TexModMatrix(const texModInfo_t &tm, texModInfo_t &tmi);
+void RB_ConcatTexMods(texModInfo_t &a, const texModInfo_t &b);
 void RB_CalcSpecularAlpha(unsigned char *alphas);
 void RB_CalcFogTexCoords(float *st);
 void RB_CalcEnvironmentTexCoords(float *st);
@@ -27,10 +27,12 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include "tr_sky.hpp"
 #include "vk.hpp"
 #include "tr_image.hpp"
+#include "tr_smp.hpp"
 #include "math.hpp"
 #include "utils.hpp"
 #include <cstdint>
 #include "vk_pipeline.hpp"
+#include "vk_pipeline_cache.hpp"
 
 #define generateHashValue Com_GenerateHashValue_cpp
 
@@ -3785,6 +3787,8 @@ static shader_t* FinishShader(void)
 			pStage.vk_pipeline[0] = vk_find_pipeline_ext(0, def, true);
 			def.mirror = true;
 			pStage.vk_mirror_pipeline[0] = vk_find_pipeline_ext(0, def, false);
+			// mirror and fog variants are created on first use, have them ready for that
+			vk_queue_pipeline(pStage.vk_mirror_pipeline[0]);
 
 			if (pStage.depthFragment)
 			{
@@ -3794,6 +3798,7 @@ static shader_t* FinishShader(void)
 				def.mirror = true;
 				def.shader_type = Vk_Shader_Type::TYPE_SIGNLE_TEXTURE_DF;
 				pStage.vk_mirror_pipeline_df = vk_find_pipeline_ext(0, def, false);
+				vk_queue_pipeline(pStage.vk_mirror_pipeline_df);
 			}
 
 #ifdef USE_FOG_COLLAPSE
@@ -3812,6 +3817,8 @@ static shader_t* FinishShader(void)
 
 				pStage.vk_pipeline[1] = vk_find_pipeline_ext(0, def, false);
 				pStage.vk_mirror_pipeline[1] = vk_find_pipeline_ext(0, def_mirror, false);
+				vk_queue_pipeline(pStage.vk_pipeline[1]);
+				vk_queue_pipeline(pStage.vk_mirror_pipeline[1]);
 
 				pStage.bundle[0].adjustColorsForFog = acff_t::ACFF_NONE; // will be handled in shader from now
 
@@ -3922,6 +3929,80 @@ static const char* FindShaderInShaderText(std::string_view shadername)
 	return nullptr;
 }
 
+/*
+====================
+R_GetShaderImageNames
+
+Lists the image files R_FindShader() is going to ask for when it creates
+the named shader, without parsing it: the map, clampMap and animMap images
+of its script or the shader name itself when there is no script.
+Conditional stages are not evaluated, so the list may contain extra names.
+====================
+*/
+void R_GetShaderImageNames(std::string_view name, std::vector<std::string> &images)
+{
+	std::array<char, MAX_QPATH> strippedName;
+	std::string_view token;
+	const char *p;
+	int depth;
+
+	if (name.empty())
+	{
+		return;
+	}
+
+	COM_StripExtension_cpp(name, strippedName);
+
+	p = FindShaderInShaderText(strippedName.data());
+	if (!p)
+	{
+		images.emplace_back(name);
+		return;
+	}
+
+	depth = 0;
+	while (1)
+	{
+		token = COM_ParseExt_cpp(&p, true);
+		if (token.empty())
+		{
+			break;
+		}
+
+		if (token[0] == '{')
+		{
+			depth++;
+			continue;
+		}
+		if (token[0] == '}')
+		{
+			if (--depth <= 0)
+			{
+				break;
+			}
+			continue;
+		}
+
+		if (!Q_stricmp_cpp(token, "map") || !Q_stricmp_cpp(token, "clampMap"))
+		{
+			token = COM_ParseExt_cpp(&p, false);
+			if (!token.empty() && token[0] != '$' && token[0] != '*')
+			{
+				images.emplace_back(token);
+			}
+		}
+		else if (!Q_stricmp_cpp(token, "animMap"))
+		{
+			// skip the frequency
+			COM_ParseExt_cpp(&p, false);
+			while (!(token = COM_ParseExt_cpp(&p, false)).empty())
+			{
+				images.emplace_back(token);
+			}
+		}
+	}
+}
+
 /*
 ==================
 R_FindShaderByName
@@ -4104,6 +4185,9 @@ shader_t* R_FindShader(std::string_view name, int lightmapIndex, const bool mipR
 		}
 	}
 
+	// new shaders re-sort the shader list the back end is drawing with
+	R_SyncRenderThread();
+
 	InitShader(strippedName.data(), lightmapIndex);
 
 	// FIXME: set these "need" values appropriately
@@ -4200,6 +4284,8 @@ qhandle_t RE_RegisterShaderFromImage(std::string_view name, int lightmapIndex, i
 		}
 	}
 
+	R_SyncRenderThread();
+
 	InitShader(name.data(), lightmapIndex);
 
 	// FIXME: set these "need" values appropriately
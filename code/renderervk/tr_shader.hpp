@@ -3,6 +3,9 @@
 
 #include "tr_local.hpp"
 
+#include <string>
+#include <vector>
+
 /*
 ================
 return a hash value for the filename
@@ -39,6 +42,9 @@ extern "C"
 }
 #endif
 
+// appends the image names the shader script references, see the comment in tr_shader.cpp
+void R_GetShaderImageNames(std::string_view name, std::vector<std::string> &images);
+
 void R_ShaderList_f(void);
 void R_InitShaders(void);
 
@@ -0,0 +1,205 @@
+#include "tr_smp.hpp"
+#include "tr_backend.hpp"
+#include "vk_profiler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+using smpClock = std::chrono::steady_clock;
+
+static struct
+{
+	std::thread thread;
+	std::mutex lock;
+	std::condition_variable wake;
+	std::condition_variable done;
+
+	// published under lock
+	const void *cmds; // list owned by the render thread, nullptr when idle
+	int backUsec;
+	bool quit;
+
+	smpClock::time_point lastSubmit;
+	backEndCounters_t backEndPC;
+	smpCounters_t pc;
+} smp;
+
+static int R_ElapsedUsec(const smpClock::time_point start, const smpClock::time_point end)
+{
+	return static_cast<int>(std::chrono::duration_cast<std::chrono::microseconds>(end - start).count());
+}
+
+static void R_RenderThread(void)
+{
+	for (;;)
+	{
+		const void *cmds;
+
+		{
+			std::unique_lock<std::mutex> lk(smp.lock);
+			smp.wake.wait(lk, []
+						  { return smp.quit || smp.cmds != nullptr; });
+			// finish the pending list before honoring quit
+			if (smp.cmds == nullptr)
+			{
+				return;
+			}
+			cmds = smp.cmds;
+		}
+
+		const smpClock::time_point start = smpClock::now();
+		RB_ExecuteRenderCommands(cmds);
+		const int usec = R_ElapsedUsec(start, smpClock::now());
+
+		{
+			std::lock_guard<std::mutex> lk(smp.lock);
+			smp.backUsec = usec;
+			smp.cmds = nullptr;
+		}
+		smp.done.notify_all();
+	}
+}
+
+/*
+===============
+R_InitRenderThread
+===============
+*/
+void R_InitRenderThread(void)
+{
+	R_ShutdownRenderThread();
+
+	Com_Memset(&smp.pc, 0, sizeof(smp.pc));
+	Com_Memset(&smp.backEndPC, 0, sizeof(smp.backEndPC));
+	smp.lastSubmit = {};
+
+	if (!r_smp->integer)
+	{
+		return;
+	}
+
+	smp.cmds = nullptr;
+	smp.backUsec = 0;
+	smp.quit = false;
+
+	smp.thread = std::thread(R_RenderThread);
+
+	ri.Printf(PRINT_ALL, "...using SMP render thread\n");
+}
+
+/*
+===============
+R_ShutdownRenderThread
+===============
+*/
+void R_ShutdownRenderThread(void)
+{
+	if (!smp.thread.joinable())
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lk(smp.lock);
+		smp.quit = true;
+	}
+	smp.wake.notify_one();
+
+	smp.thread.join();
+}
+
+bool R_RenderThreadActive(void)
+{
+	return smp.thread.joinable();
+}
+
+/*
+===============
+R_SyncRenderThread
+===============
+*/
+void R_SyncRenderThread(void)
+{
+	if (!smp.thread.joinable())
+	{
+		return;
+	}
+
+	std::unique_lock<std::mutex> lk(smp.lock);
+	smp.done.wait(lk, []
+				  { return smp.cmds == nullptr; });
+}
+
+/*
+===============
+R_SubmitRenderCommands
+===============
+*/
+void R_SubmitRenderCommands(const void *cmds, bool sync)
+{
+	smpClock::time_point now = smpClock::now();
+
+	smp.pc.frontUsec = smp.lastSubmit == smpClock::time_point{} ? 0 : R_ElapsedUsec(smp.lastSubmit, now);
+	smp.pc.waitUsec = 0;
+	smp.pc.overlapUsec = 0;
+
+	if (smp.thread.joinable())
+	{
+		R_SyncRenderThread();
+
+		const smpClock::time_point synced = smpClock::now();
+		smp.pc.waitUsec = R_ElapsedUsec(now, synced);
+		smp.pc.backUsec = smp.backUsec;
+		// whatever the back end did not spend stalling the main thread ran in parallel
+		smp.pc.overlapUsec = std::max(smp.backUsec - smp.pc.waitUsec, 0);
+		now = synced;
+
+		if (!sync)
+		{
+			// the back end is idle, take over its counters before it starts the new list
+			smp.backEndPC = backEnd.pc;
+			Com_Memset(&backEnd.pc, 0, sizeof(backEnd.pc));
+			R_GPUProfilerSnapshot();
+
+			{
+				std::lock_guard<std::mutex> lk(smp.lock);
+				smp.cmds = cmds;
+			}
+			smp.wake.notify_one();
+
+			smp.lastSubmit = smpClock::now();
+			return;
+		}
+	}
+
+	RB_ExecuteRenderCommands(cmds);
+
+	smp.lastSubmit = smpClock::now();
+	if (smp.thread.joinable())
+	{
+		// main thread did the back end work itself this time
+		smp.pc.waitUsec += R_ElapsedUsec(now, smp.lastSubmit);
+		smp.backUsec = 0;
+	}
+	else
+	{
+		smp.pc.backUsec = R_ElapsedUsec(now, smp.lastSubmit);
+	}
+
+	smp.backEndPC = backEnd.pc;
+	Com_Memset(&backEnd.pc, 0, sizeof(backEnd.pc));
+	R_GPUProfilerSnapshot();
+}
+
+backEndCounters_t &R_BackEndCounters(void)
+{
+	return smp.backEndPC;
+}
+
+const smpCounters_t &R_SMPCounters(void)
+{
+	return smp.pc;
+}
@@ -0,0 +1,39 @@
+#ifndef TR_SMP_HPP
+#define TR_SMP_HPP
+
+#include "tr_local.hpp"
+
+// Optional dedicated back end thread (r_smp).
+// The front end fills backEndBuffers[tr.smpFrame] while the render thread
+// replays the other buffer into Vulkan command buffers. Everything the front
+// end does that touches Vulkan or back end state (registration, cinematic
+// uploads, screenshots, shutdown) must call R_SyncRenderThread() first.
+
+typedef struct
+{
+	int frontUsec;	 // main thread time between two submits
+	int backUsec;	 // back end time spent on the last finished list
+	int waitUsec;	 // main thread stalled waiting for the back end
+	int overlapUsec; // back end time hidden behind front end work
+} smpCounters_t;
+
+void R_InitRenderThread(void);
+void R_ShutdownRenderThread(void);
+
+// true when command lists are replayed on the render thread
+bool R_RenderThreadActive(void);
+
+// blocks until the render thread has finished the list it was given,
+// no-op without r_smp
+void R_SyncRenderThread(void);
+
+// hands a terminated command list to the back end, with sync == true
+// or without r_smp the list is executed before returning
+void R_SubmitRenderCommands(const void *cmds, bool sync);
+
+// counters of the last list the back end finished, owned by the front end
+backEndCounters_t &R_BackEndCounters(void);
+
+const smpCounters_t &R_SMPCounters(void);
+
+#endif // TR_SMP_HPP
@@ -23,8 +23,10 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include "tr_surface.hpp"
 #include "tr_animation.hpp"
 #include "tr_backend.hpp"
+#include "tr_model.hpp"
 #include "tr_model_iqm.hpp"
 #include "tr_shade.hpp"
+#include "tr_mesh_kernels.hpp"
 #include "vk_flares.hpp"
 #include "vk_vbo.hpp"
 #include "vk.hpp"
@@ -691,129 +693,34 @@ static void RB_SurfaceLightningBolt(void)
 	}
 }
 
-/*
-** VectorArrayNormalize
-*
-* The inputs to this routing seem to always be close to length = 1.0 (about 0.6 to 2.0)
-* This means that we don't have to worry about zero length ort enormously long vectors.
-*/
-static void VectorArrayNormalize(vec4_t *normals, unsigned int count)
-{
-	//    assert(count);
-	// given the input, it's safe to call VectorNormalizeFast
-	while (count--)
-	{
-		VectorNormalizeFast(normals[0]);
-		normals++;
-	}
-}
-
 /*
 ** LerpMeshVertexes
 */
-static void LerpMeshVertexes_scalar(md3Surface_t *surf, float backlerp)
+static void LerpMeshVertexes(md3Surface_t *surf, float backlerp)
 {
-	short *oldXyz, *newXyz, *oldNormals, *newNormals;
-	float *outXyz, *outNormal;
-	float oldXyzScale, newXyzScale;
-	float oldNormalScale, newNormalScale;
-	int vertNum;
-	unsigned lat, lng;
-	int numVerts;
-
-	outXyz = tess.xyz[tess.numVertexes];
-	outNormal = tess.normal[tess.numVertexes];
+	const int numVerts = surf->numVerts;
+	const int frame = backEnd.currentEntity->e.frame;
+	const int oldframe = backEnd.currentEntity->e.oldframe;
+	vec4_t *xyz = tess.xyz + tess.numVertexes;
+	vec4_t *normal = tess.normal + tess.numVertexes;
 
-	newXyz = (short *)((byte *)surf + surf->ofsXyzNormals) + (backEnd.currentEntity->e.frame * surf->numVerts * 4);
-	newNormals = newXyz + 3;
+	// expanded by R_DecodeMD3Frames()
+	const md3DecodedVert_t *decoded = R_GetMD3Frames(*R_GetModelByHandle(backEnd.currentEntity->e.hModel), surf);
 
-	newXyzScale = MD3_XYZ_SCALE * (1.0 - backlerp);
-	newNormalScale = 1.0 - backlerp;
-
-	numVerts = surf->numVerts;
-
-	if (backlerp == 0)
+	if (decoded)
 	{
-		//
-		// just copy the vertexes
-		//
-		for (vertNum = 0; vertNum < numVerts; vertNum++,
-			newXyz += 4, newNormals += 4,
-			outXyz += 4, outNormal += 4)
-		{
-
-			outXyz[0] = newXyz[0] * newXyzScale;
-			outXyz[1] = newXyz[1] * newXyzScale;
-			outXyz[2] = newXyz[2] * newXyzScale;
-
-			lat = (newNormals[0] >> 8) & 0xff;
-			lng = (newNormals[0] & 0xff);
-			lat *= (FUNCTABLE_SIZE / 256);
-			lng *= (FUNCTABLE_SIZE / 256);
-
-			// decode X as cos( lat ) * sin( long )
-			// decode Y as sin( lat ) * sin( long )
-			// decode Z as cos( long )
-
-			outNormal[0] = tr.sinTable[(lat + (FUNCTABLE_SIZE / 4)) & FUNCTABLE_MASK] * tr.sinTable[lng];
-			outNormal[1] = tr.sinTable[lat] * tr.sinTable[lng];
-			outNormal[2] = tr.sinTable[(lng + (FUNCTABLE_SIZE / 4)) & FUNCTABLE_MASK];
-		}
+		meshKernels.lerpDecoded(xyz, normal, decoded + oldframe * numVerts, decoded + frame * numVerts, numVerts, backlerp);
 	}
 	else
 	{
-		//
-		// interpolate and copy the vertex and normal
-		//
-		oldXyz = (short *)((byte *)surf + surf->ofsXyzNormals) + (backEnd.currentEntity->e.oldframe * surf->numVerts * 4);
-		oldNormals = oldXyz + 3;
-
-		oldXyzScale = MD3_XYZ_SCALE * backlerp;
-		oldNormalScale = backlerp;
-
-		for (vertNum = 0; vertNum < numVerts; vertNum++,
-			oldXyz += 4, newXyz += 4, oldNormals += 4, newNormals += 4,
-			outXyz += 4, outNormal += 4)
-		{
-
-			// interpolate the xyz
-			outXyz[0] = oldXyz[0] * oldXyzScale + newXyz[0] * newXyzScale;
-			outXyz[1] = oldXyz[1] * oldXyzScale + newXyz[1] * newXyzScale;
-			outXyz[2] = oldXyz[2] * oldXyzScale + newXyz[2] * newXyzScale;
-
-			// FIXME: interpolate lat/long instead?
-			lat = (newNormals[0] >> 8) & 0xff;
-			lng = (newNormals[0] & 0xff);
-			lat *= 4;
-			lng *= 4;
-			vec3_t uncompressedNewNormal = {
-				tr.sinTable[(lat + (FUNCTABLE_SIZE / 4)) & FUNCTABLE_MASK] * tr.sinTable[lng],
-				tr.sinTable[lat] * tr.sinTable[lng],
-				tr.sinTable[(lng + (FUNCTABLE_SIZE / 4)) & FUNCTABLE_MASK]};
-
-			lat = (oldNormals[0] >> 8) & 0xff;
-			lng = (oldNormals[0] & 0xff);
-			lat *= 4;
-			lng *= 4;
-
-			vec3_t uncompressedOldNormal{
-				tr.sinTable[(lat + (FUNCTABLE_SIZE / 4)) & FUNCTABLE_MASK] * tr.sinTable[lng],
-				tr.sinTable[lat] * tr.sinTable[lng],
-				tr.sinTable[(lng + (FUNCTABLE_SIZE / 4)) & FUNCTABLE_MASK]};
-
-			outNormal[0] = uncompressedOldNormal[0] * oldNormalScale + uncompressedNewNormal[0] * newNormalScale;
-			outNormal[1] = uncompressedOldNormal[1] * oldNormalScale + uncompressedNewNormal[1] * newNormalScale;
-			outNormal[2] = uncompressedOldNormal[2] * oldNormalScale + uncompressedNewNormal[2] * newNormalScale;
-
-			//			VectorNormalize (outNormal);
-		}
-		VectorArrayNormalize((vec4_t *)tess.normal[tess.numVertexes], numVerts);
+		const md3XyzNormal_t *frames = (const md3XyzNormal_t *)((const byte *)surf + surf->ofsXyzNormals);
+		meshKernels.lerpPacked(xyz, normal, frames + oldframe * numVerts, frames + frame * numVerts, numVerts, backlerp);
 	}
-}
 
-static void LerpMeshVertexes(md3Surface_t *surf, float backlerp)
-{
-	LerpMeshVertexes_scalar(surf, backlerp);
+	if (backlerp != 0)
+	{
+		meshKernels.normalize(normal, numVerts);
+	}
 }
 
 /*
@@ -24,6 +24,9 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include "tr_light.hpp"
 #include "tr_model.hpp"
 #include "math.hpp"
+#include "tr_jobs.hpp"
+
+#include <vector>
 
 /*
 =================
@@ -380,25 +383,13 @@ static int R_DlightSurface(msurface_t &surf, int dlightBits)
 
 /*
 ======================
-R_AddWorldSurface
+R_AddVisibleWorldSurface
+
+Adds a surface that already passed R_CullSurface()
 ======================
 */
-static void R_AddWorldSurface(msurface_t &surf, int dlightBits)
+static void R_AddVisibleWorldSurface(msurface_t &surf, int dlightBits)
 {
-	if (surf.viewCount == tr.viewCount)
-	{
-		return; // already in this view
-	}
-
-	surf.viewCount = tr.viewCount;
-	// FIXME: bmodel fog?
-
-	// try to cull before dlighting or adding
-	if (R_CullSurface(surf.data, *surf.shader))
-	{
-		return;
-	}
-
 #ifdef USE_PMLIGHT
 #ifdef USE_LEGACY_DLIGHTS
 	if (r_dlightMode->integer)
@@ -422,6 +413,30 @@ static void R_AddWorldSurface(msurface_t &surf, int dlightBits)
 #endif // USE_LEGACY_DLIGHTS
 }
 
+/*
+======================
+R_AddWorldSurface
+======================
+*/
+static void R_AddWorldSurface(msurface_t &surf, int dlightBits)
+{
+	if (surf.viewCount == tr.viewCount)
+	{
+		return; // already in this view
+	}
+
+	surf.viewCount = tr.viewCount;
+	// FIXME: bmodel fog?
+
+	// try to cull before dlighting or adding
+	if (R_CullSurface(surf.data, *surf.shader))
+	{
+		return;
+	}
+
+	R_AddVisibleWorldSurface(surf, dlightBits);
+}
+
 /*
 =============================================================
 	PM LIGHTING
@@ -619,80 +634,159 @@ void R_AddBrushModelSurfaces(trRefEntity_t &ent)
 =============================================================
 */
 
+/*
+=============================================================
+
+	PARALLEL WORLD TRAVERSAL
+
+	The upper levels of the BSP are walked on the main thread and
+	split into subtrees which are then walked by the job workers.
+	Workers only do node and face culling and record candidate
+	surfaces, everything that touches shared state (viewCount
+	marks, dlight bits, drawsurf list) happens in R_MergeWorldJobs
+	in subtree order, so the resulting drawsurf list is identical
+	to the single-threaded walk.
+
+=============================================================
+*/
+
+struct worldSurf_t
+{
+	msurface_t *surf;
+	int dlightBits;
+};
+
+struct worldJob_t
+{
+	const mnode_t *node;
+	unsigned int planeBits;
+	unsigned int dlightBits;
+
+	// results, owned by the worker until R_RunJobs returns
+	vec3_t visBounds[2];
+	int c_leafs;
+	std::vector<worldSurf_t> surfs;
+};
+
+constexpr int MAX_WORLD_JOBS = 256;
+
+static worldJob_t worldJobs[MAX_WORLD_JOBS];
+static int numWorldJobs;
+
 /*
 ================
-R_RecursiveWorldNode
+R_CullWorldNode
+
+Returns true if the node is outside the PVS or the view frustum,
+otherwise clears the frustum planes it is completely in front of
 ================
 */
-static void R_RecursiveWorldNode(const mnode_t *node, unsigned int planeBits, unsigned int dlightBits)
+static bool R_CullWorldNode(const mnode_t *node, unsigned int &planeBits)
 {
-	do
+	// if the node wasn't marked as potentially visible, exit
+	if (node->visframe != tr.visCount)
 	{
-		// if the node wasn't marked as potentially visible, exit
-		if (node->visframe != tr.visCount)
-		{
-			return;
-		}
+		return true;
+	}
 
-		// if the bounding volume is outside the frustum, nothing
-		// inside can be visible OPTIMIZE: don't do this all the way to leafs?
+	// if the bounding volume is outside the frustum, nothing
+	// inside can be visible OPTIMIZE: don't do this all the way to leafs?
 
-		if (!r_nocull->integer)
+	if (!r_nocull->integer)
+	{
+		for (int i = 0; i < 4; i++)
 		{
-			int r;
+			const unsigned int bit = 1 << i;
 
-			if (planeBits & 1)
+			if (planeBits & bit)
 			{
-				r = BoxOnPlaneSide_cpp(node->mins, node->maxs, tr.viewParms.frustum[0]);
+				int r = BoxOnPlaneSide_cpp(node->mins, node->maxs, tr.viewParms.frustum[i]);
 				if (r == 2)
 				{
-					return; // culled
+					return true; // culled
 				}
 				if (r == 1)
 				{
-					planeBits &= ~1; // all descendants will also be in front
+					planeBits &= ~bit; // all descendants will also be in front
 				}
 			}
+		}
+	}
 
-			if (planeBits & 2)
-			{
-				r = BoxOnPlaneSide_cpp(node->mins, node->maxs, tr.viewParms.frustum[1]);
-				if (r == 2)
-				{
-					return; // culled
-				}
-				if (r == 1)
-				{
-					planeBits &= ~2; // all descendants will also be in front
-				}
-			}
+	return false;
+}
 
-			if (planeBits & 4)
-			{
-				r = BoxOnPlaneSide_cpp(node->mins, node->maxs, tr.viewParms.frustum[2]);
-				if (r == 2)
-				{
-					return; // culled
-				}
-				if (r == 1)
-				{
-					planeBits &= ~4; // all descendants will also be in front
-				}
-			}
+/*
+================
+R_SplitNodeDlights
 
-			if (planeBits & 8)
+Determines which dlights are needed on each side of the node
+================
+*/
+static void R_SplitNodeDlights(const mnode_t *node, const unsigned int dlightBits, unsigned int (&newDlights)[2])
+{
+	newDlights[0] = newDlights[1] = 0;
+#ifdef USE_LEGACY_DLIGHTS
+#ifdef USE_PMLIGHT
+	if (r_dlightMode->integer)
+		return;
+#endif
+	if (dlightBits)
+	{
+		int i;
+
+		for (i = 0; i < static_cast<int>(tr.refdef.num_dlights); i++)
+		{
+			if (dlightBits & (1 << i))
 			{
-				r = BoxOnPlaneSide_cpp(node->mins, node->maxs, tr.viewParms.frustum[3]);
-				if (r == 2)
+				const dlight_t &dl = tr.refdef.dlights[i];
+				float dist = DotProduct(dl.origin, node->plane->normal) - node->plane->dist;
+
+				if (dist > -dl.radius)
 				{
-					return; // culled
+					newDlights[0] |= (1 << i);
 				}
-				if (r == 1)
+				if (dist < dl.radius)
 				{
-					planeBits &= ~8; // all descendants will also be in front
+					newDlights[1] |= (1 << i);
 				}
 			}
 		}
+	}
+#endif // USE_LEGACY_DLIGHTS
+}
+
+static void R_AddLeafBounds(const mnode_t *node, vec3_t (&bounds)[2])
+{
+	for (int i = 0; i < 3; i++)
+	{
+		if (node->mins[i] < bounds[0][i])
+		{
+			bounds[0][i] = node->mins[i];
+		}
+		if (node->maxs[i] > bounds[1][i])
+		{
+			bounds[1][i] = node->maxs[i];
+		}
+	}
+}
+
+/*
+================
+R_RecursiveWorldNode
+
+With job == nullptr surfaces are added to the view directly,
+otherwise unculled candidates are recorded into the job
+================
+*/
+static void R_RecursiveWorldNode(const mnode_t *node, unsigned int planeBits, unsigned int dlightBits, worldJob_t *job)
+{
+	do
+	{
+		if (R_CullWorldNode(node, planeBits))
+		{
+			return;
+		}
 
 		if (static_cast<uint32_t>(node->contents) != CONTENTS_NODE)
 		{
@@ -703,89 +797,162 @@ static void R_RecursiveWorldNode(const mnode_t *node, unsigned int planeBits, un
 		// since we don't care about sort orders, just go positive to negative
 
 		// determine which dlights are needed
-		unsigned int newDlights[2]{};
-#ifdef USE_LEGACY_DLIGHTS
-#ifdef USE_PMLIGHT
-		if (!r_dlightMode->integer)
-#endif
-			if (dlightBits)
-			{
-				int i;
-
-				for (i = 0; i < static_cast<int>(tr.refdef.num_dlights); i++)
-				{
-					if (dlightBits & (1 << i))
-					{
-						const dlight_t &dl = tr.refdef.dlights[i];
-						float dist = DotProduct(dl.origin, node->plane->normal) - node->plane->dist;
-
-						if (dist > -dl.radius)
-						{
-							newDlights[0] |= (1 << i);
-						}
-						if (dist < dl.radius)
-						{
-							newDlights[1] |= (1 << i);
-						}
-					}
-				}
-			}
-#endif // USE_LEGACY_DLIGHTS
+		unsigned int newDlights[2];
+		R_SplitNodeDlights(node, dlightBits, newDlights);
 
 		// recurse down the children, front side first
-		R_RecursiveWorldNode(node->children[0], planeBits, newDlights[0]);
+		R_RecursiveWorldNode(node->children[0], planeBits, newDlights[0], job);
 
 		// tail recurse
 		node = node->children[1];
-#ifdef USE_LEGACY_DLIGHTS
 		dlightBits = newDlights[1];
-#endif
 	} while (1);
 
+	// leaf node, so add mark surfaces
+	msurface_t **mark = node->firstmarksurface;
+
+	if (job)
 	{
-		// leaf node, so add mark surfaces
-		tr.pc.c_leafs++;
+		job->c_leafs++;
+		R_AddLeafBounds(node, job->visBounds);
 
-		// add to z buffer bounds
-		if (node->mins[0] < tr.viewParms.visBounds[0][0])
-		{
-			tr.viewParms.visBounds[0][0] = node->mins[0];
-		}
-		if (node->mins[1] < tr.viewParms.visBounds[0][1])
-		{
-			tr.viewParms.visBounds[0][1] = node->mins[1];
-		}
-		if (node->mins[2] < tr.viewParms.visBounds[0][2])
+		for (int i = 0; i < node->nummarksurfaces; ++i)
 		{
-			tr.viewParms.visBounds[0][2] = node->mins[2];
+			msurface_t *surf = mark[i];
+			// duplicates are resolved during merge, culling is view-constant
+			// so a surface rejected here would be rejected in any other leaf too
+			if (!R_CullSurface(surf->data, *surf->shader))
+			{
+				job->surfs.push_back({surf, static_cast<int>(dlightBits)});
+			}
 		}
+		return;
+	}
 
-		if (node->maxs[0] > tr.viewParms.visBounds[1][0])
+	tr.pc.c_leafs++;
+
+	// add to z buffer bounds
+	R_AddLeafBounds(node, tr.viewParms.visBounds);
+
+	// add the individual surfaces
+	for (int i = 0; i < node->nummarksurfaces; ++i)
+	{
+		// the surface may have already been added if it
+		// spans multiple leafs
+		msurface_t *surf = mark[i];
+		R_AddWorldSurface(*surf, dlightBits);
+	}
+}
+
+/*
+================
+R_CollectWorldJobs
+
+Walks the top of the tree exactly like R_RecursiveWorldNode and
+emits the subtrees below `depth` as jobs, in traversal order
+================
+*/
+static void R_CollectWorldJobs(const mnode_t *node, unsigned int planeBits, unsigned int dlightBits, int depth)
+{
+	while (depth > 0 && static_cast<uint32_t>(node->contents) == CONTENTS_NODE)
+	{
+		if (R_CullWorldNode(node, planeBits))
 		{
-			tr.viewParms.visBounds[1][0] = node->maxs[0];
+			return;
 		}
-		if (node->maxs[1] > tr.viewParms.visBounds[1][1])
+
+		unsigned int newDlights[2];
+		R_SplitNodeDlights(node, dlightBits, newDlights);
+
+		R_CollectWorldJobs(node->children[0], planeBits, newDlights[0], depth - 1);
+
+		node = node->children[1];
+		dlightBits = newDlights[1];
+		depth--;
+	}
+
+	if (numWorldJobs >= MAX_WORLD_JOBS)
+	{
+		// can't happen with the depth limit in R_AddWorldSurfacesParallel
+		return;
+	}
+
+	worldJob_t &job = worldJobs[numWorldJobs++];
+	job.node = node;
+	job.planeBits = planeBits;
+	job.dlightBits = dlightBits;
+}
+
+static void R_WorldJob(void *arg, int index)
+{
+	worldJob_t &job = worldJobs[index];
+
+	ClearBounds_cpp(job.visBounds[0], job.visBounds[1]);
+	job.c_leafs = 0;
+	job.surfs.clear();
+
+	R_RecursiveWorldNode(job.node, job.planeBits, job.dlightBits, &job);
+}
+
+/*
+================
+R_MergeWorldJobs
+================
+*/
+static void R_MergeWorldJobs(void)
+{
+	for (int i = 0; i < numWorldJobs; i++)
+	{
+		const worldJob_t &job = worldJobs[i];
+
+		tr.pc.c_leafs += job.c_leafs;
+
+		if (job.c_leafs)
 		{
-			tr.viewParms.visBounds[1][1] = node->maxs[1];
+			AddPointToBounds(job.visBounds[0], tr.viewParms.visBounds[0], tr.viewParms.visBounds[1]);
+			AddPointToBounds(job.visBounds[1], tr.viewParms.visBounds[0], tr.viewParms.visBounds[1]);
 		}
-		if (node->maxs[2] > tr.viewParms.visBounds[1][2])
+
+		for (const worldSurf_t &ws : job.surfs)
 		{
-			tr.viewParms.visBounds[1][2] = node->maxs[2];
-		}
+			msurface_t &surf = *ws.surf;
 
-		// add the individual surfaces
-		msurface_t **mark = node->firstmarksurface;
+			if (surf.viewCount == tr.viewCount)
+			{
+				continue; // already in this view
+			}
 
-		for (int i = 0; i < node->nummarksurfaces; ++i)
-		{
-			// the surface may have already been added if it
-			// spans multiple leafs
-			msurface_t *surf = mark[i];
-			R_AddWorldSurface(*surf, dlightBits);
+			surf.viewCount = tr.viewCount;
+
+			R_AddVisibleWorldSurface(surf, ws.dlightBits);
 		}
 	}
 }
 
+/*
+================
+R_AddWorldSurfacesParallel
+================
+*/
+static void R_AddWorldSurfacesParallel(const unsigned int dlightBits)
+{
+	// aim for a few jobs per thread so uneven subtrees even out
+	const int threads = R_JobWorkers() + 1;
+	int depth = 2;
+
+	while ((1 << depth) < threads * 4 && (1 << depth) < MAX_WORLD_JOBS)
+	{
+		depth++;
+	}
+
+	numWorldJobs = 0;
+	R_CollectWorldJobs(tr.world->nodes, 15, dlightBits, depth);
+
+	R_RunJobs(R_WorldJob, nullptr, numWorldJobs);
+
+	R_MergeWorldJobs();
+}
+
 /*
 ===============
 R_PointInLeaf
@@ -984,7 +1151,14 @@ void R_AddWorldSurfaces(void)
 		tr.refdef.num_dlights = MAX_DLIGHTS;
 	}
 
-	R_RecursiveWorldNode(tr.world->nodes, 15, (1ULL << tr.refdef.num_dlights) - 1);
+	if (R_JobWorkers() > 0)
+	{
+		R_AddWorldSurfacesParallel((1ULL << tr.refdef.num_dlights) - 1);
+	}
+	else
+	{
+		R_RecursiveWorldNode(tr.world->nodes, 15, (1ULL << tr.refdef.num_dlights) - 1, nullptr);
+	}
 
 #ifdef USE_PMLIGHT
 #ifdef USE_LEGACY_DLIGHTS
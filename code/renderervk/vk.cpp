@@ -22,6 +22,7 @@
 #include "vk_render_pass.hpp"
 #include "vk_utils.hpp"
 #include "vk_physical_device.hpp"
+#include "vk_profiler.hpp"
 
 static vk::SampleCountFlagBits vkMaxSamples = vk::SampleCountFlagBits::e1;
 
@@ -411,6 +412,10 @@ static bool vk_wait_staging_buffer()
 	{
 		const uint64_t timeout_ns = 5ull * 1000ull * 1000ull * 1000ull;
 
+		if (vk_inst.device.getFenceStatus(vk_inst.aux_fence) == vk::Result::eNotReady) {
+			vk_inst.stats.staging_stalls++;
+		}
+
 		vk::Result res = vk_inst.device.waitForFences(vk_inst.aux_fence, /*waitAll*/ vk::True, timeout_ns);
 		if (res != vk::Result::eSuccess) {
 			ri.Error(ERR_FATAL, "vkWaitForFences() failed with %s at %s",
@@ -430,6 +435,18 @@ static bool vk_wait_staging_buffer()
 	}
 }
 
+static void vk_rotate_staging_buffer(void)
+{
+	Vk_Instance::staging_slot_s& slot = vk_inst.staging_ring[vk_inst.staging_ring_index];
+
+	std::swap(vk_inst.staging_buffer, slot.buffer);
+	std::swap(vk_inst.staging_command_buffer, slot.command_buffer);
+	std::swap(vk_inst.aux_fence, slot.fence);
+	std::swap(vk_inst.aux_fence_wait, slot.fence_wait);
+
+	vk_inst.staging_ring_index = (vk_inst.staging_ring_index + 1) % std::size(vk_inst.staging_ring);
+}
+
 static void vk_flush_staging_buffer(bool final)
 {
 	if (vk_inst.staging_buffer.offset == 0) {
@@ -473,23 +490,20 @@ static void vk_flush_staging_buffer(bool final)
 		submit_info.signalSemaphoreCount = 1;
 		submit_info.pSignalSemaphores = &vk_inst.image_uploaded2;
 		vk_inst.image_uploaded = vk_inst.image_uploaded2;
-
-		VK_CHECK(vk_inst.queue.submit(submit_info, vk_inst.aux_fence));
-		vk_inst.aux_fence_wait = true;
 	}
-	else
-	{
-		// submit and block until it finishes, then reset fence/cmd buffer
-		VK_CHECK(vk_inst.queue.submit(submit_info, vk_inst.aux_fence));
 
-		vk::Result res = vk_inst.device.waitForFences(vk_inst.aux_fence, vk::True, 5 * 1000000000ULL);
-		if (res != vk::Result::eSuccess) {
-			ri.Error(ERR_FATAL, "vkWaitForFences() failed with %s at %s",
-				vk::to_string(res).data(), __func__);
-		}
+	VK_CHECK(vk_inst.queue.submit(submit_info, vk_inst.aux_fence));
+	vk_inst.aux_fence_wait = true;
+	vk_inst.stats.staging_submits++;
 
-		VK_CHECK(vk_inst.device.resetFences(vk_inst.aux_fence));
-		VK_CHECK(vk_inst.staging_command_buffer.reset(vk::CommandBufferResetFlags{}));
+	// keep filling the next staging buffer while this one is being copied
+	vk_rotate_staging_buffer();
+
+	if (!final)
+	{
+		// caller writes into the current buffer right away, so it must be idle,
+		// this only blocks when the whole ring is still in flight
+		vk_wait_staging_buffer();
 	}
 }
 #endif // USE_UPLOAD_QUEUE
@@ -1259,7 +1273,13 @@ bool vk_alloc_vbo(const byte* vbo_data, const uint32_t vbo_size)
 	// utilize existing staging buffer
 #ifdef USE_UPLOAD_QUEUE
 	vk_flush_staging_buffer(false);
+	vk_wait_staging_buffer();
 #endif
+	// the flush may have rotated in a ring slot that was never used,
+	// and vk_release_resources() frees the current one
+	if (vk_inst.staging_buffer.size == 0) {
+		vk_alloc_staging_buffer(vk_inst.defaults.staging_size);
+	}
 	// utilize existing staging buffer
 	uploadDone = 0;
 	while (uploadDone < vbo_size) {
@@ -1287,6 +1307,7 @@ bool vk_alloc_vbo(const byte* vbo_data, const uint32_t vbo_size)
 #include "../renderervk/shaders/spirv/shader_data.c"
 #include "tr_main.hpp"
 #include "vk_pipeline.hpp"
+#include "vk_pipeline_cache.hpp"
 #include "vk_attachments.hpp"
 #define SHADER_MODULE(name) SHADER_MODULE(name, sizeof(name))
 
@@ -1669,8 +1690,17 @@ static void vk_create_sync_primitives(void)
 	vk_inst.rendering_finished = vk::Semaphore{};
 	vk_inst.image_uploaded = vk::Semaphore{};
 	vk_inst.aux_fence_wait = false;
+	for (i = 0; i < std::size(vk_inst.staging_ring); i++)
+	{
+		VK_CHECK_ASSIGN(vk_inst.staging_ring[i].fence, vk_inst.device.createFence(fence_desc));
+		vk_inst.staging_ring[i].fence_wait = false;
+	}
 #ifdef USE_VK_VALIDATION
 	SET_OBJECT_NAME(VkFence(vk_inst.aux_fence), "aux fence", VK_DEBUG_REPORT_OBJECT_TYPE_FENCE_EXT);
+	for (i = 0; i < std::size(vk_inst.staging_ring); i++)
+	{
+		SET_OBJECT_NAME(VkFence(vk_inst.staging_ring[i].fence), va("aux fence %i", i + 1), VK_DEBUG_REPORT_OBJECT_TYPE_FENCE_EXT);
+	}
 #endif
 #endif
 }
@@ -1696,6 +1726,12 @@ static void vk_destroy_sync_primitives(void)
 
 #ifdef USE_UPLOAD_QUEUE
 	vk_inst.device.destroyFence(vk_inst.aux_fence);
+	vk_inst.aux_fence_wait = false;
+	for (i = 0; i < std::size(vk_inst.staging_ring); i++)
+	{
+		vk_inst.device.destroyFence(vk_inst.staging_ring[i].fence);
+		vk_inst.staging_ring[i].fence_wait = false;
+	}
 	vk_inst.rendering_finished = nullptr;
 	vk_inst.image_uploaded = nullptr;
 #endif
@@ -1788,6 +1824,10 @@ static void vk_restart_swapchain(const char* funcname, vk::Result res)
 
 #ifdef USE_UPLOAD_QUEUE
 	vk_inst.staging_command_buffer.reset();
+	for (i = 0; i < std::size(vk_inst.staging_ring); i++)
+	{
+		vk_inst.staging_ring[i].command_buffer.reset();
+	}
 #endif
 
 	vk_destroy_pipelines(false);
@@ -2024,7 +2064,10 @@ void vk_initialize(void)
 	else
 		glConfig.textureEnvAddAvailable = false;
 
-	glConfig.textureCompression = TC_NONE;
+	if (vk_inst.textureCompressionBC)
+		glConfig.textureCompression = TC_S3TC_ARB;
+	else
+		glConfig.textureCompression = TC_NONE;
 
 	major = VK_VERSION_MAJOR(props.apiVersion);
 	minor = VK_VERSION_MINOR(props.apiVersion);
@@ -2072,6 +2115,11 @@ void vk_initialize(void)
 	//
 	vk_create_sync_primitives();
 
+	//
+	// GPU timestamp queries, r_speeds 8.
+	//
+	vk_create_profiler();
+
 	//
 	// Command pool.
 	//
@@ -2087,6 +2135,11 @@ void vk_initialize(void)
 	{
 		vk::CommandBufferAllocateInfo allocInfo{ vk_inst.command_pool,vk::CommandBufferLevel::ePrimary,1 };
 		VK_CHECK(vk_inst.device.allocateCommandBuffers(&allocInfo, &vk_inst.staging_command_buffer));
+		for (i = 0; i < std::size(vk_inst.staging_ring); i++)
+		{
+			VK_CHECK(vk_inst.device.allocateCommandBuffers(&allocInfo, &vk_inst.staging_ring[i].command_buffer));
+		}
+		vk_inst.staging_ring_index = 0;
 	}
 #endif
 
@@ -2231,11 +2284,8 @@ void vk_initialize(void)
 
 	vk_create_shader_modules();
 
-	{
-		vk::PipelineCacheCreateInfo ci{};
-		// ci.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
-		VK_CHECK_ASSIGN(vk_inst.pipelineCache, vk_inst.device.createPipelineCache(ci));
-	}
+	vk_create_pipeline_cache(props);
+	vk_start_pipeline_worker();
 
 	vk_inst.renderPassIndex = renderPass_t::RENDER_PASS_MAIN; // default render pass
 
@@ -2259,6 +2309,14 @@ void vk_initialize(void)
 	// preallocate staging buffer
 	if (vk_inst.defaults.staging_size == STAGING_BUFFER_SIZE_HI) {
 		vk_alloc_staging_buffer(vk_inst.defaults.staging_size);
+#ifdef USE_UPLOAD_QUEUE
+		// and the ring slots behind it, so a flush never rotates in a smaller one
+		for (i = 0; i < std::size(vk_inst.staging_ring); i++)
+		{
+			vk_rotate_staging_buffer();
+			vk_alloc_staging_buffer(vk_inst.defaults.staging_size);
+		}
+#endif
 	}
 
 
@@ -2382,6 +2440,8 @@ static void reset_vk_instance(Vk_Instance& s) noexcept
 	s.stats.vertex_buffer_max = {};
 	s.stats.push_size = 0;
 	s.stats.push_size_max = 0;
+	s.stats.staging_submits = 0;
+	s.stats.staging_stalls = 0;
 
 	// Shader modules
 	for (auto& a : s.modules.vert.gen)     for (auto& b : a) for (auto& c : b) for (auto& d : c) reset_to_default(d);
@@ -2454,8 +2514,10 @@ static void reset_vk_instance(Vk_Instance& s) noexcept
 	s.active = false;
 	s.wideLines = false;
 	s.samplerAnisotropy = false;
+	s.textureCompressionBC = false;
 	s.fragmentStores = false;
 	s.dedicatedAllocation = false;
+	s.pipelineCreationFeedback = false;
 #ifdef USE_VK_VALIDATION
 	if (debugMarker) {
 		s.debugMarkers = true;
@@ -2473,6 +2535,7 @@ static void reset_vk_instance(Vk_Instance& s) noexcept
 	s.clearAttachment = false;
 	s.fboActive = false;
 	s.blitEnabled = false;
+	s.mipBlitEnabled = false;
 	s.msaaActive = false;
 	s.offscreenRender = false;
 
@@ -2507,6 +2570,8 @@ static void reset_vk_instance(Vk_Instance& s) noexcept
 	s.staging_buffer.ptr = nullptr;
 #ifdef USE_UPLOAD_QUEUE
 	s.staging_buffer.offset = {};
+	for (auto& slot : s.staging_ring) slot = {};
+	s.staging_ring_index = 0;
 #endif
 
 	// samplers wrapper
@@ -2533,16 +2598,13 @@ void vk_shutdown(const refShutdownCode_t code)
 	}
 
 	vk_destroy_framebuffers();
+	vk_stop_pipeline_worker();
 	vk_destroy_pipelines(true); // Reset counter
 	vk_destroy_render_passes();
 	vk_destroy_attachments();
 	vk_destroy_swapchain();
 
-	if (vk_inst.pipelineCache)
-	{
-		vk_inst.device.destroyPipelineCache(vk_inst.pipelineCache);
-		vk_inst.pipelineCache = nullptr;
-	}
+	vk_destroy_pipeline_cache();
 
 	vk_inst.device.destroyCommandPool(vk_inst.command_pool);
 	vk_inst.device.destroyDescriptorPool(vk_inst.descriptor_pool);
@@ -2561,6 +2623,14 @@ void vk_shutdown(const refShutdownCode_t code)
 #endif
 
 	vk_clean_staging_buffer();
+#ifdef USE_UPLOAD_QUEUE
+	// cycle the rest of the ring through the current slot
+	for (i = 0; i < std::size(vk_inst.staging_ring); i++)
+	{
+		vk_rotate_staging_buffer();
+		vk_clean_staging_buffer();
+	}
+#endif
 
 	vk_release_geometry_buffers();
 
@@ -2568,6 +2638,8 @@ void vk_shutdown(const refShutdownCode_t code)
 
 	vk_destroy_sync_primitives();
 
+	vk_destroy_profiler();
+
 	vk_inst.device.destroyBuffer(vk_inst.storage.buffer);
 	vk_inst.device.freeMemory(vk_inst.storage.memory);
 
@@ -2729,6 +2801,7 @@ void vk_release_resources(void)
 	// }
 
 	// Destroy pipelines
+	vk_finish_pipelines(true);
 	for (i = vk_inst.pipelines_world_base; i < vk_inst.pipelines_count; ++i)
 	{
 		for (j = 0; j < RENDER_PASS_COUNT; ++j)
@@ -2805,7 +2878,7 @@ static void record_buffer_memory_barrier(const vk::CommandBuffer& cb, const vk::
 }
 #endif
 
-void vk_create_image(image_t& image, const int width, const int height, const int mip_levels)
+void vk_create_image(image_t& image, const int width, const int height, const int mip_levels, const bool gen_mips)
 {
 	if (image.handle)
 	{
@@ -2820,6 +2893,9 @@ void vk_create_image(image_t& image, const int width, const int height, const in
 	}
 
 	// create image
+	vk::ImageUsageFlags usage = vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled;
+	if (gen_mips)
+		usage |= vk::ImageUsageFlagBits::eTransferSrc;
 
 	vk::ImageCreateInfo desc{ {},
 							 vk::ImageType::e2D,
@@ -2829,7 +2905,7 @@ void vk_create_image(image_t& image, const int width, const int height, const in
 							 1,
 							 vk::SampleCountFlagBits::e1,
 							 vk::ImageTiling::eOptimal,
-							 vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
+							 usage,
 							 vk::SharingMode::eExclusive,
 							 0,
 							 nullptr,
@@ -2946,8 +3022,86 @@ static byte* resample_image_data(vk::Format target_format, byte* data, const int
 	}
 }
 
-void vk_upload_image_data(image_t& image, int x, int y, int width, int height, int mipmaps, byte* pixels, int size, bool update)
+static int compressed_block_bytes(const vk::Format format)
+{
+	switch (format)
+	{
+	case vk::Format::eBc1RgbUnormBlock:
+	case vk::Format::eBc1RgbaUnormBlock:
+		return 8;
+	case vk::Format::eBc3UnormBlock:
+	case vk::Format::eBc7UnormBlock:
+		return 16;
+	default:
+		return 0;
+	}
+}
+
+static void record_mip_level_transition(const vk::CommandBuffer& command_buffer, const vk::Image& image, const uint32_t level,
+	const vk::ImageLayout old_layout, const vk::ImageLayout new_layout,
+	const vk::AccessFlags src_access, const vk::AccessFlags dst_access,
+	const vk::PipelineStageFlags src_stage, const vk::PipelineStageFlags dst_stage)
+{
+	vk::ImageMemoryBarrier barrier{ src_access,
+								   dst_access,
+								   old_layout,
+								   new_layout,
+								   vk::QueueFamilyIgnored,
+								   vk::QueueFamilyIgnored,
+								   image,
+								   {vk::ImageAspectFlagBits::eColor, level, 1, 0, 1},
+								   nullptr };
+
+	command_buffer.pipelineBarrier(src_stage, dst_stage, {}, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+/*
+Fills mip levels 1..mip_levels-1 from level 0 with linear 2:1 blits,
+expects every level in TRANSFER_DST and leaves them in SHADER_READ_ONLY.
+*/
+static void record_mipmap_blits(const vk::CommandBuffer& command_buffer, const vk::Image& image, int width, int height, const int mip_levels)
+{
+	int32_t dst_width, dst_height;
+	uint32_t level;
+
+	for (level = 1; level < (uint32_t)mip_levels; level++)
+	{
+		dst_width = width > 1 ? width >> 1 : 1;
+		dst_height = height > 1 ? height >> 1 : 1;
+
+		record_mip_level_transition(command_buffer, image, level - 1,
+			vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eTransferSrcOptimal,
+			vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eTransferRead,
+			vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer);
+
+		vk::ImageBlit region{ {vk::ImageAspectFlagBits::eColor, level - 1, 0, 1},
+							 {{vk::Offset3D{0, 0, 0}, vk::Offset3D{width, height, 1}}},
+							 {vk::ImageAspectFlagBits::eColor, level, 0, 1},
+							 {{vk::Offset3D{0, 0, 0}, vk::Offset3D{dst_width, dst_height, 1}}} };
+
+		command_buffer.blitImage(image, vk::ImageLayout::eTransferSrcOptimal, image, vk::ImageLayout::eTransferDstOptimal, 1, &region, vk::Filter::eLinear);
+
+		record_mip_level_transition(command_buffer, image, level - 1,
+			vk::ImageLayout::eTransferSrcOptimal, vk::ImageLayout::eShaderReadOnlyOptimal,
+			vk::AccessFlagBits::eTransferRead, vk::AccessFlagBits::eShaderRead,
+			vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader);
+
+		width = dst_width;
+		height = dst_height;
+	}
+
+	record_mip_level_transition(command_buffer, image, mip_levels - 1,
+		vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal,
+		vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead,
+		vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader);
+}
+
+void vk_upload_image_data(image_t& image, int x, int y, int width, int height, int mipmaps, byte* pixels, int size, bool update, bool gen_mips)
 {
+	const int base_width = width;
+	const int base_height = height;
+	const int upload_levels = gen_mips ? 1 : mipmaps;
+	const int block_bytes = compressed_block_bytes(image.internalFormat);
 	vk::CommandBuffer command_buffer;
 	constexpr std::size_t max_regions = 16; // Assuming a maximum of 16 regions
 	std::array<vk::BufferImageCopy, max_regions> regions;
@@ -2977,9 +3131,12 @@ void vk_upload_image_data(image_t& image, int x, int y, int width, int height, i
 		regions[num_regions] = region;
 		num_regions++;
 
-		buffer_size += width * height * n;
+		if (block_bytes)
+			buffer_size += ((width + 3) / 4) * ((height + 3) / 4) * block_bytes;
+		else
+			buffer_size += width * height * n;
 
-		if (num_regions >= (uint32_t)mipmaps || (width == 1 && height == 1) || num_regions >= (uint32_t)max_regions)
+		if (num_regions >= (uint32_t)upload_levels || (width == 1 && height == 1) || num_regions >= (uint32_t)max_regions)
 			break;
 
 		x >>= 1;
@@ -3001,10 +3158,16 @@ void vk_upload_image_data(image_t& image, int x, int y, int width, int height, i
 
 	const vk::DeviceSize bufSize = static_cast<vk::DeviceSize>(buffer_size);
 
-	if (vk_inst.staging_buffer.size - vk_inst.staging_buffer.offset < bufSize) {
+	// block compressed copies need a buffer offset aligned to the block size
+	const vk::DeviceSize bufOffset = block_bytes ? PAD(vk_inst.staging_buffer.offset, 16) : vk_inst.staging_buffer.offset;
+
+	if (vk_inst.staging_buffer.size < bufOffset + bufSize) {
 		// try to flush staging buffer and reset offset
 		vk_flush_staging_buffer(false);
 	}
+	else {
+		vk_inst.staging_buffer.offset = bufOffset;
+	}
 
 	if (vk_inst.staging_buffer.size /* - vk_world.staging_buffer_offset */ < bufSize) {
 		// if still not enough - reallocate staging buffer
@@ -3048,10 +3211,15 @@ void vk_upload_image_data(image_t& image, int x, int y, int width, int height, i
 		regions.data());
 
 	// final transition after upload comleted
-	record_image_layout_transition(command_buffer, image.handle,
-		vk::ImageAspectFlagBits::eColor,
-		vk::ImageLayout::eTransferDstOptimal,
-		vk::ImageLayout::eShaderReadOnlyOptimal);
+	if (gen_mips) {
+		record_mipmap_blits(command_buffer, image.handle, base_width, base_height, mipmaps);
+	}
+	else {
+		record_image_layout_transition(command_buffer, image.handle,
+			vk::ImageAspectFlagBits::eColor,
+			vk::ImageLayout::eTransferDstOptimal,
+			vk::ImageLayout::eShaderReadOnlyOptimal);
+	}
 #else
 	if (vk_inst.staging_buffer.size < buffer_size) {
 		vk_alloc_staging_buffer(buffer_size);
@@ -3083,7 +3251,14 @@ void vk_upload_image_data(image_t& image, int x, int y, int width, int height, i
 		num_regions,
 		regions.data());
 
-	record_image_layout_transition(command_buffer, image.handle, vk::ImageAspectFlagBits::eColor, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal);
+	if (gen_mips)
+	{
+		record_mipmap_blits(command_buffer, image.handle, base_width, base_height, mipmaps);
+	}
+	else
+	{
+		record_image_layout_transition(command_buffer, image.handle, vk::ImageAspectFlagBits::eColor, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal);
+	}
 	end_command_buffer(command_buffer, __func__);
 #endif
 
@@ -3447,6 +3622,7 @@ void vk_bind_index_buffer(const vk::Buffer& buffer, const uint32_t offset)
 void vk_draw_indexed(const uint32_t indexCount, const uint32_t firstIndex)
 {
 	vk_inst.cmd->command_buffer.drawIndexed(indexCount, 1, firstIndex, 0, 0);
+	backEnd.pc.c_draws++;
 }
 #endif
 
@@ -3662,6 +3838,7 @@ void vk_draw_geometry(Vk_Depth_Range depth_range, bool indexed) {
 		VBO_RenderIBOItems();
 	else
 #endif
+	{
 		if (indexed)
 		{
 			vk_inst.cmd->command_buffer.drawIndexed(vk_inst.cmd->num_indexes, 1, 0, 0, 0);
@@ -3670,6 +3847,8 @@ void vk_draw_geometry(Vk_Depth_Range depth_range, bool indexed) {
 		{
 			vk_inst.cmd->command_buffer.draw(tess.numVertexes, 1, 0, 0);
 		}
+		backEnd.pc.c_draws++;
+	}
 }
 
 void vk_draw_dot(uint32_t storage_offset)
@@ -3696,7 +3875,7 @@ void vk_draw_dot(uint32_t storage_offset)
 
 static bool vk_find_screenmap_drawsurfs(void)
 {
-	const void* curCmd = &backEndData->commands.cmds;
+	const void* curCmd = backEnd.cmds;
 	const drawBufferCommand_t* db_cmd;
 	const drawSurfsCommand_t* ds_cmd;
 
@@ -3791,6 +3970,8 @@ void vk_begin_frame(void)
 
 	VK_CHECK(vk_inst.cmd->command_buffer.begin(begin_info));
 
+	vk_profiler_begin_frame();
+
 	// Ensure visibility of geometry buffers writes.
 	// record_buffer_memory_barrier( vk_inst.cmd->command_buffer, vk_inst.cmd->vertex_buffer, vk_inst.cmd->geometry_buffer_size, VK_PIPELINE_STAGE_HOST_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_HOST_WRITE_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT );
 
@@ -3919,6 +4100,8 @@ void vk_end_frame(void)
 			vk_bloom();
 		}
 
+		vk_profiler_begin(gpuZone_t::GPU_ZONE_POST);
+
 		if (backEnd.screenshotMask && vk_inst.capture.image)
 		{
 			vk_end_render_pass();
@@ -3953,6 +4136,9 @@ void vk_end_frame(void)
 
 	vk_end_render_pass();
 
+	// closes GPU_ZONE_POST as well
+	vk_profiler_end_frame();
+
 	VK_CHECK(vk_inst.cmd->command_buffer.end());
 
 	vk::SubmitInfo submit_info{ 0,
@@ -4020,7 +4206,7 @@ void vk_end_frame(void)
 	vk_inst.cmd->waitForFence = true;
 
 	// presentation may take undefined time to complete, we can't measure it in a reliable way
-	backEnd.pc.msec = ri.Milliseconds() - backEnd.pc.msec;
+	backEnd.pc.usec = ri.Microseconds() - backEnd.pc.usec;
 
 	vk_inst.renderPassIndex = renderPass_t::RENDER_PASS_MAIN;
 	// vk_present_frame();
@@ -4372,6 +4558,8 @@ bool vk_bloom(void)
 		return false;
 	}
 
+	vk_profiler_begin(gpuZone_t::GPU_ZONE_BLOOM);
+
 	vk_end_render_pass(); // end main
 
 	// bloom extraction
@@ -4456,5 +4644,7 @@ bool vk_bloom(void)
 
 	backEnd.doneBloom = true;
 
+	vk_profiler_end(gpuZone_t::GPU_ZONE_BLOOM);
+
 	return true;
 }
@@ -44,8 +44,9 @@ void vk_queue_wait_idle( void );
 //
 // Resources allocation.
 //
-void vk_create_image(image_t &image, const int width, const int height, const int mip_levels);
-void vk_upload_image_data(image_t &image, int x, int y, int width, int height, int miplevels, byte *pixels, int size, bool update);
+void vk_create_image(image_t &image, const int width, const int height, const int mip_levels, const bool gen_mips = false);
+// with gen_mips only level 0 is read from pixels, the other miplevels are blitted from it
+void vk_upload_image_data(image_t &image, int x, int y, int width, int height, int miplevels, byte *pixels, int size, bool update, bool gen_mips = false);
 void vk_destroy_image_resources(vk::Image &image, vk::ImageView &imageView);
 void vk_destroy_samplers( void );
 
@@ -0,0 +1,594 @@
+#include "tr_local.hpp"
+#include "vk.hpp"
+#include "utils.hpp"
+#include "tr_image.hpp"
+#include "vk_descriptors.hpp"
+#include "vk_pipeline.hpp"
+#include "vk_pipeline_cache.hpp"
+#include "vk_profiler.hpp"
+#include "vk_render_pass.hpp"
+
+// Device layer of the null renderer (make BUILD_RENDERER_NULL=1).
+// It replaces vk.cpp and the other vk_*.cpp files that talk to the driver,
+// so the front end, tess building and the surface code run unchanged on
+// a machine without a GPU or a display. Every call only records what it
+// would have submitted; vertex, index and uniform data is still copied into
+// a host buffer so that the back end costs what it does with a real device.
+
+#ifdef USE_NULL_RENDERER
+
+constexpr vk::DeviceSize NULL_GEOMETRY_SIZE = 4 * 1024 * 1024; // grows on overflow like the real one
+constexpr uint32_t NULL_UNIFORM_ALIGNMENT = 256;			   // the most common minUniformBufferOffsetAlignment
+
+// recorded calls of one command list, taken over by R_GPUProfilerSnapshot()
+// and printed by r_speeds 8
+typedef struct
+{
+	int draws;
+	int indexes;
+	int pipelineBinds;
+	int descriptorUpdates;
+	int pushConstants;
+	int renderPasses;
+	uint64_t geometryBytes;
+	uint64_t uploadBytes;
+} nullCounters_t;
+
+static nullCounters_t counters, shown;
+
+static void vk_alloc_geometry_buffers(const vk::DeviceSize size)
+{
+	int i;
+
+	for (i = 0; i < NUM_COMMAND_BUFFERS; i++)
+	{
+		std::free(vk_inst.tess[i].vertex_buffer_ptr);
+		vk_inst.tess[i].vertex_buffer_ptr = static_cast<byte *>(std::malloc(size));
+		if (!vk_inst.tess[i].vertex_buffer_ptr)
+		{
+			ri.Error(ERR_FATAL, "%s: out of memory", __func__);
+		}
+		vk_inst.tess[i].vertex_buffer_offset = 0;
+	}
+
+	vk_inst.geometry_buffer_size = size;
+}
+
+/*
+================
+vk_initialize
+
+Fills in the limits the front end reads, glConfig comes from InitOpenGL
+================
+*/
+void vk_initialize(void)
+{
+	vk_inst.cmd = vk_inst.tess + 0;
+	vk_inst.cmd_index = 0;
+	vk_inst.uniform_alignment = NULL_UNIFORM_ALIGNMENT;
+	vk_inst.uniform_item_size = pad_up(sizeof(vkUniform_t), vk_inst.uniform_alignment);
+	vk_inst.storage_alignment = NULL_UNIFORM_ALIGNMENT;
+
+	vk_inst.fboActive = false;
+	vk_inst.msaaActive = false;
+	vk_inst.offscreenRender = false;
+	vk_inst.renderPassIndex = renderPass_t::RENDER_PASS_MAIN;
+
+	vk_inst.defaults.geometry_size = NULL_GEOMETRY_SIZE;
+	vk_alloc_geometry_buffers(vk_inst.defaults.geometry_size);
+
+	// flare visibility feedback, nothing is ever written so no flare passes the test
+	vk_inst.storage.buffer_ptr = static_cast<byte *>(std::calloc(MAX_FLARES, vk_inst.storage_alignment));
+
+	glConfig.maxTextureSize = MAX_TEXTURE_SIZE;
+	glConfig.numTextureUnits = MAX_TEXTURE_UNITS;
+	glConfig.textureEnvAddAvailable = r_ext_texture_env_add->integer != 0;
+	glConfig.textureCompression = TC_NONE;
+	Q_strncpyz(glConfig.vendor_string, "none", sizeof(glConfig.vendor_string));
+	Q_strncpyz(glConfig.renderer_string, "null renderer", sizeof(glConfig.renderer_string));
+	Q_strncpyz(glConfig.version_string, "API: none", sizeof(glConfig.version_string));
+
+	vk_inst.maxLod = 1 + Q_log2(glConfig.maxTextureSize);
+	vk_inst.maxBoundDescriptorSets = VK_DESC_COUNT;
+
+	vk_inst.samplers.filter_min = -1;
+	vk_inst.samplers.filter_max = -1;
+	TextureMode(r_textureMode->string);
+	r_textureMode->modified = false;
+
+	counters = {};
+
+	vk_inst.active = true;
+}
+
+void vk_init_descriptors(void)
+{
+}
+
+/*
+================
+vk_shutdown
+================
+*/
+void vk_shutdown(const refShutdownCode_t code)
+{
+	int i;
+
+	for (i = 0; i < NUM_COMMAND_BUFFERS; i++)
+	{
+		std::free(vk_inst.tess[i].vertex_buffer_ptr);
+	}
+	std::free(vk_inst.storage.buffer_ptr);
+
+	vk_inst = Vk_Instance{};
+	vk_world = Vk_World{};
+}
+
+/*
+================
+vk_release_resources
+
+Level change, pipelines above the persistent base are dropped like in vk.cpp
+================
+*/
+void vk_release_resources(void)
+{
+	uint32_t i;
+
+	for (i = vk_inst.pipelines_world_base; i < vk_inst.pipelines_count; ++i)
+	{
+		vk_inst.pipelines[i] = {};
+	}
+	vk_inst.pipelines_count = vk_inst.pipelines_world_base;
+
+	vk_world = Vk_World{};
+
+	for (i = 0; i < NUM_COMMAND_BUFFERS; ++i)
+	{
+		vk_inst.tess[i].uniform_read_offset = 0;
+		vk_inst.tess[i].vertex_buffer_offset = 0;
+	}
+
+	vk_inst.stats = {};
+}
+
+void vk_wait_idle(void)
+{
+}
+
+void vk_queue_wait_idle(void)
+{
+}
+
+/*
+==============================================================================
+
+Images
+
+==============================================================================
+*/
+
+void vk_create_image(image_t &image, const int width, const int height, const int mip_levels, const bool gen_mips)
+{
+	image.uploadWidth = width;
+	image.uploadHeight = height;
+}
+
+void vk_upload_image_data(image_t &image, int x, int y, int width, int height, int miplevels, byte *pixels, int size, bool update, bool gen_mips)
+{
+	counters.uploadBytes += size;
+}
+
+void vk_destroy_image_resources(vk::Image &image, vk::ImageView &imageView)
+{
+	image = nullptr;
+	imageView = nullptr;
+}
+
+void vk_destroy_samplers(void)
+{
+	vk_inst.samplers.count = 0;
+}
+
+void vk_read_pixels(byte *buffer, const uint32_t width, const uint32_t height)
+{
+	Com_Memset(buffer, 0, width * height * 4);
+}
+
+/*
+==============================================================================
+
+Descriptors and pipelines
+
+==============================================================================
+*/
+
+void vk_reset_descriptor(int idx)
+{
+}
+
+void vk_update_descriptor(int idx, const vk::DescriptorSet &descriptor)
+{
+	counters.descriptorUpdates++;
+}
+
+void vk_update_descriptor_offset(int idx, uint32_t offset)
+{
+}
+
+void vk_update_descriptor_set(const image_t &image, bool mipmap)
+{
+}
+
+void vk_update_attachment_descriptors(void)
+{
+}
+
+/*
+================
+vk_find_pipeline_ext
+
+Definitions are still deduplicated so shader setup sees the same indexes
+================
+*/
+uint32_t vk_find_pipeline_ext(const uint32_t base, const Vk_Pipeline_Def &def, bool use)
+{
+	uint32_t index;
+
+	for (index = base; index < vk_inst.pipelines_count; index++)
+	{
+		if (memcmp(&vk_inst.pipelines[index].def, &def, sizeof(def)) == 0)
+		{
+			return index;
+		}
+	}
+
+	if (vk_inst.pipelines_count >= MAX_VK_PIPELINES)
+	{
+		ri.Error(ERR_DROP, "alloc_pipeline: MAX_VK_PIPELINES reached");
+	}
+
+	vk_inst.pipelines[vk_inst.pipelines_count].def = def;
+
+	return vk_inst.pipelines_count++;
+}
+
+void vk_get_pipeline_def(const uint32_t pipeline, Vk_Pipeline_Def &def)
+{
+	if (pipeline >= vk_inst.pipelines_count)
+		def = {};
+	else
+		def = vk_inst.pipelines[pipeline].def;
+}
+
+void vk_create_pipelines(void)
+{
+	// persistent pipelines all map to index 0
+	vk_inst.pipelines_world_base = vk_inst.pipelines_count;
+}
+
+void vk_update_post_process_pipelines(void)
+{
+}
+
+void vk_bind_pipeline(const uint32_t pipeline)
+{
+	counters.pipelineBinds++;
+}
+
+bool vk_queue_pipeline(const uint32_t index)
+{
+	return true;
+}
+
+void vk_finish_pipelines(bool cancel)
+{
+}
+
+void vk_pipeline_cache_info(void)
+{
+	ri.Printf(PRINT_ALL, "pipeline cache: none (null renderer)\n");
+}
+
+/*
+==============================================================================
+
+Frames and render passes
+
+==============================================================================
+*/
+
+void vk_begin_frame(void)
+{
+	if (vk_inst.frame_count++)
+		return;
+
+	vk_inst.cmd = &vk_inst.tess[vk_inst.cmd_index];
+
+	if (vk_inst.cmd->vertex_buffer_offset > vk_inst.stats.vertex_buffer_max)
+	{
+		vk_inst.stats.vertex_buffer_max = vk_inst.cmd->vertex_buffer_offset;
+	}
+
+	if (vk_inst.stats.push_size > vk_inst.stats.push_size_max)
+	{
+		vk_inst.stats.push_size_max = vk_inst.stats.push_size;
+	}
+
+	backEnd.screenMapDone = false;
+
+	vk_begin_main_render_pass();
+
+	vk_inst.cmd->uniform_read_offset = 0;
+	vk_inst.cmd->vertex_buffer_offset = 0;
+	Com_Memset(vk_inst.cmd->buf_offset, 0, sizeof(vk_inst.cmd->buf_offset));
+	Com_Memset(vk_inst.cmd->vbo_offset, 0, sizeof(vk_inst.cmd->vbo_offset));
+	vk_inst.cmd->curr_index_buffer = nullptr;
+	vk_inst.cmd->curr_index_offset = 0;
+	vk_inst.cmd->num_indexes = 0;
+	vk_inst.cmd->depth_range = Vk_Depth_Range::DEPTH_RANGE_COUNT;
+
+	vk_inst.stats.push_size = 0;
+}
+
+void vk_end_frame(void)
+{
+	if (vk_inst.frame_count == 0)
+		return;
+
+	vk_inst.frame_count = 0;
+
+	if (vk_inst.geometry_buffer_size_new)
+	{
+		vk_alloc_geometry_buffers(vk_inst.geometry_buffer_size_new);
+		vk_inst.geometry_buffer_size_new = 0;
+		ri.Printf(PRINT_DEVELOPER, "...geometry buffer resized to %iK\n", (int)(vk_inst.geometry_buffer_size / 1024));
+		return;
+	}
+
+	backEnd.pc.usec = ri.Microseconds() - backEnd.pc.usec;
+
+	vk_inst.renderPassIndex = renderPass_t::RENDER_PASS_MAIN;
+}
+
+void vk_present_frame(void)
+{
+	vk_inst.cmd_index++;
+	vk_inst.cmd_index %= NUM_COMMAND_BUFFERS;
+	vk_inst.cmd = &vk_inst.tess[vk_inst.cmd_index];
+}
+
+void vk_begin_main_render_pass(void)
+{
+	vk_inst.renderPassIndex = renderPass_t::RENDER_PASS_MAIN;
+	counters.renderPasses++;
+}
+
+void vk_end_render_pass(void)
+{
+}
+
+void vk_clear_color(const vec4_t &color)
+{
+}
+
+void vk_clear_depth(const bool clear_stencil)
+{
+}
+
+bool vk_bloom(void)
+{
+	return false;
+}
+
+/*
+==============================================================================
+
+Geometry, same host-side layout as vk.cpp
+
+==============================================================================
+*/
+
+static void vk_bind_attr(const int index, const unsigned int item_size, const void *src)
+{
+	const vk::DeviceSize offset = pad_up_ct<vk::DeviceSize, 32>(vk_inst.cmd->vertex_buffer_offset);
+	const uint32_t size = tess.numVertexes * item_size;
+
+	if (offset + size > vk_inst.geometry_buffer_size)
+	{
+		vk_inst.geometry_buffer_size_new = log2pad_plus(offset + size, 1);
+	}
+	else
+	{
+		vk_inst.cmd->buf_offset[index] = offset;
+		Com_Memcpy(vk_inst.cmd->vertex_buffer_ptr + offset, src, size);
+		vk_inst.cmd->vertex_buffer_offset = offset + size;
+		counters.geometryBytes += size;
+	}
+}
+
+uint32_t vk_tess_index(const uint32_t numIndexes, const void *src)
+{
+	const uint32_t offset = vk_inst.cmd->vertex_buffer_offset;
+	const uint32_t size = numIndexes * sizeof(tess.indexes[0]);
+
+	if (offset + size > vk_inst.geometry_buffer_size)
+	{
+		vk_inst.geometry_buffer_size_new = log2pad_plus(offset + size, 1);
+		return ~0U;
+	}
+
+	Com_Memcpy(vk_inst.cmd->vertex_buffer_ptr + offset, src, size);
+	vk_inst.cmd->vertex_buffer_offset = (vk::DeviceSize)offset + size;
+	counters.geometryBytes += size;
+
+	return offset;
+}
+
+void vk_bind_index_buffer(const vk::Buffer &buffer, const uint32_t offset)
+{
+	vk_inst.cmd->curr_index_buffer = buffer;
+	vk_inst.cmd->curr_index_offset = offset;
+}
+
+void vk_bind_index(void)
+{
+#ifdef USE_VBO
+	if (tess.vboIndex)
+	{
+		vk_inst.cmd->num_indexes = 0;
+		return;
+	}
+#endif
+
+	vk_bind_index_ext(tess.numIndexes, tess.indexes);
+}
+
+void vk_bind_index_ext(const int numIndexes, const uint32_t *indexes)
+{
+	const uint32_t offset = vk_tess_index(numIndexes, indexes);
+
+	if (offset != ~0U)
+	{
+		vk_bind_index_buffer(vk_inst.cmd->vertex_buffer, offset);
+		vk_inst.cmd->num_indexes = numIndexes;
+	}
+	else
+	{
+		vk_inst.cmd->num_indexes = 0;
+	}
+}
+
+void vk_bind_geometry(const uint32_t flags)
+{
+#ifdef USE_VBO
+	if (tess.vboIndex)
+		return;
+#endif
+
+	if (flags & TESS_XYZ)
+		vk_bind_attr(0, sizeof(tess.xyz[0]), &tess.xyz[0]);
+
+	if (flags & TESS_RGBA0)
+		vk_bind_attr(1, sizeof(color4ub_t), tess.svars.colors[0][0].rgba);
+
+	if (flags & TESS_ST0)
+		vk_bind_attr(2, sizeof(vec2_t), tess.svars.texcoordPtr[0]);
+
+	if (flags & TESS_ST1)
+		vk_bind_attr(3, sizeof(vec2_t), tess.svars.texcoordPtr[1]);
+
+	if (flags & TESS_ST2)
+		vk_bind_attr(4, sizeof(vec2_t), tess.svars.texcoordPtr[2]);
+
+	if (flags & TESS_NNN)
+		vk_bind_attr(5, sizeof(tess.normal[0]), tess.normal);
+
+	if (flags & TESS_RGBA1)
+		vk_bind_attr(6, sizeof(color4ub_t), tess.svars.colors[1][0].rgba);
+
+	if (flags & TESS_RGBA2)
+		vk_bind_attr(7, sizeof(color4ub_t), tess.svars.colors[2][0].rgba);
+}
+
+void vk_bind_lighting(const int stage, const int bundle)
+{
+#ifdef USE_VBO
+	if (tess.vboIndex)
+		return;
+#endif
+
+	vk_bind_attr(0, sizeof(tess.xyz[0]), &tess.xyz[0]);
+	vk_bind_attr(1, sizeof(vec2_t), tess.svars.texcoordPtr[bundle]);
+	vk_bind_attr(2, sizeof(tess.normal[0]), tess.normal);
+}
+
+void vk_update_mvp(const float *m)
+{
+	counters.pushConstants++;
+	vk_inst.stats.push_size += 16 * sizeof(float);
+}
+
+void vk_draw_geometry(const Vk_Depth_Range depth_range, const bool indexed)
+{
+	if (vk_inst.geometry_buffer_size_new)
+		return;
+
+	vk_inst.cmd->depth_range = depth_range;
+
+#ifdef USE_VBO
+	if (tess.vboIndex)
+	{
+		VBO_RenderIBOItems();
+		return;
+	}
+#endif
+
+	counters.draws++;
+	counters.indexes += indexed ? vk_inst.cmd->num_indexes : tess.numVertexes;
+	backEnd.pc.c_draws++;
+}
+
+#ifdef USE_VBO
+void vk_draw_indexed(const uint32_t indexCount, const uint32_t firstIndex)
+{
+	counters.draws++;
+	counters.indexes += indexCount;
+	backEnd.pc.c_draws++;
+}
+
+bool vk_alloc_vbo(const byte *vbo_data, const uint32_t vbo_size)
+{
+	counters.uploadBytes += vbo_size;
+	return true;
+}
+#endif
+
+void vk_draw_dot(uint32_t storage_offset)
+{
+	if (vk_inst.geometry_buffer_size_new)
+		return;
+
+	counters.draws++;
+}
+
+/*
+==============================================================================
+
+Profiler entry points, r_speeds 8 shows the recorded calls instead of GPU time
+
+==============================================================================
+*/
+
+void vk_profiler_begin(gpuZone_t zone)
+{
+}
+
+void vk_profiler_end(gpuZone_t zone)
+{
+}
+
+void R_GPUProfilerSnapshot(void)
+{
+	shown = counters;
+	counters = {};
+}
+
+void R_GPUProfilerPrint(void)
+{
+	ri.Printf(PRINT_ALL, "null: %i draws %i indexes %i pipelines %i descriptors %i mvp %i passes %iKB geometry %iKB uploads\n",
+			  shown.draws, shown.indexes, shown.pipelineBinds, shown.descriptorUpdates,
+			  shown.pushConstants, shown.renderPasses,
+			  static_cast<int>(shown.geometryBytes / 1024), static_cast<int>(shown.uploadBytes / 1024));
+}
+
+void R_GPUProfilerFlushLog(void)
+{
+	if (r_gpuProfileLog->integer > 0)
+	{
+		ri.Printf(PRINT_WARNING, "r_gpuProfileLog: no GPU timestamps in the null renderer\n");
+		ri.Cvar_Set("r_gpuProfileLog", "0");
+	}
+}
+
+#endif // USE_NULL_RENDERER
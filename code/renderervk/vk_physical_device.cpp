@@ -189,6 +189,10 @@ static void setup_surface_formats(Vk_Instance& vk_inst, const vk::PhysicalDevice
 	vk_inst.blitEnabled = vk_blit_enabled(physical_device, vk_inst.color_format, vk_inst.capture_format);
 	if (!vk_inst.blitEnabled)
 		vk_inst.capture_format = vk_inst.color_format;
+
+	// r_gpuMipMaps downsamples RGBA8 textures with linear blits between their own mip levels
+	const vk::FormatFeatureFlags mipFeatures = vk::FormatFeatureFlagBits::eBlitSrc | vk::FormatFeatureFlagBits::eBlitDst | vk::FormatFeatureFlagBits::eSampledImageFilterLinear;
+	vk_inst.mipBlitEnabled = (physical_device.getFormatProperties(vk::Format::eR8G8B8A8Unorm).optimalTilingFeatures & mipFeatures) == mipFeatures;
 }
 
 static bool find_graphics_present_queue(
@@ -227,6 +231,7 @@ static bool create_logical_device(
 
 	bool dedicatedAllocation = false;
 	bool memoryRequirements2 = false;
+	bool creationFeedback = false;
 
 #ifdef USE_VK_VALIDATION
 	bool debugMarker = false;
@@ -281,6 +286,10 @@ static bool create_logical_device(
 		{
 			swapchainSupported = true;
 		}
+		else if (ext == vk::EXTPipelineCreationFeedbackExtensionName)
+		{
+			creationFeedback = true;
+		}
 #ifdef USE_VK_VALIDATION
 		else if (ext == vk::EXTDebugUtilsExtensionName)
 		{
@@ -320,6 +329,12 @@ static bool create_logical_device(
 
 	device_extension_list.push_back(vk::KHRSwapchainExtensionName);
 
+	if (creationFeedback)
+	{
+		device_extension_list.push_back(vk::EXTPipelineCreationFeedbackExtensionName);
+		vk_inst.pipelineCreationFeedback = true;
+	}
+
 #ifdef USE_VK_VALIDATION
 	if (debugMarker)
 	{
@@ -371,6 +386,12 @@ static bool create_logical_device(
 		vk_inst.samplerAnisotropy = true;
 	}
 
+	if (r_ext_compressed_textures->integer && device_features.textureCompressionBC)
+	{
+		features.textureCompressionBC = vk::True;
+		vk_inst.textureCompressionBC = true;
+	}
+
 	vk::DeviceCreateInfo device_desc{
 		{},
 		1, &queue_desc,
@@ -1,4 +1,5 @@
 #include "vk_pipeline.hpp"
+#include "vk_pipeline_cache.hpp"
 #include "utils.hpp"
 
 void vk_alloc_persistent_pipelines()
@@ -291,7 +292,32 @@ inline constexpr std::array<vk::SpecializationMapEntry, 11> kFragSpecEntries = {
 	{10, offsetof(FragSpec, acff),             sizeof(int)   },
 } };
 
-static void GetCullModeByFaceCulling(const Vk_Pipeline_Def& def, vk::CullModeFlags& cullMode)
+/*
+Raises a pipeline creation error, or only records the first one when there
+is a status: the background compiler must not longjmp out of its thread
+*/
+static void vk_pipeline_error(pipelineStatus_t *status, const errorParm_t code, const char *fmt, ...)
+{
+	va_list argptr;
+	char msg[MAX_STRING_CHARS];
+
+	va_start(argptr, fmt);
+	Q_vsnprintf(msg, sizeof(msg), fmt, argptr);
+	va_end(argptr);
+
+	if (!status)
+	{
+		ri.Error(code, "%s", msg);
+	}
+	else if (!status->failed)
+	{
+		status->failed = true;
+		status->errorCode = code;
+		Q_strncpyz(status->error, msg, sizeof(status->error));
+	}
+}
+
+static void GetCullModeByFaceCulling(const Vk_Pipeline_Def& def, vk::CullModeFlags& cullMode, pipelineStatus_t *status)
 {
 	switch (def.face_culling)
 	{
@@ -305,15 +331,16 @@ static void GetCullModeByFaceCulling(const Vk_Pipeline_Def& def, vk::CullModeFla
 		cullMode = (def.mirror ? vk::CullModeFlagBits::eBack : vk::CullModeFlagBits::eFront);
 		break;
 	default:
-		ri.Error(ERR_DROP, "create_pipeline: invalid face culling mode %i\n", static_cast<int>(def.face_culling));
+		vk_pipeline_error(status, ERR_DROP, "create_pipeline: invalid face culling mode %i\n", static_cast<int>(def.face_culling));
 		break;
 	}
 }
 
-static vk::VertexInputBindingDescription bindingsCpp[8];
-static vk::VertexInputAttributeDescription attribsCpp[8];
-static uint32_t num_binds;
-static uint32_t num_attrs;
+// per thread, pipelines are also built by the background compiler
+static thread_local vk::VertexInputBindingDescription bindingsCpp[8];
+static thread_local vk::VertexInputAttributeDescription attribsCpp[8];
+static thread_local uint32_t num_binds;
+static thread_local uint32_t num_attrs;
 
 static void push_bind(const uint32_t binding, const uint32_t stride)
 {
@@ -348,7 +375,7 @@ inline static vk::PrimitiveTopology GetTopologyByPrimitivies(Vk_Primitive_Topolo
 	}
 }
 
-static vk::PipelineColorBlendAttachmentState createBlendAttachmentState(const uint32_t state_bits, const Vk_Pipeline_Def& def)
+static vk::PipelineColorBlendAttachmentState createBlendAttachmentState(const uint32_t state_bits, const Vk_Pipeline_Def& def, pipelineStatus_t *status)
 {
 	// Determine whether blending is enabled
 	bool blendEnable = (state_bits & (GLS_SRCBLEND_BITS | GLS_DSTBLEND_BITS)) ? vk::True : vk::False;
@@ -392,7 +419,7 @@ static vk::PipelineColorBlendAttachmentState createBlendAttachmentState(const ui
 			srcColorBlendFactor = vk::BlendFactor::eSrcAlphaSaturate;
 			break;
 		default:
-			ri.Error(ERR_DROP, "create_pipeline: invalid src blend state bits\n");
+			vk_pipeline_error(status, ERR_DROP, "create_pipeline: invalid src blend state bits\n");
 			break;
 		}
 
@@ -423,7 +450,7 @@ static vk::PipelineColorBlendAttachmentState createBlendAttachmentState(const ui
 			dstColorBlendFactor = vk::BlendFactor::eOneMinusDstAlpha;
 			break;
 		default:
-			ri.Error(ERR_DROP, "create_pipeline: invalid dst blend state bits\n");
+			vk_pipeline_error(status, ERR_DROP, "create_pipeline: invalid dst blend state bits\n");
 			break;
 		}
 	}
@@ -443,7 +470,7 @@ static vk::PipelineColorBlendAttachmentState createBlendAttachmentState(const ui
 	return attachmentBlendState;
 }
 
-vk::Pipeline create_pipeline(const Vk_Pipeline_Def& def, const renderPass_t renderPassIndex, uint32_t def_index)
+vk::Pipeline create_pipeline(const Vk_Pipeline_Def& def, const renderPass_t renderPassIndex, uint32_t def_index, pipelineStatus_t *status)
 {
 	vk::ShaderModule* vs_module = nullptr;
 	vk::ShaderModule* fs_module = nullptr;
@@ -458,6 +485,13 @@ vk::Pipeline create_pipeline(const Vk_Pipeline_Def& def, const renderPass_t rend
 	unsigned int atest_bits;
 	unsigned int state_bits = def.state_bits;
 
+	if (status)
+	{
+		status->failed = false;
+		status->error[0] = '\0';
+		status->cacheHit = -1;
+	}
+
 	switch (def.shader_type)
 	{
 
@@ -632,7 +666,7 @@ vk::Pipeline create_pipeline(const Vk_Pipeline_Def& def, const renderPass_t rend
 		break;
 
 	default:
-		ri.Error(ERR_DROP, "create_pipeline_plus: unknown shader type %i\n", static_cast<int>(def.shader_type));
+		vk_pipeline_error(status, ERR_DROP, "create_pipeline_plus: unknown shader type %i\n", static_cast<int>(def.shader_type));
 		return nullptr;
 	}
 
@@ -1084,8 +1118,8 @@ vk::Pipeline create_pipeline(const Vk_Pipeline_Def& def, const renderPass_t rend
 		break;
 
 	default:
-		ri.Error(ERR_DROP, "%s: invalid shader type - %i", __func__, static_cast<int>(def.shader_type));
-		break;
+		vk_pipeline_error(status, ERR_DROP, "%s: invalid shader type - %i", __func__, static_cast<int>(def.shader_type));
+		return nullptr;
 	}
 
 	vk::PipelineVertexInputStateCreateInfo vertex_input_state{ {},
@@ -1129,7 +1163,7 @@ vk::Pipeline create_pipeline(const Vk_Pipeline_Def& def, const renderPass_t rend
 																 def.line_width ? (float)def.line_width : 1.0f,
 																 nullptr };
 
-	GetCullModeByFaceCulling(def, rasterization_state.cullMode);
+	GetCullModeByFaceCulling(def, rasterization_state.cullMode, status);
 
 	// depth bias state
 	if (def.polygon_offset)
@@ -1204,7 +1238,12 @@ vk::Pipeline create_pipeline(const Vk_Pipeline_Def& def, const renderPass_t rend
 		depth_stencil_state.back = depth_stencil_state.front;
 	}
 
-	vk::PipelineColorBlendAttachmentState attachment_blend_state = createBlendAttachmentState(state_bits, def);
+	vk::PipelineColorBlendAttachmentState attachment_blend_state = createBlendAttachmentState(state_bits, def, status);
+
+	if (status && status->failed)
+	{
+		return nullptr;
+	}
 
 	if (attachment_blend_state.blendEnable)
 	{
@@ -1254,6 +1293,16 @@ vk::Pipeline create_pipeline(const Vk_Pipeline_Def& def, const renderPass_t rend
 											   -1,
 											   nullptr };
 
+	// ask the driver whether the pipeline came out of vk_inst.pipelineCache
+	vk::PipelineCreationFeedback feedback{};
+	std::array<vk::PipelineCreationFeedback, 2> stage_feedback{};
+	vk::PipelineCreationFeedbackCreateInfo feedback_info{ &feedback, static_cast<uint32_t>(stage_feedback.size()), stage_feedback.data(), nullptr };
+
+	if (status && vk_inst.pipelineCreationFeedback)
+	{
+		create_info.pNext = &feedback_info;
+	}
+
 	vk::Pipeline resultPipeline;
 
 #ifdef USE_VK_VALIDATION
@@ -1264,25 +1313,42 @@ vk::Pipeline create_pipeline(const Vk_Pipeline_Def& def, const renderPass_t rend
 
 		if (static_cast<int>(createGraphicsPipelineResult.result) < 0)
 		{
-			ri.Error(ERR_FATAL, "Vulkan: %s returned %s", "create_pipeline -> createGraphicsPipeline", vk::to_string(createGraphicsPipelineResult.result).data());
+			vk_pipeline_error(status, ERR_FATAL, "Vulkan: %s returned %s", "create_pipeline -> createGraphicsPipeline", vk::to_string(createGraphicsPipelineResult.result).data());
+			return nullptr;
 		}
 		else
 		{
+			char name[64];
+
 			resultPipeline = createGraphicsPipelineResult.value;
-			SET_OBJECT_NAME(VkPipeline(resultPipeline), va("pipeline def#%i, pass#%i", def_index, static_cast<int>(renderPassIndex)), VK_DEBUG_REPORT_OBJECT_TYPE_PIPELINE_EXT);
+			// va() is not thread safe
+			Com_sprintf(name, sizeof(name), "pipeline def#%i, pass#%i", def_index, static_cast<int>(renderPassIndex));
+			SET_OBJECT_NAME(VkPipeline(resultPipeline), name, VK_DEBUG_REPORT_OBJECT_TYPE_PIPELINE_EXT);
 			SET_OBJECT_NAME(VkPipeline(resultPipeline), "create_pipeline -> createGraphicsPipeline", VK_DEBUG_REPORT_OBJECT_TYPE_PIPELINE_EXT);
 		}
 	}
 	catch (vk::SystemError& err)
 	{
-		ri.Error(ERR_FATAL, "Vulkan error in function: %s, what: %s", "create_pipeline -> createGraphicsPipeline", err.what());
+		vk_pipeline_error(status, ERR_FATAL, "Vulkan error in function: %s, what: %s", "create_pipeline -> createGraphicsPipeline", err.what());
+		return nullptr;
 	}
 
 #else
-	VK_CHECK_ASSIGN(resultPipeline, vk_inst.device.createGraphicsPipeline(vk_inst.pipelineCache, create_info));
+	auto createGraphicsPipelineResult = vk_inst.device.createGraphicsPipeline(vk_inst.pipelineCache, create_info);
+
+	if (static_cast<int>(createGraphicsPipelineResult.result) < 0)
+	{
+		vk_pipeline_error(status, ERR_FATAL, "Vulkan: %s returned %s", "vk_inst.device.createGraphicsPipeline(vk_inst.pipelineCache, create_info)", vk::to_string(createGraphicsPipelineResult.result).data());
+		return nullptr;
+	}
+	resultPipeline = createGraphicsPipelineResult.value;
 
 #endif
-	vk_inst.pipeline_create_count++;
+	if (create_info.pNext && (feedback.flags & vk::PipelineCreationFeedbackFlagBits::eValid))
+	{
+		status->cacheHit = (feedback.flags & vk::PipelineCreationFeedbackFlagBits::eApplicationPipelineCacheHit) ? 1 : 0;
+	}
+
 	return resultPipeline;
 }
 
@@ -1293,7 +1359,7 @@ vk::Pipeline vk_gen_pipeline(const uint32_t index)
 		VK_Pipeline_t* pipeline = vk_inst.pipelines + index;
 		const uint8_t pass = static_cast<uint8_t>(vk_inst.renderPassIndex);
 		if (!pipeline->handle[pass])
-			pipeline->handle[pass] = create_pipeline(pipeline->def, vk_inst.renderPassIndex, index);
+			pipeline->handle[pass] = vk_build_pipeline(index);
 		return pipeline->handle[pass];
 	}
 	else
@@ -1803,6 +1869,8 @@ void vk_destroy_pipelines(bool resetCounter)
 {
 	uint32_t i, j;
 
+	vk_finish_pipelines(true);
+
 	// Destroy all pipelines in the vk_inst.pipelines array
 	for (i = 0; i < vk_inst.pipelines_count; ++i)
 	{
@@ -1914,7 +1982,7 @@ uint32_t vk_find_pipeline_ext(const uint32_t base, const Vk_Pipeline_Def& def, b
 	index = vk_alloc_pipeline(def);
 found:
 
-	if (use)
+	if (use && !vk_queue_pipeline(index))
 		vk_gen_pipeline(index);
 
 	return index;
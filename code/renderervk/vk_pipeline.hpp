@@ -6,7 +6,18 @@
 void vk_alloc_persistent_pipelines();
 uint32_t vk_find_pipeline_ext(const uint32_t base, const Vk_Pipeline_Def& def, bool use);
 vk::Pipeline vk_gen_pipeline(const uint32_t index);
-vk::Pipeline create_pipeline(const Vk_Pipeline_Def& def, const renderPass_t renderPassIndex, uint32_t def_index);
+// how create_pipeline() went, for callers that must not raise errors themselves
+typedef struct
+{
+	bool failed; // no pipeline was created
+	errorParm_t errorCode;
+	char error[MAX_STRING_CHARS];
+	int cacheHit; // 1 or 0 from creation feedback, -1 when the driver didn't say
+} pipelineStatus_t;
+
+// with a status, failures are reported there instead of through ri.Error
+// so the background compiler can hand them over to the main thread
+vk::Pipeline create_pipeline(const Vk_Pipeline_Def& def, const renderPass_t renderPassIndex, uint32_t def_index, pipelineStatus_t *status = nullptr);
 void vk_bind_pipeline(const uint32_t pipeline);
 
 void vk_create_blur_pipeline(const uint32_t index, const uint32_t width, const uint32_t height, const bool horizontal_pass);
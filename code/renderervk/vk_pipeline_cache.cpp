@@ -0,0 +1,532 @@
+#include "vk_pipeline_cache.hpp"
+#include "vk_pipeline.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#define PIPELINE_CACHE_FILE "vkpipelines.cache"
+#define PIPELINE_CACHE_MAGIC 0x43504b56 // "VKPC"
+#define PIPELINE_CACHE_VERSION 1
+// without creation feedback, builds faster than this are counted as cache hits
+#define PIPELINE_CACHE_HIT_USEC 500
+
+// everything up to dataSize has to match for the blob to be reused
+typedef struct
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t vendorID;
+	uint32_t deviceID;
+	uint32_t driverVersion;
+	uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+	char build[48];
+	uint32_t dataSize;
+	uint32_t dataHash;
+} pipelineCacheHeader_t;
+
+enum pipelineState_t : uint8_t
+{
+	PIPELINE_IDLE,
+	PIPELINE_QUEUED,
+	PIPELINE_BUILDING,
+	PIPELINE_DONE
+};
+
+using pipelineClock = std::chrono::steady_clock;
+
+static struct
+{
+	pipelineCacheHeader_t header;
+	int loadedBytes;
+	int built; // pipelines created through the cache since it was loaded
+} cache;
+
+static struct
+{
+	std::thread thread;
+	std::mutex lock;
+	std::condition_variable wake;
+	std::condition_variable done;
+
+	// published under lock
+	std::deque<uint32_t> queue;
+	pipelineState_t state[MAX_VK_PIPELINES];
+	vk::Pipeline result[MAX_VK_PIPELINES]; // null for a failed build
+	pipelineStatus_t failure;			   // first failed build, raised on the main thread for any of them
+	bool building;
+	bool quit;
+} worker;
+
+static struct
+{
+	int background; // built by the worker
+	int backgroundUsec;
+	int ready;	// background builds that were finished before their first use
+	int waited; // first use had to wait for the worker
+	int onDemand; // built by the thread that needed them
+	int onDemandUsec;
+	int cacheHits; // found in vk_inst.pipelineCache
+	int cacheMisses;
+	int cacheGuessed; // hits and misses told apart by build time
+} pc;
+
+static int vk_elapsed_usec(const pipelineClock::time_point start)
+{
+	return static_cast<int>(std::chrono::duration_cast<std::chrono::microseconds>(pipelineClock::now() - start).count());
+}
+
+// called with worker.lock held when the worker is running
+static void vk_count_cache_lookup(const pipelineStatus_t &status, const int usec)
+{
+	int hit = status.cacheHit;
+
+	if (hit < 0)
+	{
+		hit = usec < PIPELINE_CACHE_HIT_USEC;
+		pc.cacheGuessed++;
+	}
+
+	if (hit)
+		pc.cacheHits++;
+	else
+		pc.cacheMisses++;
+}
+
+static uint32_t vk_hash_data(const uint8_t *data, const size_t size)
+{
+	uint32_t hash = 2166136261u; // FNV-1a
+
+	for (size_t i = 0; i < size; i++)
+	{
+		hash = (hash ^ data[i]) * 16777619u;
+	}
+
+	return hash;
+}
+
+/*
+===============
+vk_create_pipeline_cache
+===============
+*/
+void vk_create_pipeline_cache(const vk::PhysicalDeviceProperties &props)
+{
+	vk::PipelineCacheCreateInfo ci{};
+	void *buffer = nullptr;
+
+	Com_Memset(&cache, 0, sizeof(cache));
+	Com_Memset(&pc, 0, sizeof(pc));
+
+	cache.header.magic = PIPELINE_CACHE_MAGIC;
+	cache.header.version = PIPELINE_CACHE_VERSION;
+	cache.header.vendorID = props.vendorID;
+	cache.header.deviceID = props.deviceID;
+	cache.header.driverVersion = props.driverVersion;
+	Com_Memcpy(cache.header.pipelineCacheUUID, props.pipelineCacheUUID.data(), VK_UUID_SIZE);
+	// embedded shaders and pipeline layouts change with every rebuild
+	Q_strncpyz(cache.header.build, Q3_VERSION " " __DATE__ " " __TIME__, sizeof(cache.header.build));
+
+	if (r_pipelineCache->integer)
+	{
+		const int len = ri.FS_ReadFile(PIPELINE_CACHE_FILE, &buffer);
+
+		if (buffer)
+		{
+			const pipelineCacheHeader_t *hdr = static_cast<const pipelineCacheHeader_t *>(buffer);
+			const uint8_t *data = static_cast<const uint8_t *>(buffer) + sizeof(*hdr);
+
+			if (len < static_cast<int>(sizeof(*hdr)) || memcmp(hdr, &cache.header, offsetof(pipelineCacheHeader_t, dataSize)) != 0)
+			{
+				ri.Printf(PRINT_ALL, "...discarding %s from a different driver or build\n", PIPELINE_CACHE_FILE);
+			}
+			else if (hdr->dataSize != static_cast<size_t>(len) - sizeof(*hdr) || hdr->dataHash != vk_hash_data(data, hdr->dataSize))
+			{
+				ri.Printf(PRINT_WARNING, "...discarding corrupted %s\n", PIPELINE_CACHE_FILE);
+			}
+			else
+			{
+				ci.initialDataSize = hdr->dataSize;
+				ci.pInitialData = data;
+				cache.loadedBytes = static_cast<int>(hdr->dataSize);
+				ri.Printf(PRINT_ALL, "...loaded %i bytes of pipeline cache\n", cache.loadedBytes);
+			}
+		}
+	}
+
+	VK_CHECK_ASSIGN(vk_inst.pipelineCache, vk_inst.device.createPipelineCache(ci));
+
+	if (buffer)
+	{
+		ri.FS_FreeFile(buffer);
+	}
+}
+
+/*
+===============
+vk_destroy_pipeline_cache
+===============
+*/
+void vk_destroy_pipeline_cache(void)
+{
+	if (!vk_inst.pipelineCache)
+	{
+		return;
+	}
+
+	// rewrite the file only when new pipelines went through the cache
+	if (r_pipelineCache->integer && cache.built > 0)
+	{
+		std::vector<uint8_t> data;
+		std::vector<uint8_t> file;
+		pipelineCacheHeader_t hdr = cache.header;
+
+		VK_CHECK_ASSIGN(data, vk_inst.device.getPipelineCacheData(vk_inst.pipelineCache));
+
+		if (!data.empty())
+		{
+			hdr.dataSize = static_cast<uint32_t>(data.size());
+			hdr.dataHash = vk_hash_data(data.data(), data.size());
+
+			file.resize(sizeof(hdr) + data.size());
+			Com_Memcpy(file.data(), &hdr, sizeof(hdr));
+			Com_Memcpy(file.data() + sizeof(hdr), data.data(), data.size());
+
+			ri.FS_WriteFile(PIPELINE_CACHE_FILE, file.data(), static_cast<int>(file.size()));
+			ri.Printf(PRINT_ALL, "...saved %i bytes of pipeline cache\n", static_cast<int>(data.size()));
+		}
+	}
+
+	vk_inst.device.destroyPipelineCache(vk_inst.pipelineCache);
+	vk_inst.pipelineCache = nullptr;
+}
+
+static void vk_pipeline_worker(void)
+{
+	for (;;)
+	{
+		uint32_t index;
+		Vk_Pipeline_Def def;
+
+		{
+			std::unique_lock<std::mutex> lk(worker.lock);
+			worker.wake.wait(lk, []
+							 { return worker.quit || !worker.queue.empty(); });
+			if (worker.queue.empty())
+			{
+				return;
+			}
+			index = worker.queue.front();
+			worker.queue.pop_front();
+			if (worker.state[index] != PIPELINE_QUEUED)
+			{
+				// taken over by vk_build_pipeline() in the meantime
+				if (worker.queue.empty())
+				{
+					worker.done.notify_all();
+				}
+				continue;
+			}
+			worker.state[index] = PIPELINE_BUILDING;
+			worker.building = true;
+			// slots are only rewritten after vk_finish_pipelines()
+			def = vk_inst.pipelines[index].def;
+		}
+
+		pipelineStatus_t status;
+		const pipelineClock::time_point start = pipelineClock::now();
+		const vk::Pipeline handle = create_pipeline(def, renderPass_t::RENDER_PASS_MAIN, index, &status);
+		const int usec = vk_elapsed_usec(start);
+
+		{
+			std::lock_guard<std::mutex> lk(worker.lock);
+			worker.result[index] = handle;
+			worker.state[index] = PIPELINE_DONE;
+			worker.building = false;
+			if (status.failed)
+			{
+				if (!worker.failure.failed)
+				{
+					worker.failure = status;
+				}
+			}
+			else
+			{
+				pc.background++;
+				pc.backgroundUsec += usec;
+				vk_count_cache_lookup(status, usec);
+			}
+		}
+		worker.done.notify_all();
+	}
+}
+
+/*
+===============
+vk_start_pipeline_worker
+===============
+*/
+void vk_start_pipeline_worker(void)
+{
+	vk_stop_pipeline_worker();
+
+	if (!r_pipelineThread->integer)
+	{
+		return;
+	}
+
+	worker.queue.clear();
+	std::fill(std::begin(worker.state), std::end(worker.state), PIPELINE_IDLE);
+	worker.failure.failed = false;
+	worker.building = false;
+	worker.quit = false;
+
+	worker.thread = std::thread(vk_pipeline_worker);
+
+	ri.Printf(PRINT_ALL, "...compiling pipelines in background\n");
+}
+
+/*
+===============
+vk_stop_pipeline_worker
+===============
+*/
+void vk_stop_pipeline_worker(void)
+{
+	if (!worker.thread.joinable())
+	{
+		return;
+	}
+
+	vk_finish_pipelines(true);
+
+	{
+		std::lock_guard<std::mutex> lk(worker.lock);
+		worker.quit = true;
+	}
+	worker.wake.notify_one();
+
+	worker.thread.join();
+}
+
+/*
+===============
+vk_queue_pipeline
+===============
+*/
+bool vk_queue_pipeline(const uint32_t index)
+{
+	if (!worker.thread.joinable())
+	{
+		return false;
+	}
+
+	if (index >= vk_inst.pipelines_count || vk_inst.pipelines[index].handle[static_cast<int>(renderPass_t::RENDER_PASS_MAIN)])
+	{
+		return true;
+	}
+
+	{
+		std::lock_guard<std::mutex> lk(worker.lock);
+		if (worker.state[index] != PIPELINE_IDLE)
+		{
+			return true;
+		}
+		worker.state[index] = PIPELINE_QUEUED;
+		worker.queue.push_back(index);
+	}
+	worker.wake.notify_one();
+
+	return true;
+}
+
+/*
+===============
+vk_raise_pipeline_failure
+
+Raises an error the worker ran into, worker.lock must not be held
+===============
+*/
+static void vk_raise_pipeline_failure(const pipelineStatus_t &failure)
+{
+	ri.Error(failure.errorCode, "%s", failure.error);
+}
+
+/*
+===============
+vk_build_pipeline
+===============
+*/
+vk::Pipeline vk_build_pipeline(const uint32_t index)
+{
+	const renderPass_t pass = vk_inst.renderPassIndex;
+
+	if (pass == renderPass_t::RENDER_PASS_MAIN && worker.thread.joinable())
+	{
+		std::unique_lock<std::mutex> lk(worker.lock);
+		bool waited = false;
+
+		switch (worker.state[index])
+		{
+		case PIPELINE_QUEUED:
+			// not started yet, cheaper to build it here than to wait for the queue
+			worker.state[index] = PIPELINE_IDLE;
+			break;
+
+		case PIPELINE_BUILDING:
+			pc.waited++;
+			waited = true;
+			worker.done.wait(lk, [index]
+							 { return worker.state[index] != PIPELINE_BUILDING; });
+			[[fallthrough]];
+
+		case PIPELINE_DONE:
+			if (worker.state[index] == PIPELINE_DONE)
+			{
+				const vk::Pipeline handle = worker.result[index];
+				worker.result[index] = nullptr;
+				worker.state[index] = PIPELINE_IDLE;
+				if (!handle)
+				{
+					const pipelineStatus_t failure = worker.failure;
+					lk.unlock();
+					vk_raise_pipeline_failure(failure);
+				}
+				if (!waited)
+				{
+					pc.ready++;
+				}
+				vk_inst.pipeline_create_count++;
+				cache.built++;
+				return handle;
+			}
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	pipelineStatus_t status;
+	const pipelineClock::time_point start = pipelineClock::now();
+	const vk::Pipeline handle = create_pipeline(vk_inst.pipelines[index].def, pass, index, &status);
+	const int usec = vk_elapsed_usec(start);
+
+	if (status.failed)
+	{
+		vk_raise_pipeline_failure(status);
+	}
+
+	{
+		// the worker updates the same counters
+		std::lock_guard<std::mutex> lk(worker.lock);
+		pc.onDemand++;
+		pc.onDemandUsec += usec;
+		vk_count_cache_lookup(status, usec);
+	}
+
+	vk_inst.pipeline_create_count++;
+	cache.built++;
+
+	return handle;
+}
+
+/*
+===============
+vk_finish_pipelines
+===============
+*/
+void vk_finish_pipelines(bool cancel)
+{
+	const int pass = static_cast<int>(renderPass_t::RENDER_PASS_MAIN);
+	pipelineStatus_t failure;
+	bool failed = false;
+	uint32_t i;
+
+	if (!worker.thread.joinable())
+	{
+		return;
+	}
+
+	std::unique_lock<std::mutex> lk(worker.lock);
+
+	if (cancel)
+	{
+		for (const uint32_t index : worker.queue)
+		{
+			if (worker.state[index] == PIPELINE_QUEUED)
+			{
+				worker.state[index] = PIPELINE_IDLE;
+			}
+		}
+		worker.queue.clear();
+	}
+
+	worker.done.wait(lk, []
+					 { return worker.queue.empty() && !worker.building; });
+
+	for (i = 0; i < MAX_VK_PIPELINES; i++)
+	{
+		if (worker.state[i] != PIPELINE_DONE)
+		{
+			continue;
+		}
+
+		if (!worker.result[i])
+		{
+			failed = true; // raised below
+		}
+		else if (i < vk_inst.pipelines_count && !vk_inst.pipelines[i].handle[pass])
+		{
+			vk_inst.pipelines[i].handle[pass] = worker.result[i];
+			vk_inst.pipeline_create_count++;
+			cache.built++;
+			pc.ready++;
+		}
+		else
+		{
+			vk_inst.device.destroyPipeline(worker.result[i]);
+		}
+
+		worker.result[i] = nullptr;
+		worker.state[i] = PIPELINE_IDLE;
+	}
+
+	failure = worker.failure;
+	lk.unlock();
+
+	if (failed)
+	{
+		// cancelling is part of restarts and shutdowns, don't start another error from there
+		if (cancel)
+			ri.Printf(PRINT_WARNING, "%s\n", failure.error);
+		else
+			vk_raise_pipeline_failure(failure);
+	}
+}
+
+/*
+===============
+vk_pipeline_cache_info
+===============
+*/
+void vk_pipeline_cache_info(void)
+{
+	const int background = pc.background ? pc.backgroundUsec / pc.background : 0;
+	const int onDemand = pc.onDemand ? pc.onDemandUsec / pc.onDemand : 0;
+
+	ri.Printf(PRINT_ALL, "pipeline cache: %i bytes loaded, %i pipelines added\n", cache.loadedBytes, cache.built);
+	ri.Printf(PRINT_ALL, "pipelines built in background: %i, %i msec total, %i usec avg\n", pc.background, pc.backgroundUsec / 1000, background);
+	ri.Printf(PRINT_ALL, "pipelines built on demand: %i, %i msec total, %i usec avg\n", pc.onDemand, pc.onDemandUsec / 1000, onDemand);
+	ri.Printf(PRINT_ALL, "background pipelines ready before first use: %i, waited for: %i\n", pc.ready, pc.waited);
+	if (pc.cacheGuessed)
+		ri.Printf(PRINT_ALL, "pipeline cache hits: %i, misses: %i (%i guessed from a build time under %i usec, no creation feedback)\n",
+				  pc.cacheHits, pc.cacheMisses, pc.cacheGuessed, PIPELINE_CACHE_HIT_USEC);
+	else
+		ri.Printf(PRINT_ALL, "pipeline cache hits: %i, misses: %i\n", pc.cacheHits, pc.cacheMisses);
+}
@@ -0,0 +1,36 @@
+#ifndef VK_PIPELINE_CACHE_HPP
+#define VK_PIPELINE_CACHE_HPP
+
+#include "tr_local.hpp"
+
+// Persistent VkPipelineCache (r_pipelineCache) and background pipeline
+// compilation (r_pipelineThread).
+// The worker only builds RENDER_PASS_MAIN handles into its own result slots,
+// they are moved into vk_inst.pipelines on the thread that owns the pipeline
+// array: by vk_build_pipeline() on first use or by vk_finish_pipelines().
+
+// creates vk_inst.pipelineCache, seeded from disk when the saved blob matches this device, driver and build
+void vk_create_pipeline_cache(const vk::PhysicalDeviceProperties &props);
+
+// writes the cache back to disk if it learned something new, then destroys it
+void vk_destroy_pipeline_cache(void);
+
+void vk_start_pipeline_worker(void);
+void vk_stop_pipeline_worker(void);
+
+// schedules a background build of the main pass handle,
+// returns false when there is no worker and the caller has to build it itself
+bool vk_queue_pipeline(const uint32_t index);
+
+// returns the handle for the current render pass: takes over a finished
+// background build (waiting for it if it is in progress) or compiles it right away
+vk::Pipeline vk_build_pipeline(const uint32_t index);
+
+// waits for the worker and moves all finished handles into vk_inst.pipelines,
+// with cancel == true pipelines that were not started yet are dropped instead;
+// a build the worker failed is raised here or by vk_build_pipeline(), not on the worker
+void vk_finish_pipelines(bool cancel);
+
+void vk_pipeline_cache_info(void);
+
+#endif // VK_PIPELINE_CACHE_HPP
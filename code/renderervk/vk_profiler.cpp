@@ -0,0 +1,385 @@
+#include "vk_profiler.hpp"
+
+#include <atomic>
+#include <string>
+
+// two timestamps per zone entry
+constexpr uint32_t MAX_GPU_QUERIES = 1024;
+constexpr uint32_t MAX_GPU_SPANS = MAX_GPU_QUERIES / 2;
+constexpr int NUM_GPU_ZONES = static_cast<int>(gpuZone_t::GPU_ZONE_COUNT);
+
+constexpr const char *GPU_PROFILE_LOG = "gpuprofile.csv";
+
+static constexpr const char *zoneNames[NUM_GPU_ZONES] = {
+	"frame", "view", "portal", "dlights", "fog", "flares", "bloom", "post"};
+
+typedef struct
+{
+	uint64_t frame; // increments with each frame read back
+	double msec[NUM_GPU_ZONES];
+	int count[NUM_GPU_ZONES];
+	int dropped; // zone entries that did not fit in the query pool
+} gpuTimings_t;
+
+typedef struct
+{
+	gpuZone_t zone;
+	uint32_t query; // begin, end is query + 1
+} gpuSpan_t;
+
+static struct
+{
+	bool supported;
+	double msecPerTick;
+	uint64_t tickMask;
+
+	vk::QueryPool pool[NUM_COMMAND_BUFFERS];
+	gpuSpan_t spans[NUM_COMMAND_BUFFERS][MAX_GPU_SPANS];
+	uint32_t numSpans[NUM_COMMAND_BUFFERS];
+	int dropped[NUM_COMMAND_BUFFERS];
+	bool submitted[NUM_COMMAND_BUFFERS]; // spans are valid once the command buffer has been ended
+
+	// state of the command buffer being recorded
+	bool recording;
+	int slot;
+	int open[NUM_GPU_ZONES]; // span of the zone entered last, -1 when closed
+
+	gpuTimings_t timings; // written by the back end
+	gpuTimings_t shown;	  // front end copy for r_speeds 8
+
+	// r_gpuProfileLog, rows are collected on the back end and written by the front end
+	std::string log;
+	int logFrames;
+	std::atomic<bool> logDone;
+} prof;
+
+/*
+================
+vk_create_profiler
+================
+*/
+void vk_create_profiler(void)
+{
+	const auto queue_families = vk_inst.physical_device.getQueueFamilyProperties();
+	const vk::PhysicalDeviceProperties props = vk_inst.physical_device.getProperties();
+	uint32_t validBits;
+	int i;
+
+	prof.supported = false;
+	prof.recording = false;
+
+	validBits = queue_families[vk_inst.queue_family_index].timestampValidBits;
+	if (validBits == 0 || props.limits.timestampPeriod <= 0.0f)
+	{
+		ri.Printf(PRINT_DEVELOPER, "...GPU timestamps are not supported on this queue\n");
+		return;
+	}
+
+	prof.tickMask = (validBits >= 64) ? ~0ULL : ((1ULL << validBits) - 1);
+	prof.msecPerTick = props.limits.timestampPeriod / 1000000.0;
+
+	for (i = 0; i < NUM_COMMAND_BUFFERS; i++)
+	{
+		vk::QueryPoolCreateInfo desc{ {}, vk::QueryType::eTimestamp, MAX_GPU_QUERIES, {} };
+
+		VK_CHECK_ASSIGN(prof.pool[i], vk_inst.device.createQueryPool(desc));
+#ifdef USE_VK_VALIDATION
+		SET_OBJECT_NAME(VkQueryPool(prof.pool[i]), va("timestamp query pool %i", i), VK_DEBUG_REPORT_OBJECT_TYPE_QUERY_POOL_EXT);
+#endif
+		prof.numSpans[i] = 0;
+		prof.submitted[i] = false;
+	}
+
+	prof.supported = true;
+}
+
+/*
+================
+vk_destroy_profiler
+================
+*/
+void vk_destroy_profiler(void)
+{
+	int i;
+
+	for (i = 0; i < NUM_COMMAND_BUFFERS; i++)
+	{
+		if (prof.pool[i])
+		{
+			vk_inst.device.destroyQueryPool(prof.pool[i]);
+			prof.pool[i] = nullptr;
+		}
+		prof.numSpans[i] = 0;
+		prof.submitted[i] = false;
+	}
+
+	prof.supported = false;
+	prof.recording = false;
+}
+
+static bool vk_profiler_enabled(void)
+{
+	return prof.supported && (r_speeds->integer == 8 || r_gpuProfileLog->integer > 0);
+}
+
+/*
+================
+vk_profiler_log_frame
+
+Back end, appends the frame just read back to the CSV buffer
+================
+*/
+static void vk_profiler_log_frame(void)
+{
+	char row[256];
+	int i, n;
+
+	if (prof.logDone.load(std::memory_order_acquire))
+		return;
+
+	if (r_gpuProfileLog->integer <= 0)
+	{
+		// capture cancelled, start over next time
+		prof.log.clear();
+		return;
+	}
+
+	if (prof.log.empty())
+	{
+		prof.log = "frame";
+		for (i = 0; i < NUM_GPU_ZONES; i++)
+		{
+			prof.log += ',';
+			prof.log += zoneNames[i];
+		}
+		prof.log += ",dropped\n";
+		prof.logFrames = 0;
+	}
+
+	n = Com_sprintf(row, sizeof(row), "%llu", (unsigned long long)prof.timings.frame);
+	for (i = 0; i < NUM_GPU_ZONES; i++)
+	{
+		n += Com_sprintf(row + n, sizeof(row) - n, ",%.4f", prof.timings.msec[i]);
+	}
+	Com_sprintf(row + n, sizeof(row) - n, ",%i\n", prof.timings.dropped);
+	prof.log += row;
+
+	if (++prof.logFrames >= r_gpuProfileLog->integer)
+	{
+		prof.logDone.store(true, std::memory_order_release);
+	}
+}
+
+/*
+================
+vk_profiler_collect
+
+Reads back the last frame recorded into this slot, its fence has been waited for
+================
+*/
+static void vk_profiler_collect(const int slot)
+{
+	uint64_t ticks[MAX_GPU_QUERIES];
+	const uint32_t numQueries = prof.numSpans[slot] * 2;
+	gpuTimings_t t{};
+	uint32_t i;
+
+	const vk::Result res = vk_inst.device.getQueryPoolResults(prof.pool[slot], 0, numQueries, numQueries * sizeof(uint64_t), ticks, sizeof(uint64_t), vk::QueryResultFlagBits::e64);
+	if (res != vk::Result::eSuccess)
+		return; // not executed, i.e. dropped on device loss
+
+	for (i = 0; i < prof.numSpans[slot]; i++)
+	{
+		const gpuSpan_t &span = prof.spans[slot][i];
+		const uint64_t delta = (ticks[span.query + 1] - ticks[span.query]) & prof.tickMask;
+
+		t.msec[static_cast<int>(span.zone)] += delta * prof.msecPerTick;
+		t.count[static_cast<int>(span.zone)]++;
+	}
+
+	t.dropped = prof.dropped[slot];
+	t.frame = prof.timings.frame + 1;
+	prof.timings = t;
+
+	vk_profiler_log_frame();
+}
+
+/*
+================
+vk_profiler_begin_frame
+
+Called once vk_inst.cmd has started recording, outside of any render pass
+================
+*/
+void vk_profiler_begin_frame(void)
+{
+	const int slot = static_cast<int>(vk_inst.cmd - vk_inst.tess);
+	int i;
+
+	prof.recording = false;
+
+	if (!prof.supported)
+		return;
+
+	if (prof.submitted[slot] && prof.numSpans[slot])
+	{
+		vk_profiler_collect(slot);
+	}
+
+	prof.submitted[slot] = false;
+	prof.numSpans[slot] = 0;
+	prof.dropped[slot] = 0;
+
+	if (!vk_profiler_enabled())
+		return;
+
+	vk_inst.cmd->command_buffer.resetQueryPool(prof.pool[slot], 0, MAX_GPU_QUERIES);
+
+	for (i = 0; i < NUM_GPU_ZONES; i++)
+	{
+		prof.open[i] = -1;
+	}
+
+	prof.slot = slot;
+	prof.recording = true;
+
+	vk_profiler_begin(gpuZone_t::GPU_ZONE_FRAME);
+}
+
+/*
+================
+vk_profiler_end_frame
+
+Called right before the command buffer is ended and submitted
+================
+*/
+void vk_profiler_end_frame(void)
+{
+	int i;
+
+	if (!prof.recording)
+		return;
+
+	// a zone left open would keep the whole pool from becoming available
+	for (i = NUM_GPU_ZONES - 1; i >= 0; i--)
+	{
+		vk_profiler_end(static_cast<gpuZone_t>(i));
+	}
+
+	prof.submitted[prof.slot] = true;
+	prof.recording = false;
+}
+
+/*
+================
+vk_profiler_begin
+================
+*/
+void vk_profiler_begin(gpuZone_t zone)
+{
+	const int z = static_cast<int>(zone);
+	uint32_t n;
+
+	if (!prof.recording || prof.open[z] >= 0)
+		return;
+
+	n = prof.numSpans[prof.slot];
+	if (n >= MAX_GPU_SPANS)
+	{
+		prof.dropped[prof.slot]++;
+		return;
+	}
+
+	prof.spans[prof.slot][n].zone = zone;
+	prof.spans[prof.slot][n].query = n * 2;
+	prof.numSpans[prof.slot] = n + 1;
+	prof.open[z] = n;
+
+	vk_inst.cmd->command_buffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, prof.pool[prof.slot], n * 2);
+}
+
+/*
+================
+vk_profiler_end
+================
+*/
+void vk_profiler_end(gpuZone_t zone)
+{
+	const int z = static_cast<int>(zone);
+
+	if (!prof.recording || prof.open[z] < 0)
+		return;
+
+	vk_inst.cmd->command_buffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, prof.pool[prof.slot], prof.spans[prof.slot][prof.open[z]].query + 1);
+
+	prof.open[z] = -1;
+}
+
+/*
+================
+R_GPUProfilerSnapshot
+================
+*/
+void R_GPUProfilerSnapshot(void)
+{
+	prof.shown = prof.timings;
+}
+
+/*
+================
+R_GPUProfilerPrint
+
+r_speeds 8, zones entered more than once show the count in braces
+================
+*/
+void R_GPUProfilerPrint(void)
+{
+	const gpuTimings_t &t = prof.shown;
+	char line[512];
+	int i, n;
+
+	if (!prof.supported)
+	{
+		ri.Printf(PRINT_ALL, "GPU timestamps are not supported\n");
+		return;
+	}
+
+	n = 0;
+	for (i = 0; i < NUM_GPU_ZONES; i++)
+	{
+		if (t.count[i] > 1)
+			n += Com_sprintf(line + n, sizeof(line) - n, "%s %.2f (%i) ", zoneNames[i], t.msec[i], t.count[i]);
+		else
+			n += Com_sprintf(line + n, sizeof(line) - n, "%s %.2f ", zoneNames[i], t.msec[i]);
+	}
+	if (t.dropped)
+	{
+		Com_sprintf(line + n, sizeof(line) - n, "dropped %i ", t.dropped);
+	}
+
+	ri.Printf(PRINT_ALL, "gpu msec: %s\n", line);
+}
+
+/*
+================
+R_GPUProfilerFlushLog
+
+Front end, writes out a finished r_gpuProfileLog capture
+================
+*/
+void R_GPUProfilerFlushLog(void)
+{
+	if (prof.logDone.load(std::memory_order_acquire))
+	{
+		ri.FS_WriteFile(GPU_PROFILE_LOG, prof.log.data(), static_cast<int>(prof.log.size()));
+		ri.Printf(PRINT_ALL, "Wrote %i frames of GPU timings to %s\n", prof.logFrames, GPU_PROFILE_LOG);
+		ri.Cvar_Set("r_gpuProfileLog", "0");
+		prof.log.clear();
+		prof.logDone.store(false, std::memory_order_release);
+	}
+	else if (r_gpuProfileLog->integer > 0 && !prof.supported)
+	{
+		ri.Printf(PRINT_WARNING, "r_gpuProfileLog: GPU timestamps are not supported\n");
+		ri.Cvar_Set("r_gpuProfileLog", "0");
+	}
+}
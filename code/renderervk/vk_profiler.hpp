@@ -0,0 +1,40 @@
+#ifndef VK_PROFILER_HPP
+#define VK_PROFILER_HPP
+
+#include "tr_local.hpp"
+
+// GPU timestamp queries around the main parts of a frame.
+// Every command buffer has its own query pool, results are read back when
+// vk_begin_frame() has waited for that command buffer again, so they are
+// one frame late. Zones may be entered several times per frame (portal
+// views, fog and dlight batches), their time is summed. Inner zones are
+// included in outer ones: dlights, fog and flares count towards the view.
+
+enum class gpuZone_t : uint8_t
+{
+	GPU_ZONE_FRAME,
+	GPU_ZONE_VIEW,	  // RB_DrawSurfs() without a portal
+	GPU_ZONE_PORTAL,  // RB_DrawSurfs() for portals and mirrors
+	GPU_ZONE_DLIGHTS,
+	GPU_ZONE_FOG,
+	GPU_ZONE_FLARES,
+	GPU_ZONE_BLOOM,
+	GPU_ZONE_POST,	  // capture and gamma passes
+	GPU_ZONE_COUNT
+};
+
+void vk_create_profiler(void);
+void vk_destroy_profiler(void);
+
+void vk_profiler_begin_frame(void);
+void vk_profiler_end_frame(void);
+void vk_profiler_begin(gpuZone_t zone);
+void vk_profiler_end(gpuZone_t zone);
+
+// front end, takes over the timings of the last finished frame while the
+// back end is idle, see R_SubmitRenderCommands()
+void R_GPUProfilerSnapshot(void);
+void R_GPUProfilerPrint(void);
+void R_GPUProfilerFlushLog(void);
+
+#endif // VK_PROFILER_HPP
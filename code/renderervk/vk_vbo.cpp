@@ -25,6 +25,8 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include "tr_shade.hpp"
 #include "tr_surface.hpp"
 
+#include <bit>
+
 #ifdef USE_VBO
 
 constexpr int MAX_VBO_STAGES = MAX_SHADER_STAGES;
@@ -67,8 +69,10 @@ typedef struct vbo_s
 	vbo_item_t *items;
 	int items_count;
 
-	int *items_queue;
+	uint64_t *items_queue; // one bit per queued item
 	int items_queue_count;
+	int items_queue_min;
+	int items_queue_max;
 
 } vbo_t;
 
@@ -87,8 +91,10 @@ Every static surface gets unique item index which will be added to queue
 instead of tesselation like for regular surfaces. Using items queue also
 eleminates run-time tesselation limits.
 
-When it is time to render - we sort queued items to get longest possible
+When it is time to render - we scan queued items in ascending order to get longest possible
 index sequence run to check if it is long enough i.e. worth issuing a draw call.
+Queue is a bitmask over item indexes, items of one shader are numbered contiguously
+so the scan is bounded by the shader's item range rather than by a sort.
 So long device-local index runs are rendered via multiple draw calls,
 all remaining short index sequences are grouped together into single
 host-visible index buffer which is finally rendered via single draw call.
@@ -142,6 +148,9 @@ constexpr static bool isStaticTCgen(const shaderStage_t &stage, const int bundle
 	}
 }
 
+// scroll, rotate, stretch, turb and entityTranslate change with time or entity and are
+// still worked out on the CPU by R_ComputeTexCoords() for every batch, so they keep
+// the surface out of the static VBO, as do waveform and portal color/alpha generators
 constexpr static bool isStaticTCmod(const textureBundle_t &bundle)
 {
 	for (auto i = 0; i < bundle.numTexMods; i++)
@@ -201,6 +210,7 @@ static bool isStaticShader(shader_t &shader)
 	if (shader.isSky || shader.remappedShader)
 		return false;
 
+	// deformVertexes are applied to tess.xyz by RB_DeformTessGeometry() every batch
 	if (shader.numDeforms || shader.numUnfoggedPasses > MAX_VBO_STAGES)
 		return false;
 
@@ -583,8 +593,7 @@ void R_BuildWorldVBO(msurface_t &surf, const int surfCount)
 	vbo.items = static_cast<vbo_item_t *>(ri.Hunk_Alloc((numStaticSurfaces + 1) * sizeof(vbo_item_t), h_low));
 	vbo.items_count = numStaticSurfaces;
 
-	// last item will be used for run length termination
-	vbo.items_queue = static_cast<int *>(ri.Hunk_Alloc((numStaticSurfaces + 1) * sizeof(int), h_low));
+	vbo.items_queue = static_cast<uint64_t *>(ri.Hunk_Alloc(((numStaticSurfaces + 64) / 64) * sizeof(uint64_t), h_low));
 	vbo.items_queue_count = 0;
 
 	ri.Printf(PRINT_ALL, "...found %i VBO surfaces (%i vertexes, %i indexes)\n",
@@ -746,111 +755,48 @@ void VBO_Cleanup(void)
 	}
 }
 
-/*
-=============
-qsort_int
-=============
-*/
-constexpr int MIN_MERGE = 32;
-
-static void timSort(int arr[], const int n)
+void VBO_QueueItem(const int itemIndex)
 {
-	int r = 0;
-	int a = n;
-	while (a >= MIN_MERGE)
-	{
-		r |= (a & 1);
-		a >>= 1;
-	}
-
-	int minRun = a + r;
-
-	std::vector<int> leftArr, rightArr;
+	vbo_t &vbo = world_vbo;
 
-	// insertionSort
-	for (int z = 0; z < n; z += minRun)
+	if (vbo.items_queue_count < vbo.items_count)
 	{
-		int right = (z + minRun - 1 < n - 1) ? z + minRun - 1 : n - 1;
-		for (int i = z + 1; i <= right; i++)
+		if (vbo.items_queue_count == 0)
 		{
-			int key = arr[i];
-			int j = i - 1;
-			while (j >= z && arr[j] > key)
-			{
-				arr[j + 1] = arr[j];
-				j--;
-			}
-			arr[j + 1] = key;
+			vbo.items_queue_min = vbo.items_queue_max = itemIndex;
 		}
-	}
-
-	for (int size = minRun; size < n; size = 2 * size)
-	{
-		for (int left = 0; left < n; left += 2 * size)
+		else if (itemIndex < vbo.items_queue_min)
 		{
-			int mid = left + size - 1;
-			int right = (left + 2 * size - 1 < n - 1) ? left + 2 * size - 1 : n - 1;
-
-			int len1 = mid - left + 1, len2 = right - mid;
-			for (int i = 0; i < len1; i++)
-			{
-				leftArr[i] = arr[left + i];
-			}
-			for (int i = 0; i < len2; i++)
-			{
-				rightArr[i] = arr[mid + 1 + i];
-			}
-
-			int i = 0, j = 0, k = left;
-			while (i < len1 && j < len2)
-			{
-				if (leftArr[i] <= rightArr[j])
-					arr[k++] = leftArr[i++];
-				else
-					arr[k++] = rightArr[j++];
-			}
-
-			while (i < len1)
-				arr[k++] = leftArr[i++];
-			while (j < len2)
-				arr[k++] = rightArr[j++];
+			vbo.items_queue_min = itemIndex;
+		}
+		else if (itemIndex > vbo.items_queue_max)
+		{
+			vbo.items_queue_max = itemIndex;
 		}
+		vbo.items_queue[itemIndex >> 6] |= 1ULL << (itemIndex & 63);
+		vbo.items_queue_count++;
 	}
-}
-
-static int run_length(const int *a, int from, int to, int *count)
-{
-	vbo_t &vbo = world_vbo;
-	int i, n, cnt;
-	for (cnt = 0, n = 1, i = from; i < to; i++, n++)
+	else
 	{
-		cnt += vbo.items[a[i]].num_indexes;
-		if (a[i] + 1 != a[i + 1])
-			break;
+		ri.Error(ERR_DROP, "VBO queue overflow");
 	}
-	*count = cnt;
-	return n;
 }
 
-void VBO_QueueItem(const int itemIndex)
+void VBO_ClearQueue(void)
 {
 	vbo_t &vbo = world_vbo;
 
-	if (vbo.items_queue_count < vbo.items_count)
-	{
-		vbo.items_queue[vbo.items_queue_count++] = itemIndex;
-	}
-	else
+	if (vbo.items_queue_count)
 	{
-		ri.Error(ERR_DROP, "VBO queue overflow");
+		// batch may have been dropped without VBO_PrepareQueues()
+		for (int i = vbo.items_queue_min >> 6; i <= vbo.items_queue_max >> 6; i++)
+		{
+			vbo.items_queue[i] = 0;
+		}
+		vbo.items_queue_count = 0;
 	}
 }
 
-void VBO_ClearQueue(void)
-{
-	world_vbo.items_queue_count = 0;
-}
-
 void VBO_Flush(void)
 {
 	if (tess.vboIndex)
@@ -913,40 +859,63 @@ void VBO_RenderIBOItems(void)
 	}
 }
 
-void VBO_PrepareQueues(void)
+static void VBO_AddItemRun(const int first, const int last, const int index_run)
 {
-	vbo_t &vbo = world_vbo;
-	int i, item_run, index_run, n;
-	const int *a;
+	const vbo_t &vbo = world_vbo;
 
-	vbo.items_queue[vbo.items_queue_count] = 0; // terminate run
+	if (index_run < MIN_IBO_RUN)
+	{
+		for (int n = first; n <= last; n++)
+			VBO_AddItemDataToSoftBuffer(n);
+	}
+	else
+	{
+		const vbo_item_t *start = vbo.items + first;
+		const vbo_item_t *end = vbo.items + last;
+		VBO_AddItemRangeToIBOBuffer(start->index_offset, (end->index_offset - start->index_offset) + end->num_indexes);
+	}
+}
 
-	// sort items so we can scan for longest runs
-	if (vbo.items_queue_count > 1)
-		timSort(vbo.items_queue, vbo.items_queue_count);
+void VBO_PrepareQueues(void)
+{
+	vbo_t &vbo = world_vbo;
+	int first, last, index_run;
 
 	vbo.soft_buffer_indexes = 0;
 	vbo.ibo_items_count = 0;
 
-	a = vbo.items_queue;
-	i = 0;
-	while (i < vbo.items_queue_count)
+	if (vbo.items_queue_count == 0)
+		return;
+
+	// walk queued items in ascending order, collecting runs of consecutive
+	// items, and clear the mask on the way for the next batch
+	first = last = -1;
+	index_run = 0;
+	for (int i = vbo.items_queue_min >> 6; i <= vbo.items_queue_max >> 6; i++)
 	{
-		item_run = run_length(a, i, vbo.items_queue_count, &index_run);
-		if (index_run < MIN_IBO_RUN)
-		{
-			for (n = 0; n < item_run; n++)
-				VBO_AddItemDataToSoftBuffer(a[i + n]);
-		}
-		else
+		uint64_t bits = vbo.items_queue[i];
+		vbo.items_queue[i] = 0;
+
+		while (bits)
 		{
-			vbo_item_t *start = vbo.items + a[i];
-			vbo_item_t *end = vbo.items + a[i + item_run - 1];
-			n = (end->index_offset - start->index_offset) + end->num_indexes;
-			VBO_AddItemRangeToIBOBuffer(start->index_offset, n);
+			const int item = (i << 6) + std::countr_zero(bits);
+			bits &= bits - 1;
+
+			if (first < 0 || item != last + 1)
+			{
+				if (first >= 0)
+					VBO_AddItemRun(first, last, index_run);
+				first = item;
+				index_run = 0;
+			}
+			last = item;
+			index_run += vbo.items[item].num_indexes;
 		}
-		i += item_run;
 	}
+
+	VBO_AddItemRun(first, last, index_run);
+
+	vbo.items_queue_count = 0;
 }
 
-#endif // USE_VBO
\ No newline at end of file
+#endif // USE_VBO
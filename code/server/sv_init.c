@@ -788,6 +788,16 @@ void SV_Init( void )
 
 	sv_padPackets = Cvar_Get( "sv_padPackets", "0", CVAR_DEVELOPER );
 	Cvar_SetDescription( sv_padPackets, "Adds padding bytes to network packets for rate debugging." );
+	sv_snapshotThreads = Cvar_Get( "sv_snapshotThreads", "0", CVAR_ARCHIVE_ND );
+	Cvar_CheckRange( sv_snapshotThreads, "0", va( "%i", MAX_SV_WORKERS ), CV_INTEGER );
+	Cvar_SetDescription( sv_snapshotThreads, "Number of worker threads that build and encode client snapshots in parallel, 0 builds them on the main thread." );
+	sv_worldIndex = Cvar_Get( "sv_worldIndex", "0", CVAR_ARCHIVE_ND );
+	Cvar_CheckRange( sv_worldIndex, "0", "1", CV_INTEGER );
+	Cvar_SetDescription( sv_worldIndex, "Spatial index for entity linking, traces and area queries, takes effect on the next map load:\n"
+		" 0 - fixed 16 leaf sector tree\n"
+		" 1 - dynamic bounding volume tree, for maps with many entities\n"
+		"Area queries return the same entities but in entity number order, so two entities hit at the same trace fraction"
+		" and triggers touched in the same frame may be resolved in a different order than with 0." );
 	sv_killserver = Cvar_Get( "sv_killserver", "0", 0 );
 	Cvar_SetDescription( sv_killserver, "Internal flag to manage server state." );
 	sv_mapChecksum = Cvar_Get( "sv_mapChecksum", "", CVAR_ROM );
@@ -888,6 +898,8 @@ void SV_Shutdown( const char *finalmsg ) {
 		SV_FinalMessage( finalmsg );
 	}
 
+	SV_ShutdownSnapshotWorkers();
+
 	SV_RemoveOperatorCommands();
 	SV_MasterShutdown();
 	SV_ShutdownGameProgs();
@@ -127,19 +127,15 @@ static void SV_EmitPacketEntities(const clientSnapshot_t *from, const clientSnap
 
 /*
 ==================
-SV_WriteSnapshotToClient
+SV_SnapshotDeltaFrame
+
+Picks the frame to delta compress the snapshot from, NULL for a full snapshot
 ==================
 */
-static void SV_WriteSnapshotToClient(const client_t *client, msg_t *msg)
+static const clientSnapshot_t *SV_SnapshotDeltaFrame(const client_t *client, int *deltaNum)
 {
 	const clientSnapshot_t *oldframe;
-	const clientSnapshot_t *frame;
 	int lastframe;
-	int i;
-	int snapFlags;
-
-	// this is the snapshot we are creating
-	frame = &client->frames[client->netchan.outgoingSequence & PACKET_MASK];
 
 	// try to use a previous frame as the source for delta compressing the snapshot
 	if ( /* client->deltaMessage <= 0 || */ client->state != CS_ACTIVE ) {
@@ -168,6 +164,24 @@ static void SV_WriteSnapshotToClient(const client_t *client, msg_t *msg)
 		}
 	}
 
+	*deltaNum = lastframe;
+	return oldframe;
+}
+
+/*
+==================
+SV_WriteSnapshotToClient
+==================
+*/
+static void SV_WriteSnapshotToClient(const client_t *client, const clientSnapshot_t *oldframe, const int lastframe, msg_t *msg)
+{
+	const clientSnapshot_t *frame;
+	int i;
+	int snapFlags;
+
+	// this is the snapshot we are creating
+	frame = &client->frames[client->netchan.outgoingSequence & PACKET_MASK];
+
 	MSG_WriteByte(msg, svc_snapshot);
 
 	// NOTE, MRE: now sent at the start of every message from server to client
@@ -281,6 +295,8 @@ typedef struct
 	int numSnapshotEntities;
 	entityNum_t snapshotEntities[MAX_SNAPSHOT_ENTITIES];
 	bool unordered;
+	bool clientMaskError;
+	byte added[MAX_GENTITIES / 8]; // prevents double adding from portal views
 } snapshotEntityNumbers_t;
 
 /*
@@ -322,10 +338,9 @@ static void SV_SortEntityNumbers(entityNum_t *num, const int size)
 SV_AddIndexToSnapshot
 ===============
 */
-static void SV_AddIndexToSnapshot(svEntity_t *svEnt, int index, snapshotEntityNumbers_t *eNums)
+static void SV_AddIndexToSnapshot(int entityNum, int index, snapshotEntityNumbers_t *eNums)
 {
-
-	svEnt->snapshotCounter = sv.snapshotCounter;
+	eNums->added[entityNum >> 3] |= 1 << (entityNum & 7);
 
 	// if we are full, silently discard entities
 	if (eNums->numSnapshotEntities >= MAX_SNAPSHOT_ENTITIES)
@@ -337,6 +352,226 @@ static void SV_AddIndexToSnapshot(svEntity_t *svEnt, int index, snapshotEntityNu
 	eNums->numSnapshotEntities++;
 }
 
+/*
+===============
+SV_EntityVisible
+
+Area and PVS test of an entity seen from clientarea
+===============
+*/
+static bool SV_EntityVisible(const svEntity_t *svEnt, int clientarea, const byte *bitvector)
+{
+	int i, l;
+
+	// ignore if not touching a PV leaf
+	// check area
+	if (!CM_AreasConnected(clientarea, svEnt->areanum))
+	{
+		// doors can legally straddle two areas, so
+		// we may need to check another one
+		if (!CM_AreasConnected(clientarea, svEnt->areanum2))
+		{
+			return false; // blocked by a door
+		}
+	}
+
+	// check individual leafs
+	if (!svEnt->numClusters)
+	{
+		return false;
+	}
+	l = 0;
+	for (i = 0; i < svEnt->numClusters; i++)
+	{
+		l = svEnt->clusternums[i];
+		if (bitvector[l >> 3] & (1 << (l & 7)))
+		{
+			break;
+		}
+	}
+
+	// if we haven't found it to be visible,
+	// check overflow clusters that couldn't be stored
+	if (i == svEnt->numClusters)
+	{
+		if (svEnt->lastCluster)
+		{
+			for (; l <= svEnt->lastCluster; l++)
+			{
+				if (bitvector[l >> 3] & (1 << (l & 7)))
+				{
+					break;
+				}
+			}
+			if (l == svEnt->lastCluster)
+			{
+				return false; // not visible
+			}
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+=============================================================================
+
+Visibility cache
+
+Clients standing in the same cluster and area see the same entities apart
+from the per-client flags, so the area and PVS tests of the common snapshot
+are done once per viewpoint and kept as a bitmask of snapshot indexes. The
+area fully determines the areabits for the frame, so (cluster, area) is
+the key. Entries are built on the main thread while preparing the
+snapshots, snapshot workers only look them up. Portal views that nobody
+stands in are tested the old way.
+
+=============================================================================
+*/
+
+#define MAX_VIS_CACHE MAX_CLIENTS
+
+typedef struct
+{
+	int cluster;
+	int area;
+	byte visible[MAX_GENTITIES / 8]; // indexes into svs.currFrame->ents
+} visCacheEntry_t;
+
+static struct
+{
+	const snapshotFrame_t *frame; // entries are valid for this common snapshot
+	bool clientMask;			  // it has SVF_CLIENTMASK entities
+	int numEntries;
+	visCacheEntry_t entries[MAX_VIS_CACHE];
+} svVis;
+
+int c_visCacheHits, c_visCacheLookups;
+
+/*
+===============
+SV_ClearVisCache
+===============
+*/
+static void SV_ClearVisCache(const snapshotFrame_t *sf)
+{
+	int e;
+
+	svVis.frame = sf;
+	svVis.numEntries = 0;
+	svVis.clientMask = false;
+
+	for (e = 0; e < sf->count; e++)
+	{
+		if (SV_GentityNum(sf->ents[e]->number)->r.svFlags & SVF_CLIENTMASK)
+		{
+			svVis.clientMask = true;
+			break;
+		}
+	}
+}
+
+/*
+===============
+SV_CacheVisibility
+
+Makes sure there is an entry for the point, main thread only
+===============
+*/
+static void SV_CacheVisibility(const vec3_t origin)
+{
+	visCacheEntry_t *vc;
+	const sharedEntity_t *ent;
+	const byte *clientpvs;
+	int leafnum, cluster, area;
+	int e, i;
+
+	leafnum = CM_PointLeafnum(origin);
+	area = CM_LeafArea(leafnum);
+	cluster = CM_LeafCluster(leafnum);
+
+	// reset by every com_speeds report, left alone otherwise
+	if (com_speeds->integer)
+	{
+		c_visCacheLookups++;
+	}
+
+	for (i = 0; i < svVis.numEntries; i++)
+	{
+		if (svVis.entries[i].cluster == cluster && svVis.entries[i].area == area)
+		{
+			if (com_speeds->integer)
+			{
+				c_visCacheHits++;
+			}
+			return;
+		}
+	}
+
+	if (svVis.numEntries == MAX_VIS_CACHE)
+	{
+		return;
+	}
+
+	vc = &svVis.entries[svVis.numEntries];
+	vc->cluster = cluster;
+	vc->area = area;
+	Com_Memset(vc->visible, 0, sizeof(vc->visible));
+
+	clientpvs = CM_ClusterPVS(cluster);
+
+	for (e = 0; e < svs.currFrame->count; e++)
+	{
+		i = svs.currFrame->ents[e]->number;
+		ent = SV_GentityNum(i);
+
+		// broadcast entities are always sent
+		if (ent->r.svFlags & SVF_BROADCAST || SV_EntityVisible(&sv.svEntities[i], area, clientpvs))
+		{
+			vc->visible[e >> 3] |= 1 << (e & 7);
+		}
+	}
+
+	svVis.numEntries++;
+}
+
+/*
+===============
+SV_FindVisCache
+
+Returns the visible snapshot indexes for the viewpoint or NULL
+===============
+*/
+static const byte *SV_FindVisCache(int cluster, int area, int clientNum)
+{
+	int i;
+
+	if (svVis.frame != svs.currFrame)
+	{
+		return NULL;
+	}
+
+	// the full scan has to see every SVF_CLIENTMASK entity to raise the error
+	if (clientNum >= 32 && svVis.clientMask)
+	{
+		return NULL;
+	}
+
+	for (i = 0; i < svVis.numEntries; i++)
+	{
+		if (svVis.entries[i].cluster == cluster && svVis.entries[i].area == area)
+		{
+			return svVis.entries[i].visible;
+		}
+	}
+
+	return NULL;
+}
+
 /*
 ===============
 SV_AddEntitiesVisibleFromPoint
@@ -345,15 +580,14 @@ SV_AddEntitiesVisibleFromPoint
 static void SV_AddEntitiesVisibleFromPoint(const vec3_t origin, clientSnapshot_t *frame,
 										   snapshotEntityNumbers_t *eNums, bool portal)
 {
-	int e, i;
+	int e;
 	sharedEntity_t *ent;
 	svEntity_t *svEnt;
 	entityState_t *es;
-	int l;
 	int clientarea, clientcluster;
 	int leafnum;
-	byte *clientpvs;
-	byte *bitvector;
+	const byte *clientpvs;
+	const byte *visible;
 
 	// during an error shutdown message we may need to transmit
 	// the shutdown message after the server has shutdown, so
@@ -370,10 +604,16 @@ static void SV_AddEntitiesVisibleFromPoint(const vec3_t origin, clientSnapshot_t
 	// calculate the visible areas
 	frame->areabytes = CM_WriteAreaBits(frame->areabits, clientarea);
 
-	clientpvs = CM_ClusterPVS(clientcluster);
+	visible = SV_FindVisCache(clientcluster, clientarea, frame->ps.clientNum);
+	clientpvs = visible ? NULL : CM_ClusterPVS(clientcluster);
 
 	for (e = 0; e < svs.currFrame->count; e++)
 	{
+		if (visible && !(visible[e >> 3] & (1 << (e & 7))))
+		{
+			continue; // cached area and PVS test failed
+		}
+
 		es = svs.currFrame->ents[e];
 		ent = SV_GentityNum(es->number);
 
@@ -397,81 +637,37 @@ static void SV_AddEntitiesVisibleFromPoint(const vec3_t origin, clientSnapshot_t
 		if (ent->r.svFlags & SVF_CLIENTMASK)
 		{
 			if (frame->ps.clientNum >= 32)
-				Com_Error(ERR_DROP, "SVF_CLIENTMASK: clientNum >= 32");
+			{
+				// may run on a worker, the caller raises the error
+				eNums->clientMaskError = true;
+				return;
+			}
 			if (~ent->r.singleClient & (1 << frame->ps.clientNum))
 				continue;
 		}
 
-		svEnt = &sv.svEntities[es->number];
-
 		// don't double add an entity through portals
-		if (svEnt->snapshotCounter == sv.snapshotCounter)
+		if (eNums->added[es->number >> 3] & (1 << (es->number & 7)))
 		{
 			continue;
 		}
 
+		svEnt = &sv.svEntities[es->number];
+
 		// broadcast entities are always sent
 		if (ent->r.svFlags & SVF_BROADCAST)
 		{
-			SV_AddIndexToSnapshot(svEnt, e, eNums);
+			SV_AddIndexToSnapshot(es->number, e, eNums);
 			continue;
 		}
 
-		// ignore if not touching a PV leaf
-		// check area
-		if (!CM_AreasConnected(clientarea, svEnt->areanum))
-		{
-			// doors can legally straddle two areas, so
-			// we may need to check another one
-			if (!CM_AreasConnected(clientarea, svEnt->areanum2))
-			{
-				continue; // blocked by a door
-			}
-		}
-
-		bitvector = clientpvs;
-
-		// check individual leafs
-		if (!svEnt->numClusters)
+		if (!visible && !SV_EntityVisible(svEnt, clientarea, clientpvs))
 		{
 			continue;
 		}
-		l = 0;
-		for (i = 0; i < svEnt->numClusters; i++)
-		{
-			l = svEnt->clusternums[i];
-			if (bitvector[l >> 3] & (1 << (l & 7)))
-			{
-				break;
-			}
-		}
-
-		// if we haven't found it to be visible,
-		// check overflow clusters that couldn't be stored
-		if (i == svEnt->numClusters)
-		{
-			if (svEnt->lastCluster)
-			{
-				for (; l <= svEnt->lastCluster; l++)
-				{
-					if (bitvector[l >> 3] & (1 << (l & 7)))
-					{
-						break;
-					}
-				}
-				if (l == svEnt->lastCluster)
-				{
-					continue; // not visible
-				}
-			}
-			else
-			{
-				continue;
-			}
-		}
 
 		// add it
-		SV_AddIndexToSnapshot(svEnt, e, eNums);
+		SV_AddIndexToSnapshot(es->number, e, eNums);
 
 		// if it's a portal entity, add everything visible from its camera position
 		if (ent->r.svFlags & SVF_PORTAL && !portal)
@@ -487,6 +683,8 @@ static void SV_AddEntitiesVisibleFromPoint(const vec3_t origin, clientSnapshot_t
 			}
 			eNums->unordered = true;
 			SV_AddEntitiesVisibleFromPoint(ent->s.origin2, frame, eNums, portal);
+			if (eNums->clientMaskError)
+				return;
 		}
 	}
 
@@ -582,12 +780,9 @@ static void SV_BuildCommonSnapshot(void)
 			}
 
 			list[count++] = ent;
-			sv.svEntities[num].snapshotCounter = -1;
 		}
 	}
 
-	sv.snapshotCounter = -1;
-
 	sf = &svs.snapFrames[svs.snapshotFrame % NUM_SNAPSHOT_FRAMES];
 
 	// track last valid frame
@@ -635,28 +830,23 @@ static void SV_BuildCommonSnapshot(void)
 		svs.snapshotEntities[index] = list[i]->s;
 		sf->ents[i] = &svs.snapshotEntities[index];
 	}
+
+	SV_ClearVisCache(sf);
 }
 
 /*
 =============
-SV_BuildClientSnapshot
-
-Decides which entities are going to be visible to the client, and
-copies off the playerstate and areabits.
+SV_PrepareClientSnapshot
 
-This properly handles multiple recursive portals, but the render
-currently doesn't.
-
-For viewing through other player's eyes, clent can be something other than client->gentity
+Copies off the playerstate and makes sure the common snapshot exists.
+Returns false if the client gets no packet entities this time.
 =============
 */
-static void SV_BuildClientSnapshot(client_t *client)
+static bool SV_PrepareClientSnapshot(client_t *client)
 {
 	vec3_t org;
 	clientSnapshot_t *frame;
-	snapshotEntityNumbers_t entityNumbers;
-	int i, cl;
-	svEntity_t *svEnt;
+	int cl;
 	int clientNum;
 	playerState_t *ps;
 
@@ -673,7 +863,7 @@ static void SV_BuildClientSnapshot(client_t *client)
 	frame->frameNum = svs.currentSnapshotFrame;
 
 	if (client->state == CS_ZOMBIE)
-		return;
+		return false;
 
 	// grab the current playerState_t
 	ps = SV_GameClientNum(cl);
@@ -690,7 +880,7 @@ static void SV_BuildClientSnapshot(client_t *client)
 	// because new gamestate will invalidate them anyway
 	if (!client->gentity)
 	{
-		return;
+		return false;
 	}
 
 	if (svs.currFrame == NULL)
@@ -699,27 +889,63 @@ static void SV_BuildClientSnapshot(client_t *client)
 		SV_BuildCommonSnapshot();
 	}
 
-	// bump the counter used to prevent double adding
-	sv.snapshotCounter++;
+	frame->frameNum = svs.currFrame->frameNum;
+
+	if (sv.state != SS_DEAD)
+	{
+		// same viewpoint as SV_AddClientSnapshotEntities
+		VectorCopy(frame->ps.origin, org);
+		org[2] += frame->ps.viewheight;
+		SV_CacheVisibility(org);
+	}
+
+	return true;
+}
+
+/*
+=============
+SV_AddClientSnapshotEntities
+
+Decides which entities are going to be visible to the client and
+finishes the areabits. Only reads shared server state, so this may
+run on a worker thread. Returns false on SVF_CLIENTMASK misuse.
+
+This properly handles multiple recursive portals, but the render
+currently doesn't.
+=============
+*/
+static bool SV_AddClientSnapshotEntities(client_t *client)
+{
+	vec3_t org;
+	clientSnapshot_t *frame;
+	snapshotEntityNumbers_t entityNumbers;
+	int i;
+	int clientNum;
+
+	frame = &client->frames[client->netchan.outgoingSequence & PACKET_MASK];
+	clientNum = frame->ps.clientNum;
 
 	// empty entities before visibility check
 	entityNumbers.numSnapshotEntities = 0;
-
-	frame->frameNum = svs.currFrame->frameNum;
+	entityNumbers.clientMaskError = false;
+	Com_Memset(entityNumbers.added, 0, sizeof(entityNumbers.added));
 
 	// never send client's own entity, because it can
 	// be regenerated from the playerstate
-	svEnt = &sv.svEntities[clientNum];
-	svEnt->snapshotCounter = sv.snapshotCounter;
+	entityNumbers.added[clientNum >> 3] |= 1 << (clientNum & 7);
 
 	// find the client's viewpoint
-	VectorCopy(ps->origin, org);
-	org[2] += ps->viewheight;
+	VectorCopy(frame->ps.origin, org);
+	org[2] += frame->ps.viewheight;
 
 	// add all the entities directly visible to the eye, which
 	// may include portal entities that merge other viewpoints
 	entityNumbers.unordered = false;
 	SV_AddEntitiesVisibleFromPoint(org, frame, &entityNumbers, false);
+	if (entityNumbers.clientMaskError)
+	{
+		return false;
+	}
 
 	// if there were portals visible, there may be out of order entities
 	// in the list which will need to be resorted for the delta compression
@@ -744,6 +970,30 @@ static void SV_BuildClientSnapshot(client_t *client)
 	{
 		frame->ents[i] = svs.currFrame->ents[entityNumbers.snapshotEntities[i]];
 	}
+
+	return true;
+}
+
+/*
+=============
+SV_BuildClientSnapshot
+
+Copies off the playerstate, the visible entities and the areabits.
+
+For viewing through other player's eyes, clent can be something other than client->gentity
+=============
+*/
+static void SV_BuildClientSnapshot(client_t *client)
+{
+	if (!SV_PrepareClientSnapshot(client))
+	{
+		return;
+	}
+
+	if (!SV_AddClientSnapshotEntities(client))
+	{
+		Com_Error(ERR_DROP, "SVF_CLIENTMASK: clientNum >= 32");
+	}
 }
 
 /*
@@ -764,6 +1014,44 @@ void SV_SendMessageToClient(msg_t *msg, client_t *client)
 	SV_Netchan_Transmit(client, msg);
 }
 
+/*
+=======================
+SV_WriteClientMessage
+
+Writes the whole snapshot message, may run on a worker thread
+=======================
+*/
+static void SV_WriteClientMessage(client_t *client, const clientSnapshot_t *oldframe, const int lastframe, msg_t *msg)
+{
+	// NOTE, MRE: all server->client messages now acknowledge
+	// let the client know which reliable clientCommands we have received
+	MSG_WriteLong(msg, client->lastClientCommand);
+
+	// (re)send any reliable server commands
+	SV_UpdateServerCommandsToClient(client, msg);
+
+	// send over all the relevant entityState_t
+	// and the playerState_t
+	SV_WriteSnapshotToClient(client, oldframe, lastframe, msg);
+}
+
+/*
+=======================
+SV_TransmitClientSnapshot
+=======================
+*/
+static void SV_TransmitClientSnapshot(client_t *client, msg_t *msg)
+{
+	// check for overflow
+	if (msg->overflowed)
+	{
+		Com_Printf("WARNING: msg overflowed for %s\n", client->name);
+		MSG_Clear(msg);
+	}
+
+	SV_SendMessageToClient(msg, client);
+}
+
 /*
 =======================
 SV_SendClientSnapshot
@@ -775,6 +1063,8 @@ Also called by SV_FinalMessage
 void SV_SendClientSnapshot(client_t *client)
 {
 	byte msg_buf[MAX_MSGLEN_BUF];
+	const clientSnapshot_t *oldframe;
+	int lastframe;
 	msg_t msg;
 
 	// build the snapshot
@@ -787,28 +1077,157 @@ void SV_SendClientSnapshot(client_t *client)
 		return;
 	}
 
+	oldframe = SV_SnapshotDeltaFrame(client, &lastframe);
+
 	MSG_Init(&msg, msg_buf, MAX_MSGLEN);
 	msg.allowoverflow = true;
 
-	// NOTE, MRE: all server->client messages now acknowledge
-	// let the client know which reliable clientCommands we have received
-	MSG_WriteLong(&msg, client->lastClientCommand);
+	SV_WriteClientMessage(client, oldframe, lastframe, &msg);
 
-	// (re)send any reliable server commands
-	SV_UpdateServerCommandsToClient(client, &msg);
+	SV_TransmitClientSnapshot(client, &msg);
+}
 
-	// send over all the relevant entityState_t
-	// and the playerState_t
-	SV_WriteSnapshotToClient(client, &msg);
+/*
+=============================================================================
 
-	// check for overflow
-	if (msg.overflowed)
+Parallel snapshots
+
+With sv_snapshotThreads the clients due for a snapshot are handled in three
+passes. The main thread prepares every frame in client order, which builds
+the common snapshot and picks the delta frames exactly like the serial loop
+does. The workers then add the visible entities and write the messages, each
+client only touching its own frame and message. Finally the main thread
+transmits them in client order, so the packets are byte for byte the same
+as without threads.
+
+=============================================================================
+*/
+
+typedef struct
+{
+	client_t *client;
+	const clientSnapshot_t *oldframe;
+	int lastframe;
+	bool addEntities;
+	bool clientMaskError;
+	msg_t msg;
+	byte msgBuf[MAX_MSGLEN_BUF];
+} snapshotJob_t;
+
+static snapshotJob_t *snapshotJobs; // MAX_CLIENTS, allocated with the workers
+
+/*
+=======================
+SV_UpdateSnapshotWorkers
+=======================
+*/
+static void SV_UpdateSnapshotWorkers(void)
+{
+	if (!sv_snapshotThreads->modified)
 	{
-		Com_Printf("WARNING: msg overflowed for %s\n", client->name);
-		MSG_Clear(&msg);
+		return;
+	}
+
+	sv_snapshotThreads->modified = false;
+
+	SV_ShutdownWorkers();
+
+	if (sv_snapshotThreads->integer > 0)
+	{
+		SV_InitWorkers(sv_snapshotThreads->integer);
+		if (SV_NumWorkers() && !snapshotJobs)
+		{
+			snapshotJobs = Z_Malloc(MAX_CLIENTS * sizeof(snapshotJobs[0]));
+		}
+	}
+}
+
+/*
+=======================
+SV_ShutdownSnapshotWorkers
+=======================
+*/
+void SV_ShutdownSnapshotWorkers(void)
+{
+	SV_ShutdownWorkers();
+
+	if (snapshotJobs)
+	{
+		Z_Free(snapshotJobs);
+		snapshotJobs = NULL;
+	}
+
+	// start them again with the next server
+	if (sv_snapshotThreads)
+	{
+		sv_snapshotThreads->modified = true;
+	}
+}
+
+/*
+=======================
+SV_SnapshotJob
+=======================
+*/
+static void SV_SnapshotJob(void *data, int index)
+{
+	snapshotJob_t *job = (snapshotJob_t *)data + index;
+
+	if (job->addEntities && !SV_AddClientSnapshotEntities(job->client))
+	{
+		job->clientMaskError = true;
+		return;
+	}
+
+	if (job->client->netchan.remoteAddress.type == NA_BOT)
+	{
+		return;
 	}
 
-	SV_SendMessageToClient(&msg, client);
+	MSG_Init(&job->msg, job->msgBuf, MAX_MSGLEN);
+	job->msg.allowoverflow = true;
+
+	SV_WriteClientMessage(job->client, job->oldframe, job->lastframe, &job->msg);
+}
+
+/*
+=======================
+SV_SendClientSnapshots
+=======================
+*/
+static void SV_SendClientSnapshots(client_t **clients, const int numClients)
+{
+	snapshotJob_t *job;
+	int i;
+
+	for (i = 0, job = snapshotJobs; i < numClients; i++, job++)
+	{
+		job->client = clients[i];
+		job->clientMaskError = false;
+		job->addEntities = SV_PrepareClientSnapshot(job->client);
+		if (job->client->netchan.remoteAddress.type != NA_BOT)
+		{
+			job->oldframe = SV_SnapshotDeltaFrame(job->client, &job->lastframe);
+		}
+	}
+
+	SV_RunWorkers(SV_SnapshotJob, snapshotJobs, numClients);
+
+	for (i = 0, job = snapshotJobs; i < numClients; i++, job++)
+	{
+		if (job->clientMaskError)
+		{
+			Com_Error(ERR_DROP, "SVF_CLIENTMASK: clientNum >= 32");
+		}
+
+		if (job->client->netchan.remoteAddress.type != NA_BOT)
+		{
+			SV_TransmitClientSnapshot(job->client, &job->msg);
+		}
+
+		job->client->lastSnapshotTime = svs.time;
+		job->client->rateDelayed = false;
+	}
 }
 
 /*
@@ -818,11 +1237,17 @@ SV_SendClientMessages
 */
 void SV_SendClientMessages(void)
 {
+	client_t *clients[MAX_CLIENTS];
+	int numClients;
 	int i;
 	client_t *c;
 
 	svs.msgTime = Sys_Milliseconds();
 
+	SV_UpdateSnapshotWorkers();
+	NET_BeginPacketBatch();
+	numClients = 0;
+
 	// send a message to each connected client
 	for (i = 0; i < sv.maxclients; i++)
 	{
@@ -859,9 +1284,23 @@ void SV_SendClientMessages(void)
 			continue;
 		}
 
+		if (SV_NumWorkers())
+		{
+			// sent by SV_SendClientSnapshots
+			clients[numClients++] = c;
+			continue;
+		}
+
 		// generate and send a new message
 		SV_SendClientSnapshot(c);
 		c->lastSnapshotTime = svs.time;
 		c->rateDelayed = false;
 	}
+
+	if (numClients)
+	{
+		SV_SendClientSnapshots(clients, numClients);
+	}
+
+	NET_FlushPacketBatch();
 }
@@ -0,0 +1,338 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+
+This file is part of Quake III Arena source code.
+
+Quake III Arena source code is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Quake III Arena source code is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Quake III Arena source code; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+===========================================================================
+*/
+// sv_workers.c -- small thread pool for per-client server work
+
+#include "server.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+/*
+==============================================================================
+
+SV_RunWorkers hands out the indexes of a batch one at a time to the worker
+threads and to the calling thread, and returns once all of them are done.
+Work functions must not call Com_Error, Com_Printf or anything else that
+touches engine state which is not safe to share, results are handed back
+to the main thread through the batch data.
+
+==============================================================================
+*/
+
+#ifdef _MSC_VER
+#define SV_AtomicInc( p )	( InterlockedIncrement( (volatile LONG *)(p) ) - 1 )
+#define SV_AtomicDec( p )	InterlockedDecrement( (volatile LONG *)(p) )
+#else
+#define SV_AtomicInc( p )	__atomic_fetch_add( (p), 1, __ATOMIC_ACQ_REL )
+#define SV_AtomicDec( p )	__atomic_sub_fetch( (p), 1, __ATOMIC_ACQ_REL )
+#endif
+
+static struct {
+	int				numThreads;
+	bool			quit;
+
+	// current batch
+	svWorkFunc_t	func;
+	void			*data;
+	int				count;
+	volatile int	next;
+	volatile int	active;		// workers still running the batch
+
+#ifdef _WIN32
+	HANDLE			threads[ MAX_SV_WORKERS ];
+	HANDLE			start[ MAX_SV_WORKERS ];
+	HANDLE			done;		// set by the last worker to finish
+#else
+	pthread_t		threads[ MAX_SV_WORKERS ];
+	pthread_mutex_t	lock;
+	pthread_cond_t	start;
+	pthread_cond_t	done;
+	int				generation;	// bumped for each batch
+#endif
+} svw;
+
+
+/*
+=================
+SV_WorkLoop
+=================
+*/
+static void SV_WorkLoop( void ) {
+	int index;
+
+	while ( ( index = SV_AtomicInc( &svw.next ) ) < svw.count ) {
+		svw.func( svw.data, index );
+	}
+}
+
+
+#ifdef _WIN32
+
+static DWORD WINAPI SV_WorkerThread( LPVOID arg ) {
+	const HANDLE start = (HANDLE)arg;
+
+	for ( ;; ) {
+		WaitForSingleObject( start, INFINITE );
+		if ( svw.quit ) {
+			break;
+		}
+		SV_WorkLoop();
+		if ( SV_AtomicDec( &svw.active ) == 0 ) {
+			SetEvent( svw.done );
+		}
+	}
+	return 0;
+}
+
+
+/*
+=================
+SV_InitWorkers
+=================
+*/
+void SV_InitWorkers( int count ) {
+	int i;
+
+	if ( count > MAX_SV_WORKERS ) {
+		count = MAX_SV_WORKERS;
+	}
+
+	if ( svw.numThreads || count <= 0 ) {
+		return;
+	}
+
+	svw.quit = false;
+	svw.done = CreateEvent( NULL, FALSE, FALSE, NULL );
+
+	for ( i = 0; i < count; i++ ) {
+		svw.start[ i ] = CreateEvent( NULL, FALSE, FALSE, NULL );
+		svw.threads[ i ] = CreateThread( NULL, 0, SV_WorkerThread, svw.start[ i ], 0, NULL );
+		if ( !svw.threads[ i ] ) {
+			CloseHandle( svw.start[ i ] );
+			break;
+		}
+	}
+	svw.numThreads = i;
+
+	if ( svw.numThreads == 0 ) {
+		CloseHandle( svw.done );
+	}
+}
+
+
+/*
+=================
+SV_ShutdownWorkers
+=================
+*/
+void SV_ShutdownWorkers( void ) {
+	int i;
+
+	if ( !svw.numThreads ) {
+		return;
+	}
+
+	svw.quit = true;
+	for ( i = 0; i < svw.numThreads; i++ ) {
+		SetEvent( svw.start[ i ] );
+	}
+	WaitForMultipleObjects( svw.numThreads, svw.threads, TRUE, INFINITE );
+
+	for ( i = 0; i < svw.numThreads; i++ ) {
+		CloseHandle( svw.threads[ i ] );
+		CloseHandle( svw.start[ i ] );
+	}
+	CloseHandle( svw.done );
+
+	svw.numThreads = 0;
+}
+
+
+static void SV_StartBatch( void ) {
+	int i;
+
+	svw.active = svw.numThreads;
+	for ( i = 0; i < svw.numThreads; i++ ) {
+		SetEvent( svw.start[ i ] );
+	}
+}
+
+
+static void SV_WaitBatch( void ) {
+	WaitForSingleObject( svw.done, INFINITE );
+}
+
+#else // !_WIN32
+
+static void *SV_WorkerThread( void *arg ) {
+	int generation = 0; // SV_InitWorkers starts every pool at generation 0
+
+	pthread_mutex_lock( &svw.lock );
+	for ( ;; ) {
+		while ( svw.generation == generation && !svw.quit ) {
+			pthread_cond_wait( &svw.start, &svw.lock );
+		}
+		if ( svw.quit ) {
+			break;
+		}
+		generation = svw.generation;
+		pthread_mutex_unlock( &svw.lock );
+
+		SV_WorkLoop();
+
+		pthread_mutex_lock( &svw.lock );
+		if ( --svw.active == 0 ) {
+			pthread_cond_signal( &svw.done );
+		}
+	}
+	pthread_mutex_unlock( &svw.lock );
+
+	return NULL;
+}
+
+
+/*
+=================
+SV_InitWorkers
+=================
+*/
+void SV_InitWorkers( int count ) {
+	int i;
+
+	if ( count > MAX_SV_WORKERS ) {
+		count = MAX_SV_WORKERS;
+	}
+
+	if ( svw.numThreads || count <= 0 ) {
+		return;
+	}
+
+	svw.quit = false;
+	svw.generation = 0;
+	pthread_mutex_init( &svw.lock, NULL );
+	pthread_cond_init( &svw.start, NULL );
+	pthread_cond_init( &svw.done, NULL );
+
+	for ( i = 0; i < count; i++ ) {
+		if ( pthread_create( &svw.threads[ i ], NULL, SV_WorkerThread, NULL ) != 0 ) {
+			break;
+		}
+	}
+	svw.numThreads = i;
+
+	if ( svw.numThreads == 0 ) {
+		pthread_cond_destroy( &svw.done );
+		pthread_cond_destroy( &svw.start );
+		pthread_mutex_destroy( &svw.lock );
+	}
+}
+
+
+/*
+=================
+SV_ShutdownWorkers
+=================
+*/
+void SV_ShutdownWorkers( void ) {
+	int i;
+
+	if ( !svw.numThreads ) {
+		return;
+	}
+
+	pthread_mutex_lock( &svw.lock );
+	svw.quit = true;
+	pthread_cond_broadcast( &svw.start );
+	pthread_mutex_unlock( &svw.lock );
+
+	for ( i = 0; i < svw.numThreads; i++ ) {
+		pthread_join( svw.threads[ i ], NULL );
+	}
+
+	pthread_cond_destroy( &svw.done );
+	pthread_cond_destroy( &svw.start );
+	pthread_mutex_destroy( &svw.lock );
+
+	svw.numThreads = 0;
+}
+
+
+static void SV_StartBatch( void ) {
+	pthread_mutex_lock( &svw.lock );
+	svw.active = svw.numThreads;
+	svw.generation++;
+	pthread_cond_broadcast( &svw.start );
+	pthread_mutex_unlock( &svw.lock );
+}
+
+
+static void SV_WaitBatch( void ) {
+	pthread_mutex_lock( &svw.lock );
+	while ( svw.active ) {
+		pthread_cond_wait( &svw.done, &svw.lock );
+	}
+	pthread_mutex_unlock( &svw.lock );
+}
+
+#endif // !_WIN32
+
+
+/*
+=================
+SV_NumWorkers
+=================
+*/
+int SV_NumWorkers( void ) {
+	return svw.numThreads;
+}
+
+
+/*
+=================
+SV_RunWorkers
+
+Calls func( data, index ) for every index below count, in no particular
+order and possibly at the same time
+=================
+*/
+void SV_RunWorkers( svWorkFunc_t func, void *data, int count ) {
+	int i;
+
+	if ( svw.numThreads == 0 || count < 2 ) {
+		for ( i = 0; i < count; i++ ) {
+			func( data, i );
+		}
+		return;
+	}
+
+	svw.func = func;
+	svw.data = data;
+	svw.count = count;
+	svw.next = 0;
+
+	SV_StartBatch();
+	SV_WorkLoop();
+	SV_WaitBatch();
+}
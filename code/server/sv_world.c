@@ -58,6 +58,16 @@ the world is carved up with an evenly spaced, axially aligned bsp tree.  Entitie
 are kept in chains either at the final leafs, or at the first node that splits
 them, which prevents having to deal with multiple fragments of a single entity.
 
+With sv_worldIndex 1 a dynamic bounding volume tree is used instead.  Every
+linked entity is a leaf whose box is its absmin / absmax grown by WORLD_MARGIN,
+so small moves don't touch the tree at all, and inner nodes enclose their two
+children.  AVL style rotations keep the tree close to balanced, so queries stay
+logarithmic however the entities are spread over the map.
+
+Both find the same entities, but the sector tree lists them in chain order and
+the dynamic tree in entity number order.  Traces that hit two entities at the
+same fraction and triggers touched in the same frame can resolve differently.
+
 ===============================================================================
 */
 
@@ -74,6 +84,23 @@ typedef struct worldSector_s {
 static worldSector_t	sv_worldSectors[AREA_NODES];
 static int			sv_numworldSectors;
 
+typedef struct worldNode_s {
+	vec3_t		mins, maxs;
+	struct worldNode_s	*parent;		// next free node while unused
+	struct worldNode_s	*children[2];	// NULL for leafs
+	svEntity_t	*entity;				// leafs only
+	int			height;					// 0 for leafs
+} worldNode_t;
+
+#define	WORLD_NODES		(MAX_GENTITIES*2)
+#define	WORLD_MARGIN	8.0f
+
+static worldNode_t	sv_worldNodes[WORLD_NODES];
+static worldNode_t	*sv_worldFreeNodes;
+static worldNode_t	*sv_worldRoot;
+static int			sv_numWorldLeafs;
+static bool			sv_worldTree;		// sv_worldIndex at map load
+
 
 /*
 ===============
@@ -85,6 +112,12 @@ void SV_SectorList_f( void ) {
 	worldSector_t	*sec;
 	svEntity_t		*ent;
 
+	if ( sv_worldTree ) {
+		Com_Printf( "dynamic tree: %i entities, height %i\n", sv_numWorldLeafs,
+			sv_worldRoot ? sv_worldRoot->height : 0 );
+		return;
+	}
+
 	for ( i = 0 ; i < AREA_NODES ; i++ ) {
 		sec = &sv_worldSectors[i];
 
@@ -138,19 +171,329 @@ static worldSector_t *SV_CreateworldSector( int depth, vec3_t mins, vec3_t maxs
 	return anode;
 }
 
+
 /*
 ===============
-SV_ClearWorld
+SV_AllocWorldNode
+===============
+*/
+static worldNode_t *SV_AllocWorldNode( void ) {
+	worldNode_t	*node;
+
+	node = sv_worldFreeNodes;
+	if ( !node ) {
+		// can't happen, a tree with n leafs has n-1 inner nodes
+		Com_Error( ERR_DROP, "SV_AllocWorldNode: out of nodes" );
+	}
+	sv_worldFreeNodes = node->parent;
 
+	Com_Memset( node, 0, sizeof( *node ) );
+	return node;
+}
+
+
+/*
+===============
+SV_FreeWorldNode
 ===============
 */
-void SV_ClearWorld( void ) {
+static void SV_FreeWorldNode( worldNode_t *node ) {
+	node->parent = sv_worldFreeNodes;
+	sv_worldFreeNodes = node;
+}
+
+
+/*
+===============
+SV_BoundsCost
+
+Half the surface area of a box, the cost of visiting a node
+===============
+*/
+static float SV_BoundsCost( const vec3_t mins, const vec3_t maxs ) {
+	float	dx, dy, dz;
+
+	dx = maxs[0] - mins[0];
+	dy = maxs[1] - mins[1];
+	dz = maxs[2] - mins[2];
+
+	return dx * dy + dy * dz + dz * dx;
+}
+
+
+/*
+===============
+SV_UnionCost
+===============
+*/
+static float SV_UnionCost( const worldNode_t *a, const worldNode_t *b ) {
+	vec3_t	mins, maxs;
+	int		i;
+
+	for ( i = 0 ; i < 3 ; i++ ) {
+		mins[i] = MIN( a->mins[i], b->mins[i] );
+		maxs[i] = MAX( a->maxs[i], b->maxs[i] );
+	}
+
+	return SV_BoundsCost( mins, maxs );
+}
+
+
+/*
+===============
+SV_UpdateWorldNode
+
+Recomputes the box and height of an inner node from its children
+===============
+*/
+static void SV_UpdateWorldNode( worldNode_t *node ) {
+	const worldNode_t *a = node->children[0];
+	const worldNode_t *b = node->children[1];
+	int		i;
+
+	for ( i = 0 ; i < 3 ; i++ ) {
+		node->mins[i] = MIN( a->mins[i], b->mins[i] );
+		node->maxs[i] = MAX( a->maxs[i], b->maxs[i] );
+	}
+
+	node->height = 1 + MAX( a->height, b->height );
+}
+
+
+/*
+===============
+SV_RotateWorldNode
+
+Lifts child `up' of node into its place, node keeps the other child and
+takes the lower subtree of `up'
+===============
+*/
+static worldNode_t *SV_RotateWorldNode( worldNode_t *node, int up ) {
+	worldNode_t	*raise, *keep, *give;
+
+	raise = node->children[up];
+	if ( raise->children[0]->height > raise->children[1]->height ) {
+		keep = raise->children[0];
+		give = raise->children[1];
+	} else {
+		keep = raise->children[1];
+		give = raise->children[0];
+	}
+
+	raise->parent = node->parent;
+	if ( raise->parent ) {
+		raise->parent->children[ raise->parent->children[1] == node ] = raise;
+	} else {
+		sv_worldRoot = raise;
+	}
+
+	raise->children[0] = node;
+	raise->children[1] = keep;
+	node->parent = raise;
+
+	node->children[up] = give;
+	give->parent = node;
+
+	SV_UpdateWorldNode( node );
+	SV_UpdateWorldNode( raise );
+
+	return raise;
+}
+
+
+/*
+===============
+SV_RefitWorldTree
+
+Walks up from node, rebalancing and updating the boxes of all ancestors
+===============
+*/
+static void SV_RefitWorldTree( worldNode_t *node ) {
+	int		balance;
+
+	while ( node ) {
+		balance = node->children[1]->height - node->children[0]->height;
+		if ( balance > 1 ) {
+			node = SV_RotateWorldNode( node, 1 );
+		} else if ( balance < -1 ) {
+			node = SV_RotateWorldNode( node, 0 );
+		} else {
+			SV_UpdateWorldNode( node );
+		}
+		node = node->parent;
+	}
+}
+
+
+/*
+===============
+SV_InsertWorldLeaf
+
+Pairs the leaf with the node that makes the tree cheapest to search,
+going down while the surface area heuristic says it pays off
+===============
+*/
+static void SV_InsertWorldLeaf( worldNode_t *leaf ) {
+	worldNode_t	*sibling, *parent, *child;
+	float		cost, inherit, childCost[2];
+	int			i;
+
+	if ( !sv_worldRoot ) {
+		leaf->parent = NULL;
+		sv_worldRoot = leaf;
+		return;
+	}
+
+	sibling = sv_worldRoot;
+	while ( sibling->children[0] ) {
+		// cost of a new parent for sibling and leaf right here
+		cost = 2.0f * SV_UnionCost( sibling, leaf );
+		// every node on the way down grows to include the leaf
+		inherit = cost - 2.0f * SV_BoundsCost( sibling->mins, sibling->maxs );
+
+		for ( i = 0 ; i < 2 ; i++ ) {
+			child = sibling->children[i];
+			childCost[i] = SV_UnionCost( child, leaf ) + inherit;
+			if ( child->children[0] ) {
+				childCost[i] -= SV_BoundsCost( child->mins, child->maxs );
+			}
+		}
+
+		if ( cost < childCost[0] && cost < childCost[1] ) {
+			break;
+		}
+
+		sibling = sibling->children[ childCost[1] < childCost[0] ];
+	}
+
+	parent = SV_AllocWorldNode();
+	parent->parent = sibling->parent;
+	if ( parent->parent ) {
+		parent->parent->children[ parent->parent->children[1] == sibling ] = parent;
+	} else {
+		sv_worldRoot = parent;
+	}
+
+	parent->children[0] = sibling;
+	parent->children[1] = leaf;
+	sibling->parent = parent;
+	leaf->parent = parent;
+
+	SV_RefitWorldTree( parent );
+}
+
+
+/*
+===============
+SV_RemoveWorldLeaf
+
+Takes the leaf out of the tree, its sibling replaces their parent
+===============
+*/
+static void SV_RemoveWorldLeaf( worldNode_t *leaf ) {
+	worldNode_t	*parent, *sibling;
+
+	if ( leaf == sv_worldRoot ) {
+		sv_worldRoot = NULL;
+		return;
+	}
+
+	parent = leaf->parent;
+	sibling = parent->children[ parent->children[0] == leaf ];
+
+	sibling->parent = parent->parent;
+	if ( sibling->parent ) {
+		sibling->parent->children[ sibling->parent->children[1] == parent ] = sibling;
+	} else {
+		sv_worldRoot = sibling;
+	}
+
+	SV_FreeWorldNode( parent );
+	SV_RefitWorldTree( sibling->parent );
+}
+
+
+/*
+===============
+SV_LinkWorldLeaf
+
+Nothing changes while the new box stays inside the leaf box
+===============
+*/
+static void SV_LinkWorldLeaf( svEntity_t *ent, const vec3_t absmin, const vec3_t absmax ) {
+	worldNode_t	*leaf;
+	int			i;
+
+	leaf = ent->worldNode;
+	if ( leaf ) {
+		if ( absmin[0] >= leaf->mins[0] && absmin[1] >= leaf->mins[1] && absmin[2] >= leaf->mins[2]
+			&& absmax[0] <= leaf->maxs[0] && absmax[1] <= leaf->maxs[1] && absmax[2] <= leaf->maxs[2] ) {
+			return;
+		}
+		SV_RemoveWorldLeaf( leaf );
+	} else {
+		leaf = SV_AllocWorldNode();
+		leaf->entity = ent;
+		ent->worldNode = leaf;
+		sv_numWorldLeafs++;
+	}
+
+	for ( i = 0 ; i < 3 ; i++ ) {
+		leaf->mins[i] = absmin[i] - WORLD_MARGIN;
+		leaf->maxs[i] = absmax[i] + WORLD_MARGIN;
+	}
+
+	SV_InsertWorldLeaf( leaf );
+}
+
+
+/*
+===============
+SV_UnlinkWorldLeaf
+===============
+*/
+static void SV_UnlinkWorldLeaf( svEntity_t *ent ) {
+	SV_RemoveWorldLeaf( ent->worldNode );
+	SV_FreeWorldNode( ent->worldNode );
+	ent->worldNode = NULL;
+	sv_numWorldLeafs--;
+}
+
+
+/*
+===============
+SV_ClearWorldTree
+===============
+*/
+static void SV_ClearWorldTree( void ) {
+	int		i;
+
+	Com_Memset( sv_worldNodes, 0, sizeof( sv_worldNodes ) );
+	sv_worldFreeNodes = NULL;
+	for ( i = WORLD_NODES - 1 ; i >= 0 ; i-- ) {
+		SV_FreeWorldNode( &sv_worldNodes[i] );
+	}
+
+	sv_worldRoot = NULL;
+	sv_numWorldLeafs = 0;
+}
+
+/*
+===============
+SV_ClearWorldIndex
+
+===============
+*/
+static void SV_ClearWorldIndex( bool tree ) {
 	clipHandle_t	h;
 	vec3_t			mins, maxs;
 
 	Com_Memset( sv_worldSectors, 0, sizeof(sv_worldSectors) );
 	sv_numworldSectors = 0;
 
+	sv_worldTree = tree;
+	SV_ClearWorldTree();
+
 	// get world map bounds
 	h = CM_InlineModel( 0 );
 	CM_ModelBounds( h, mins, maxs );
@@ -158,6 +501,17 @@ void SV_ClearWorld( void ) {
 }
 
 
+/*
+===============
+SV_ClearWorld
+
+===============
+*/
+void SV_ClearWorld( void ) {
+	SV_ClearWorldIndex( sv_worldIndex->integer ? true : false );
+}
+
+
 /*
 ===============
 SV_UnlinkEntity
@@ -173,6 +527,11 @@ void SV_UnlinkEntity( sharedEntity_t *gEnt ) {
 
 	gEnt->r.linked = false;
 
+	if ( ent->worldNode ) {
+		SV_UnlinkWorldLeaf( ent );
+		return;
+	}
+
 	ws = ent->worldSector;
 	if ( !ws ) {
 		return;		// not linked in anywhere
@@ -291,6 +650,9 @@ void SV_LinkEntity( sharedEntity_t *gEnt ) {
 	// if none of the leafs were inside the map, the
 	// entity is outside the world and can be considered unlinked
 	if ( !num_leafs ) {
+		if ( ent->worldNode ) {
+			SV_UnlinkEntity( gEnt );
+		}
 		return;
 	}
 
@@ -332,6 +694,13 @@ void SV_LinkEntity( sharedEntity_t *gEnt ) {
 
 	gEnt->r.linkcount++;
 
+	if ( sv_worldTree ) {
+		// the old leaf is kept if the entity hasn't moved far
+		SV_LinkWorldLeaf( ent, gEnt->r.absmin, gEnt->r.absmax );
+		gEnt->r.linked = true;
+		return;
+	}
+
 	// find the first world sector node that the ent's box crosses
 	node = sv_worldSectors;
 	while (1)
@@ -418,6 +787,53 @@ static void SV_AreaEntities_r( worldSector_t *node, areaParms_t *ap ) {
 	}
 }
 
+
+/*
+====================
+SV_AreaEntitiesTree_r
+
+Marks the entities found in the dynamic tree
+====================
+*/
+static void SV_AreaEntitiesTree_r( const worldNode_t *node, const areaParms_t *ap, uint32_t *touched ) {
+	const sharedEntity_t *gcheck;
+	int		num;
+
+	for ( ;; ) {
+		if ( node->mins[0] > ap->maxs[0]
+		|| node->mins[1] > ap->maxs[1]
+		|| node->mins[2] > ap->maxs[2]
+		|| node->maxs[0] < ap->mins[0]
+		|| node->maxs[1] < ap->mins[1]
+		|| node->maxs[2] < ap->mins[2]) {
+			return;
+		}
+
+		if ( !node->children[0] ) {
+			break;
+		}
+
+		SV_AreaEntitiesTree_r( node->children[0], ap, touched );
+		node = node->children[1];
+	}
+
+	// leaf boxes have a margin, check the entity itself
+	gcheck = SV_GEntityForSvEntity( node->entity );
+
+	if ( gcheck->r.absmin[0] > ap->maxs[0]
+	|| gcheck->r.absmin[1] > ap->maxs[1]
+	|| gcheck->r.absmin[2] > ap->maxs[2]
+	|| gcheck->r.absmax[0] < ap->mins[0]
+	|| gcheck->r.absmax[1] < ap->mins[1]
+	|| gcheck->r.absmax[2] < ap->mins[2]) {
+		return;
+	}
+
+	num = node->entity - sv.svEntities;
+	touched[ num >> 5 ] |= 1u << ( num & 31 );
+}
+
+
 /*
 ================
 SV_AreaEntities
@@ -425,6 +841,9 @@ SV_AreaEntities
 */
 int SV_AreaEntities( const vec3_t mins, const vec3_t maxs, int *entityList, int maxcount ) {
 	areaParms_t		ap;
+	uint32_t		touched[MAX_GENTITIES/32];
+	uint32_t		bits;
+	int				i, j;
 
 	ap.mins = mins;
 	ap.maxs = maxs;
@@ -432,7 +851,31 @@ int SV_AreaEntities( const vec3_t mins, const vec3_t maxs, int *entityList, int
 	ap.count = 0;
 	ap.maxcount = maxcount;
 
-	SV_AreaEntities_r( sv_worldSectors, &ap );
+	if ( !sv_worldTree ) {
+		SV_AreaEntities_r( sv_worldSectors, &ap );
+		return ap.count;
+	}
+
+	if ( !sv_worldRoot ) {
+		return 0;
+	}
+
+	Com_Memset( touched, 0, sizeof( touched ) );
+	SV_AreaEntitiesTree_r( sv_worldRoot, &ap, touched );
+
+	// the list comes out in entity number order whatever the tree looks like
+	for ( i = 0 ; i < MAX_GENTITIES/32 ; i++ ) {
+		for ( bits = touched[i], j = 0 ; bits ; bits >>= 1, j++ ) {
+			if ( !( bits & 1 ) ) {
+				continue;
+			}
+			if ( ap.count == ap.maxcount ) {
+				Com_Printf ("SV_AreaEntities: MAXCOUNT\n");
+				return ap.count;
+			}
+			ap.list[ap.count++] = i * 32 + j;
+		}
+	}
 
 	return ap.count;
 }
@@ -687,3 +1130,255 @@ int SV_PointContents( const vec3_t p, int passEntityNum ) {
 }
 
 
+
+
+/*
+===============================================================================
+
+WORLD BENCHMARK
+
+\worldbench [entities] [frames] [traces] runs the same link, unlink and trace
+load against the sector tree and the dynamic tree on the current map.  Boxes
+the size of players move around in empty space, a few of them are unlinked and
+respawned every frame, then traces and area queries start at random entities.
+
+The game entities are swapped out for the benchmark ones and restored after,
+together with both indexes, so the running game is not disturbed.
+
+===============================================================================
+*/
+
+#define WORLD_BENCH_MOVE	24.0f
+#define WORLD_BENCH_RANGE	1024.0f
+#define WORLD_BENCH_MAX_FRAMES	10000
+#define WORLD_BENCH_MAX_TRACES	4096
+// both result arrays come out of the zone, keep them to a few megabytes
+#define WORLD_BENCH_MAX_SAMPLES	( 256 * 1024 )
+
+typedef struct {
+	float		fraction;
+	int			entityNum;
+	int			areaCount;
+} worldBenchResult_t;
+
+typedef struct {
+	int64_t		linkUsec;
+	int64_t		traceUsec;
+	int64_t		areaUsec;
+} worldBenchTimes_t;
+
+
+/*
+===============
+SV_WorldBenchSpot
+
+Picks a point that is not inside world brushes, gives up after a few tries
+===============
+*/
+static void SV_WorldBenchSpot( vec3_t origin, const vec3_t mins, const vec3_t maxs, int *seed ) {
+	int		i, tries;
+
+	for ( tries = 0 ; tries < 16 ; tries++ ) {
+		for ( i = 0 ; i < 3 ; i++ ) {
+			origin[i] = mins[i] + Q_random( seed ) * ( maxs[i] - mins[i] );
+		}
+		if ( !( CM_PointContents( origin, 0 ) & CONTENTS_SOLID ) ) {
+			return;
+		}
+	}
+}
+
+
+/*
+===============
+SV_WorldBenchRun
+===============
+*/
+static void SV_WorldBenchRun( sharedEntity_t *ents, int numEntities, int frames, int traces, bool tree, worldBenchResult_t *results, worldBenchTimes_t *times ) {
+	static const vec3_t	boxMins = { -15, -15, -24 };
+	static const vec3_t	boxMaxs = { 15, 15, 32 };
+	int				touch[MAX_GENTITIES];
+	vec3_t			worldMins, worldMaxs;
+	vec3_t			end, mins, maxs;
+	sharedEntity_t	*ent;
+	trace_t			trace;
+	int64_t			start;
+	int				seed;
+	int				frame, i, j;
+
+	CM_ModelBounds( CM_InlineModel( 0 ), worldMins, worldMaxs );
+
+	Com_Memset( sv.svEntities, 0, sizeof( sv.svEntities ) );
+	Com_Memset( ents, 0, numEntities * sizeof( *ents ) );
+	Com_Memset( times, 0, sizeof( *times ) );
+	SV_ClearWorldIndex( tree );
+
+	// the same load for both indexes
+	seed = 0x1d;
+	for ( i = 0 ; i < numEntities ; i++ ) {
+		ent = &ents[i];
+		ent->s.number = i;
+		ent->r.contents = CONTENTS_BODY;
+		ent->r.ownerNum = ENTITYNUM_NONE;
+		VectorCopy( boxMins, ent->r.mins );
+		VectorCopy( boxMaxs, ent->r.maxs );
+		SV_WorldBenchSpot( ent->r.currentOrigin, worldMins, worldMaxs, &seed );
+		SV_LinkEntity( ent );
+	}
+
+	for ( frame = 0 ; frame < frames ; frame++ ) {
+		start = Sys_Microseconds();
+		for ( i = 0 ; i < numEntities ; i++ ) {
+			ent = &ents[i];
+			if ( ( Q_rand( &seed ) & 63 ) == 0 ) {
+				// killed and respawned somewhere else
+				SV_UnlinkEntity( ent );
+				SV_WorldBenchSpot( ent->r.currentOrigin, worldMins, worldMaxs, &seed );
+			} else {
+				for ( j = 0 ; j < 3 ; j++ ) {
+					ent->r.currentOrigin[j] += Q_crandom( &seed ) * WORLD_BENCH_MOVE;
+				}
+			}
+			SV_LinkEntity( ent );
+		}
+		times->linkUsec += Sys_Microseconds() - start;
+
+		start = Sys_Microseconds();
+		for ( i = 0 ; i < traces ; i++ ) {
+			ent = &ents[ ( Q_rand( &seed ) & 0x7fffffff ) % numEntities ];
+			for ( j = 0 ; j < 3 ; j++ ) {
+				end[j] = ent->r.currentOrigin[j] + Q_crandom( &seed ) * WORLD_BENCH_RANGE;
+			}
+			SV_Trace( &trace, ent->r.currentOrigin, boxMins, boxMaxs, end, ent->s.number, CONTENTS_SOLID | CONTENTS_BODY, false );
+			results[ frame * traces + i ].fraction = trace.fraction;
+			results[ frame * traces + i ].entityNum = trace.entityNum;
+		}
+		times->traceUsec += Sys_Microseconds() - start;
+
+		start = Sys_Microseconds();
+		for ( i = 0 ; i < traces ; i++ ) {
+			ent = &ents[ ( frame * traces + i ) % numEntities ];
+			for ( j = 0 ; j < 3 ; j++ ) {
+				mins[j] = ent->r.currentOrigin[j] - WORLD_BENCH_RANGE / 4;
+				maxs[j] = ent->r.currentOrigin[j] + WORLD_BENCH_RANGE / 4;
+			}
+			results[ frame * traces + i ].areaCount = SV_AreaEntities( mins, maxs, touch, MAX_GENTITIES );
+		}
+		times->areaUsec += Sys_Microseconds() - start;
+	}
+}
+
+
+/*
+===============
+SV_WorldBench_f
+===============
+*/
+void SV_WorldBench_f( void ) {
+	static const char *names[2] = { "sector tree", "dynamic tree" };
+	worldBenchResult_t	*results[2];
+	worldBenchTimes_t	times[2];
+	sharedEntity_t	*ents;
+	svEntity_t		*savedEntities;
+	worldSector_t	*savedSectors;
+	worldNode_t		*savedNodes;
+	worldNode_t		*savedFreeNodes, *savedRoot;
+	sharedEntity_t	*savedGentities;
+	int				savedGentitySize, savedNumEntities;
+	int				savedNumSectors, savedNumLeafs;
+	bool			savedTree;
+	int				numEntities, frames, traces, height;
+	int				fractions, hits, areas;
+	int				i;
+
+	if ( !com_sv_running->integer || sv.state != SS_GAME ) {
+		Com_Printf( "Server is not running.\n" );
+		return;
+	}
+
+	numEntities = Cmd_Argc() > 1 ? atoi( Cmd_Argv( 1 ) ) : 512;
+	frames = Cmd_Argc() > 2 ? atoi( Cmd_Argv( 2 ) ) : 100;
+	traces = Cmd_Argc() > 3 ? atoi( Cmd_Argv( 3 ) ) : 256;
+	// the last entity numbers stand for the world and for nothing
+	numEntities = MAX( 1, MIN( numEntities, MAX_GENTITIES - 2 ) );
+	frames = MAX( 1, MIN( frames, WORLD_BENCH_MAX_FRAMES ) );
+	traces = MAX( 1, MIN( traces, WORLD_BENCH_MAX_TRACES ) );
+	if ( (int64_t)frames * traces > WORLD_BENCH_MAX_SAMPLES ) {
+		Com_Printf( "%i frames of %i traces is too many, keep frames * traces within %i.\n",
+			frames, traces, WORLD_BENCH_MAX_SAMPLES );
+		return;
+	}
+
+	ents = Z_Malloc( numEntities * sizeof( *ents ) );
+	results[0] = Z_Malloc( frames * traces * sizeof( *results[0] ) );
+	results[1] = Z_Malloc( frames * traces * sizeof( *results[1] ) );
+
+	savedEntities = Z_Malloc( sizeof( sv.svEntities ) );
+	savedSectors = Z_Malloc( sizeof( sv_worldSectors ) );
+	savedNodes = Z_Malloc( sizeof( sv_worldNodes ) );
+	Com_Memcpy( savedEntities, sv.svEntities, sizeof( sv.svEntities ) );
+	Com_Memcpy( savedSectors, sv_worldSectors, sizeof( sv_worldSectors ) );
+	Com_Memcpy( savedNodes, sv_worldNodes, sizeof( sv_worldNodes ) );
+	savedNumSectors = sv_numworldSectors;
+	savedFreeNodes = sv_worldFreeNodes;
+	savedRoot = sv_worldRoot;
+	savedNumLeafs = sv_numWorldLeafs;
+	savedTree = sv_worldTree;
+	savedGentities = sv.gentities;
+	savedGentitySize = sv.gentitySize;
+	savedNumEntities = sv.num_entities;
+
+	sv.gentities = ents;
+	sv.gentitySize = sizeof( *ents );
+	sv.num_entities = numEntities;
+
+	height = 0;
+	for ( i = 0 ; i < 2 ; i++ ) {
+		SV_WorldBenchRun( ents, numEntities, frames, traces, i != 0, results[i], &times[i] );
+		if ( sv_worldRoot ) {
+			height = sv_worldRoot->height;
+		}
+	}
+
+	// the game never saw any of this
+	sv.gentities = savedGentities;
+	sv.gentitySize = savedGentitySize;
+	sv.num_entities = savedNumEntities;
+	Com_Memcpy( sv.svEntities, savedEntities, sizeof( sv.svEntities ) );
+	Com_Memcpy( sv_worldSectors, savedSectors, sizeof( sv_worldSectors ) );
+	Com_Memcpy( sv_worldNodes, savedNodes, sizeof( sv_worldNodes ) );
+	sv_numworldSectors = savedNumSectors;
+	sv_worldFreeNodes = savedFreeNodes;
+	sv_worldRoot = savedRoot;
+	sv_numWorldLeafs = savedNumLeafs;
+	sv_worldTree = savedTree;
+
+	fractions = hits = areas = 0;
+	for ( i = 0 ; i < frames * traces ; i++ ) {
+		if ( results[0][i].fraction != results[1][i].fraction ) {
+			fractions++;
+		} else if ( results[0][i].entityNum != results[1][i].entityNum ) {
+			hits++;
+		}
+		if ( results[0][i].areaCount != results[1][i].areaCount ) {
+			areas++;
+		}
+	}
+
+	Com_Printf( "%i entities, %i frames, %i traces and area queries per frame, tree height %i\n",
+		numEntities, frames, traces, height );
+	Com_Printf( "               link msec  trace msec  area msec\n" );
+	for ( i = 0 ; i < 2 ; i++ ) {
+		Com_Printf( "%-13s %10.2f  %10.2f  %9.2f\n", names[i],
+			times[i].linkUsec / 1000.0, times[i].traceUsec / 1000.0, times[i].areaUsec / 1000.0 );
+	}
+	Com_Printf( "%i traces differ in fraction, %i only in the entity hit at the same fraction, %i area queries in count\n",
+		fractions, hits, areas );
+
+	Z_Free( savedNodes );
+	Z_Free( savedSectors );
+	Z_Free( savedEntities );
+	Z_Free( results[1] );
+	Z_Free( results[0] );
+	Z_Free( ents );
+}